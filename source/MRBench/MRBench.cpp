@@ -0,0 +1,594 @@
+#include "MRMesh/MRMesh.h"
+#include "MRMesh/MRAABBTree.h"
+#include "MRMesh/MRBox.h"
+#include "MRMesh/MRMakeSphereMesh.h"
+#include "MRMesh/MRTorus.h"
+#include "MRMesh/MRRegularGridMesh.h"
+#include "MRMesh/MRMeshBoolean.h"
+#include "MRMesh/MRMeshDecimate.h"
+#include "MRMesh/MRMeshProject.h"
+#include "MRMesh/MRMeshToDistanceVolume.h"
+#include "MRMesh/MRMarchingCubes.h"
+#include "MRMesh/MROffset.h"
+#include "MRMesh/MRMeshLoad.h"
+#include "MRMesh/MRMeshSave.h"
+#include "MRMesh/MRParallelFor.h"
+#include "MRMesh/MRSystem.h"
+#include "MRMesh/MRStringConvert.h"
+#include "MRPch/MRJson.h"
+#include "MRPch/MRTBB.h"
+#pragma warning(push)
+#if _MSC_VER >= 1937 // Visual Studio 2022 version 17.7
+#pragma warning(disable: 5267) //definition of implicit copy constructor is deprecated because it has a user-provided destructor
+#endif
+#include <boost/program_options.hpp>
+#pragma warning(pop)
+#include <boost/exception/diagnostic_information.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+using namespace MR;
+
+/// returns the maximal resident set size of this process since its start (or since last resetPeakRss)
+size_t getPeakRss()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof( pmc ) ) )
+        return pmc.PeakWorkingSetSize;
+    return 0;
+#elif defined(__linux__)
+    // VmHWM can be reset in contrast to ru_maxrss
+    std::ifstream in( "/proc/self/status" );
+    std::string line;
+    while ( std::getline( in, line ) )
+    {
+        if ( line.rfind( "VmHWM:", 0 ) == 0 )
+            return size_t( std::stoull( line.substr( 6 ) ) ) * 1024;
+    }
+    return 0;
+#else
+    rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+        return 0;
+    return size_t( usage.ru_maxrss ); // in bytes on macOS
+#endif
+}
+
+/// tries to make the next getPeakRss() call return the memory consumption from now on
+void resetPeakRss()
+{
+#if defined(__linux__)
+    std::ofstream out( "/proc/self/clear_refs" );
+    out << "5";
+#endif
+}
+
+struct BenchShape
+{
+    std::string name;
+    /// whether the shape has no boundary (required for volume-based benchmarks)
+    bool closed = true;
+    Mesh mesh;
+};
+
+/// sphere with regular triangulation having approximately given number of triangles
+Mesh makeBenchSphere( size_t numTris )
+{
+    const int res = std::max( 4, int( std::sqrt( numTris / 4.0 ) ) );
+    return makeUVSphere( 1.0f, 2 * res, res );
+}
+
+/// torus with approximately given number of triangles
+Mesh makeBenchTorus( size_t numTris )
+{
+    const int res = std::max( 4, int( std::sqrt( numTris / 4.0 ) ) );
+    return makeTorus( 1.0f, 0.3f, 2 * res, res );
+}
+
+/// open height field with smooth hills and random noise having approximately given number of triangles
+Mesh makeBenchTerrain( size_t numTris )
+{
+    const size_t res = std::max( size_t( 4 ), size_t( std::sqrt( numTris / 2.0 ) ) + 1 );
+    const float step = 2.0f / res;
+    std::vector<float> noise( res * res );
+    std::mt19937 gen( 0 );
+    std::normal_distribution<float> dist( 0.0f, 0.1f * step );
+    for ( auto & n : noise )
+        n = dist( gen );
+
+    auto mesh = makeRegularGridMesh( res, res,
+        []( size_t, size_t ) { return true; },
+        [&]( size_t x, size_t y )
+        {
+            const float fx = x * step - 1.0f;
+            const float fy = y * step - 1.0f;
+            const float z = 0.2f * std::sin( 3 * fx ) * std::cos( 4 * fy ) + 0.05f * std::sin( 17 * fx + 11 * fy );
+            return Vector3f( fx, fy, z + noise[x + y * res] );
+        } );
+    return mesh.has_value() ? std::move( *mesh ) : Mesh{};
+}
+
+BenchShape makeBenchShape( const std::string & name, size_t numTris )
+{
+    BenchShape res;
+    res.name = name;
+    if ( name == "sphere" )
+        res.mesh = makeBenchSphere( numTris );
+    else if ( name == "torus" )
+        res.mesh = makeBenchTorus( numTris );
+    else if ( name == "terrain" )
+    {
+        res.mesh = makeBenchTerrain( numTris );
+        res.closed = false;
+    }
+    else
+        throw std::invalid_argument( "unknown shape: " + name );
+    return res;
+}
+
+/// the result of one benchmark execution
+struct BenchSample
+{
+    /// duration of the timed part only
+    double seconds = 0;
+    /// the number of processed items (triangles, queries), used to compute throughput
+    double items = 0;
+    /// the amount of heap memory occupied by the produced data structure
+    size_t heapBytes = 0;
+};
+
+using BenchFunc = std::function<std::optional<BenchSample>( const BenchShape & shape )>;
+
+struct Benchmark
+{
+    std::string name;
+    /// the units of BenchSample::items
+    std::string itemName;
+    BenchFunc func;
+};
+
+class BenchTimer
+{
+public:
+    BenchTimer() : start_( std::chrono::steady_clock::now() ) {}
+    double seconds() const { return std::chrono::duration<double>( std::chrono::steady_clock::now() - start_ ).count(); }
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+/// voxel size to get approximately the same number of triangles after marching cubes as in the given mesh
+float benchVoxelSize( const Mesh & mesh )
+{
+    const auto numTris = std::max( 1, mesh.topology.numValidFaces() );
+    return float( std::sqrt( mesh.area() / ( 0.5 * numTris ) ) );
+}
+
+std::vector<Benchmark> makeBenchmarks( const std::filesystem::path & tmpDir )
+{
+    std::vector<Benchmark> res;
+
+    res.push_back( { "aabbTree", "triangles", []( const BenchShape & shape ) -> std::optional<BenchSample>
+    {
+        BenchTimer t;
+        AABBTree tree( shape.mesh );
+        BenchSample s;
+        s.seconds = t.seconds();
+        s.items = shape.mesh.topology.numValidFaces();
+        s.heapBytes = tree.heapBytes();
+        return s;
+    } } );
+
+    res.push_back( { "findProjection", "queries", []( const BenchShape & shape ) -> std::optional<BenchSample>
+    {
+        const auto & mesh = shape.mesh;
+        mesh.getAABBTree(); // tree construction is measured separately
+        auto box = mesh.computeBoundingBox();
+        box.include( box.min - 0.1f * box.size() );
+        box.include( box.max + 0.1f * box.size() );
+        std::vector<Vector3f> queries( 1000000 );
+        std::mt19937 gen( 0 );
+        std::uniform_real_distribution<float> dx( box.min.x, box.max.x ), dy( box.min.y, box.max.y ), dz( box.min.z, box.max.z );
+        for ( auto & q : queries )
+            q = Vector3f( dx( gen ), dy( gen ), dz( gen ) );
+        std::vector<float> distSq( queries.size() );
+
+        BenchTimer t;
+        ParallelFor( queries, [&]( size_t i )
+        {
+            distSq[i] = findProjection( queries[i], mesh ).distSq;
+        } );
+        BenchSample s;
+        s.seconds = t.seconds();
+        s.items = double( queries.size() );
+        s.heapBytes = mesh.getAABBTree().heapBytes();
+        return s;
+    } } );
+
+    res.push_back( { "decimateMesh", "triangles", []( const BenchShape & shape ) -> std::optional<BenchSample>
+    {
+        Mesh mesh = shape.mesh;
+        DecimateSettings settings;
+        settings.strategy = DecimateStrategy::MinimizeError;
+        settings.maxError = FLT_MAX;
+        settings.maxDeletedFaces = mesh.topology.numValidFaces() / 2;
+        settings.touchBdVertices = false;
+        // parallel mode, otherwise the thread scaling is flat
+        settings.subdivideParts = 64;
+
+        BenchTimer t;
+        decimateMesh( mesh, settings );
+        BenchSample s;
+        s.seconds = t.seconds();
+        s.items = shape.mesh.topology.numValidFaces();
+        s.heapBytes = mesh.heapBytes();
+        return s;
+    } } );
+
+    res.push_back( { "decimateMeshIndependentSets", "triangles", []( const BenchShape & shape ) -> std::optional<BenchSample>
+    {
+        Mesh mesh = shape.mesh;
+        DecimateSettings settings;
+        settings.strategy = DecimateStrategy::MinimizeError;
+        settings.maxError = FLT_MAX;
+        settings.maxDeletedFaces = mesh.topology.numValidFaces() / 2;
+        settings.touchBdVertices = false;
+        settings.independentSets = true;
+
+        BenchTimer t;
+        decimateMesh( mesh, settings );
+        BenchSample s;
+        s.seconds = t.seconds();
+        s.items = shape.mesh.topology.numValidFaces();
+        s.heapBytes = mesh.heapBytes();
+        return s;
+    } } );
+
+    res.push_back( { "boolean", "triangles", []( const BenchShape & shape ) -> std::optional<BenchSample>
+    {
+        if ( !shape.closed )
+            return {};
+        const auto & mesh = shape.mesh;
+        // shifted and slightly rotated copy to avoid degenerate coplanar intersections
+        const auto box = mesh.computeBoundingBox();
+        const AffineXf3f rigidB2A( Matrix3f::rotation( Vector3f( 1, 1, 1 ).normalized(), 0.3f ), 0.27f * box.size() );
+
+        BenchTimer t;
+        auto r = boolean( mesh, mesh, BooleanOperation::Union, &rigidB2A );
+        BenchSample s;
+        s.seconds = t.seconds();
+        if ( !r.valid() )
+            throw std::runtime_error( "boolean failed: " + r.errorString );
+        s.items = 2.0 * mesh.topology.numValidFaces();
+        s.heapBytes = r.mesh.heapBytes();
+        return s;
+    } } );
+
+    res.push_back( { "marchingCubes", "voxels", []( const BenchShape & shape ) -> std::optional<BenchSample>
+    {
+        if ( !shape.closed )
+            return {};
+        const auto & mesh = shape.mesh;
+        const float voxelSize = benchVoxelSize( mesh );
+        auto box = mesh.computeBoundingBox();
+        box.include( box.min - Vector3f::diagonal( 2 * voxelSize ) );
+        box.include( box.max + Vector3f::diagonal( 2 * voxelSize ) );
+        MeshToDistanceVolumeParams vparams;
+        vparams.origin = box.min;
+        vparams.voxelSize = Vector3f::diagonal( voxelSize );
+        vparams.dimensions = Vector3i( box.size() / voxelSize ) + Vector3i::diagonal( 1 );
+        vparams.maxDistSq = sqr( 2 * voxelSize );
+        vparams.signMode = SignDetectionMode::ProjectionNormal;
+        auto vol = meshToDistanceVolume( mesh, vparams ); // not measured
+        if ( !vol )
+            throw std::runtime_error( vol.error() );
+
+        MarchingCubesParams mparams;
+        mparams.origin = box.min;
+        mparams.lessInside = true;
+        BenchTimer t;
+        auto r = marchingCubes( *vol, mparams );
+        BenchSample s;
+        s.seconds = t.seconds();
+        if ( !r )
+            throw std::runtime_error( r.error() );
+        s.items = double( vol->data.size() );
+        s.heapBytes = r->heapBytes() + vol->heapBytes();
+        return s;
+    } } );
+
+    res.push_back( { "mcOffsetMesh", "triangles", []( const BenchShape & shape ) -> std::optional<BenchSample>
+    {
+        if ( !shape.closed )
+            return {};
+        OffsetParameters params;
+        params.voxelSize = benchVoxelSize( shape.mesh );
+        params.signDetectionMode = SignDetectionMode::ProjectionNormal;
+
+        BenchTimer t;
+        auto r = mcOffsetMesh( shape.mesh, 3 * params.voxelSize, params );
+        BenchSample s;
+        s.seconds = t.seconds();
+        if ( !r )
+            throw std::runtime_error( r.error() );
+        s.items = shape.mesh.topology.numValidFaces();
+        s.heapBytes = r->heapBytes();
+        return s;
+    } } );
+
+#ifndef MRMESH_NO_OPENVDB
+    res.push_back( { "mcOffsetMesh.vdb", "triangles", []( const BenchShape & shape ) -> std::optional<BenchSample>
+    {
+        if ( !shape.closed )
+            return {};
+        OffsetParameters params;
+        params.voxelSize = benchVoxelSize( shape.mesh );
+        params.signDetectionMode = SignDetectionMode::OpenVDB;
+
+        BenchTimer t;
+        auto r = mcOffsetMesh( shape.mesh, 3 * params.voxelSize, params );
+        BenchSample s;
+        s.seconds = t.seconds();
+        if ( !r )
+            throw std::runtime_error( r.error() );
+        s.items = shape.mesh.topology.numValidFaces();
+        s.heapBytes = r->heapBytes();
+        return s;
+    } } );
+
+    res.push_back( { "offsetMesh", "triangles", []( const BenchShape & shape ) -> std::optional<BenchSample>
+    {
+        if ( !shape.closed )
+            return {};
+        OffsetParameters params;
+        params.voxelSize = benchVoxelSize( shape.mesh );
+
+        BenchTimer t;
+        auto r = offsetMesh( shape.mesh, 3 * params.voxelSize, params );
+        BenchSample s;
+        s.seconds = t.seconds();
+        if ( !r )
+            throw std::runtime_error( r.error() );
+        s.items = shape.mesh.topology.numValidFaces();
+        s.heapBytes = r->heapBytes();
+        return s;
+    } } );
+#endif
+
+    for ( const char * ext : { ".mrmesh", ".stl", ".ply" } )
+    {
+        res.push_back( { std::string( "meshLoad" ) + ext, "triangles", [tmpDir, ext]( const BenchShape & shape ) -> std::optional<BenchSample>
+        {
+            const auto path = tmpDir / ( shape.name + ext );
+            if ( !std::filesystem::exists( path ) )
+            {
+                auto saved = MeshSave::toAnySupportedFormat( shape.mesh, path );
+                if ( !saved )
+                    throw std::runtime_error( saved.error() );
+            }
+
+            BenchTimer t;
+            auto r = MeshLoad::fromAnySupportedFormat( path );
+            BenchSample s;
+            s.seconds = t.seconds();
+            if ( !r )
+                throw std::runtime_error( r.error() );
+            s.items = shape.mesh.topology.numValidFaces();
+            s.heapBytes = r->heapBytes();
+            return s;
+        } } );
+    }
+
+    return res;
+}
+
+/// 1, 2, 4, ..., maxThreads
+std::vector<int> threadCounts( int maxThreads )
+{
+    std::vector<int> res;
+    for ( int t = 1; t < maxThreads; t *= 2 )
+        res.push_back( t );
+    res.push_back( maxThreads );
+    return res;
+}
+
+struct BenchOptions
+{
+    std::vector<size_t> triangles;
+    std::vector<std::string> shapes;
+    std::vector<std::string> benchmarks;
+    int maxThreads = 1;
+    bool scaling = true;
+    int repeats = 3;
+    std::filesystem::path output;
+};
+
+Json::Value runBenchmarks( const BenchOptions & opts, const std::filesystem::path & tmpDir )
+{
+    Json::Value root;
+    root["meshlibVersion"] = GetMRVersionString();
+    root["cpu"] = GetCpuId();
+    root["os"] = GetDetailedOSName();
+    root["hardwareThreads"] = int( std::thread::hardware_concurrency() );
+    root["repeats"] = opts.repeats;
+    auto & results = root["results"] = Json::arrayValue;
+
+    const auto benchmarks = makeBenchmarks( tmpDir );
+    const auto threads = opts.scaling ? threadCounts( opts.maxThreads ) : std::vector<int>{ opts.maxThreads };
+    for ( auto numTris : opts.triangles )
+    {
+        for ( const auto & shapeName : opts.shapes )
+        {
+            std::cerr << "generating " << shapeName << " with ~" << numTris << " triangles..." << std::endl;
+            const auto shape = makeBenchShape( shapeName, numTris );
+            const auto actualTris = shape.mesh.topology.numValidFaces();
+            for ( const auto & bench : benchmarks )
+            {
+                if ( !opts.benchmarks.empty() && std::find( opts.benchmarks.begin(), opts.benchmarks.end(), bench.name ) == opts.benchmarks.end() )
+                    continue;
+
+                double singleThreadSeconds = 0;
+                for ( int t : threads )
+                {
+                    tbb::global_control control( tbb::global_control::max_allowed_parallelism, t );
+                    std::cerr << "  " << bench.name << " on " << t << " thread(s)..." << std::flush;
+                    resetPeakRss();
+
+                    std::vector<BenchSample> samples;
+                    for ( int i = 0; i < opts.repeats; ++i )
+                    {
+                        auto s = bench.func( shape );
+                        if ( !s )
+                            break;
+                        samples.push_back( *s );
+                    }
+                    if ( samples.empty() )
+                    {
+                        std::cerr << " not applicable" << std::endl;
+                        break;
+                    }
+
+                    double minSeconds = DBL_MAX, sumSeconds = 0;
+                    size_t heapBytes = 0;
+                    for ( const auto & s : samples )
+                    {
+                        minSeconds = std::min( minSeconds, s.seconds );
+                        sumSeconds += s.seconds;
+                        heapBytes = std::max( heapBytes, s.heapBytes );
+                    }
+                    if ( t == 1 )
+                        singleThreadSeconds = minSeconds;
+                    std::cerr << " " << minSeconds << "s" << std::endl;
+
+                    Json::Value r;
+                    r["benchmark"] = bench.name;
+                    r["shape"] = shape.name;
+                    r["triangles"] = actualTris;
+                    r["threads"] = t;
+                    r["minSeconds"] = minSeconds;
+                    r["meanSeconds"] = sumSeconds / samples.size();
+                    r["throughput"] = minSeconds > 0 ? samples.front().items / minSeconds : 0.0;
+                    r["throughputUnit"] = bench.itemName + "/s";
+                    if ( singleThreadSeconds > 0 )
+                        r["speedup"] = singleThreadSeconds / minSeconds;
+                    r["heapBytes"] = Json::UInt64( heapBytes );
+                    r["peakRssBytes"] = Json::UInt64( getPeakRss() );
+                    results.append( std::move( r ) );
+                }
+            }
+        }
+    }
+    return root;
+}
+
+// can throw
+int mainInternal( int argc, char **argv )
+{
+    BenchOptions opts;
+    namespace po = boost::program_options;
+    po::options_description options( "Available options" );
+    options.add_options()
+        ( "help", "produce help message" )
+        ( "triangles", po::value<std::vector<size_t>>( &opts.triangles )->multitoken(), "approximate triangle counts of generated meshes (default: 100000 1000000)" )
+        ( "shapes", po::value<std::vector<std::string>>( &opts.shapes )->multitoken(), "generated shapes among: sphere torus terrain (default: all)" )
+        ( "benchmarks", po::value<std::vector<std::string>>( &opts.benchmarks )->multitoken(), "names of benchmarks to run (default: all)" )
+        ( "list", "print names of all benchmarks and exit" )
+        ( "threads", po::value<int>( &opts.maxThreads ), "maximal number of TBB threads (default: hardware concurrency)" )
+        ( "no-scaling", "run with maximal number of threads only instead of 1, 2, 4, ... threads" )
+        ( "repeats", po::value<int>( &opts.repeats ), "number of runs of each benchmark, the fastest one is reported" )
+        ( "output", po::value<std::filesystem::path>( &opts.output ), "JSON file to write results into (default: standard output)" )
+        ;
+
+    po::variables_map vm;
+    po::store( po::parse_command_line( argc, argv, options ), vm );
+    po::notify( vm );
+
+    if ( vm.count( "help" ) )
+    {
+        std::cerr <<
+            "MRBench measures performance of MeshLib algorithms on generated meshes\n"
+            "Usage: MRBench [options]\n"
+            << options << "\n";
+        return 0;
+    }
+
+    const auto tmpDir = GetTempDirectory() / ( "MRBench_" + std::to_string( std::chrono::system_clock::now().time_since_epoch().count() ) );
+    if ( vm.count( "list" ) )
+    {
+        for ( const auto & b : makeBenchmarks( tmpDir ) )
+            std::cout << b.name << "\n";
+        return 0;
+    }
+
+    if ( opts.triangles.empty() )
+        opts.triangles = { 100000, 1000000 };
+    if ( opts.shapes.empty() )
+        opts.shapes = { "sphere", "torus", "terrain" };
+    if ( !vm.count( "threads" ) || opts.maxThreads <= 0 )
+        opts.maxThreads = std::max( 1, int( std::thread::hardware_concurrency() ) );
+    opts.scaling = !vm.count( "no-scaling" );
+    opts.repeats = std::max( 1, opts.repeats );
+
+    std::filesystem::create_directories( tmpDir );
+    Json::Value root;
+    try
+    {
+        root = runBenchmarks( opts, tmpDir );
+    }
+    catch ( ... )
+    {
+        std::error_code ec;
+        std::filesystem::remove_all( tmpDir, ec );
+        throw;
+    }
+    std::error_code ec;
+    std::filesystem::remove_all( tmpDir, ec );
+
+    Json::StreamWriterBuilder builder;
+    std::unique_ptr<Json::StreamWriter> writer{ builder.newStreamWriter() };
+    if ( opts.output.empty() )
+    {
+        writer->write( root, &std::cout );
+        std::cout << std::endl;
+    }
+    else
+    {
+        std::ofstream out( opts.output );
+        if ( !out || writer->write( root, &out ) != 0 )
+        {
+            std::cerr << "Cannot write file " << utf8string( opts.output ) << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+} //anonymous namespace
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        return mainInternal( argc, argv );
+    }
+    catch ( ... )
+    {
+        std::cerr << "Exception: " << boost::current_exception_diagnostic_information();
+        return 2;
+    }
+}
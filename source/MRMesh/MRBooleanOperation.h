@@ -95,6 +95,10 @@ struct BooleanInternalParameters
     const Mesh* originalMeshA{ nullptr };
     /// Instance of original mesh with tree for better speed
     const Mesh* originalMeshB{ nullptr };
+    /// Fixed converters float-int-float, if not set they are computed from the boxes of both meshes
+    const CoordinateConverters* converters{ nullptr };
+    /// Integer coordinates of original mesh A computed by given converters, they are used instead of conversion while mesh A is not subdivided
+    const MeshIntCoords* intCoordsA{ nullptr };
 };
 
 /// Perform boolean operation on cut meshes
@@ -6,6 +6,8 @@
 #include "MRBitSetParallelFor.h"
 #include "MRVolumeIndexer.h"
 #include "MRMeshProject.h"
+#include "MROrder.h"
+#include "MRTorus.h"
 
 namespace MR
 {
@@ -226,6 +228,264 @@ size_t FastWindingNumber::fromGridHeapBytes( const Vector3i& ) const
     return 0;
 }
 
+PacketFastWindingNumber::PacketFastWindingNumber( const Mesh & mesh ) : FastWindingNumber( mesh )
+{
+}
+
+void PacketFastWindingNumber::calcPacket( Packet & p, float beta ) const
+{
+    for ( int l = 0; l < PacketSize; ++l )
+        p.w[l] = 0;
+    if ( dipoles_.empty() )
+    {
+        assert( false );
+        return;
+    }
+    if ( !p.valid )
+        return;
+
+    const float betaSq = sqr( beta );
+    struct SubTask
+    {
+        AABBTree::NodeId n;
+        std::uint32_t lanes; // the points of the packet, which have to visit this node
+    };
+    constexpr int MaxStackSize = 32; // to avoid allocations
+    SubTask subtasks[MaxStackSize];
+    int stackSize = 0;
+    subtasks[stackSize++] = { tree_.rootNodeId(), p.valid };
+
+    while( stackSize > 0 )
+    {
+        const auto s = subtasks[--stackSize];
+        const auto & node = tree_[s.n];
+        const auto & d = dipoles_[s.n];
+
+        // the same formulas as in Dipole::goodApprox and Dipole::w, but for all points of the packet at once
+        const auto pos = d.pos();
+        const auto thresholdSq = betaSq * d.rr;
+        float dx[PacketSize], dy[PacketSize], dz[PacketSize], distSq[PacketSize];
+        for ( int l = 0; l < PacketSize; ++l )
+        {
+            dx[l] = pos.x - p.x[l];
+            dy[l] = pos.y - p.y[l];
+            dz[l] = pos.z - p.z[l];
+            distSq[l] = dx[l] * dx[l] + dy[l] * dy[l] + dz[l] * dz[l];
+        }
+        std::uint32_t good = 0;
+        for ( int l = 0; l < PacketSize; ++l )
+            good |= std::uint32_t( distSq[l] > thresholdSq ) << l;
+        good &= s.lanes;
+
+        if ( good )
+        {
+            for ( int l = 0; l < PacketSize; ++l )
+            {
+                const auto dist = std::sqrt( distSq[l] );
+                const auto w = dist > 0 ? INV_4PI * ( dx[l] * d.dirArea.x + dy[l] * d.dirArea.y + dz[l] * d.dirArea.z ) / ( dist * dist * dist ) : 0.0f;
+                p.w[l] += ( good >> l ) & 1 ? w : 0.0f;
+            }
+        }
+
+        const auto rest = s.lanes & ~good;
+        if ( !rest )
+            continue;
+        if ( !node.leaf() )
+        {
+            // recurse deeper only with the points, for which the approximation was not good
+            subtasks[stackSize++] = { node.r, rest }; // to look later
+            subtasks[stackSize++] = { node.l, rest }; // to look first
+            continue;
+        }
+        const auto f = node.leafId();
+        const auto tri = mesh_.getTriPoints( f );
+        for ( int l = 0; l < PacketSize; ++l )
+        {
+            if ( ( ( rest >> l ) & 1 ) && p.skipFace[l] != f )
+                p.w[l] += INV_4PI * triangleSolidAngle( Vector3f( p.x[l], p.y[l], p.z[l] ), tri );
+        }
+    }
+}
+
+void PacketFastWindingNumber::calcFromVector( std::vector<float>& res, const std::vector<Vector3f>& points, float beta, FaceId skipFace )
+{
+    MR_TIMER
+    res.resize( points.size() );
+    // nearby points in one packet descend the tree mostly together
+    const auto order = getMortonOrder( points );
+    const size_t numPackets = ( points.size() + PacketSize - 1 ) / PacketSize;
+    ParallelFor( size_t( 0 ), numPackets, [&]( size_t i )
+    {
+        Packet p;
+        const auto first = i * PacketSize;
+        const int num = int( std::min( points.size() - first, size_t( PacketSize ) ) );
+        for ( int l = 0; l < num; ++l )
+            p.set( l, points[order[first + l]], skipFace );
+        calcPacket( p, beta );
+        for ( int l = 0; l < num; ++l )
+            res[order[first + l]] = p.w[l];
+    } );
+}
+
+bool PacketFastWindingNumber::calcSelfIntersections( FaceBitSet& res, float beta, ProgressCallback cb )
+{
+    MR_TIMER
+    // the faces in the order of tree leaves are spatially coherent
+    std::vector<FaceId> faces;
+    faces.reserve( mesh_.topology.numValidFaces() );
+    for ( const auto & node : tree_.nodes() )
+        if ( node.leaf() )
+            faces.push_back( node.leafId() );
+
+    std::vector<float> windings( faces.size() );
+    const size_t numPackets = ( faces.size() + PacketSize - 1 ) / PacketSize;
+    if ( !ParallelFor( size_t( 0 ), numPackets, [&]( size_t i )
+    {
+        Packet p;
+        const auto first = i * PacketSize;
+        const int num = int( std::min( faces.size() - first, size_t( PacketSize ) ) );
+        for ( int l = 0; l < num; ++l )
+        {
+            const auto f = faces[first + l];
+            p.set( l, mesh_.triCenter( f ), f );
+        }
+        calcPacket( p, beta );
+        for ( int l = 0; l < num; ++l )
+            windings[first + l] = p.w[l];
+    }, cb ) )
+        return false;
+
+    res.clear();
+    res.resize( mesh_.topology.faceSize() );
+    for ( size_t i = 0; i < faces.size(); ++i )
+        if ( windings[i] < 0 || windings[i] > 1 )
+            res.set( faces[i] );
+    return true;
+}
+
+/// calls given function for each 2x2x2 block of voxels
+/// with the packet of up to 8 voxel points and the voxel ids of these points
+template <typename GetPoint, typename F>
+static bool forEachVoxelPacket( const Vector3i& dims, GetPoint && getPoint, F && f, ProgressCallback cb )
+{
+    using Packet = PacketFastWindingNumber::Packet;
+    const Vector3i blockDims( ( dims.x + 1 ) / 2, ( dims.y + 1 ) / 2, ( dims.z + 1 ) / 2 );
+    const size_t numBlocks = size_t( blockDims.x ) * blockDims.y * blockDims.z;
+    VolumeIndexer indexer( dims );
+    VolumeIndexer blockIndexer( blockDims );
+    return ParallelFor( size_t( 0 ), numBlocks, [&]( size_t b )
+    {
+        const auto blockPos = blockIndexer.toPos( VoxelId( b ) );
+        Packet p;
+        VoxelId ids[PacketFastWindingNumber::PacketSize];
+        for ( int l = 0; l < PacketFastWindingNumber::PacketSize; ++l )
+        {
+            const auto pos = 2 * blockPos + Vector3i( l & 1, ( l >> 1 ) & 1, l >> 2 );
+            if ( pos.x >= dims.x || pos.y >= dims.y || pos.z >= dims.z )
+                continue;
+            ids[l] = indexer.toVoxelId( pos );
+            p.set( l, getPoint( pos ) );
+        }
+        f( p, ids );
+    }, cb );
+}
+
+VoidOrErrStr PacketFastWindingNumber::calcFromGrid( std::vector<float>& res, const Vector3i& dims, const Vector3f& minCoord, const Vector3f& voxelSize, const AffineXf3f& gridToMeshXf, float beta, ProgressCallback cb )
+{
+    MR_TIMER
+
+    res.resize( size_t( dims.x ) * dims.y * dims.z );
+    auto getPoint = [&]( const Vector3i & pos )
+    {
+        auto coord = minCoord;
+        for ( int j = 0; j < 3; ++j )
+            coord[j] += pos[j];
+
+        auto coord3i = Vector3i( int( coord.x ), int( coord.y ), int( coord.z ) );
+        auto pointInSpace = mult( voxelSize, Vector3f( coord3i ) );
+        return gridToMeshXf( pointInSpace );
+    };
+    if ( !forEachVoxelPacket( dims, getPoint, [&]( Packet & p, const VoxelId * ids )
+    {
+        calcPacket( p, beta );
+        for ( int l = 0; l < PacketSize; ++l )
+            if ( ( p.valid >> l ) & 1 )
+                res[ids[l]] = p.w[l];
+    }, cb ) )
+        return unexpectedOperationCanceled();
+    return {};
+}
+
+VoidOrErrStr PacketFastWindingNumber::calcFromGridWithDistances( std::vector<float>& res, const Vector3i& dims, const Vector3f& minCoord, const Vector3f& voxelSize, const AffineXf3f& gridToMeshXf, float beta, float maxDistSq, float minDistSq, ProgressCallback cb )
+{
+    MR_TIMER
+
+    res.resize( size_t( dims.x ) * dims.y * dims.z );
+    auto getPoint = [&]( const Vector3i & pos )
+    {
+        auto coord = minCoord;
+        for ( int j = 0; j < 3; ++j )
+            coord[j] += pos[j];
+        return gridToMeshXf( mult( voxelSize, coord ) );
+    };
+    if ( !forEachVoxelPacket( dims, getPoint, [&]( Packet & p, const VoxelId * ids )
+    {
+        calcPacket( p, beta );
+        for ( int l = 0; l < PacketSize; ++l )
+        {
+            if ( !( ( p.valid >> l ) & 1 ) )
+                continue;
+            const auto sign = p.w[l] > 0.5f ? -1.f : +1.f;
+            res[ids[l]] = sign * std::sqrt( findProjection( Vector3f( p.x[l], p.y[l], p.z[l] ), mesh_, maxDistSq, nullptr, minDistSq ).distSq );
+        }
+    }, cb ) )
+        return unexpectedOperationCanceled();
+    return {};
+}
+
+size_t PacketFastWindingNumber::fromVectorHeapBytes( size_t inputSize ) const
+{
+    // the order of points and temporary buffer for its computation
+    return inputSize * ( 2 * sizeof( size_t ) + sizeof( std::uint64_t ) );
+}
+
+size_t PacketFastWindingNumber::selfIntersectionsHeapBytes( const Mesh& mesh ) const
+{
+    return mesh.topology.numValidFaces() * ( sizeof( FaceId ) + sizeof( float ) );
+}
+
+TEST(MRMesh, PacketFastWindingNumber)
+{
+    const auto torus = makeTorus( 1.0f, 0.3f, 32, 16 );
+    FastWindingNumber fwn( torus );
+    PacketFastWindingNumber pfwn( torus );
+    constexpr float beta = 2;
+
+    std::vector<Vector3f> points;
+    for ( int i = 0; i < 101; ++i )
+        points.emplace_back( -1.5f + 0.03f * i, 0.01f * ( i % 7 ), 0.1f * std::sin( float( i ) ) );
+    std::vector<float> ref, res;
+    fwn.calcFromVector( ref, points, beta );
+    pfwn.calcFromVector( res, points, beta );
+    ASSERT_EQ( ref.size(), res.size() );
+    for ( size_t i = 0; i < ref.size(); ++i )
+        EXPECT_NEAR( ref[i], res[i], 1e-5f );
+
+    const Vector3i dims( 7, 6, 5 );
+    const auto xf = AffineXf3f::translation( Vector3f( -1.5f, -1.5f, -0.5f ) );
+    const auto voxelSize = Vector3f( 0.5f, 0.6f, 0.25f );
+    EXPECT_TRUE( fwn.calcFromGrid( ref, dims, Vector3f{}, voxelSize, xf, beta, {} ).has_value() );
+    EXPECT_TRUE( pfwn.calcFromGrid( res, dims, Vector3f{}, voxelSize, xf, beta, {} ).has_value() );
+    ASSERT_EQ( ref.size(), res.size() );
+    for ( size_t i = 0; i < ref.size(); ++i )
+        EXPECT_NEAR( ref[i], res[i], 1e-5f );
+
+    FaceBitSet refSelf, resSelf;
+    EXPECT_TRUE( fwn.calcSelfIntersections( refSelf, beta, {} ) );
+    EXPECT_TRUE( pfwn.calcSelfIntersections( resSelf, beta, {} ) );
+    EXPECT_EQ( refSelf, resSelf );
+}
+
 TEST(MRMesh, TriangleSolidAngle) 
 {
     const Triangle3f tri =
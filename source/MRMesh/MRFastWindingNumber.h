@@ -4,6 +4,8 @@
 #include "MRProgressCallback.h"
 #include "MRExpected.h"
 #include <array>
+#include <cassert>
+#include <cstdint>
 #include <string>
 
 namespace MR
@@ -176,10 +178,68 @@ public:
     /// <param name="dims">dimensions of original grid</param>
     MRMESH_API virtual size_t fromGridHeapBytes( const Vector3i& dims ) const override;
 
-private:
+protected:
     const Mesh & mesh_;
     const AABBTree & tree_;
     Dipoles dipoles_;
 };
 
+/// the class for fast approximate computation of winding number for a mesh (using its AABB tree),
+/// which processes spatially close query points in packets of 8:
+/// all points of a packet descend the tree together until the dipole approximation becomes good for each of them,
+/// and the computations for all points of the packet are done in vectorizable loops;
+/// the results are the same as from FastWindingNumber up to floating-point rounding
+/// \ingroup AABBTreeGroup
+class [[nodiscard]] PacketFastWindingNumber : public FastWindingNumber
+{
+public:
+    /// constructs this from AABB tree of given mesh;
+    /// this remains valid only if tree is valid
+    [[nodiscard]] MRMESH_API PacketFastWindingNumber( const Mesh & mesh );
+
+    /// calculates winding numbers for a vector of points, which are grouped in packets along Morton curve
+    MRMESH_API void calcFromVector( std::vector<float>& res, const std::vector<Vector3f>& points, float beta, FaceId skipFace = {} ) override;
+    /// calculates winding numbers for all centers of mesh's triangles taken in packets in the order of AABB tree leaves
+    MRMESH_API bool calcSelfIntersections( FaceBitSet& res, float beta, ProgressCallback cb ) override;
+    /// calculates winding numbers for each point in a three-dimensional grid taking 2x2x2 blocks of voxels as packets
+    MRMESH_API VoidOrErrStr calcFromGrid( std::vector<float>& res, const Vector3i& dims, const Vector3f& minCoord, const Vector3f& voxelSize, const AffineXf3f& gridToMeshXf, float beta, ProgressCallback cb ) override;
+    /// calculates distances and winding numbers for each point in a three-dimensional grid taking 2x2x2 blocks of voxels as packets
+    MRMESH_API VoidOrErrStr calcFromGridWithDistances( std::vector<float>& res, const Vector3i& dims, const Vector3f& minCoord, const Vector3f& voxelSize, const AffineXf3f& gridToMeshXf, float beta, float maxDistSq, float minDistSq, ProgressCallback cb ) override;
+
+    /// returns amount of required memory for calcFromVector operation (the ordering of points)
+    MRMESH_API virtual size_t fromVectorHeapBytes( size_t inputSize ) const override;
+    /// returns amount of required memory for calcSelfIntersections operation (the ordering of faces)
+    MRMESH_API virtual size_t selfIntersectionsHeapBytes( const Mesh& mesh ) const override;
+
+    /// the number of points in one packet
+    static constexpr int PacketSize = 8;
+    struct Packet;
+    /// computes winding numbers for all valid points of the packet
+    MRMESH_API void calcPacket( Packet & packet, float beta ) const;
+};
+
+/// up to PacketSize query points in SoA layout together with their results
+struct PacketFastWindingNumber::Packet
+{
+    float x[PacketSize] = {};
+    float y[PacketSize] = {};
+    float z[PacketSize] = {};
+    /// for each point, this triangle will be skipped from summation
+    FaceId skipFace[PacketSize];
+    /// i-th bit is set if i-th point is present
+    std::uint32_t valid = 0;
+    /// computed winding numbers
+    float w[PacketSize] = {};
+
+    void set( int i, const Vector3f & p, FaceId skip = {} )
+    {
+        assert( i >= 0 && i < PacketSize );
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+        skipFace[i] = skip;
+        valid |= 1u << i;
+    }
+};
+
 } // namespace MR
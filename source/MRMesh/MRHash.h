@@ -34,4 +34,13 @@ struct hash<MR::Vector3f>
     }
 };
 
+template<>
+struct hash<MR::Vector3i>
+{
+    size_t operator()( MR::Vector3i const& p ) const noexcept
+    {
+        return size_t( p.x ) * 73856093 ^ size_t( p.y ) * 19349663 ^ size_t( p.z ) * 83492791;
+    }
+};
+
 } // namespace std
@@ -238,6 +238,31 @@ VoidOrErrStr parseSingleNumber( const std::string_view& str, T& num )
     return {};
 }
 
+template<typename T>
+VoidOrErrStr parseNumbers( const std::string_view& str, T* nums, int maxCount, int& count, bool onlyPrefix )
+{
+    using namespace boost::spirit::x3;
+
+    count = 0;
+    auto num = [&] ( auto& ctx )
+    {
+        nums[count++] = _attr( ctx );
+    };
+    auto it = str.begin();
+    bool r = phrase_parse(
+        it,
+        str.end(),
+        repeat( 0, maxCount )[floatT[num]],
+        ascii::space );
+
+    if ( !r )
+        return unexpected( "Failed to parse numbers" );
+    if ( !onlyPrefix && it != str.end() )
+        return unexpected( count == maxCount ? "Too many numbers" : "Failed to parse numbers" );
+
+    return {};
+}
+
 VoidOrErrStr parseFirstNum( const std::string_view& str, int& num )
 {
     using namespace boost::spirit::x3;
@@ -300,6 +325,9 @@ VoidOrErrStr parseAscCoordinate( const std::string_view& str, Vector3<T>& v, Vec
     return parseTextCoordinate( str, v, n, c );
 }
 
+template VoidOrErrStr parseNumbers<float>( const std::string_view& str, float* nums, int maxCount, int& count, bool onlyPrefix );
+template VoidOrErrStr parseNumbers<double>( const std::string_view& str, double* nums, int maxCount, int& count, bool onlyPrefix );
+
 template VoidOrErrStr parseSingleNumber<float>( const std::string_view& str, float& num );
 template VoidOrErrStr parseSingleNumber<int>( const std::string_view& str, int& num );
 
@@ -21,6 +21,11 @@ VoidOrErrStr parseObjCoordinate( const std::string_view& str, Vector3<T>& v, Vec
 template<typename T>
 VoidOrErrStr parsePtsCoordinate( const std::string_view& str, Vector3<T>& v, Color& c );
 
+// reads up to `maxCount` numbers separated by spaces to `nums`, and returns the number of read numbers in `count`;
+// returns error if the string contains anything else after them, unless `onlyPrefix` is set
+template<typename T>
+VoidOrErrStr parseNumbers( const std::string_view& str, T* nums, int maxCount, int& count, bool onlyPrefix = false );
+
 // reads the first integer number in the line
 VoidOrErrStr parseFirstNum( const std::string_view& str, int& num );
 // reads the polygon points and optional number of polygon points
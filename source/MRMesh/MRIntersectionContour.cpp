@@ -4,7 +4,12 @@
 #include "MRTimer.h"
 #include "MRRegionBoundary.h"
 #include "MRFillContour.h"
+#include "MRUnionFind.h"
+#include "MRParallelFor.h"
+#include "MRPch/MRTBB.h"
 #include <parallel_hashmap/phmap.h>
+#include <algorithm>
+#include <cstdint>
 
 namespace
 {
@@ -42,73 +47,101 @@ bool isClosedContourTrivial( const MeshTopology& topology, const OneMeshContour&
 namespace MR
 {
 
-struct EdgeTriHash
+namespace
 {
-    size_t operator()( const EdgeTri& et ) const
-    {
-        return 17 * et.edge.undirected() + 23 * et.tri;
-    }
-};
 
-using EdgeTriSet = HashSet<EdgeTri, EdgeTriHash>;
+/// packs undirected edge and triangle in one key, so the direction of the edge is ignored as in EdgeTri comparison
+inline std::uint64_t edgeTriKey( const EdgeTri& et )
+{
+    return ( std::uint64_t( std::uint32_t( int( et.edge.undirected() ) ) ) << 32 ) | std::uint32_t( int( et.tri ) );
+}
+
+using KeyIndex = std::pair<std::uint64_t, int>;
+
+/// returns keys of all given intersections with their indices (starting from firstIndex) sorted by keys and then by indices
+std::vector<KeyIndex> sortedKeys( const std::vector<EdgeTri>& edgeTris, int firstIndex )
+{
+    std::vector<KeyIndex> res( edgeTris.size() );
+    ParallelFor( edgeTris, [&]( size_t i )
+    {
+        res[i] = { edgeTriKey( edgeTris[i] ), firstIndex + int( i ) };
+    } );
+    tbb::parallel_sort( res.begin(), res.end() );
+    return res;
+}
 
+/// all intersections of both kinds with the search by edge and triangle;
+/// the intersection with index i < numAtB is edgesAtrisB[i], otherwise it is edgesBtrisA[i - numAtB]
 struct AccumulativeSet
 {
     const MeshTopology& topologyA;
     const MeshTopology& topologyB;
+    const PreciseCollisionResult& intersections;
+    int numAtB = 0;
+    std::vector<KeyIndex> sortedAtB;
+    std::vector<KeyIndex> sortedBtA;
+    /// nonzero for the intersections already included in the contours and for repeated intersections;
+    /// bytes and not bits to be modified from parallel threads
+    std::vector<std::uint8_t> removed;
 
-    EdgeTriSet eAtB;
-    EdgeTriSet eBtA;
-
-    const MeshTopology& topologyByEdge( bool edgesATriB )
+    AccumulativeSet( const MeshTopology& topologyA, const MeshTopology& topologyB, const PreciseCollisionResult& intersections )
+        : topologyA( topologyA ), topologyB( topologyB ), intersections( intersections ), numAtB( int( intersections.edgesAtrisB.size() ) )
     {
-        return edgesATriB ? topologyA : topologyB;
+        sortedAtB = sortedKeys( intersections.edgesAtrisB, 0 );
+        sortedBtA = sortedKeys( intersections.edgesBtrisA, numAtB );
+        removed.resize( size(), 0 );
+        // only the first of equal intersections is considered as in a set
+        for ( const auto* sorted : { &sortedAtB, &sortedBtA } )
+        {
+            ParallelFor( size_t( 1 ), sorted->size(), [&]( size_t i )
+            {
+                if ( ( *sorted )[i].first == ( *sorted )[i - 1].first )
+                    removed[( *sorted )[i].second] = 1;
+            } );
+        }
     }
 
-    const MeshTopology& topologyByTri( bool edgesATriB )
+    int size() const
     {
-        return topologyByEdge( !edgesATriB );
+        return numAtB + int( intersections.edgesBtrisA.size() );
     }
 
-    EdgeTriSet& set( bool edgesATriB )
+    VariableEdgeTri get( int i ) const
     {
-        return edgesATriB ? eAtB : eBtA;
+        if ( i < numAtB )
+            return { intersections.edgesAtrisB[i], true };
+        return { intersections.edgesBtrisA[i - numAtB], false };
     }
-    const EdgeTriSet& set( bool edgesATriB ) const
+
+    const MeshTopology& topologyByEdge( bool edgesATriB ) const
     {
-        return edgesATriB ? eAtB : eBtA;
+        return edgesATriB ? topologyA : topologyB;
     }
-    bool empty() const
+
+    const MeshTopology& topologyByTri( bool edgesATriB ) const
     {
-        return eAtB.empty() && eBtA.empty();
+        return topologyByEdge( !edgesATriB );
     }
-    VariableEdgeTri getFirst() const
+
+    /// returns the index of not removed intersection equal to given one, or -1
+    int find( const VariableEdgeTri& item ) const
     {
-        if ( !eAtB.empty() )
-            return {*eAtB.begin(),true};
-        else if ( !eBtA.empty() )
-            return {*eBtA.begin(),false};
-        return {};
+        const auto& sorted = item.isEdgeATriB ? sortedAtB : sortedBtA;
+        const auto key = edgeTriKey( item );
+        auto it = std::lower_bound( sorted.begin(), sorted.end(), key, []( const KeyIndex& a, std::uint64_t k ) { return a.first < k; } );
+        if ( it == sorted.end() || it->first != key || removed[it->second] )
+            return -1;
+        return it->second;
     }
 };
 
-EdgeTriSet createSet( const std::vector<EdgeTri>& edgeTris )
-{
-    EdgeTriSet set;
-    set.reserve( edgeTris.size() * 2 ); // 2 here is for mental peace
-    for ( const auto& edgeTri : edgeTris )
-        set.insert( edgeTri );
-    return set;
-}
-
 bool erase( AccumulativeSet& accumulativeSet, VariableEdgeTri& item )
 {
-    auto& itemSet = accumulativeSet.set( item.isEdgeATriB );
-    auto it = itemSet.find( item );
-    if ( it == itemSet.end() )
+    const auto i = accumulativeSet.find( item );
+    if ( i < 0 )
         return false;
-    item = {*it,item.isEdgeATriB};
-    itemSet.erase( it );
+    item = accumulativeSet.get( i );
+    accumulativeSet.removed[i] = 1;
     return true;
 }
 
@@ -127,7 +160,9 @@ VariableEdgeTri sym( const VariableEdgeTri& curr )
     return res;
 }
 
-bool getNext( AccumulativeSet& accumulativeSet, const VariableEdgeTri& curr, VariableEdgeTri& next )
+/// calls given function for each possible continuation of the contour after given intersection in the order of preference
+template<typename F>
+void forEachNextVariant( const AccumulativeSet& accumulativeSet, const VariableEdgeTri& curr, F && f )
 {
     const auto& edgeTopology = accumulativeSet.topologyByEdge( curr.isEdgeATriB );
     const auto& triTopology = accumulativeSet.topologyByTri( curr.isEdgeATriB );
@@ -152,18 +187,28 @@ bool getNext( AccumulativeSet& accumulativeSet, const VariableEdgeTri& curr, Var
         {
             if ( !v.edge.valid() )
                 continue;
-            next = v;
-            if ( erase( accumulativeSet, next ) )
-                return true;
+            if ( f( v ) )
+                return;
         }
     }
-    return false;
 }
 
-ContinuousContour orderFirstIntersectionContour( AccumulativeSet& accumulativeSet )
+bool getNext( AccumulativeSet& accumulativeSet, const VariableEdgeTri& curr, VariableEdgeTri& next )
+{
+    bool found = false;
+    forEachNextVariant( accumulativeSet, curr, [&]( const VariableEdgeTri& v )
+    {
+        next = v;
+        found = erase( accumulativeSet, next );
+        return found;
+    } );
+    return found;
+}
+
+ContinuousContour orderFirstIntersectionContour( AccumulativeSet& accumulativeSet, int firstId )
 {
     ContinuousContour forwardRes;
-    auto first = accumulativeSet.getFirst();
+    auto first = accumulativeSet.get( firstId );
     forwardRes.push_back( orientBtoA( first ) );
     VariableEdgeTri next;
     while ( getNext( accumulativeSet, forwardRes.back(), next ) )
@@ -185,15 +230,170 @@ ContinuousContour orderFirstIntersectionContour( AccumulativeSet& accumulativeSe
     return forwardRes;
 }
 
+struct EdgeTriHash
+{
+    size_t operator()( const EdgeTri& et ) const
+    {
+        return 17 * et.edge.undirected() + 23 * et.tri;
+    }
+};
+
+/// returns the indices of all not repeated intersections in the order of starting contours from them:
+/// the contours were always started from the first remaining element of the hash set of edgesAtrisB and then of edgesBtrisA,
+/// and this order is kept to produce the same contours (and booleans) as before
+std::vector<int> contourStartOrder( const AccumulativeSet& accumulativeSet )
+{
+    MR_TIMER
+    std::vector<VariableEdgeTri> items;
+    items.reserve( accumulativeSet.size() );
+    for ( bool isEdgeATriB : { true, false } )
+    {
+        const auto& edgeTris = isEdgeATriB ? accumulativeSet.intersections.edgesAtrisB : accumulativeSet.intersections.edgesBtrisA;
+        HashSet<EdgeTri, EdgeTriHash> set;
+        set.reserve( edgeTris.size() * 2 ); // the same capacity as it was to get the same order of elements
+        for ( const auto& edgeTri : edgeTris )
+            set.insert( edgeTri );
+        for ( const auto& edgeTri : set )
+            items.push_back( { edgeTri, isEdgeATriB } );
+    }
+    std::vector<int> res( items.size() );
+    ParallelFor( items, [&]( size_t i )
+    {
+        res[i] = accumulativeSet.find( items[i] );
+        assert( res[i] >= 0 );
+    } );
+    return res;
+}
+
+/// contour with the position of intersection it was started from in contourStartOrder
+using IndexedContour = std::pair<int, ContinuousContour>;
+
+/// orders the intersections in contours: each next contour starts from the first not used intersection in given order;
+/// \param startPos the position of each intersection in contourStartOrder
+void orderContours( AccumulativeSet& accumulativeSet, const int* ids, size_t numIds, const std::vector<int>& startPos, std::vector<IndexedContour>& res )
+{
+    for ( size_t i = 0; i < numIds; ++i )
+    {
+        const auto id = ids[i];
+        if ( accumulativeSet.removed[id] )
+            continue;
+        res.emplace_back( startPos[id], orderFirstIntersectionContour( accumulativeSet, id ) );
+    }
+}
+
+/// unites each intersection with all intersections that can precede or follow it in a contour
+UnionFind<int> uniteAdjacentIntersections( const AccumulativeSet& accumulativeSet )
+{
+    MR_TIMER
+    const int size = accumulativeSet.size();
+    UnionFind<int> res( size );
+    auto forEachAdjacent = [&]( int i, auto && f )
+    {
+        const auto v = orientBtoA( accumulativeSet.get( i ) );
+        auto onVariant = [&]( const VariableEdgeTri& n )
+        {
+            if ( auto j = accumulativeSet.find( n ); j >= 0 && j != i )
+                f( j );
+            return false; // consider all variants
+        };
+        forEachNextVariant( accumulativeSet, v, onVariant );
+        forEachNextVariant( accumulativeSet, sym( v ), onVariant );
+    };
+
+    // first unite the intersections inside each range in parallel, the neighbors from other ranges are united after that sequentially
+    std::vector<std::uint8_t> lastPass( size, 0 );
+    tbb::parallel_for( tbb::blocked_range<int>( 0, size ), [&]( const tbb::blocked_range<int>& range )
+    {
+        for ( int i = range.begin(); i < range.end(); ++i )
+        {
+            if ( accumulativeSet.removed[i] )
+                continue;
+            forEachAdjacent( i, [&]( int j )
+            {
+                if ( j >= range.begin() && j < range.end() )
+                    res.unite( i, j );
+                else
+                    lastPass[i] = 1;
+            } );
+        }
+    } );
+    for ( int i = 0; i < size; ++i )
+    {
+        if ( lastPass[i] )
+            forEachAdjacent( i, [&]( int j ) { res.unite( i, j ); } );
+    }
+
+    tbb::parallel_for( tbb::blocked_range<int>( 0, size ), [&]( const tbb::blocked_range<int>& range )
+    {
+        for ( int i = range.begin(); i < range.end(); ++i )
+            res.findUpdateRange( i, range.begin(), range.end() );
+    } );
+    return res;
+}
+
+} // anonymous namespace
+
 ContinuousContours orderIntersectionContours( const MeshTopology& topologyA, const MeshTopology& topologyB, const PreciseCollisionResult& intersections )
 {
     MR_TIMER;
-    AccumulativeSet accumulativeSet{topologyA,topologyB, createSet( intersections.edgesAtrisB ),createSet( intersections.edgesBtrisA ),};
-    ContinuousContours res;
-    while ( !accumulativeSet.empty() )
+    AccumulativeSet accumulativeSet( topologyA, topologyB, intersections );
+    const int size = accumulativeSet.size();
+
+    const auto startOrder = contourStartOrder( accumulativeSet );
+    std::vector<int> startPos( size, -1 );
+    for ( int p = 0; p < int( startOrder.size() ); ++p )
+        startPos[startOrder[p]] = p;
+
+    std::vector<IndexedContour> indexedContours;
+    const auto numThreads = int( tbb::global_control::active_value( tbb::global_control::max_allowed_parallelism ) );
+    if ( numThreads <= 1 || size < 1024 )
+        orderContours( accumulativeSet, startOrder.data(), startOrder.size(), startPos, indexedContours );
+    else
     {
-        res.push_back( orderFirstIntersectionContour( accumulativeSet ) );
+        // the contours are formed only from the intersections of one connected component,
+        // so the components are ordered independently in parallel, giving the same contours as sequential ordering
+        auto unionFind = uniteAdjacentIntersections( accumulativeSet );
+        const auto& roots = unionFind.parents();
+
+        // sort the intersections by components keeping their start order inside each component
+        std::vector<int> compOfRoot( size, -1 );
+        std::vector<int> compStart( 1, 0 );
+        for ( int i : startOrder )
+        {
+            auto& c = compOfRoot[roots[i]];
+            if ( c < 0 )
+            {
+                c = int( compStart.size() ) - 1;
+                compStart.push_back( 0 );
+            }
+            ++compStart[c + 1];
+        }
+        const int numComps = int( compStart.size() ) - 1;
+        for ( int c = 0; c < numComps; ++c )
+            compStart[c + 1] += compStart[c];
+        std::vector<int> sortedIds( compStart.back() );
+        std::vector<int> compPos( compStart.begin(), compStart.end() - 1 );
+        for ( int i : startOrder )
+            sortedIds[compPos[compOfRoot[roots[i]]]++] = i;
+
+        std::vector<std::vector<IndexedContour>> compContours( numComps );
+        tbb::parallel_for( tbb::blocked_range<int>( 0, numComps, 1 ), [&]( const tbb::blocked_range<int>& range )
+        {
+            for ( int c = range.begin(); c < range.end(); ++c )
+                orderContours( accumulativeSet, sortedIds.data() + compStart[c], size_t( compStart[c + 1] - compStart[c] ), startPos, compContours[c] );
+        } );
+        for ( auto& cc : compContours )
+            for ( auto& ic : cc )
+                indexedContours.push_back( std::move( ic ) );
+        // sequential ordering takes the contours in the start order of their first intersections
+        tbb::parallel_sort( indexedContours.begin(), indexedContours.end(),
+            []( const IndexedContour& a, const IndexedContour& b ) { return a.first < b.first; } );
     }
+
+    ContinuousContours res;
+    res.reserve( indexedContours.size() );
+    for ( auto& ic : indexedContours )
+        res.push_back( std::move( ic.second ) );
     return res;
 }
 
@@ -0,0 +1,109 @@
+#include "MRMappedFile.h"
+#include "MRStringConvert.h"
+#include "MRTimer.h"
+#include <utility>
+
+#ifdef _WIN32
+#include "windows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MR
+{
+
+MappedFile::MappedFile( MappedFile && b ) noexcept
+    : data_( std::exchange( b.data_, nullptr ) )
+    , size_( std::exchange( b.size_, 0 ) )
+    , copyOnWrite_( b.copyOnWrite_ )
+{
+}
+
+MappedFile & MappedFile::operator =( MappedFile && b ) noexcept
+{
+    if ( this != &b )
+    {
+        close();
+        data_ = std::exchange( b.data_, nullptr );
+        size_ = std::exchange( b.size_, 0 );
+        copyOnWrite_ = b.copyOnWrite_;
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+Expected<MappedFile, std::string> MappedFile::open( const std::filesystem::path & file, bool copyOnWrite )
+{
+    MR_TIMER
+    MappedFile res;
+    res.copyOnWrite_ = copyOnWrite;
+
+#ifdef _WIN32
+    HANDLE h = CreateFileW( file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( h == INVALID_HANDLE_VALUE )
+        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( h, &size ) )
+    {
+        CloseHandle( h );
+        return unexpected( std::string( "Cannot get the size of file " ) + utf8string( file ) );
+    }
+    res.size_ = size_t( size.QuadPart );
+    if ( res.size_ > 0 )
+    {
+        // the view keeps the mapping and the file alive after their handles are closed
+        HANDLE mapping = CreateFileMappingW( h, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr );
+        if ( mapping )
+        {
+            res.data_ = (char*)MapViewOfFile( mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0 );
+            CloseHandle( mapping );
+        }
+    }
+    CloseHandle( h );
+#else
+    int fd = ::open( file.c_str(), O_RDONLY );
+    if ( fd < 0 )
+        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 )
+    {
+        ::close( fd );
+        return unexpected( std::string( "Cannot get the size of file " ) + utf8string( file ) );
+    }
+    res.size_ = size_t( st.st_size );
+    if ( res.size_ > 0 )
+    {
+        // private mapping makes modifications invisible to the file and other processes
+        void * p = mmap( nullptr, res.size_, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( p != MAP_FAILED )
+            res.data_ = (char*)p;
+    }
+    ::close( fd );
+#endif
+
+    if ( res.size_ > 0 && !res.data_ )
+        return unexpected( std::string( "Cannot map file in memory " ) + utf8string( file ) );
+    return res;
+}
+
+void MappedFile::close()
+{
+    if ( !data_ )
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile( data_ );
+#else
+    munmap( data_, size_ );
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace MR
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include <cassert>
+#include <filesystem>
+#include <string>
+
+namespace MR
+{
+
+/// \addtogroup IOGroup
+/// \{
+
+/// whole file mapped in the memory of the process;
+/// the pages of the file are read from disk by the operating system only on first access to them
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile( const MappedFile & ) = delete;
+    MappedFile & operator =( const MappedFile & ) = delete;
+    MRMESH_API MappedFile( MappedFile && b ) noexcept;
+    MRMESH_API MappedFile & operator =( MappedFile && b ) noexcept;
+    MRMESH_API ~MappedFile();
+
+    /// maps given file in memory;
+    /// \param copyOnWrite if false then the mapping is read-only, otherwise the data can be modified in memory without affecting the file
+    [[nodiscard]] MRMESH_API static Expected<MappedFile, std::string> open( const std::filesystem::path & file, bool copyOnWrite = false );
+
+    /// the size of mapped file in bytes
+    [[nodiscard]] size_t size() const { return size_; }
+    /// the address of the first byte of mapped file
+    [[nodiscard]] const char * data() const { return data_; }
+    /// the address of the first byte of mapped file, which can be modified only if the file was opened with copyOnWrite
+    [[nodiscard]] char * mutableData() { assert( copyOnWrite_ ); return data_; }
+    [[nodiscard]] bool copyOnWrite() const { return copyOnWrite_; }
+
+    /// unmaps the file
+    MRMESH_API void close();
+
+private:
+    char * data_ = nullptr;
+    size_t size_ = 0;
+    bool copyOnWrite_ = false;
+};
+
+/// \}
+
+} // namespace MR
@@ -0,0 +1,227 @@
+#include "MRMappedMrmesh.h"
+#include "MRMesh.h"
+#include "MRMeshSave.h"
+#include "MRMeshLoad.h"
+#include "MRProgressReadWrite.h"
+#include "MRSerializer.h"
+#include "MRTorus.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include <cstring>
+#include <sstream>
+
+namespace MR
+{
+
+namespace
+{
+
+std::uint64_t alignUp( std::uint64_t x )
+{
+    return ( x + MrmeshAlignedHeader::Alignment - 1 ) / MrmeshAlignedHeader::Alignment * MrmeshAlignedHeader::Alignment;
+}
+
+/// the layout of half-edge record as saved by MeshTopology::write
+struct EdgeRecord
+{
+    EdgeId next;
+    EdgeId prev;
+    VertId org;
+    FaceId left;
+};
+static_assert( sizeof( EdgeRecord ) == MrmeshAlignedHeader::EdgeRecordSize );
+
+} // anonymous namespace
+
+bool MrmeshAlignedHeader::hasMagic( const char * data, size_t size )
+{
+    return size >= sizeof( Magic ) && std::memcmp( data, Magic, sizeof( Magic ) ) == 0;
+}
+
+MrmeshAlignedHeader MrmeshAlignedHeader::forMesh( const Mesh & mesh )
+{
+    MrmeshAlignedHeader res;
+    std::memcpy( res.magic, Magic, sizeof( Magic ) );
+    res.version = CurrentVersion;
+    res.headerSize = sizeof( MrmeshAlignedHeader );
+    res.numEdges = mesh.topology.edgeSize();
+    res.numVerts = mesh.topology.edgePerVertex().size();
+    res.numFaces = mesh.topology.edgePerFace().size();
+    res.numPoints = std::uint64_t( mesh.topology.lastValidVert() + 1 );
+    res.edgesOffset = alignUp( sizeof( MrmeshAlignedHeader ) );
+    res.edgePerVertexOffset = alignUp( res.edgesOffset + res.numEdges * sizeof( EdgeRecord ) );
+    res.edgePerFaceOffset = alignUp( res.edgePerVertexOffset + res.numVerts * sizeof( EdgeId ) );
+    res.pointsOffset = alignUp( res.edgePerFaceOffset + res.numFaces * sizeof( EdgeId ) );
+    return res;
+}
+
+VoidOrErrStr MrmeshAlignedHeader::validate( std::uint64_t fileSize ) const
+{
+    if ( !hasMagic( magic, sizeof( magic ) ) )
+        return unexpected( std::string( "Not an aligned mrmesh-file" ) );
+    if ( version > CurrentVersion )
+        return unexpected( "Unsupported version of aligned mrmesh-file: " + std::to_string( version ) );
+    if ( headerSize < sizeof( MrmeshAlignedHeader ) )
+        return unexpected( std::string( "Wrong header size of aligned mrmesh-file" ) );
+    // the end of previous block (or of the header)
+    std::uint64_t prevEnd = headerSize;
+    auto checkBlock = [&]( std::uint64_t offset, std::uint64_t count, std::uint64_t itemSize ) -> VoidOrErrStr
+    {
+        if ( offset % Alignment != 0 || offset < prevEnd )
+            return unexpected( std::string( "Wrong layout of data blocks in aligned mrmesh-file" ) );
+        if ( offset > fileSize || count > ( fileSize - offset ) / itemSize )
+            return unexpected( std::string( "Aligned mrmesh-file is too short" ) );
+        prevEnd = offset + count * itemSize;
+        return {};
+    };
+    return checkBlock( edgesOffset, numEdges, sizeof( EdgeRecord ) )
+        .and_then( [&] { return checkBlock( edgePerVertexOffset, numVerts, sizeof( EdgeId ) ); } )
+        .and_then( [&] { return checkBlock( edgePerFaceOffset, numFaces, sizeof( EdgeId ) ); } )
+        .and_then( [&] { return checkBlock( pointsOffset, numPoints, sizeof( Vector3f ) ); } );
+}
+
+Expected<MappedMrmesh, std::string> MappedMrmesh::open( const std::filesystem::path & file, bool copyOnWrite )
+{
+    MR_TIMER
+    auto mapped = MappedFile::open( file, copyOnWrite );
+    if ( !mapped )
+        return unexpected( std::move( mapped.error() ) );
+    if ( mapped->size() < sizeof( MrmeshAlignedHeader ) )
+        return unexpected( std::string( "Aligned mrmesh-file is too short" ) );
+
+    MappedMrmesh res;
+    res.file_ = std::move( *mapped );
+    res.header_ = (const MrmeshAlignedHeader*)res.file_.data();
+    if ( auto v = res.header_->validate( res.file_.size() ); !v )
+        return unexpected( std::move( v.error() ) );
+    return res;
+}
+
+ThreeVertIds MappedMrmesh::getTriVerts( FaceId f ) const
+{
+    assert( f < (int)header_->numFaces );
+    const auto * edges = (const EdgeRecord*)( file_.data() + header_->edgesOffset );
+    const EdgeId a = edgePerFace()[f];
+    assert( a.valid() );
+    // the same as MeshTopology::getLeftTriVerts
+    const EdgeId b = edges[a.sym()].prev;
+    const EdgeId c = edges[b.sym()].prev;
+    return { edges[a].org, edges[b].org, edges[c].org };
+}
+
+Expected<Mesh, std::string> MappedMrmesh::toMesh( ProgressCallback callback ) const
+{
+    MR_TIMER
+    Mesh mesh;
+    auto readRes = mesh.topology.read(
+        { file_.data() + header_->edgesOffset, size_t( header_->numEdges * sizeof( EdgeRecord ) ) },
+        { file_.data() + header_->edgePerVertexOffset, size_t( header_->numVerts * sizeof( EdgeId ) ) },
+        { file_.data() + header_->edgePerFaceOffset, size_t( header_->numFaces * sizeof( EdgeId ) ) },
+        subprogress( callback, 0.0f, 0.8f ) );
+    if ( !readRes )
+        return unexpected( std::move( readRes.error() ) );
+
+    mesh.points.resizeNoInit( header_->numPoints );
+    if ( !copyByBlocks( (char*)mesh.points.data(), file_.data() + header_->pointsOffset, header_->numPoints * sizeof( Vector3f ),
+        subprogress( callback, 0.8f, 1.0f ) ) )
+        return unexpected( std::string( "Loading canceled" ) );
+    return mesh;
+}
+
+TEST( MRMesh, MappedMrmesh )
+{
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+    const auto path = folder / "torus.mrmesh";
+
+    Mesh torus = makeTorus( 2, 1, 16, 16 );
+    FaceBitSet toDelete( torus.topology.faceSize() );
+    toDelete.set( 3_f );
+    torus.deleteFaces( toDelete );
+    ASSERT_TRUE( MeshSave::toMrmeshAligned( torus, path ).has_value() );
+
+    {
+        auto mapped = MappedMrmesh::open( path );
+        ASSERT_TRUE( mapped.has_value() );
+        EXPECT_EQ( mapped->header().edgesOffset % MrmeshAlignedHeader::Alignment, 0 );
+        EXPECT_EQ( mapped->points().size(), torus.points.size() );
+        for ( auto v : torus.topology.getValidVerts() )
+            EXPECT_EQ( mapped->points()[v], torus.points[v] );
+        for ( auto f : torus.topology.getValidFaces() )
+            EXPECT_EQ( mapped->getTriVerts( f ), torus.topology.getTriVerts( f ) );
+
+        auto copy = mapped->toMesh();
+        ASSERT_TRUE( copy.has_value() );
+        EXPECT_EQ( copy->topology, torus.topology );
+        EXPECT_EQ( copy->points, torus.points );
+    }
+
+    // modifications of copy-on-write mapping do not change the file
+    {
+        auto mapped = MappedMrmesh::open( path, true );
+        ASSERT_TRUE( mapped.has_value() );
+        mapped->mutablePoints()[0] = Vector3f( 100, 100, 100 );
+    }
+
+    // ordinary loaders recognize aligned layout
+    auto loaded = MeshLoad::fromMrmesh( path );
+    ASSERT_TRUE( loaded.has_value() );
+    EXPECT_EQ( loaded->topology, torus.topology );
+    EXPECT_EQ( loaded->points, torus.points );
+
+    std::stringstream ss;
+    ASSERT_TRUE( MeshSave::toMrmeshAligned( torus, ss ).has_value() );
+    auto streamLoaded = MeshLoad::fromMrmesh( ss );
+    ASSERT_TRUE( streamLoaded.has_value() );
+    EXPECT_EQ( streamLoaded->topology, torus.topology );
+    EXPECT_EQ( streamLoaded->points, torus.points );
+}
+
+TEST( MRMesh, MappedMrmeshDamagedHeader )
+{
+    const Mesh torus = makeTorus( 2, 1, 16, 16 );
+    std::stringstream ss;
+    ASSERT_TRUE( MeshSave::toMrmeshAligned( torus, ss ).has_value() );
+    const auto good = ss.str();
+    MrmeshAlignedHeader header;
+    std::memcpy( &header, good.data(), sizeof( header ) );
+    EXPECT_TRUE( header.validate( good.size() ).has_value() );
+    EXPECT_FALSE( header.validate( good.size() - 1 ).has_value() );
+
+    auto loadWith = [&good]( const MrmeshAlignedHeader & h )
+    {
+        auto damaged = good;
+        std::memcpy( damaged.data(), &h, sizeof( h ) );
+        std::istringstream in( damaged );
+        return MeshLoad::fromMrmesh( in );
+    };
+    EXPECT_TRUE( loadWith( header ).has_value() );
+
+    // points before topology
+    auto h = header;
+    std::swap( h.edgesOffset, h.pointsOffset );
+    EXPECT_FALSE( h.validate( good.size() ).has_value() );
+    EXPECT_FALSE( loadWith( h ).has_value() );
+
+    // edge per vertex after edge per face
+    h = header;
+    std::swap( h.edgePerVertexOffset, h.edgePerFaceOffset );
+    EXPECT_FALSE( loadWith( h ).has_value() );
+
+    // edge per face outside of topology blocks
+    h = header;
+    h.edgePerFaceOffset = h.pointsOffset + MrmeshAlignedHeader::Alignment;
+    EXPECT_FALSE( loadWith( h ).has_value() );
+
+    // overlapping blocks
+    h = header;
+    h.edgePerVertexOffset = h.edgesOffset;
+    EXPECT_FALSE( loadWith( h ).has_value() );
+
+    // block overlapping the header
+    h = header;
+    h.edgesOffset = 0;
+    EXPECT_FALSE( loadWith( h ).has_value() );
+}
+
+} // namespace MR
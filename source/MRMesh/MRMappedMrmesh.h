@@ -0,0 +1,95 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRMappedFile.h"
+#include "MRProgressCallback.h"
+#include "MRId.h"
+#include "MRVector3.h"
+#include <cstdint>
+#include <span>
+
+namespace MR
+{
+
+/// \addtogroup IOGroup
+/// \{
+
+/// the header of .mrmesh file with aligned layout:
+/// it is followed by the blocks of half-edge records, edge per vertex, edge per face and vertex coordinates
+/// in the same binary format as in ordinary .mrmesh file, but each block starts at the offset multiple of \ref Alignment,
+/// so the file can be mapped in memory and the blocks can be used directly
+struct MrmeshAlignedHeader
+{
+    static constexpr char Magic[8] = { 'M', 'R', 'M', 'E', 'S', 'H', 'A', '\0' };
+    static constexpr std::uint32_t CurrentVersion = 1;
+    /// alignment of data blocks equal to the typical size of memory page
+    static constexpr std::uint64_t Alignment = 4096;
+    /// the size of one half-edge record in the file
+    static constexpr std::uint64_t EdgeRecordSize = 16;
+
+    char magic[8] = {};
+    std::uint32_t version = 0;
+    /// the size of this structure, to be able to add new fields in future versions
+    std::uint32_t headerSize = 0;
+    std::uint64_t numEdges = 0;
+    std::uint64_t numVerts = 0;
+    std::uint64_t numFaces = 0;
+    std::uint64_t numPoints = 0;
+    /// offsets of data blocks from the start of the file
+    std::uint64_t edgesOffset = 0;
+    std::uint64_t edgePerVertexOffset = 0;
+    std::uint64_t edgePerFaceOffset = 0;
+    std::uint64_t pointsOffset = 0;
+
+    /// returns true if given bytes start with the magic of aligned layout
+    [[nodiscard]] MRMESH_API static bool hasMagic( const char * data, size_t size );
+    /// fills the header for given mesh
+    [[nodiscard]] MRMESH_API static MrmeshAlignedHeader forMesh( const Mesh & mesh );
+    /// checks that the header is supported, and all data blocks go after the header in their order without overlapping
+    /// and are within the file of given size
+    [[nodiscard]] MRMESH_API VoidOrErrStr validate( std::uint64_t fileSize ) const;
+    /// the size of the file with this header and all data blocks
+    [[nodiscard]] std::uint64_t fileSize() const { return pointsOffset + numPoints * sizeof( Vector3f ); }
+};
+
+/// read-only view on the mesh saved in .mrmesh file with aligned layout (see \ref MeshSave::toMrmeshAligned);
+/// opening takes constant time independently on the size of the file, and only the accessed parts of the file are read from disk
+class MappedMrmesh
+{
+public:
+    /// maps given file in memory and validates its header;
+    /// \param copyOnWrite if true then the points can be modified in memory without affecting the file
+    [[nodiscard]] MRMESH_API static Expected<MappedMrmesh, std::string> open( const std::filesystem::path & file, bool copyOnWrite = false );
+
+    [[nodiscard]] const MrmeshAlignedHeader & header() const { return *header_; }
+
+    /// coordinates of all vertices
+    [[nodiscard]] std::span<const Vector3f> points() const { return { (const Vector3f*)( file_.data() + header_->pointsOffset ), size_t( header_->numPoints ) }; }
+    /// coordinates of all vertices that can be modified in memory;
+    /// returns empty span if the file was not opened with copyOnWrite
+    [[nodiscard]] std::span<Vector3f> mutablePoints()
+    {
+        assert( file_.copyOnWrite() );
+        if ( !file_.copyOnWrite() )
+            return {};
+        return { (Vector3f*)( file_.mutableData() + header_->pointsOffset ), size_t( header_->numPoints ) };
+    }
+    /// one edge with the origin in each vertex (invalid for deleted vertices)
+    [[nodiscard]] std::span<const EdgeId> edgePerVertex() const { return { (const EdgeId*)( file_.data() + header_->edgePerVertexOffset ), size_t( header_->numVerts ) }; }
+    /// one edge with each face on the left (invalid for deleted faces)
+    [[nodiscard]] std::span<const EdgeId> edgePerFace() const { return { (const EdgeId*)( file_.data() + header_->edgePerFaceOffset ), size_t( header_->numFaces ) }; }
+
+    /// returns three vertices of given valid face, reading only the records of its edges
+    [[nodiscard]] MRMESH_API ThreeVertIds getTriVerts( FaceId f ) const;
+
+    /// copies all data in ordinary mesh using parallel threads
+    [[nodiscard]] MRMESH_API Expected<Mesh, std::string> toMesh( ProgressCallback callback = {} ) const;
+
+private:
+    MappedFile file_;
+    const MrmeshAlignedHeader * header_ = nullptr;
+};
+
+/// \}
+
+} // namespace MR
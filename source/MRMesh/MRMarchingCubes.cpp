@@ -5,12 +5,17 @@
 #include "MRVolumeIndexer.h"
 #include "MRVoxelsVolumeAccess.h"
 #include "MRLine3.h"
+#include "MRBox.h"
 #include "MRMeshBuilder.h"
 #include "MRVDBFloatGrid.h"
 #include "MRTimer.h"
 #include "MRParallelFor.h"
+#include "MRBitSetParallelFor.h"
 #include "MRTriMesh.h"
+#include "MRGTest.h"
 #ifndef MRMESH_NO_OPENVDB
+#include "MRVDBConversions.h"
+#include "MRTorus.h"
 #include "MRPch/MROpenvdb.h"
 #endif
 #include <thread>
@@ -450,6 +455,156 @@ bool findSeparationPoint( Vector3f & pos, const V& volume, const Accessor& acces
     return true;
 }
 
+/// the bricks of voxels, which contain a part of iso-surface
+class ActiveBricks
+{
+public:
+    static constexpr int cBrickSize = 8;
+
+    /// finds the bricks having voxels both below and above iso, considering the voxels of next bricks adjacent to each brick
+    template <typename V, typename NaNChecker>
+    ActiveBricks( const V& volume, float iso, NaNChecker&& nanChecker )
+    {
+        MR_TIMER
+        for ( int a = 0; a < 3; ++a )
+            dims_[a] = ( volume.dims[a] + cBrickSize - 1 ) / cBrickSize;
+        const VolumeIndexer brickIndexer( dims_ );
+        active_.resize( brickIndexer.size() );
+
+        // returns minimal and maximal voxel of the brick extended on the first voxels of next bricks
+        auto brickBox = [&] ( VoxelId brick )
+        {
+            const auto brickPos = brickIndexer.toPos( brick );
+            Box3i res;
+            for ( int a = 0; a < 3; ++a )
+            {
+                res.min[a] = brickPos[a] * cBrickSize;
+                res.max[a] = std::min( res.min[a] + cBrickSize, volume.dims[a] - 1 );
+            }
+            return res;
+        };
+
+#ifndef MRMESH_NO_OPENVDB
+        if constexpr ( std::is_same_v<V, VdbVolume> )
+        {
+            const auto minCoord = volume.data->evalActiveVoxelBoundingBox().min();
+            forEachRange_( [&] ( VoxelId begin, VoxelId end )
+            {
+                const auto acc = volume.data->getConstAccessor();
+                for ( auto brick = begin; brick < end; ++brick )
+                {
+                    const auto box = brickBox( brick );
+                    if ( vdbBoxStraddles_( acc,
+                        minCoord.offsetBy( box.min.x, box.min.y, box.min.z ),
+                        minCoord.offsetBy( box.max.x, box.max.y, box.max.z ), iso ) )
+                        active_.set( brick );
+                }
+            } );
+        }
+        else
+#endif
+        {
+            forEachRange_( [&] ( VoxelId begin, VoxelId end )
+            {
+                const VoxelsVolumeAccessor<V> accessor( volume );
+                auto straddles = [&] ( const Box3i& box )
+                {
+                    bool below = false, above = false;
+                    Vector3i pos;
+                    for ( pos.z = box.min.z; pos.z <= box.max.z; ++pos.z )
+                        for ( pos.y = box.min.y; pos.y <= box.max.y; ++pos.y )
+                            for ( pos.x = box.min.x; pos.x <= box.max.x; ++pos.x )
+                            {
+                                const float value = accessor.get( pos );
+                                if ( nanChecker( value ) )
+                                    continue;
+                                if ( value < iso )
+                                    below = true;
+                                else
+                                    above = true;
+                                if ( below && above )
+                                    return true;
+                            }
+                    return false;
+                };
+                for ( auto brick = begin; brick < end; ++brick )
+                    if ( straddles( brickBox( brick ) ) )
+                        active_.set( brick );
+            } );
+        }
+    }
+
+    /// returns true if the cube with given minimal corner can contain a part of iso-surface
+    bool active( const Vector3i& pos ) const
+    {
+        return active_.test( VoxelId( ( size_t( pos.z / cBrickSize ) * dims_.y + pos.y / cBrickSize ) * dims_.x + pos.x / cBrickSize ) );
+    }
+
+    /// returns the number of voxels from given one to the next brick along X
+    static int toNextBrick( const Vector3i& pos )
+    {
+        return cBrickSize - pos.x % cBrickSize;
+    }
+
+private:
+    /// calls f( begin, end ) in parallel for the ranges of bricks, each range consisting of whole blocks of active_ bit-set
+    template <typename F>
+    void forEachRange_( F&& f )
+    {
+        const size_t endBlock = ( active_.size() + VoxelBitSet::bits_per_block - 1 ) / VoxelBitSet::bits_per_block;
+        tbb::parallel_for( tbb::blocked_range<size_t>( 0, endBlock ), [&] ( const tbb::blocked_range<size_t>& range )
+        {
+            f( VoxelId( range.begin() * VoxelBitSet::bits_per_block ),
+                VoxelId( range.end() < endBlock ? range.end() * VoxelBitSet::bits_per_block : active_.size() ) );
+        } );
+    }
+
+#ifndef MRMESH_NO_OPENVDB
+    /// returns true if the grid has values both below and above iso in the box [lo, hi];
+    /// all nodes of VDB tree are aligned on 8 voxels, so each 8-aligned cell intersecting the box is either
+    /// a leaf with individual values or a part of a tile (or background) with one value
+    static bool vdbBoxStraddles_( const openvdb::FloatGrid::ConstAccessor& acc, const VdbCoord& lo, const VdbCoord& hi, float iso )
+    {
+        static_assert( int( openvdb::FloatTree::LeafNodeType::DIM ) == cBrickSize );
+        bool below = false, above = false;
+        auto add = [&] ( float value )
+        {
+            if ( value < iso )
+                below = true;
+            else
+                above = true;
+            return below && above;
+        };
+        constexpr int cMask = ~( cBrickSize - 1 );
+        VdbCoord cell;
+        for ( cell.z() = lo.z() & cMask; cell.z() <= hi.z(); cell.z() += cBrickSize )
+            for ( cell.y() = lo.y() & cMask; cell.y() <= hi.y(); cell.y() += cBrickSize )
+                for ( cell.x() = lo.x() & cMask; cell.x() <= hi.x(); cell.x() += cBrickSize )
+                {
+                    const auto * leaf = acc.probeConstLeaf( cell );
+                    if ( !leaf )
+                    {
+                        if ( add( acc.getValue( cell ) ) )
+                            return true;
+                        continue;
+                    }
+                    const auto from = VdbCoord::maxComponent( lo, cell );
+                    const auto to = VdbCoord::minComponent( hi, cell.offsetBy( cBrickSize - 1 ) );
+                    VdbCoord c;
+                    for ( c.z() = from.z(); c.z() <= to.z(); ++c.z() )
+                        for ( c.y() = from.y(); c.y() <= to.y(); ++c.y() )
+                            for ( c.x() = from.x(); c.x() <= to.x(); ++c.x() )
+                                if ( add( leaf->getValue( c ) ) )
+                                    return true;
+                }
+        return false;
+    }
+#endif
+
+    Vector3i dims_;
+    VoxelBitSet active_;
+};
+
 template<typename V> auto accessorCtor( const V& v );
 
 template<> auto accessorCtor<SimpleVolume>( const SimpleVolume& ) { return ( void* )nullptr; }
@@ -523,6 +678,24 @@ Expected<TriMesh> volumeToMesh( const V& volume, const MarchingCubesParams& para
 
     SeparationPointStorage sepStorage( blockCount, blockSize );
 
+    std::optional<ActiveBricks> activeBricks;
+    if constexpr ( std::is_same_v<V, SimpleVolume>
+#ifndef MRMESH_NO_OPENVDB
+        || std::is_same_v<V, VdbVolume>
+#endif
+    )
+    {
+        if ( params.skipEmptyBlocks )
+            activeBricks.emplace( volume, params.iso, nanChecker );
+    }
+    // returns the number of voxels starting from given one, which can be skipped since the iso-surface is not there
+    auto voxelsToSkip = [&]( const Vector3i& basePos ) -> size_t
+    {
+        if ( !activeBricks || activeBricks->active( basePos ) )
+            return 0;
+        return std::min( ActiveBricks::toNextBrick( basePos ), volume.dims.x - basePos.x );
+    };
+
     ParallelFor( size_t( 0 ), blockCount, [&] ( size_t blockIndex )
     {
         auto & block = sepStorage.getBlock( blockIndex );
@@ -568,6 +741,15 @@ Expected<TriMesh> volumeToMesh( const V& volume, const MarchingCubesParams& para
                 assert( basePos.z == cache->currentLayer() );
             }
 
+            if ( const auto skip = voxelsToSkip( basePos ) )
+            {
+                if ( runCallback && ( ( i - begin ) % 16384 == 0 || ( i - begin ) % 16384 + skip > 16384 ) )
+                    if ( !params.cb( 0.3f * float( i - begin ) / float( end - begin ) ) )
+                        keepGoing.store( false, std::memory_order_relaxed );
+                i += skip - 1;
+                continue;
+            }
+
             SeparationPointSet set;
             bool atLeastOneOk = false;
 #ifndef MRMESH_NO_OPENVDB
@@ -686,6 +868,15 @@ Expected<TriMesh> volumeToMesh( const V& volume, const MarchingCubesParams& para
                 assert( basePos.z == cache->currentLayer() );
             }
 
+            if ( const auto skip = voxelsToSkip( basePos ) )
+            {
+                if ( runCallback && ( ( ind - begin ) % 16384 == 0 || ( ind - begin ) % 16384 + skip > 16384 ) )
+                    if ( !subprogress2( float( ind - begin ) / float( end - begin ) ) )
+                        keepGoing.store( false, std::memory_order_relaxed );
+                ind += skip - 1;
+                continue;
+            }
+
             bool voxelValid = true;
             voxelConfiguration = 0;
             std::array<bool, 8> vx{};
@@ -861,6 +1052,12 @@ Expected<TriMesh> volumeToMesh( const V& volume, const MarchingCubesParams& para
     // some points may be not referenced by any triangle due to NaNs
     result.points.resize( totalVertices );
     sepStorage.getPoints( result.points );
+    if ( params.outVertEdgeMap )
+    {
+        params.outVertEdgeMap->clear();
+        params.outVertEdgeMap->resize( totalVertices );
+        sepStorage.getEdgeIndices( *params.outVertEdgeMap );
+    }
 
     if ( params.cb && !params.cb( 1.0f ) )
         return unexpectedOperationCanceled();
@@ -943,4 +1140,52 @@ Expected<Mesh> marchingCubes( const FunctionVolume& volume, const MarchingCubesP
     } );
 }
 
+TEST( MRMesh, MarchingCubesSkipEmptyBlocks )
+{
+    // distance to a sphere with a hole of NaN values
+    SimpleVolume volume{ .dims = { 43, 37, 29 }, .voxelSize = Vector3f::diagonal( 0.1f ), .min = -20, .max = 20 };
+    VolumeIndexer indexer( volume.dims );
+    volume.data.resize( indexer.size() );
+    const Vector3f center( 21, 18, 14 );
+    for ( size_t i = 0; i < indexer.size(); ++i )
+    {
+        const auto pos = indexer.toPos( VoxelId( i ) );
+        volume.data[i] = pos.z > 20 && pos.x < 20 ? cQuietNan : ( Vector3f( pos ) - center ).length() - 10.5f;
+    }
+
+    for ( float iso : { 0.0f, 2.2f } )
+    {
+        Vector<VoxelId, FaceId> refMap, map;
+        auto ref = marchingCubesAsTriMesh( volume, { .iso = iso, .lessInside = true, .outVoxelPerFaceMap = &refMap } );
+        auto res = marchingCubesAsTriMesh( volume, { .iso = iso, .lessInside = true, .outVoxelPerFaceMap = &map, .skipEmptyBlocks = true } );
+        ASSERT_TRUE( ref.has_value() && res.has_value() );
+        EXPECT_GT( ref->tris.size(), 0 );
+        EXPECT_EQ( ref->points, res->points );
+        EXPECT_EQ( ref->tris, res->tris );
+        EXPECT_EQ( refMap, map );
+    }
+}
+
+#ifndef MRMESH_NO_OPENVDB
+TEST( MRMesh, MarchingCubesSkipEmptyBlocksVdb )
+{
+    // narrow-band level set, where most of the volume consists of tiles
+    const float voxelSize = 0.02f;
+    auto volume = floatGridToVdbVolume( meshToLevelSet( makeTorus( 1.0f, 0.3f, 64, 32 ), AffineXf3f(), Vector3f::diagonal( voxelSize ), 5 ) );
+    volume.voxelSize = Vector3f::diagonal( voxelSize );
+
+    for ( float iso : { 0.0f, 2.5f } )
+    {
+        Vector<VoxelId, FaceId> refMap, map;
+        auto ref = marchingCubesAsTriMesh( volume, { .iso = iso, .lessInside = true, .outVoxelPerFaceMap = &refMap } );
+        auto res = marchingCubesAsTriMesh( volume, { .iso = iso, .lessInside = true, .outVoxelPerFaceMap = &map, .skipEmptyBlocks = true } );
+        ASSERT_TRUE( ref.has_value() && res.has_value() );
+        EXPECT_GT( ref->tris.size(), 0 );
+        EXPECT_EQ( ref->points, res->points );
+        EXPECT_EQ( ref->tris, res->tris );
+        EXPECT_EQ( refMap, map );
+    }
+}
+#endif
+
 } //namespace MR
@@ -27,6 +27,9 @@ struct MarchingCubesParams
     float iso{ 0.0f };
     bool lessInside{ false }; // should be false for dense volumes, and true for distance volume
     Vector<VoxelId, FaceId>* outVoxelPerFaceMap{ nullptr }; // optional output map FaceId->VoxelId
+    // optional output map VertId->index of voxel edge with the vertex: 3 * VoxelId + axis (0 - X, 1 - Y, 2 - Z),
+    // the vertices are always ordered by increasing indices of their edges
+    Vector<size_t, VertId>* outVertEdgeMap{ nullptr };
     // function to calculate position of result mesh points
     // if the function isn't set, `voxelPositionerLinear` will be used
     // note: this function is called in parallel from different threads
@@ -47,6 +50,11 @@ struct MarchingCubesParams
         /// cache some voxel volume data
         Normal,
     } cachingMode = CachingMode::Automatic;
+    /// for simple and VDB volumes only: first find the minimal and maximal values in each brick of 8x8x8 voxels,
+    /// and then search for the iso-surface only in the bricks where the values are both below and above iso;
+    /// the resulting mesh is the same, but it is found much faster if the most of the volume is far from iso-surface
+    /// (e.g. in distance volumes of thin shells and offsets)
+    bool skipEmptyBlocks = false;
 };
 
 // makes Mesh from SimpleVolume with given settings using Marching Cubes algorithm
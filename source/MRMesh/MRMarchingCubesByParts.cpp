@@ -0,0 +1,265 @@
+#include "MRMarchingCubesByParts.h"
+#include "MRMesh.h"
+#include "MRTriMesh.h"
+#include "MRVolumeIndexer.h"
+#include "MRParallelFor.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include <algorithm>
+
+namespace MR
+{
+
+namespace
+{
+
+/// the result of Marching Cubes in the voxel layers [zBegin, zEnd]
+struct VolumePart
+{
+    int zBegin = 0;
+    int zEnd = 0;
+    TriMesh mesh;
+    /// indices of voxel edges in whole volume for all vertices, increasing
+    Vector<size_t, VertId> vertEdges;
+    /// voxels in whole volume for all faces
+    Vector<VoxelId, FaceId> faceVoxels;
+    /// the number of vertices before the layer zEnd, which are found in the next part as well
+    int numOwnVerts = 0;
+};
+
+/// finds given not own vertex of the part among own vertices of the next part
+Expected<VertId> findInNextPart( const VolumePart& part, const VolumePart& next, VertId v )
+{
+    const auto edge = part.vertEdges[v];
+    auto it = std::lower_bound( next.vertEdges.vec_.begin(), next.vertEdges.vec_.begin() + next.numOwnVerts, edge );
+    if ( it == next.vertEdges.vec_.begin() + next.numOwnVerts || *it != edge )
+        return unexpected( "Inconsistent vertices in adjacent volume parts" );
+    return VertId( int( it - next.vertEdges.vec_.begin() ) );
+}
+
+/// the function called for each part in the order of increasing Z, the next part is null for the last part
+using PartReceiver = std::function<VoidOrErrStr( const VolumePart& part, const VolumePart* next )>;
+
+VoidOrErrStr processParts( const Vector3i& dims, const VolumeLayersGetter& getLayers,
+    const MarchingCubesParams& params, const MarchingCubesByPartsParams& partsParams, bool needFaceVoxels, const PartReceiver& receiver )
+{
+    MR_TIMER
+    if ( dims.x <= 0 || dims.y <= 0 || dims.z <= 0 )
+        return {};
+
+    const VolumeIndexer indexer( dims );
+    // each part has the cubes in the layers [zBegin, zEnd) and separation points in the layers [zBegin, zEnd]
+    const int layersPerPart = std::max( 1, partsParams.layersPerPart );
+    const int numParts = std::max( 1, ( dims.z - 1 + layersPerPart - 1 ) / layersPerPart );
+
+    // voxel values plus approximately the same amount of memory for Marching Cubes structures
+    constexpr size_t cBytesPerVoxel = 2 * sizeof( float );
+    const auto partBytes = indexer.sizeXY() * ( layersPerPart + 1 ) * cBytesPerVoxel;
+    const int numParallelParts = std::clamp( int( partsParams.maxMemoryUsage / std::max( partBytes, size_t( 1 ) ) ), 1, numParts );
+
+    std::vector<VolumePart> pending; // the parts waiting for the next part to be computed
+    for ( int firstPart = 0; firstPart < numParts; firstPart += numParallelParts )
+    {
+        const int numWaveParts = std::min( numParallelParts, numParts - firstPart );
+        std::vector<VolumePart> wave( numWaveParts );
+        std::vector<std::string> errors( numWaveParts );
+        ParallelFor( 0, numWaveParts, [&] ( int i )
+        {
+            auto& part = wave[i];
+            part.zBegin = ( firstPart + i ) * layersPerPart;
+            part.zEnd = firstPart + i + 1 == numParts ? dims.z - 1 : std::min( part.zBegin + layersPerPart, dims.z - 1 );
+            auto volume = getLayers( part.zBegin, part.zEnd + 1 );
+            if ( !volume )
+            {
+                errors[i] = std::move( volume.error() );
+                return;
+            }
+            if ( volume->dims != Vector3i( dims.x, dims.y, part.zEnd + 1 - part.zBegin ) )
+            {
+                errors[i] = "Wrong dimensions of volume part";
+                return;
+            }
+
+            auto partParams = params;
+            partParams.origin.z += volume->voxelSize.z * part.zBegin;
+            partParams.cb = {};
+            partParams.maxVertices = INT_MAX;
+            partParams.outVertEdgeMap = &part.vertEdges;
+            partParams.outVoxelPerFaceMap = needFaceVoxels ? &part.faceVoxels : nullptr;
+            auto mesh = marchingCubesAsTriMesh( *volume, partParams );
+            if ( !mesh )
+            {
+                errors[i] = std::move( mesh.error() );
+                return;
+            }
+            part.mesh = std::move( *mesh );
+
+            // local indices of voxels differ from global ones by the number of voxels in the previous layers
+            const auto voxelShift = indexer.sizeXY() * part.zBegin;
+            for ( auto& e : part.vertEdges )
+                e += 3 * voxelShift;
+            for ( auto& v : part.faceVoxels )
+                v += voxelShift;
+            assert( std::is_sorted( part.vertEdges.vec_.begin(), part.vertEdges.vec_.end() ) );
+            part.numOwnVerts = firstPart + i + 1 == numParts ? int( part.vertEdges.size() ) :
+                int( std::lower_bound( part.vertEdges.vec_.begin(), part.vertEdges.vec_.end(), 3 * indexer.sizeXY() * part.zEnd ) - part.vertEdges.vec_.begin() );
+        } );
+        for ( auto& error : errors )
+            if ( !error.empty() )
+                return unexpected( std::move( error ) );
+
+        for ( auto& part : wave )
+            pending.push_back( std::move( part ) );
+        wave = {};
+        const bool lastWave = firstPart + numWaveParts == numParts;
+        const size_t numReady = lastWave ? pending.size() : pending.size() - 1;
+        for ( size_t i = 0; i < numReady; ++i )
+        {
+            auto res = receiver( pending[i], i + 1 < pending.size() ? &pending[i + 1] : nullptr );
+            if ( !res )
+                return res;
+            // release the memory of processed part
+            pending[i] = {};
+        }
+        pending.erase( pending.begin(), pending.begin() + numReady );
+
+        if ( !reportProgress( params.cb, float( firstPart + numWaveParts ) / numParts ) )
+            return unexpectedOperationCanceled();
+    }
+    return {};
+}
+
+} // anonymous namespace
+
+Expected<Mesh> marchingCubesByParts( const Vector3i& dims, const VolumeLayersGetter& getLayers,
+    const MarchingCubesParams& params, const MarchingCubesByPartsParams& partsParams )
+{
+    MR_TIMER
+    auto partsCb = subprogress( params.cb, 0.0f, 0.8f );
+    auto p = params;
+    p.cb = partsCb;
+
+    VertCoords points;
+    Triangulation tris;
+    if ( params.outVoxelPerFaceMap )
+        params.outVoxelPerFaceMap->clear();
+    auto res = processParts( dims, getLayers, p, partsParams, params.outVoxelPerFaceMap != nullptr,
+        [&] ( const VolumePart& part, const VolumePart* next ) -> VoidOrErrStr
+    {
+        // own vertices of this part are followed by own vertices of next part in the result
+        const VertId firstVert( points.size() );
+        const VertId firstNextVert = firstVert + part.numOwnVerts;
+        if ( size_t( firstNextVert ) > size_t( params.maxVertices ) )
+            return unexpected( "Vertices number limit exceeded." );
+        points.vec_.insert( points.vec_.end(), part.mesh.points.vec_.begin(), part.mesh.points.vec_.begin() + part.numOwnVerts );
+
+        tris.reserve( tris.size() + part.mesh.tris.size() );
+        for ( const auto& t : part.mesh.tris )
+        {
+            ThreeVertIds resT;
+            for ( int i = 0; i < 3; ++i )
+            {
+                if ( t[i] < part.numOwnVerts )
+                {
+                    resT[i] = firstVert + t[i];
+                    continue;
+                }
+                assert( next );
+                auto nextV = findInNextPart( part, *next, t[i] );
+                if ( !nextV )
+                    return unexpected( std::move( nextV.error() ) );
+                resT[i] = firstNextVert + *nextV;
+            }
+            tris.push_back( resT );
+        }
+        if ( params.outVoxelPerFaceMap )
+            params.outVoxelPerFaceMap->vec_.insert( params.outVoxelPerFaceMap->vec_.end(), part.faceVoxels.vec_.begin(), part.faceVoxels.vec_.end() );
+        return {};
+    } );
+    if ( !res )
+        return unexpected( std::move( res.error() ) );
+
+    return Mesh::fromTriangles( std::move( points ), tris, {}, subprogress( params.cb, 0.8f, 1.0f ) );
+}
+
+VoidOrErrStr marchingCubesByParts( const Vector3i& dims, const VolumeLayersGetter& getLayers, const TrianglesReceiver& receiver,
+    const MarchingCubesParams& params, const MarchingCubesByPartsParams& partsParams )
+{
+    MR_TIMER
+    std::vector<Triangle3f> triangles;
+    return processParts( dims, getLayers, params, partsParams, false,
+        [&] ( const VolumePart& part, const VolumePart* next ) -> VoidOrErrStr
+    {
+        triangles.clear();
+        triangles.reserve( part.mesh.tris.size() );
+        for ( const auto& t : part.mesh.tris )
+        {
+            Triangle3f triangle;
+            for ( int i = 0; i < 3; ++i )
+            {
+                if ( t[i] < part.numOwnVerts )
+                {
+                    triangle[i] = part.mesh.points[t[i]];
+                    continue;
+                }
+                assert( next );
+                auto nextV = findInNextPart( part, *next, t[i] );
+                if ( !nextV )
+                    return unexpected( std::move( nextV.error() ) );
+                // take the coordinates from the next part to have exactly the same coordinates in adjacent triangles
+                triangle[i] = next->mesh.points[*nextV];
+            }
+            triangles.push_back( triangle );
+        }
+        return receiver( triangles );
+    } );
+}
+
+TEST( MRMesh, MarchingCubesByParts )
+{
+    SimpleVolume volume{ .dims = { 31, 27, 45 }, .voxelSize = Vector3f( 0.1f, 0.2f, 0.3f ), .min = -30, .max = 30 };
+    VolumeIndexer indexer( volume.dims );
+    volume.data.resize( indexer.size() );
+    const Vector3f center( 15, 13, 22 );
+    for ( size_t i = 0; i < indexer.size(); ++i )
+        volume.data[i] = ( Vector3f( indexer.toPos( VoxelId( i ) ) ) - center ).length() - 11.3f;
+
+    const VolumeLayersGetter getLayers = [&] ( int zBegin, int zEnd ) -> Expected<SimpleVolume>
+    {
+        SimpleVolume res{ .dims = { volume.dims.x, volume.dims.y, zEnd - zBegin }, .voxelSize = volume.voxelSize, .min = volume.min, .max = volume.max };
+        res.data.assign( volume.data.begin() + indexer.sizeXY() * zBegin, volume.data.begin() + indexer.sizeXY() * zEnd );
+        return res;
+    };
+
+    const MarchingCubesParams params{ .origin = Vector3f( 1, 2, 3 ), .lessInside = true };
+    auto ref = marchingCubes( volume, params );
+    ASSERT_TRUE( ref.has_value() );
+    for ( int layersPerPart : { 5, 11, 100 } )
+    {
+        auto res = marchingCubesByParts( volume.dims, getLayers, params, { .layersPerPart = layersPerPart, .maxMemoryUsage = 100000 } );
+        ASSERT_TRUE( res.has_value() );
+        EXPECT_EQ( res->topology.numValidVerts(), ref->topology.numValidVerts() );
+        EXPECT_EQ( res->topology.numValidFaces(), ref->topology.numValidFaces() );
+        EXPECT_EQ( res->topology.getTriangulation(), ref->topology.getTriangulation() );
+        EXPECT_NEAR( res->volume(), ref->volume(), 1e-3f );
+        EXPECT_TRUE( res->topology.isClosed() );
+
+        // the triangles of adjacent parts share exactly the same vertex coordinates
+        std::vector<Triangle3f> triangles;
+        auto streamRes = marchingCubesByParts( volume.dims, getLayers, [&] ( std::span<const Triangle3f> tris ) -> VoidOrErrStr
+        {
+            triangles.insert( triangles.end(), tris.begin(), tris.end() );
+            return {};
+        }, params, { .layersPerPart = layersPerPart } );
+        ASSERT_TRUE( streamRes.has_value() );
+        ASSERT_EQ( triangles.size(), res->topology.numValidFaces() );
+        for ( FaceId f( 0 ); f < triangles.size(); ++f )
+        {
+            const auto vs = res->topology.getTriVerts( f );
+            for ( int i = 0; i < 3; ++i )
+                EXPECT_EQ( triangles[f][i], res->points[vs[i]] );
+        }
+    }
+}
+
+} //namespace MR
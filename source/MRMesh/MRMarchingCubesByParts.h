@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MRMarchingCubes.h"
+#include <span>
+
+namespace MR
+{
+
+/// functor returning the voxel layers [zBegin, zEnd) of the volume as SimpleVolume with dimensions (dims.x, dims.y, zEnd - zBegin);
+/// it is called from parallel threads
+using VolumeLayersGetter = std::function<Expected<SimpleVolume>( int zBegin, int zEnd )>;
+
+/// functor receiving next portion of triangles in the order of increasing Z
+using TrianglesReceiver = std::function<VoidOrErrStr( std::span<const Triangle3f> tris )>;
+
+struct MarchingCubesByPartsParams
+{
+    /// the number of voxel layers along Z in each part (each part additionally loads the first layer of the next part)
+    int layersPerPart = 64;
+    /// the upper limit of memory used by simultaneously processed parts, it determines how many parts are processed in parallel
+    size_t maxMemoryUsage = size_t( 1 ) << 30; // 1 GiB
+};
+
+/// makes Mesh using Marching Cubes algorithm from a volume, which is loaded by parts of voxel layers, several parts in parallel;
+/// the vertices on the boundaries of parts are identified by the indices of voxel edges they are located on,
+/// so the parts are joined without cutting, and the result has the same triangulation as after marchingCubes() on the whole volume
+/// \param dims the dimensions of whole volume
+MRMESH_API Expected<Mesh> marchingCubesByParts( const Vector3i& dims, const VolumeLayersGetter& getLayers,
+    const MarchingCubesParams& params = {}, const MarchingCubesByPartsParams& partsParams = {} );
+
+/// finds the triangles using Marching Cubes algorithm in a volume, which is loaded by parts of voxel layers, several parts in parallel,
+/// and passes them in the receiver without making whole mesh in memory (e.g. to StlTriangleWriter);
+/// the vertices on the boundaries of parts have exactly the same coordinates in the triangles of both parts
+MRMESH_API VoidOrErrStr marchingCubesByParts( const Vector3i& dims, const VolumeLayersGetter& getLayers, const TrianglesReceiver& receiver,
+    const MarchingCubesParams& params = {}, const MarchingCubesByPartsParams& partsParams = {} );
+
+} //namespace MR
@@ -156,7 +156,15 @@ BooleanResult booleanImpl( Mesh&& meshA, Mesh&& meshB, BooleanOperation operatio
     bool needCutMeshA = operation != BooleanOperation::InsideB && operation != BooleanOperation::OutsideB;
     bool needCutMeshB = operation != BooleanOperation::InsideA && operation != BooleanOperation::OutsideA;
 
-    converters = getVectorConverters( meshA, meshB, params.rigidB2A );
+    MeshIntCoords intCoordsB;
+    if ( intParams.converters )
+    {
+        converters = *intParams.converters;
+        if ( intParams.intCoordsA )
+            intCoordsB = computeMeshIntCoords( meshB, converters.toInt, params.rigidB2A );
+    }
+    else
+        converters = getVectorConverters( meshA, meshB, params.rigidB2A );
 
     auto loneCb = subprogress( params.cb, 0.0f, 0.8f );
 
@@ -170,7 +178,10 @@ BooleanResult booleanImpl( Mesh&& meshA, Mesh&& meshB, BooleanOperation operatio
     for ( ;; iters++ )
     {
         // find intersections
-        intersections = findCollidingEdgeTrisPrecise( meshA, meshB, converters.toInt, params.rigidB2A );
+        if ( intParams.converters && intParams.intCoordsA && !aSubdivided && !bSubdivided )
+            intersections = findCollidingEdgeTrisPrecise( meshA, *intParams.intCoordsA, meshB, intCoordsB );
+        else
+            intersections = findCollidingEdgeTrisPrecise( meshA, meshB, converters.toInt, params.rigidB2A );
         // order intersections
         contours = orderIntersectionContours( meshA.topology, meshB.topology, intersections );
         // find lone
@@ -427,6 +438,47 @@ BooleanResult booleanImpl( Mesh&& meshA, Mesh&& meshB, BooleanOperation operatio
     return result;
 }
 
+BooleanSession::BooleanSession( const Mesh& meshA, const Box3f& workBox )
+    : meshA_( meshA )
+{
+    MR_TIMER
+    Box3d box( meshA.computeBoundingBox() );
+    box.include( Box3d( workBox ) );
+    setWorkBox_( box );
+}
+
+void BooleanSession::setWorkBox_( const Box3d& box )
+{
+    MR_TIMER
+    box_ = box;
+    converters_.toInt = getToIntConverter( box_ );
+    converters_.toFloat = getToFloatConverter( box_ );
+    intCoordsA_ = computeMeshIntCoords( meshA_, converters_.toInt );
+}
+
+BooleanResult BooleanSession::run( const Mesh& meshB, BooleanOperation operation, const BooleanParameters& params )
+{
+    MR_TIMER
+    const Box3d bBox( meshB.computeBoundingBox( params.rigidB2A ) );
+    if ( bBox.valid() && !( box_.contains( bBox.min ) && box_.contains( bBox.max ) ) )
+    {
+        // enlarge the box with a margin not to recompute the cache on each small movement outside
+        Box3d box = box_;
+        box.include( bBox );
+        const auto margin = 0.25 * box.size();
+        setWorkBox_( Box3d( box.min - margin, box.max + margin ) );
+    }
+    // build the tree for input mesh B for the cloned mesh to copy the tree
+    meshB.getAABBTree();
+    return booleanImpl( Mesh( meshA_ ), Mesh( meshB ), operation, params,
+        { .originalMeshA = &meshA_, .originalMeshB = &meshB, .converters = &converters_, .intCoordsA = &intCoordsA_ } );
+}
+
+size_t BooleanSession::heapBytes() const
+{
+    return intCoordsA_.heapBytes();
+}
+
 Expected<BooleanResultPoints, std::string> getBooleanPoints( const Mesh& meshA, const Mesh& meshB, 
     BooleanOperation operation, const AffineXf3f* rigidB2A )
 {
@@ -595,6 +647,73 @@ TEST( MRMesh, MeshBoolean )
     }
 }
 
+TEST( MRMesh, BooleanSession )
+{
+    Mesh meshA = makeTorus( 1.1f, 0.5f, 16, 16 );
+    Mesh meshB = makeTorus( 1.0f, 0.2f, 16, 16 );
+    meshB.transform( AffineXf3f::linear( Matrix3f::rotation( Vector3f::plusZ(), Vector3f::plusY() ) ) );
+
+    BooleanSession session( meshA, Box3f( Vector3f::diagonal( -3.0f ), Vector3f::diagonal( 3.0f ) ) );
+    const auto bytes = session.heapBytes();
+    EXPECT_GE( bytes, meshA.topology.numValidVerts() * sizeof( Vector3i ) );
+
+    for ( float shift : { 0.1f, 0.2f, 0.3f } )
+    {
+        const auto xf = AffineXf3f::translation( Vector3f( shift, 0.2f, 0.1f ) )
+            * AffineXf3f::linear( Matrix3f::rotation( Vector3f::plusX(), shift ) );
+        for ( auto op : { BooleanOperation::Union, BooleanOperation::Intersection, BooleanOperation::DifferenceAB } )
+        {
+            auto ref = boolean( meshA, meshB, op, &xf );
+            auto res = session.run( meshB, op, { .rigidB2A = &xf } );
+            ASSERT_TRUE( ref.valid() );
+            ASSERT_TRUE( res.valid() );
+            EXPECT_EQ( res->topology.numValidFaces(), ref->topology.numValidFaces() );
+            EXPECT_EQ( res->topology.numValidVerts(), ref->topology.numValidVerts() );
+            EXPECT_NEAR( res->volume(), ref->volume(), 1e-4f );
+        }
+    }
+    EXPECT_EQ( session.heapBytes(), bytes );
+
+    // mesh B out of the work box leads to cache recomputation
+    const auto farXf = AffineXf3f::translation( Vector3f( 3.0f, 0, 0 ) );
+    auto res = session.run( meshB, BooleanOperation::Union, { .rigidB2A = &farXf } );
+    EXPECT_TRUE( res.valid() );
+    EXPECT_GT( session.workBox().max.x, 4.0 );
+}
+
+TEST( MRMesh, OrderIntersectionContoursParallel )
+{
+    Mesh meshA = makeTorus( 1.1f, 0.5f, 256, 256 );
+    Mesh meshB = makeTorus( 1.0f, 0.2f, 256, 256 );
+    meshB.transform( AffineXf3f::linear( Matrix3f::rotation( Vector3f::plusZ(), Vector3f::plusY() ) ) );
+    const auto xf = AffineXf3f::translation( Vector3f( 0.1f, 0.2f, 0.1f ) );
+    const auto converters = getVectorConverters( meshA, meshB, &xf );
+
+    auto orderWithThreads = [&]( int numThreads )
+    {
+        tbb::global_control control( tbb::global_control::max_allowed_parallelism, numThreads );
+        const auto intersections = findCollidingEdgeTrisPrecise( meshA, meshB, converters.toInt, &xf );
+        auto contours = orderIntersectionContours( meshA.topology, meshB.topology, intersections );
+        return std::make_pair( intersections, contours );
+    };
+    const auto [serialInts, serialContours] = orderWithThreads( 1 );
+    const auto [parallelInts, parallelContours] = orderWithThreads( 4 );
+    EXPECT_GE( serialInts.edgesAtrisB.size() + serialInts.edgesBtrisA.size(), 1024 );
+    EXPECT_EQ( serialInts.edgesAtrisB, parallelInts.edgesAtrisB );
+    EXPECT_EQ( serialInts.edgesBtrisA, parallelInts.edgesBtrisA );
+
+    ASSERT_EQ( serialContours.size(), parallelContours.size() );
+    for ( size_t i = 0; i < serialContours.size(); ++i )
+    {
+        ASSERT_EQ( serialContours[i].size(), parallelContours[i].size() );
+        for ( size_t j = 0; j < serialContours[i].size(); ++j )
+        {
+            EXPECT_EQ( serialContours[i][j].edge, parallelContours[i][j].edge );
+            EXPECT_EQ( serialContours[i][j].tri, parallelContours[i][j].tri );
+            EXPECT_EQ( serialContours[i][j].isEdgeATriB, parallelContours[i][j].isEdgeATriB );
+        }
+    }
+}
 
 TEST( MRMesh, BooleanMultipleEdgePropogationSort )
 {
@@ -3,6 +3,8 @@
 #include "MRBooleanOperation.h"
 #include "MRContoursCut.h"
 #include "MRMesh.h"
+#include "MRMeshCollidePrecise.h"
+#include "MRBox.h"
 #include "MRBitSet.h"
 #include "MRExpected.h"
 #include <string>
@@ -92,6 +94,40 @@ MRMESH_API BooleanResult boolean( const Mesh& meshA, const Mesh& meshB, BooleanO
 MRMESH_API BooleanResult boolean( Mesh&& meshA, Mesh&& meshB, BooleanOperation operation,
                                   const BooleanParameters& params = {} );
 
+/** \brief Stateful boolean operations of one fixed mesh `A` with mesh `B` in different positions (or with different meshes `B`)
+  *
+  * \ingroup BooleanGroup
+  * The session builds the AABB tree of mesh `A` once, fixes the mapping of coordinates in integers
+  * and keeps integer coordinates of mesh `A` vertices and tree boxes,
+  * so each next operation only converts mesh `B`, finds the intersections and cuts the meshes
+  */
+class BooleanSession
+{
+public:
+    /// prepares the session for given mesh `A`, which must stay alive and unchanged while the session is used;
+    /// \param workBox the box in the space of mesh `A` where mesh `B` is expected to be;
+    /// the range of integer coordinates covers both it and the box of mesh `A`
+    MRMESH_API explicit BooleanSession( const Mesh& meshA, const Box3f& workBox = {} );
+
+    /// performs boolean operation of mesh `A` and given mesh `B` placed by params.rigidB2A;
+    /// if mesh `B` is out of current work box, then the box is enlarged and the cache of mesh `A` is recomputed
+    MRMESH_API BooleanResult run( const Mesh& meshB, BooleanOperation operation, const BooleanParameters& params = {} );
+
+    /// the box in the space of mesh `A` mapped in the range of integer coordinates
+    [[nodiscard]] const Box3d& workBox() const { return box_; }
+
+    /// returns the amount of memory occupied by the cached integer coordinates (the tree is counted in mesh `A`)
+    [[nodiscard]] MRMESH_API size_t heapBytes() const;
+
+private:
+    void setWorkBox_( const Box3d& box );
+
+    const Mesh& meshA_;
+    Box3d box_;
+    CoordinateConverters converters_;
+    MeshIntCoords intCoordsA_;
+};
+
 /// vertices and points representing mesh intersection result
 struct BooleanResultPoints
 {
@@ -1,11 +1,16 @@
 #include "MRMeshCollide.h"
 #include "MRAABBTree.h"
+#include "MRWideAABBTree.h"
 #include "MRMesh.h"
 #include "MRTriangleIntersection.h"
 #include "MRTimer.h"
+#include "MRBitSetParallelFor.h"
+#include "MRRegionBoundary.h"
+#include "MRTorus.h"
 #include "MRGTest.h"
 #include "MRPch/MRTBB.h"
 #include "MRExpected.h"
+#include <algorithm>
 #include <atomic>
 #include <thread>
 
@@ -19,6 +24,60 @@ struct NodeNode
     NodeNode( AABBTree::NodeId a, AABBTree::NodeId b ) : aNode( a ), bNode( b ) { }
 };
 
+/// checks candidate pairs of triangles with overlapping boxes exactly, and removes not-intersecting pairs
+static void filterCollidingTriangles( const MeshPart & a, const MeshPart & b, const AffineXf3f * rigidB2A, bool firstIntersectionOnly,
+    std::vector<FaceFace> & res )
+{
+    std::atomic<int> firstIntersection{ (int)res.size() };
+    tbb::parallel_for( tbb::blocked_range<int>( 0, (int)res.size() ),
+        [&]( const tbb::blocked_range<int>& range )
+    {
+        for ( int i = range.begin(); i < range.end(); ++i )
+        {
+            int knownIntersection = firstIntersection.load( std::memory_order_relaxed );
+            if ( firstIntersectionOnly && knownIntersection < i )
+                break;
+            Vector3f av[3], bv[3];
+            a.mesh.getTriPoints( res[i].aFace, av[0], av[1], av[2] );
+            b.mesh.getTriPoints( res[i].bFace, bv[0], bv[1], bv[2] );
+            if ( rigidB2A )
+            {
+                bv[0] = (*rigidB2A)( bv[0] );
+                bv[1] = (*rigidB2A)( bv[1] );
+                bv[2] = (*rigidB2A)( bv[2] );
+            }
+            if ( doTrianglesIntersect( Vector3d{ av[0] }, Vector3d{ av[1] }, Vector3d{ av[2] }, Vector3d{ bv[0] }, Vector3d{ bv[1] }, Vector3d{ bv[2] } ) )
+            {
+                if ( firstIntersectionOnly )
+                {
+                    while ( knownIntersection > i && !firstIntersection.compare_exchange_strong( knownIntersection, i ) ) { }
+                    break;
+                }
+            }
+            else
+            {
+                res[i].aFace = FaceId{}; //invalidate
+            }
+        }
+    } );
+
+    if ( firstIntersectionOnly )
+    {
+        int knownIntersection = firstIntersection.load( std::memory_order_relaxed );
+        if ( knownIntersection < res.size() )
+        {
+            res[0] = res[knownIntersection];
+            res.erase( res.begin() + 1, res.end() );
+        }
+        else
+            res.clear();
+    }
+    else
+    {
+        res.erase( std::remove_if( res.begin(), res.end(), []( const FaceFace & ff ) { return !ff.aFace.valid(); } ), res.end() );
+    }
+}
+
 std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const MeshPart & b, const AffineXf3f * rigidB2A, bool firstIntersectionOnly )
 {
     MR_TIMER;
@@ -84,55 +143,68 @@ std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const MeshPart
         }
     }
 
-    std::atomic<int> firstIntersection{ (int)res.size() };
-    tbb::parallel_for( tbb::blocked_range<int>( 0, (int)res.size() ),
-        [&]( const tbb::blocked_range<int>& range )
+    filterCollidingTriangles( a, b, rigidB2A, firstIntersectionOnly, res );
+    return res;
+}
+
+std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const WideAABBTree & aTree, const MeshPart & b, const WideAABBTree & bTree,
+    const AffineXf3f * rigidB2A, bool firstIntersectionOnly )
+{
+    MR_TIMER;
+
+    std::vector<FaceFace> res;
+    if ( aTree.empty() || bTree.empty() )
+        return res;
+
+    // child references are encoded as in WideAABBTreeNode::child, 0 means the root
+    struct ChildChild
     {
-        for ( int i = range.begin(); i < range.end(); ++i )
+        int aChild = 0;
+        int bChild = 0;
+        Box3f aBox;
+        Box3f bBox; ///< already transformed in A-space
+    };
+    std::vector<ChildChild> subtasks{ { 0, 0, aTree.getBoundingBox(), transformed( bTree.getBoundingBox(), rigidB2A ) } };
+
+    while( !subtasks.empty() )
+    {
+        const auto s = subtasks.back();
+        subtasks.pop_back();
+
+        if ( !s.aBox.intersection( s.bBox ).valid() )
+            continue;
+
+        const bool aLeaf = s.aChild < 0;
+        const bool bLeaf = s.bChild < 0;
+        if ( aLeaf && bLeaf )
         {
-            int knownIntersection = firstIntersection.load( std::memory_order_relaxed );
-            if ( firstIntersectionOnly && knownIntersection < i )
-                break;
-            Vector3f av[3], bv[3];
-            a.mesh.getTriPoints( res[i].aFace, av[0], av[1], av[2] );
-            b.mesh.getTriPoints( res[i].bFace, bv[0], bv[1], bv[2] );
-            if ( rigidB2A )
-            {
-                bv[0] = (*rigidB2A)( bv[0] );
-                bv[1] = (*rigidB2A)( bv[1] );
-                bv[2] = (*rigidB2A)( bv[2] );
-            }
-            if ( doTrianglesIntersect( Vector3d{ av[0] }, Vector3d{ av[1] }, Vector3d{ av[2] }, Vector3d{ bv[0] }, Vector3d{ bv[1] }, Vector3d{ bv[2] } ) )
-            {
-                if ( firstIntersectionOnly )
-                {
-                    while ( knownIntersection > i && !firstIntersection.compare_exchange_strong( knownIntersection, i ) ) { }
-                    break;
-                }
-            }
-            else
-            {
-                res[i].aFace = FaceId{}; //invalidate
-            }
+            const auto aFace = FaceId( ~s.aChild );
+            const auto bFace = FaceId( ~s.bChild );
+            if ( ( !a.region || a.region->test( aFace ) ) && ( !b.region || b.region->test( bFace ) ) )
+                res.emplace_back( aFace, bFace );
+            continue;
         }
-    } );
 
-    if ( firstIntersectionOnly )
-    {
-        int knownIntersection = firstIntersection.load( std::memory_order_relaxed );
-        if ( knownIntersection < res.size() )
+        if ( !aLeaf && ( bLeaf || s.aBox.volume() >= s.bBox.volume() ) )
         {
-            res[0] = res[knownIntersection];
-            res.erase( res.begin() + 1, res.end() );
+            // split a-node
+            const auto & aNode = aTree[s.aChild];
+            for ( int i = 0; i < WideAABBTree::Width; ++i )
+                if ( aNode.hasChild( i ) )
+                    subtasks.push_back( { aNode.child[i], s.bChild, aNode.childBox( i ), s.bBox } );
         }
         else
-            res.clear();
-    }
-    else
-    {
-        res.erase( std::remove_if( res.begin(), res.end(), []( const FaceFace & ff ) { return !ff.aFace.valid(); } ), res.end() );
+        {
+            assert( !bLeaf );
+            // split b-node
+            const auto & bNode = bTree[s.bChild];
+            for ( int i = 0; i < WideAABBTree::Width; ++i )
+                if ( bNode.hasChild( i ) )
+                    subtasks.push_back( { s.aChild, bNode.child[i], s.aBox, transformed( bNode.childBox( i ), rigidB2A ) } );
+        }
     }
 
+    filterCollidingTriangles( a, b, rigidB2A, firstIntersectionOnly, res );
     return res;
 }
 
@@ -220,6 +292,42 @@ static void processSelfSubtasks( const AABBTree & tree,
         }
 }
 
+/// checks whether two different triangles of one mesh collide, ignoring the triangles with common edge
+/// and the triangles touching only in common vertex
+static bool doSelfTrianglesCollide( const MeshPart & mp, const Face2RegionMap * regionMap, FaceId aFace, FaceId bFace )
+{
+    if ( mp.region && !mp.region->test( aFace ) )
+        return false;
+    if ( mp.region && !mp.region->test( bFace ) )
+        return false;
+    if ( mp.mesh.topology.sharedEdge( aFace, bFace ) )
+        return false;
+    if ( regionMap && (*regionMap)[aFace] != (*regionMap)[bFace] )
+        return false;
+
+    VertId av[3], bv[3];
+    mp.mesh.topology.getTriVerts( aFace, av[0], av[1], av[2] );
+    mp.mesh.topology.getTriVerts( bFace, bv[0], bv[1], bv[2] );
+
+    Vector3d ap[3], bp[3];
+    for ( int j = 0; j < 3; ++j )
+    {
+        ap[j] = Vector3d{ mp.mesh.points[av[j]] };
+        bp[j] = Vector3d{ mp.mesh.points[bv[j]] };
+    }
+
+    auto sv = sharedVertex( av, bv );
+    if ( sv.first >= 0 )
+    {
+        // shared vertex
+        const int j = sv.first;
+        const int k = sv.second;
+        return doTriangleSegmentIntersect( ap[0], ap[1], ap[2], bp[ ( k + 1 ) % 3 ], bp[ ( k + 2 ) % 3 ] ) ||
+               doTriangleSegmentIntersect( bp[0], bp[1], bp[2], ap[ ( j + 1 ) % 3 ], ap[ ( j + 2 ) % 3 ] );
+    }
+    return doTrianglesIntersectExt( ap[0], ap[1], ap[2], bp[0], bp[1], bp[2] );
+}
+
 Expected< std::vector<FaceFace>> findSelfCollidingTriangles( const MeshPart & mp, ProgressCallback cb, const Face2RegionMap * regionMap )
 {
     MR_TIMER
@@ -267,44 +375,10 @@ Expected< std::vector<FaceFace>> findSelfCollidingTriangles( const MeshPart & mp
             processSelfSubtasks( tree, mySubtasks, mySubtasks,
                 [&tree, &mp, &myRes, regionMap]( const NodeNode & s )
                 {
-                    const auto & aNode = tree[s.aNode];
-                    const auto & bNode = tree[s.bNode];
-                    const auto aFace = aNode.leafId();
-                    if ( mp.region && !mp.region->test( aFace ) )
-                        return;
-                    const auto bFace = bNode.leafId();
-                    if ( mp.region && !mp.region->test( bFace ) )
-                        return;
-                    if ( mp.mesh.topology.sharedEdge( aFace, bFace ) )
-                        return;
-                    if ( regionMap && (*regionMap)[aFace] != (*regionMap)[bFace] )
-                        return;
-
-                    VertId av[3], bv[3];
-                    mp.mesh.topology.getTriVerts( aFace, av[0], av[1], av[2] );
-                    mp.mesh.topology.getTriVerts( bFace, bv[0], bv[1], bv[2] );
-
-                    Vector3d ap[3], bp[3];
-                    for ( int j = 0; j < 3; ++j )
-                    {
-                        ap[j] = Vector3d{ mp.mesh.points[av[j]] };
-                        bp[j] = Vector3d{ mp.mesh.points[bv[j]] };
-                    }
-
-                    auto sv = sharedVertex( av, bv );
-                    if ( sv.first >= 0 )
-                    {
-                        // shared vertex
-                        const int j = sv.first;
-                        const int k = sv.second;
-                        if ( !doTriangleSegmentIntersect( ap[0], ap[1], ap[2], bp[ ( k + 1 ) % 3 ], bp[ ( k + 2 ) % 3 ] ) &&
-                             !doTriangleSegmentIntersect( bp[0], bp[1], bp[2], ap[ ( j + 1 ) % 3 ], ap[ ( j + 2 ) % 3 ] ) )
-                            return;
-                    }
-                    else if ( !doTrianglesIntersectExt( ap[0], ap[1], ap[2], bp[0], bp[1], bp[2] ) )
-                        return;
-                    myRes.emplace_back( aFace, bFace );
-
+                    const auto aFace = tree[s.aNode].leafId();
+                    const auto bFace = tree[s.bNode].leafId();
+                    if ( doSelfTrianglesCollide( mp, regionMap, aFace, bFace ) )
+                        myRes.emplace_back( aFace, bFace );
                 }
             );
 
@@ -356,6 +430,100 @@ Expected<FaceBitSet> findSelfCollidingTrianglesBS( const MeshPart & mp, Progress
     return res;
 }
 
+/// the pair with the smaller face first
+static FaceFace orderedPair( FaceId a, FaceId b )
+{
+    return a < b ? FaceFace( a, b ) : FaceFace( b, a );
+}
+
+static bool operator <( const FaceFace & a, const FaceFace & b )
+{
+    return std::tie( a.aFace, a.bFace ) < std::tie( b.aFace, b.bFace );
+}
+
+VoidOrErrStr SelfCollidingTriangles::init( const MeshPart & mp, ProgressCallback cb, const Face2RegionMap * regionMap )
+{
+    MR_TIMER
+    region_ = mp.region;
+    regionMap_ = regionMap;
+    pairs_.clear();
+    auto res = findSelfCollidingTriangles( mp, cb, regionMap );
+    if ( !res )
+        return unexpected( std::move( res.error() ) );
+    pairs_ = std::move( *res );
+    for ( auto & ff : pairs_ )
+        ff = orderedPair( ff.aFace, ff.bFace );
+    tbb::parallel_sort( pairs_.begin(), pairs_.end() );
+    return {};
+}
+
+void SelfCollidingTriangles::update( Mesh & mesh, const FaceBitSet & changedFaces )
+{
+    MR_TIMER
+    const auto & topology = mesh.topology;
+    auto isChanged = [&]( FaceId f ) { return changedFaces.test( f ) || !topology.hasFace( f ); };
+    std::erase_if( pairs_, [&]( const FaceFace & ff ) { return isChanged( ff.aFace ) || isChanged( ff.bFace ); } );
+
+    if ( mesh.getAABBTreeNotCreate() )
+        mesh.updateCaches( getIncidentVerts( topology, changedFaces & topology.getValidFaces() ) );
+    const auto & tree = mesh.getAABBTree();
+    if ( tree.nodes().empty() )
+        return;
+
+    const MeshPart mp( mesh, region_ );
+    tbb::enumerable_thread_specific<std::vector<FaceFace>> threadPairs;
+    BitSetParallelFor( changedFaces, [&]( FaceId f )
+    {
+        if ( !topology.hasFace( f ) || ( region_ && !region_->test( f ) ) )
+            return;
+        Box3f fBox;
+        for ( const auto & p : mesh.getTriPoints( f ) )
+            fBox.include( p );
+
+        auto & local = threadPairs.local();
+        constexpr int MaxStackSize = 64; // to avoid allocations
+        AABBTree::NodeId subtasks[MaxStackSize];
+        int stackSize = 0;
+        subtasks[stackSize++] = tree.rootNodeId();
+        while ( stackSize > 0 )
+        {
+            const auto & node = tree[subtasks[--stackSize]];
+            if ( !node.box.intersects( fBox ) )
+                continue;
+            if ( !node.leaf() )
+            {
+                assert( stackSize + 2 <= MaxStackSize );
+                subtasks[stackSize++] = node.l;
+                subtasks[stackSize++] = node.r;
+                continue;
+            }
+            const auto g = node.leafId();
+            // a pair of two changed faces is found only from the smaller face
+            if ( g == f || ( g < f && changedFaces.test( g ) ) )
+                continue;
+            if ( doSelfTrianglesCollide( mp, regionMap_, f, g ) )
+                local.push_back( orderedPair( f, g ) );
+        }
+    } );
+
+    const auto oldSize = pairs_.size();
+    for ( const auto & local : threadPairs )
+        pairs_.insert( pairs_.end(), local.begin(), local.end() );
+    tbb::parallel_sort( pairs_.begin() + oldSize, pairs_.end() );
+    std::inplace_merge( pairs_.begin(), pairs_.begin() + oldSize, pairs_.end() );
+}
+
+FaceBitSet SelfCollidingTriangles::faces() const
+{
+    FaceBitSet res;
+    for ( const auto & ff : pairs_ )
+    {
+        res.autoResizeSet( ff.aFace );
+        res.autoResizeSet( ff.bFace );
+    }
+    return res;
+}
+
 bool isInside( const MeshPart & a, const MeshPart & b, const AffineXf3f * rigidB2A )
 {
     auto cols = findCollidingTriangles( a, b, rigidB2A );
@@ -400,4 +568,53 @@ TEST( MRMesh, DegenerateTrianglesIntersect )
     EXPECT_FALSE( intersection );
 }
 
+TEST( MRMesh, SelfCollidingTrianglesUpdate )
+{
+    auto mesh = makeTorus( 1.0f, 0.3f, 64, 32 );
+    SelfCollidingTriangles tracker;
+    ASSERT_TRUE( tracker.init( mesh ).has_value() );
+    EXPECT_TRUE( tracker.pairs().empty() );
+
+    auto checkSameAsFull = [&]()
+    {
+        auto full = findSelfCollidingTriangles( mesh );
+        ASSERT_TRUE( full.has_value() );
+        for ( auto & ff : *full )
+            ff = orderedPair( ff.aFace, ff.bFace );
+        std::sort( full->begin(), full->end() );
+        EXPECT_EQ( tracker.pairs(), *full );
+    };
+
+    // push a part of the torus through its opposite side
+    VertBitSet moved( mesh.topology.vertSize() );
+    for ( auto v : mesh.topology.getValidVerts() )
+        if ( mesh.points[v].x > 0.9f )
+            moved.set( v );
+    auto changedFaces = getIncidentFaces( mesh.topology, moved );
+    for ( auto v : moved )
+        mesh.points[v].x -= 1.8f;
+    tracker.update( mesh, changedFaces );
+    EXPECT_FALSE( tracker.pairs().empty() );
+    checkSameAsFull();
+
+    // move only a subset of them back
+    VertBitSet movedBack( mesh.topology.vertSize() );
+    for ( auto v : moved )
+        if ( mesh.points[v].y > 0 )
+            movedBack.set( v );
+    changedFaces = getIncidentFaces( mesh.topology, movedBack );
+    for ( auto v : movedBack )
+        mesh.points[v].x += 1.8f;
+    tracker.update( mesh, changedFaces );
+    checkSameAsFull();
+
+    // restore the original torus
+    changedFaces = getIncidentFaces( mesh.topology, moved - movedBack );
+    for ( auto v : moved - movedBack )
+        mesh.points[v].x += 1.8f;
+    tracker.update( mesh, changedFaces );
+    EXPECT_TRUE( tracker.pairs().empty() );
+    EXPECT_EQ( tracker.faces().count(), 0 );
+}
+
 } //namespace MR
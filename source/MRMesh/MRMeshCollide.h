@@ -4,6 +4,7 @@
 #include "MRMeshPart.h"
 #include "MRProgressCallback.h"
 #include "MRExpected.h"
+#include <vector>
 
 namespace MR
 {
@@ -19,6 +20,10 @@ namespace MR
 MRMESH_API std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const MeshPart & b, 
     const AffineXf3f * rigidB2A = nullptr, bool firstIntersectionOnly = false );
 
+/// the same as \ref findCollidingTriangles, but uses given compact wide BVH-trees of both mesh parts instead of cached binary trees
+MRMESH_API std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const WideAABBTree & aTree, const MeshPart & b, const WideAABBTree & bTree,
+    const AffineXf3f * rigidB2A = nullptr, bool firstIntersectionOnly = false );
+
 /// the same as \ref findCollidingTriangles, but returns one bite set per mesh with colliding triangles
 MRMESH_API std::pair<FaceBitSet, FaceBitSet> findCollidingTriangleBitsets( const MeshPart& a, const MeshPart& b,
     const AffineXf3f* rigidB2A = nullptr );
@@ -30,7 +35,36 @@ MRMESH_API Expected< std::vector<FaceFace>> findSelfCollidingTriangles( const Me
 /// the same \ref findSelfCollidingTriangles but returns the union of all self-intersecting faces
 MRMESH_API Expected<FaceBitSet> findSelfCollidingTrianglesBS( const MeshPart & mp, ProgressCallback cb = {},
     const Face2RegionMap * regionMap = nullptr ); ///< if regionMap is provided then only self-intersections within a region are returned
- 
+
+/// keeps all pairs of self-colliding triangles of a mesh (or a region) and updates them after local modifications of the mesh,
+/// testing only modified faces against the AABB tree, which is much faster than new call of \ref findSelfCollidingTriangles
+class SelfCollidingTriangles
+{
+public:
+    /// finds all pairs of colliding triangles in given mesh part;
+    /// the region and region map (if given) must remain alive while this object is updated
+    MRMESH_API VoidOrErrStr init( const MeshPart & mp, ProgressCallback cb = {},
+        const Face2RegionMap * regionMap = nullptr ); ///< if regionMap is provided then only self-intersections within a region are considered
+
+    /// updates the pairs after local modification of the mesh:
+    /// \param changedFaces all faces with moved vertices (including the faces around moved vertices) and new faces;
+    /// the pairs with changed and deleted faces are removed, and the pairs of changed faces with all faces are found again;
+    /// if the mesh has AABB tree then it is refit for the vertices of changed faces, which requires the same topology of the tree,
+    /// so after deletion or creation of faces the caller must invalidate the caches of the mesh before this call
+    MRMESH_API void update( Mesh & mesh, const FaceBitSet & changedFaces );
+
+    /// all pairs of colliding triangles, each pair as aFace < bFace, sorted
+    [[nodiscard]] const std::vector<FaceFace> & pairs() const { return pairs_; }
+
+    /// the union of all self-colliding faces
+    [[nodiscard]] MRMESH_API FaceBitSet faces() const;
+
+private:
+    std::vector<FaceFace> pairs_;
+    const FaceBitSet * region_ = nullptr;
+    const Face2RegionMap * regionMap_ = nullptr;
+};
+
 /**
  * \brief checks that arbitrary mesh part A is inside of closed mesh part B
  * \param rigidB2A rigid transformation from B-mesh space to A mesh space, nullptr considered as identity transformation
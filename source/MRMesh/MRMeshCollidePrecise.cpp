@@ -4,6 +4,8 @@
 #include "MRPrecisePredicates3.h"
 #include "MRFaceFace.h"
 #include "MRTimer.h"
+#include "MRBitSetParallelFor.h"
+#include "MRParallelFor.h"
 #include "MRPch/MRTBB.h"
 #include <array>
 
@@ -23,11 +25,15 @@ struct NodeNode
     NodeNode( AABBTree::NodeId a, AABBTree::NodeId b ) : aNode( a ), bNode( b ) { }
 };
 
-PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const MeshPart & b, 
-    ConvertToIntVector conv, const AffineXf3f * rigidB2A, bool anyIntersection )
+namespace
 {
-    MR_TIMER;
 
+/// \param aPoint and bPoint return integer coordinates of a vertex from the mesh (B is in A mesh space),
+/// \param aNodeBox and bNodeBox return integer box of a node of the mesh's AABB tree
+template<typename APoint, typename BPoint, typename ABox, typename BBox>
+PreciseCollisionResult findCollidingEdgeTrisPreciseT( const MeshPart & a, const MeshPart & b,
+    const APoint & aPoint, const BPoint & bPoint, const ABox & aNodeBox, const BBox & bNodeBox, bool anyIntersection )
+{
     PreciseCollisionResult res;
     const AABBTree & aTree = a.mesh.getAABBTree();
     const AABBTree & bTree = b.mesh.getAABBTree();
@@ -49,10 +55,7 @@ PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const M
             const auto & bNode = bTree[s.bNode];
 
             // check intersection in int boxes for consistency with precise intersections
-            auto transformedBoxb = transformed( bNode.box, rigidB2A );
-            Box3i aBox{ conv( aNode.box.min ),conv( aNode.box.max ) };
-            Box3i bBox{ conv( transformedBoxb.min ),conv( transformedBoxb.max ) };
-            if ( !aBox.intersects( bBox ) )
+            if ( !aNodeBox( s.aNode ).intersects( bNodeBox( s.bNode ) ) )
                 continue;
 
             if ( aNode.leaf() && bNode.leaf() )
@@ -107,9 +110,8 @@ PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const M
 
         for ( int j = 0; j < 3; ++j )
         {
-            avc[j].pt = conv( a.mesh.points[avc[j].id] );
-            const auto bf = b.mesh.points[bvc[j].id];
-            bvc[j].pt = conv( rigidB2A ? (*rigidB2A)( bf ) : bf );
+            avc[j].pt = aPoint( avc[j].id );
+            bvc[j].pt = bPoint( bvc[j].id );
             bvc[j].id += aVertsSize;
         }
 
@@ -190,10 +192,7 @@ PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const M
                 const auto & bNode = bTree[s.bNode];
 
                 // check intersection in int boxes for consistency with precise intersections
-                auto transformedBoxb = transformed( bNode.box, rigidB2A );
-                Box3i aBox{ conv( aNode.box.min ),conv( aNode.box.max ) };
-                Box3i bBox{ conv( transformedBoxb.min ),conv( transformedBoxb.max ) };
-                if ( !aBox.intersects( bBox ) )
+                if ( !aNodeBox( s.aNode ).intersects( bNodeBox( s.bNode ) ) )
                     continue;
 
                 if ( aNode.leaf() && bNode.leaf() )
@@ -231,24 +230,88 @@ PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const M
         }
     } );
 
-    // unite results from sub-trees into final vectors
-    size_t colsAB = 0, colsBA = 0;
-    for ( const auto & s : subtaskRes )
+    // unite results from sub-trees into final vectors in the order of subtasks,
+    // each subtask copies its results in parallel to the precomputed positions
+    std::vector<size_t> posAB( subtaskRes.size() + 1, 0 ), posBA( subtaskRes.size() + 1, 0 );
+    for ( size_t i = 0; i < subtaskRes.size(); ++i )
     {
-        colsAB += s.edgesAtrisB.size();
-        colsBA += s.edgesBtrisA.size();
+        posAB[i + 1] = posAB[i] + subtaskRes[i].edgesAtrisB.size();
+        posBA[i + 1] = posBA[i] + subtaskRes[i].edgesBtrisA.size();
     }
-    res.edgesAtrisB.reserve( colsAB );
-    res.edgesBtrisA.reserve( colsBA );
-    for ( const auto & s : subtaskRes )
+    res.edgesAtrisB.resize( posAB.back() );
+    res.edgesBtrisA.resize( posBA.back() );
+    ParallelFor( subtaskRes, [&]( size_t i )
     {
-        res.edgesAtrisB.insert( res.edgesAtrisB.end(), s.edgesAtrisB.begin(), s.edgesAtrisB.end() );
-        res.edgesBtrisA.insert( res.edgesBtrisA.end(), s.edgesBtrisA.begin(), s.edgesBtrisA.end() );
-    }
+        const auto & s = subtaskRes[i];
+        std::copy( s.edgesAtrisB.begin(), s.edgesAtrisB.end(), res.edgesAtrisB.begin() + posAB[i] );
+        std::copy( s.edgesBtrisA.begin(), s.edgesBtrisA.end(), res.edgesBtrisA.begin() + posBA[i] );
+    } );
 
     return res;
 }
 
+} // anonymous namespace
+
+PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const MeshPart & b, 
+    ConvertToIntVector conv, const AffineXf3f * rigidB2A, bool anyIntersection )
+{
+    MR_TIMER;
+    const AABBTree & aTree = a.mesh.getAABBTree();
+    const AABBTree & bTree = b.mesh.getAABBTree();
+    return findCollidingEdgeTrisPreciseT( a, b,
+        [&]( VertId v ) { return conv( a.mesh.points[v] ); },
+        [&]( VertId v )
+        {
+            const auto bf = b.mesh.points[v];
+            return conv( rigidB2A ? (*rigidB2A)( bf ) : bf );
+        },
+        [&]( AABBTree::NodeId n )
+        {
+            const auto & box = aTree[n].box;
+            return Box3i{ conv( box.min ), conv( box.max ) };
+        },
+        [&]( AABBTree::NodeId n )
+        {
+            const auto box = transformed( bTree[n].box, rigidB2A );
+            return Box3i{ conv( box.min ), conv( box.max ) };
+        },
+        anyIntersection );
+}
+
+PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const MeshIntCoords & aInt,
+    const MeshPart & b, const MeshIntCoords & bInt, bool anyIntersection )
+{
+    MR_TIMER;
+    assert( aInt.nodeBoxes.size() == a.mesh.getAABBTree().nodes().size() );
+    assert( bInt.nodeBoxes.size() == b.mesh.getAABBTree().nodes().size() );
+    return findCollidingEdgeTrisPreciseT( a, b,
+        [&]( VertId v ) { return aInt.points[v]; },
+        [&]( VertId v ) { return bInt.points[v]; },
+        [&]( AABBTree::NodeId n ) { return aInt.nodeBoxes[n]; },
+        [&]( AABBTree::NodeId n ) { return bInt.nodeBoxes[n]; },
+        anyIntersection );
+}
+
+MeshIntCoords computeMeshIntCoords( const Mesh & mesh, const ConvertToIntVector & conv, const AffineXf3f* xf )
+{
+    MR_TIMER;
+    MeshIntCoords res;
+    const auto & tree = mesh.getAABBTree();
+    res.points.resize( mesh.points.size() );
+    res.nodeBoxes.resize( tree.nodes().size() );
+    BitSetParallelFor( mesh.topology.getValidVerts(), [&]( VertId v )
+    {
+        res.points[v] = conv( xf ? (*xf)( mesh.points[v] ) : mesh.points[v] );
+    } );
+    ParallelFor( res.nodeBoxes, [&]( size_t i )
+    {
+        // the same conversion as in findCollidingEdgeTrisPrecise with converter
+        const auto box = transformed( tree[AABBTree::NodeId( int( i ) )].box, xf );
+        res.nodeBoxes[i] = Box3i{ conv( box.min ), conv( box.max ) };
+    } );
+    return res;
+}
+
 std::vector<EdgeTri> findCollidingEdgeTrisPrecise( 
     const Mesh & a, const std::vector<EdgeId> & edgesA,
     const Mesh & b, const std::vector<FaceId> & facesB,
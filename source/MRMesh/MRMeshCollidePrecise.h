@@ -2,6 +2,8 @@
 
 #include "MRId.h"
 #include "MRMeshPart.h"
+#include "MRVector.h"
+#include "MRBox.h"
 #include <functional>
 
 namespace MR
@@ -50,6 +52,29 @@ struct CoordinateConverters
 MRMESH_API PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const MeshPart & b, 
     ConvertToIntVector conv, const AffineXf3f* rigidB2A = nullptr, bool anyIntersection = false );
 
+/// integer coordinates of all mesh vertices and of the boxes of all nodes of its AABB tree computed by some converter;
+/// they can be computed once and reused in many calls of findCollidingEdgeTrisPrecise with the same converter
+struct MeshIntCoords
+{
+    /// integer coordinates of the vertices
+    Vector<Vector3i, VertId> points;
+    /// integer boxes of AABB tree nodes with the same indices as in the tree
+    std::vector<Box3i> nodeBoxes;
+
+    [[nodiscard]] size_t heapBytes() const { return points.heapBytes() + nodeBoxes.capacity() * sizeof( Box3i ); }
+};
+
+/**
+ * \brief converts the coordinates of all valid vertices of the mesh and the boxes of its AABB tree in integers
+ * \param xf optional transformation applied to the mesh before conversion, e.g. rigidB2A for the second mesh
+ */
+[[nodiscard]] MRMESH_API MeshIntCoords computeMeshIntCoords( const Mesh & mesh, const ConvertToIntVector & conv, const AffineXf3f* xf = nullptr );
+
+/// the same as findCollidingEdgeTrisPrecise above, but takes integer coordinates of both meshes (computed by the same converter) instead of the converter;
+/// bInt must already include the transformation from B-mesh space to A mesh space
+MRMESH_API PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const MeshIntCoords & aInt,
+    const MeshPart & b, const MeshIntCoords & bInt, bool anyIntersection = false );
+
 /// finds all intersections between every given edge from A and given triangles from B
 MRMESH_API std::vector<EdgeTri> findCollidingEdgeTrisPrecise( 
     const Mesh & a, const std::vector<EdgeId> & edgesA,
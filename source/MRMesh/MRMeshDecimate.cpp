@@ -7,12 +7,16 @@
 #include "MRTriMath.h"
 #include "MRTimer.h"
 #include "MRCylinder.h"
+#include "MRMakeSphereMesh.h"
 #include "MRGTest.h"
 #include "MRMeshDelone.h"
 #include "MRMeshSubdivide.h"
 #include "MRMeshRelax.h"
 #include "MRLineSegm.h"
+#include "MRParallelFor.h"
 #include "MRPch/MRTBB.h"
+#include <atomic>
+#include <bit>
 #include <queue>
 
 namespace MR
@@ -179,8 +183,6 @@ private:
     std::priority_queue<QueueElement> queue_;
     UndirectedEdgeBitSet presentInQueue_;
     DecimateResult res_;
-    std::vector<VertId> originNeis_;
-    std::vector<Vector3f> triDblAreas_; // directed double areas of newly formed triangles to check that they are consistently oriented
     class EdgeMetricCalc;
 
     bool initializeQueue_();
@@ -209,7 +211,28 @@ private:
         CollapseStatus status = CollapseStatus::Done;
     };
 
+    /// temporary buffers used during collapse checks, one per thread
+    struct CollapseCheckBuffers
+    {
+        std::vector<VertId> originNeis;
+        std::vector<Vector3f> triDblAreas; // directed double areas of newly formed triangles to check that they are consistently oriented
+    };
+    /// checks all geometric and topological criteria of the collapse without changing the mesh;
+    /// edgeToCollapse can be reversed to have its origin in remaining vertex
+    CollapseStatus canCollapse_( EdgeId & edgeToCollapse, const Vector3f & collapsePos, CollapseCheckBuffers & bufs ) const;
+    /// calls user preCollapse callback, and performs the collapse already checked by canCollapse_
+    CollapseRes performCollapse_( EdgeId edgeToCollapse, const Vector3f & collapsePos );
     CollapseRes collapse_( EdgeId edgeToCollapse, const Vector3f & collapsePos );
+    CollapseCheckBuffers checkBufs_;
+
+    /// the main loop of sequential decimation, returns false if the operation was canceled
+    bool processQueue_();
+    /// the main loop of decimation by rounds of independent collapses, returns false if the operation was canceled
+    bool processIndependentSets_();
+    /// calls given function for each vertex affected by the collapse or flip of given edge:
+    /// both edge's ends and all their neighbors
+    template <typename F>
+    void forEachAffectedVert_( UndirectedEdgeId ue, F && f ) const;
 };
 
 MeshDecimator::MeshDecimator( Mesh & mesh, const DecimateSettings & settings )
@@ -361,6 +384,10 @@ bool MeshDecimator::initializeQueue_()
     else if ( settings_.edgesToCollapse )
         regionEdges_ = *settings_.edgesToCollapse;
 
+    // in the mode of independent sets, the costs of all edges are computed in the first round
+    if ( settings_.independentSets )
+        return true;
+
     EdgeMetricCalc calc( *this );
     parallel_reduce( tbb::blocked_range<UndirectedEdgeId>( UndirectedEdgeId{0}, UndirectedEdgeId{mesh_.topology.undirectedEdgeSize()} ), calc );
 
@@ -460,9 +487,9 @@ void MeshDecimator::addInQueueIfMissing_( UndirectedEdgeId ue )
     }
 }
 
-auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapsePos ) -> CollapseRes
+auto MeshDecimator::canCollapse_( EdgeId & edgeToCollapse, const Vector3f & collapsePos, CollapseCheckBuffers & bufs ) const -> CollapseStatus
 {
-    auto & topology = mesh_.topology;
+    const auto & topology = mesh_.topology;
     auto vl = topology.left( edgeToCollapse ).valid()  ? topology.dest( topology.next( edgeToCollapse ) ) : VertId{};
     auto vr = topology.right( edgeToCollapse ).valid() ? topology.dest( topology.prev( edgeToCollapse ) ) : VertId{};
 
@@ -470,9 +497,9 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
     if ( vl && vr )
     {
         if ( auto pe = topology.prev( edgeToCollapse ); pe != edgeToCollapse && pe == topology.next( edgeToCollapse ) )
-            return { .status =  CollapseStatus::SharedEdge };
+            return CollapseStatus::SharedEdge;
         if ( auto pe = topology.prev( edgeToCollapse.sym() ); pe != edgeToCollapse.sym() && pe == topology.next( edgeToCollapse.sym() ) )
-            return { .status =  CollapseStatus::SharedEdge };
+            return CollapseStatus::SharedEdge;
     }
     const bool collapsingFlippable = !settings_.notFlippable || !settings_.notFlippable->test( edgeToCollapse );
 
@@ -496,20 +523,20 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
     if ( ( !vl || !vr ) && settings_.maxBdShift < FLT_MAX )
     {
         if ( !smallShift( mesh_.edgeSegment( edgeToCollapse ), collapsePos ) )
-            return { .status =  CollapseStatus::PosFarBd }; // new vertex is too far from collapsing boundary edge
+            return CollapseStatus::PosFarBd; // new vertex is too far from collapsing boundary edge
         if ( !vr )
         {
             if ( !smallShift( LineSegm3f{ mesh_.orgPnt( mesh_.topology.prevLeftBd( edgeToCollapse ) ), collapsePos }, po ) )
-                return { .status =  CollapseStatus::PosFarBd }; // origin of collapsing boundary edge is too far from new boundary segment
+                return CollapseStatus::PosFarBd; // origin of collapsing boundary edge is too far from new boundary segment
             if ( !smallShift( LineSegm3f{ mesh_.destPnt( mesh_.topology.nextLeftBd( edgeToCollapse ) ), collapsePos }, pd ) )
-                return { .status =  CollapseStatus::PosFarBd }; // destination of collapsing boundary edge is too far from new boundary segment
+                return CollapseStatus::PosFarBd; // destination of collapsing boundary edge is too far from new boundary segment
         }
         if ( !vl )
         {
             if ( !smallShift( LineSegm3f{ mesh_.orgPnt( mesh_.topology.prevLeftBd( edgeToCollapse.sym() ) ), collapsePos }, pd ) )
-                return { .status =  CollapseStatus::PosFarBd }; // destination of collapsing boundary edge is too far from new boundary segment
+                return CollapseStatus::PosFarBd; // destination of collapsing boundary edge is too far from new boundary segment
             if ( !smallShift( LineSegm3f{ mesh_.destPnt( mesh_.topology.nextLeftBd( edgeToCollapse.sym() ) ), collapsePos }, po ) )
-                return { .status =  CollapseStatus::PosFarBd }; // origin of collapsing boundary edge is too far from new boundary segment
+                return CollapseStatus::PosFarBd; // origin of collapsing boundary edge is too far from new boundary segment
         }
     }
 
@@ -520,17 +547,17 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
     float maxNewEdgeLenSq = 0;
 
     bool normalFlip = false; // at least one triangle flips its normal or a degenerate triangle becomes not-degenerate
-    originNeis_.clear();
-    triDblAreas_.clear();
+    bufs.originNeis.clear();
+    bufs.triDblAreas.clear();
     Vector3d sumDblArea_;
     EdgeId oBdEdge; // a boundary edge !right(e) incident to org( edgeToCollapse )
     for ( EdgeId e : orgRing0( topology, edgeToCollapse ) )
     {
         const auto eDest = topology.dest( e );
         if ( eDest == vd )
-            return { .status =  CollapseStatus::MultipleEdge }; // multiple edge found
+            return CollapseStatus::MultipleEdge; // multiple edge found
         if ( eDest != vl && eDest != vr )
-            originNeis_.push_back( eDest );
+            bufs.originNeis.push_back( eDest );
 
         const auto pDest = mesh_.points[eDest];
         maxOldEdgeLenSq = std::max( maxOldEdgeLenSq, ( po - pDest ).lengthSq() );
@@ -542,7 +569,7 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
             continue;
         }
         if ( collapsingFlippable && settings_.notFlippable && settings_.notFlippable->test( e ) )
-            return { .status =  CollapseStatus::Flippable }; // cannot collapse a flippable edge incident to a not-flippable edge
+            return CollapseStatus::Flippable; // cannot collapse a flippable edge incident to a not-flippable edge
 
         const auto pDest2 = mesh_.destPnt( topology.next( e ) );
         if ( eDest != vr )
@@ -554,11 +581,11 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
                 if ( dot( da, oldA ) <= 0 )
                     normalFlip = true;
             }
-            triDblAreas_.push_back( da );
+            bufs.triDblAreas.push_back( da );
             sumDblArea_ += Vector3d{ da };
             const auto triAspect = triangleAspectRatio( collapsePos, pDest, pDest2 );
             if ( triAspect >= settings_.criticalTriAspectRatio )
-                triDblAreas_.back() = Vector3f{}; //cannot trust direction of degenerate triangles
+                bufs.triDblAreas.back() = Vector3f{}; //cannot trust direction of degenerate triangles
             maxNewAspectRatio = std::max( maxNewAspectRatio, triAspect );
         }
         maxOldAspectRatio = std::max( maxOldAspectRatio, triangleAspectRatio( po, pDest, pDest2 ) );
@@ -566,16 +593,16 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
     if ( oBdEdge
         && !smallShift( LineSegm3f{ po, mesh_.destPnt( oBdEdge ) }, collapsePos )
         && !smallShift( LineSegm3f{ po, mesh_.orgPnt( topology.prevLeftBd( oBdEdge ) ) }, collapsePos ) )
-            return { .status =  CollapseStatus::PosFarBd }; // new vertex is too far from both existed boundary edges
-    std::sort( originNeis_.begin(), originNeis_.end() );
+            return CollapseStatus::PosFarBd; // new vertex is too far from both existed boundary edges
+    std::sort( bufs.originNeis.begin(), bufs.originNeis.end() );
 
     EdgeId dBdEdge; // a boundary edge !right(e) incident to dest( edgeToCollapse )
     for ( EdgeId e : orgRing0( topology, edgeToCollapse.sym() ) )
     {
         const auto eDest = topology.dest( e );
         assert ( eDest != vo );
-        if ( std::binary_search( originNeis_.begin(), originNeis_.end(), eDest ) )
-            return { .status =  CollapseStatus::MultipleEdge }; // to prevent appearance of multiple edges
+        if ( std::binary_search( bufs.originNeis.begin(), bufs.originNeis.end(), eDest ) )
+            return CollapseStatus::MultipleEdge; // to prevent appearance of multiple edges
 
         const auto pDest = mesh_.points[eDest];
         maxOldEdgeLenSq = std::max( maxOldEdgeLenSq, ( pd - pDest ).lengthSq() );
@@ -587,7 +614,7 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
             continue;
         }
         if ( collapsingFlippable && settings_.notFlippable && settings_.notFlippable->test( e ) )
-            return { .status =  CollapseStatus::Flippable }; // cannot collapse a flippable edge incident to a not-flippable edge
+            return CollapseStatus::Flippable; // cannot collapse a flippable edge incident to a not-flippable edge
 
         const auto pDest2 = mesh_.destPnt( topology.next( e ) );
         if ( eDest != vl )
@@ -599,11 +626,11 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
                 if ( dot( da, oldA ) <= 0 )
                     normalFlip = true;
             }
-            triDblAreas_.push_back( da );
+            bufs.triDblAreas.push_back( da );
             sumDblArea_ += Vector3d{ da };
             const auto triAspect = triangleAspectRatio( collapsePos, pDest, pDest2 );
             if ( triAspect >= settings_.criticalTriAspectRatio )
-                triDblAreas_.back() = Vector3f{}; //cannot trust direction of degenerate triangles
+                bufs.triDblAreas.back() = Vector3f{}; //cannot trust direction of degenerate triangles
             maxNewAspectRatio = std::max( maxNewAspectRatio, triAspect );
         }
         maxOldAspectRatio = std::max( maxOldAspectRatio, triangleAspectRatio( pd, pDest, pDest2 ) );
@@ -611,32 +638,41 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
     if ( dBdEdge
         && !smallShift( LineSegm3f{ pd, mesh_.destPnt( dBdEdge ) }, collapsePos )
         && !smallShift( LineSegm3f{ pd, mesh_.orgPnt( topology.prevLeftBd( dBdEdge ) ) }, collapsePos ) )
-            return { .status =  CollapseStatus::PosFarBd }; // new vertex is too far from both existed boundary edges
+            return CollapseStatus::PosFarBd; // new vertex is too far from both existed boundary edges
 
     if ( vl && vr && oBdEdge && dBdEdge )
-        return { .status =  CollapseStatus::TouchBd }; // prohibit collapse of an inner edge if it brings two boundaries in touch
+        return CollapseStatus::TouchBd; // prohibit collapse of an inner edge if it brings two boundaries in touch
 
     // special treatment for short edges on the last stage when collapse position is equal to one of edge's ends
     const bool tinyEdge = ( settings_.tinyEdgeLength >= 0 && ( po == collapsePos || pd == collapsePos ) )
         ? edgeLenSq <= sqr( settings_.tinyEdgeLength ) : false;
     if ( !tinyEdge && maxNewAspectRatio > maxOldAspectRatio && maxOldAspectRatio <= settings_.criticalTriAspectRatio )
-        return { .status =  CollapseStatus::TriAspect }; // new triangle aspect ratio would be larger than all of old triangle aspect ratios and larger than allowed in settings
+        return CollapseStatus::TriAspect; // new triangle aspect ratio would be larger than all of old triangle aspect ratios and larger than allowed in settings
 
     if ( maxNewEdgeLenSq > maxOldEdgeLenSq )
-        return { .status =  CollapseStatus::LongEdge }; // new edge would be longer than all of old edges and longer than allowed in settings
+        return CollapseStatus::LongEdge; // new edge would be longer than all of old edges and longer than allowed in settings
 
     // if at least one triangle normal flips, checks that all new normals are consistent
     if ( normalFlip && ( ( po != pd ) || ( po != collapsePos ) ) )
     {
         auto n = Vector3f{ sumDblArea_.normalized() };
-        for ( const auto da : triDblAreas_ )
+        for ( const auto da : bufs.triDblAreas )
             if ( dot( da, n ) < 0 )
-                return { .status =  CollapseStatus::NormalFlip };
+                return CollapseStatus::NormalFlip;
     }
 
+    return CollapseStatus::Done;
+}
+
+auto MeshDecimator::performCollapse_( EdgeId edgeToCollapse, const Vector3f & collapsePos ) -> CollapseRes
+{
+    auto & topology = mesh_.topology;
     if ( settings_.preCollapse && !settings_.preCollapse( edgeToCollapse, collapsePos ) )
         return { .status =  CollapseStatus::User }; // user prohibits the collapse
 
+    const auto vo = topology.org( edgeToCollapse );
+    const bool vl = topology.left( edgeToCollapse ).valid();
+    const bool vr = topology.right( edgeToCollapse ).valid();
     ++res_.vertsDeleted;
     if ( vl )
         ++res_.facesDeleted;
@@ -656,23 +692,17 @@ auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapseP
     return { .v = remainingVertex };
 }
 
-DecimateResult MeshDecimator::run()
+auto MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapsePos ) -> CollapseRes
 {
-    MR_TIMER;
-
-    if ( settings_.bdVerts )
-        pBdVerts_ = settings_.bdVerts;
-    else
-    {
-        pBdVerts_ = &myBdVerts_;
-        if ( !settings_.touchBdVertices )
-            myBdVerts_ = getBoundaryVerts( mesh_.topology, settings_.region );
-    }
-
-    if ( !initializeQueue_() )
-        return res_;
+    const auto status = canCollapse_( edgeToCollapse, collapsePos, checkBufs_ );
+    if ( status != CollapseStatus::Done )
+        return { .status = status };
+    return performCollapse_( edgeToCollapse, collapsePos );
+}
 
-    res_.errorIntroduced = settings_.maxError;
+bool MeshDecimator::processQueue_()
+{
+    MR_TIMER
     int lastProgressFacesDeleted = 0;
     const int maxFacesDeleted = std::min(
         settings_.region ? (int)settings_.region->count() : mesh_.topology.numValidFaces(), settings_.maxDeletedFaces );
@@ -691,7 +721,7 @@ DecimateResult MeshDecimator::run()
         if ( settings_.progressCallback && res_.facesDeleted >= 1000 + lastProgressFacesDeleted ) 
         {
             if ( !settings_.progressCallback( 0.25f + 0.75f * res_.facesDeleted / maxFacesDeleted ) )
-                return res_;
+                return false;
             lastProgressFacesDeleted = res_.facesDeleted;
         }
 
@@ -763,6 +793,232 @@ DecimateResult MeshDecimator::run()
         }
     }
 
+    return true;
+}
+
+template <typename F>
+void MeshDecimator::forEachAffectedVert_( UndirectedEdgeId ue, F && f ) const
+{
+    const auto & topology = mesh_.topology;
+    // the ring of origin contains destination and vice versa
+    for ( EdgeId e : orgRing( topology, EdgeId( ue ) ) )
+        f( topology.dest( e ) );
+    for ( EdgeId e : orgRing( topology, EdgeId( ue ).sym() ) )
+        f( topology.dest( e ) );
+}
+
+/// returns the key, which order is the same as the order of (c, ue) pairs
+static std::uint64_t orderedKey( float c, UndirectedEdgeId ue )
+{
+    auto bits = std::bit_cast<std::uint32_t>( c );
+    bits = ( bits & 0x80000000u ) ? ~bits : ( bits | 0x80000000u );
+    return ( std::uint64_t( bits ) << 32 ) | std::uint32_t( (int)ue );
+}
+
+bool MeshDecimator::processIndependentSets_()
+{
+    MR_TIMER
+    auto & topology = mesh_.topology;
+    const auto ueSize = topology.undirectedEdgeSize();
+    const int maxFacesDeleted = std::min(
+        settings_.region ? (int)settings_.region->count() : topology.numValidFaces(), settings_.maxDeletedFaces );
+
+    Vector<QueueElement, UndirectedEdgeId> elems( ueSize );
+    // edges waiting for collapse or flip, like presentInQueue_ in sequential mode
+    UndirectedEdgeBitSet candidates( ueSize );
+    // edges with changed neighborhood, which costs must be recomputed
+    UndirectedEdgeBitSet dirty;
+    if ( regionEdges_.empty() )
+        dirty.resize( ueSize, true );
+    else
+    {
+        dirty = regionEdges_;
+        dirty.resize( ueSize );
+    }
+    // edges, which collapse in optimized position failed, so they will be collapsed in one of their ends
+    UndirectedEdgeBitSet collapseInEnd( ueSize );
+    UndirectedEdgeBitSet selected( ueSize );
+
+    // vertKeys[v] is the minimal key of the candidate edges affecting v
+    constexpr auto noKey = std::numeric_limits<std::uint64_t>::max();
+    std::vector<std::atomic<std::uint64_t>> vertKeys( topology.vertSize() );
+    ParallelFor( size_t( 0 ), vertKeys.size(), [&]( size_t i )
+    {
+        vertKeys[i].store( noKey, std::memory_order_relaxed );
+    } );
+
+    struct Action
+    {
+        QueueElement qe;
+        EdgeId edge; ///< edge to collapse, possibly reversed by canCollapse_
+        CollapseStatus status = CollapseStatus::Done;
+        Vector3f collapsePos;
+        QuadraticForm3f collapseForm;
+    };
+    std::vector<Action> actions;
+    tbb::enumerable_thread_specific<CollapseCheckBuffers> threadBufs;
+
+    auto markDirty = [&]( UndirectedEdgeId ue )
+    {
+        dirty.set( ue );
+        collapseInEnd.reset( ue );
+    };
+
+    for ( ;; )
+    {
+        // recompute the costs of the edges with changed neighborhood
+        BitSetParallelFor( dirty, [&]( UndirectedEdgeId ue )
+        {
+            if ( ( !regionEdges_.empty() && !regionEdges_.test( ue ) ) || topology.isLoneEdge( ue ) )
+            {
+                candidates.reset( ue );
+                return;
+            }
+            const bool optimizeVertexPos = settings_.optimizeVertexPos && !collapseInEnd.test( ue );
+            if ( auto qe = computeQueueElement_( ue, optimizeVertexPos ) )
+            {
+                elems[ue] = *qe;
+                candidates.set( ue );
+            }
+            else
+                candidates.reset( ue );
+        } );
+        dirty.reset();
+
+        if ( settings_.progressCallback && !settings_.progressCallback( 0.25f + 0.75f * res_.facesDeleted / std::max( maxFacesDeleted, 1 ) ) )
+            return false;
+
+        // select the edges having smaller keys than all other candidates affecting the same vertices
+        BitSetParallelFor( candidates, [&]( UndirectedEdgeId ue )
+        {
+            if ( topology.isLoneEdge( ue ) )
+            {
+                // the edge was deleted together with a collapsed edge in previous round
+                candidates.reset( ue );
+                return;
+            }
+            const auto key = orderedKey( elems[ue].c, ue );
+            forEachAffectedVert_( ue, [&]( VertId v )
+            {
+                auto & vk = vertKeys[v];
+                auto old = vk.load( std::memory_order_relaxed );
+                while ( key < old && !vk.compare_exchange_weak( old, key, std::memory_order_relaxed ) ) { }
+            } );
+        } );
+        BitSetParallelFor( candidates, [&]( UndirectedEdgeId ue )
+        {
+            const auto key = orderedKey( elems[ue].c, ue );
+            bool minimal = true;
+            forEachAffectedVert_( ue, [&]( VertId v )
+            {
+                if ( vertKeys[v].load( std::memory_order_relaxed ) != key )
+                    minimal = false;
+            } );
+            selected.set( ue, minimal );
+        } );
+        BitSetParallelFor( candidates, [&]( UndirectedEdgeId ue )
+        {
+            forEachAffectedVert_( ue, [&]( VertId v )
+            {
+                vertKeys[v].store( noKey, std::memory_order_relaxed );
+            } );
+        } );
+
+        actions.clear();
+        for ( auto ue : selected )
+            actions.push_back( { .qe = elems[ue] } );
+        selected.reset();
+        if ( actions.empty() )
+            break;
+
+        // check selected collapses in parallel, they do not influence one another since affect disjoint vertex sets
+        ParallelFor( actions, [&]( size_t i )
+        {
+            auto & a = actions[i];
+            const auto ue = a.qe.uedgeId();
+            a.edge = EdgeId( ue );
+            if ( a.qe.x.edgeOp == EdgeOp::Flip )
+                return;
+            computeQueueElement_( ue, a.qe.x.edgeOp == EdgeOp::CollapseOptPos, &a.collapseForm, &a.collapsePos );
+            a.status = canCollapse_( a.edge, a.collapsePos, threadBufs.local() );
+        } );
+        std::sort( actions.begin(), actions.end(), []( const Action & a, const Action & b )
+            { return orderedKey( a.qe.c, a.qe.uedgeId() ) < orderedKey( b.qe.c, b.qe.uedgeId() ); } );
+
+        // perform the operations sequentially in the order of increasing cost
+        for ( const auto & a : actions )
+        {
+            const auto ue = a.qe.uedgeId();
+            if ( res_.facesDeleted >= settings_.maxDeletedFaces || res_.vertsDeleted >= settings_.maxDeletedVertices )
+            {
+                res_.errorIntroduced = std::sqrt( a.qe.c );
+                return true;
+            }
+            candidates.reset( ue );
+
+            if ( a.qe.x.edgeOp == EdgeOp::Flip )
+            {
+                EdgeId e = ue;
+                topology.flipEdge( e );
+                assert( topology.left( e ) );
+                assert( topology.right( e ) );
+                markDirty( e.undirected() );
+                markDirty( topology.prev( e ).undirected() );
+                markDirty( topology.next( e ).undirected() );
+                markDirty( topology.prev( e.sym() ).undirected() );
+                markDirty( topology.next( e.sym() ).undirected() );
+                continue;
+            }
+
+            auto collapseRes = a.status == CollapseStatus::Done ? performCollapse_( a.edge, a.collapsePos ) : CollapseRes{ .status = a.status };
+            if ( !collapseRes.v )
+            {
+                if ( a.qe.x.edgeOp == EdgeOp::CollapseOptPos &&
+                    // collapse failed due to a geometric criterion (e.g. bad collapse position)
+                    ( collapseRes.status == CollapseStatus::TriAspect || collapseRes.status == CollapseStatus::NormalFlip ||
+                      collapseRes.status == CollapseStatus::PosFarBd || collapseRes.status == CollapseStatus::LongEdge ) )
+                {
+                    dirty.set( ue );
+                    collapseInEnd.set( ue );
+                }
+                continue;
+            }
+            assert( collapseRes.status == CollapseStatus::Done );
+
+            (*pVertForms_)[collapseRes.v] = a.collapseForm;
+
+            for ( EdgeId e : orgRing( topology, collapseRes.v ) )
+            {
+                markDirty( e.undirected() );
+                if ( topology.left( e ) )
+                    markDirty( topology.prev( e.sym() ).undirected() );
+            }
+        }
+    }
+
+    return true;
+}
+
+DecimateResult MeshDecimator::run()
+{
+    MR_TIMER;
+
+    if ( settings_.bdVerts )
+        pBdVerts_ = settings_.bdVerts;
+    else
+    {
+        pBdVerts_ = &myBdVerts_;
+        if ( !settings_.touchBdVertices )
+            myBdVerts_ = getBoundaryVerts( mesh_.topology, settings_.region );
+    }
+
+    if ( !initializeQueue_() )
+        return res_;
+
+    res_.errorIntroduced = settings_.maxError;
+    if ( !( settings_.independentSets ? processIndependentSets_() : processQueue_() ) )
+        return res_;
+
     if ( settings_.progressCallback && !settings_.progressCallback( 1.0f ) )
         return res_;
 
@@ -955,7 +1211,7 @@ static DecimateResult decimateMeshParallelInplace( MR::Mesh & mesh, const Decima
 
 DecimateResult decimateMesh( Mesh & mesh, const DecimateSettings & settings )
 {
-    if ( settings.subdivideParts > 1 )
+    if ( settings.subdivideParts > 1 && !settings.independentSets )
         return decimateMeshParallelInplace( mesh, settings );
     else
         return decimateMeshSerial( mesh, settings );
@@ -1070,4 +1326,28 @@ TEST( MRMesh, MeshDecimate )
     ASSERT_GT(decimateResults.facesDeleted, 0);
 }
 
+TEST( MRMesh, MeshDecimateIndependentSets )
+{
+    const Mesh sphere = makeSphere( { .radius = 1, .numMeshVertices = 3000 } );
+    DecimateSettings settings;
+    settings.maxError = 0.01f;
+
+    Mesh seqMesh = sphere;
+    const auto seqRes = decimateMesh( seqMesh, settings );
+
+    Mesh parMesh = sphere;
+    FaceBitSet region = parMesh.topology.getValidFaces();
+    settings.region = &region;
+    settings.independentSets = true;
+    const auto parRes = decimateMesh( parMesh, settings );
+
+    EXPECT_FALSE( parRes.cancelled );
+    EXPECT_TRUE( parMesh.topology.checkValidity() );
+    EXPECT_EQ( region, parMesh.topology.getValidFaces() );
+    EXPECT_EQ( parRes.facesDeleted, sphere.topology.numValidFaces() - parMesh.topology.numValidFaces() );
+    // the number of collapses is close to that of sequential decimation
+    EXPECT_GT( parRes.vertsDeleted, seqRes.vertsDeleted * 9 / 10 );
+    EXPECT_LT( parRes.vertsDeleted, seqRes.vertsDeleted * 11 / 10 );
+}
+
 } //namespace MR
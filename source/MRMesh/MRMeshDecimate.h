@@ -104,6 +104,12 @@ struct DecimateSettings
     /// unlike \ref decimateParallelMesh it does not create copies of mesh regions, so may take less memory to operate;
     /// IMPORTANT: please call mesh.packOptimally() before calling decimating with subdivideParts > 1, otherwise performance will be bad
     int subdivideParts = 1;
+    /// If true, then the decimation is performed in rounds over the whole mesh (and subdivideParts is ignored):
+    /// in each round the costs of changed edges are computed in parallel, then a set of edges is selected with the costs
+    /// smaller than that of all other edges affecting the same vertices, their collapses are checked in parallel and performed;
+    /// it scales with the number of threads better than subdivideParts and does not produce seams between parts,
+    /// the result is close to sequential decimation but not exactly the same
+    bool independentSets = false;
 };
 
 /**
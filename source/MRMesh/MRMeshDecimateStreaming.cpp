@@ -0,0 +1,923 @@
+#include "MRMeshDecimateStreaming.h"
+#include "MRMesh.h"
+#include "MRMeshSave.h"
+#include "MRMeshLoad.h"
+#include "MRMeshDistance.h"
+#include "MRExpandShrink.h"
+#include "MRRegionBoundary.h"
+#include "MRSerializer.h"
+#include "MRStringConvert.h"
+#include "MRTorus.h"
+#include "MRBox.h"
+#include "MRBuffer.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
+namespace MR
+{
+
+namespace
+{
+
+/// approximate memory for one triangle of the mesh being decimated: input triangle soup, vertex identification,
+/// topology, coordinates and quadratic forms of vertices, queue of edges
+constexpr size_t cBytesPerTriangle = 256;
+
+/// the maximal number of chunks in one spatial subdivision
+constexpr int cMaxChunks = 512;
+
+/// the number of triangles read from a file at once
+constexpr size_t cReadPortion = 65536;
+
+static_assert( sizeof( Triangle3f ) == 36, "temporary files store raw triangles" );
+
+int plyTypeSize( const std::string & type )
+{
+    if ( type == "char" || type == "uchar" || type == "int8" || type == "uint8" )
+        return 1;
+    if ( type == "short" || type == "ushort" || type == "int16" || type == "uint16" )
+        return 2;
+    if ( type == "int" || type == "uint" || type == "int32" || type == "uint32" || type == "float" || type == "float32" )
+        return 4;
+    if ( type == "double" || type == "float64" )
+        return 8;
+    return 0;
+}
+
+bool plyTypeIsFloat( const std::string & type )
+{
+    return type == "float" || type == "float32" || type == "double" || type == "float64";
+}
+
+bool plyTypeIsSigned( const std::string & type )
+{
+    return type == "char" || type == "int8" || type == "short" || type == "int16" || type == "int" || type == "int32";
+}
+
+/// decodes little-endian integer value of given PLY type
+std::int64_t readPlyInt( const char * p, const std::string & type )
+{
+    switch ( plyTypeSize( type ) )
+    {
+    case 1:
+        return plyTypeIsSigned( type ) ? std::int64_t( *(const std::int8_t*)p ) : std::int64_t( *(const std::uint8_t*)p );
+    case 2:
+    {
+        std::uint16_t v;
+        std::memcpy( &v, p, 2 );
+        return plyTypeIsSigned( type ) ? std::int64_t( std::int16_t( v ) ) : std::int64_t( v );
+    }
+    case 4:
+    {
+        std::uint32_t v;
+        std::memcpy( &v, p, 4 );
+        return plyTypeIsSigned( type ) ? std::int64_t( std::int32_t( v ) ) : std::int64_t( v );
+    }
+    default:
+        return -1;
+    }
+}
+
+/// decodes little-endian floating-point value of given PLY type
+float readPlyFloat( const char * p, const std::string & type )
+{
+    if ( plyTypeSize( type ) == 8 )
+    {
+        double v;
+        std::memcpy( &v, p, 8 );
+        return float( v );
+    }
+    float v;
+    std::memcpy( &v, p, 4 );
+    return v;
+}
+
+/// sequential reader of triangles from binary .stl, binary little-endian .ply, or temporary file with raw triangles
+class TriangleReader
+{
+public:
+    enum class Format
+    {
+        Stl,
+        Ply,
+        Raw
+    };
+
+    VoidOrErrStr open( const std::filesystem::path & file, Format format );
+    void close() { in_.close(); }
+
+    /// the number of triangles in .stl and raw files, the number of polygons in .ply file
+    size_t numElements() const { return numElements_; }
+    /// the memory occupied by the reader during all the time
+    size_t residentBytes() const { return plyPoints_.heapBytes(); }
+
+    /// reads next portion of triangles (polygons are triangulated), the buffer is empty in the end of file
+    VoidOrErrStr read( std::vector<Triangle3f> & buf );
+    /// returns to the first triangle
+    VoidOrErrStr rewind();
+
+    /// computes the bounding box of all triangles, the reader is rewound after that
+    Expected<Box3f, std::string> computeBox( const ProgressCallback & cb );
+
+private:
+    VoidOrErrStr openPly_();
+    VoidOrErrStr readPlyFaces_( std::vector<Triangle3f> & buf );
+
+    std::ifstream in_;
+    Format format_ = Format::Raw;
+    std::streamoff dataStart_ = 0;
+    size_t numElements_ = 0;
+    size_t readElements_ = 0;
+
+    // .ply layout
+    VertCoords plyPoints_;
+    int plyFaceBytesBefore_ = 0;
+    int plyFaceBytesAfter_ = 0;
+    std::string plyCountType_;
+    std::string plyIndexType_;
+};
+
+VoidOrErrStr TriangleReader::open( const std::filesystem::path & file, Format format )
+{
+    in_ = std::ifstream( file, std::ifstream::binary );
+    if ( !in_ )
+        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+    format_ = format;
+    readElements_ = 0;
+
+    in_.seekg( 0, std::ios_base::end );
+    const std::streamoff fileSize = in_.tellg();
+    in_.seekg( 0 );
+
+    switch ( format_ )
+    {
+    case Format::Stl:
+    {
+        char header[80];
+        in_.read( header, 80 );
+        std::uint32_t numTris = 0;
+        in_.read( (char*)&numTris, 4 );
+        if ( !in_ )
+            return unexpected( std::string( "Error reading the number of triangles from STL-file" ) );
+        dataStart_ = 84;
+        numElements_ = numTris;
+        if ( fileSize - dataStart_ < 50 * std::streamoff( numTris ) )
+            return unexpected( std::string( "Binary STL-file is too short" ) );
+        break;
+    }
+    case Format::Raw:
+        dataStart_ = 0;
+        numElements_ = size_t( fileSize ) / sizeof( Triangle3f );
+        break;
+    case Format::Ply:
+        if ( auto res = openPly_(); !res )
+            return res;
+        break;
+    }
+    return {};
+}
+
+VoidOrErrStr TriangleReader::openPly_()
+{
+    struct Property
+    {
+        std::string name;
+        std::string type; // item type for lists
+        std::string countType; // not empty for lists
+    };
+    struct Element
+    {
+        std::string name;
+        size_t count = 0;
+        std::vector<Property> props;
+    };
+    std::vector<Element> elements;
+
+    std::string line;
+    std::getline( in_, line );
+    if ( !in_ || line.compare( 0, 3, "ply" ) != 0 )
+        return unexpected( std::string( "PLY-file does not start with 'ply'" ) );
+    for ( ;; )
+    {
+        if ( !std::getline( in_, line ) )
+            return unexpected( std::string( "Unexpected end of PLY-file header" ) );
+        if ( !line.empty() && line.back() == '\r' )
+            line.pop_back();
+        std::istringstream ss( line );
+        std::string keyword;
+        ss >> keyword;
+        if ( keyword == "end_header" )
+            break;
+        if ( keyword == "format" )
+        {
+            std::string format;
+            ss >> format;
+            if ( format != "binary_little_endian" )
+                return unexpected( "Streaming decimation supports only binary little-endian PLY-files, got " + format );
+        }
+        else if ( keyword == "element" )
+        {
+            Element e;
+            ss >> e.name >> e.count;
+            elements.push_back( std::move( e ) );
+        }
+        else if ( keyword == "property" )
+        {
+            if ( elements.empty() )
+                return unexpected( std::string( "PLY property outside of element" ) );
+            Property p;
+            ss >> p.type;
+            if ( p.type == "list" )
+            {
+                p.countType = std::move( p.type );
+                ss >> p.countType >> p.type;
+            }
+            ss >> p.name;
+            if ( plyTypeSize( p.type ) == 0 || ( !p.countType.empty() && plyTypeSize( p.countType ) == 0 ) )
+                return unexpected( "Unsupported type of PLY property " + p.name );
+            elements.back().props.push_back( std::move( p ) );
+        }
+    }
+
+    // fixed size of one element record, or -1 if the element has lists
+    auto elementStride = []( const Element & e )
+    {
+        int res = 0;
+        for ( const auto & p : e.props )
+        {
+            if ( !p.countType.empty() )
+                return -1;
+            res += plyTypeSize( p.type );
+        }
+        return res;
+    };
+
+    for ( const auto & e : elements )
+    {
+        if ( e.name == "face" )
+        {
+            int listPos = -1;
+            for ( int i = 0; i < (int)e.props.size(); ++i )
+            {
+                const auto & p = e.props[i];
+                if ( p.countType.empty() )
+                    continue;
+                if ( listPos >= 0 || ( p.name != "vertex_indices" && p.name != "vertex_index" ) || plyTypeIsFloat( p.type ) || plyTypeIsFloat( p.countType ) )
+                    return unexpected( std::string( "Unsupported properties of faces in PLY-file" ) );
+                listPos = i;
+            }
+            if ( listPos < 0 )
+                return unexpected( std::string( "PLY-file has no vertex indices of faces" ) );
+            plyFaceBytesBefore_ = plyFaceBytesAfter_ = 0;
+            for ( int i = 0; i < (int)e.props.size(); ++i )
+            {
+                if ( i < listPos )
+                    plyFaceBytesBefore_ += plyTypeSize( e.props[i].type );
+                else if ( i > listPos )
+                    plyFaceBytesAfter_ += plyTypeSize( e.props[i].type );
+            }
+            plyCountType_ = e.props[listPos].countType;
+            plyIndexType_ = e.props[listPos].type;
+            dataStart_ = in_.tellg();
+            numElements_ = e.count;
+            return {};
+        }
+
+        const int stride = elementStride( e );
+        if ( stride < 0 )
+            return unexpected( "Unsupported lists in PLY element " + e.name );
+        if ( e.name != "vertex" )
+        {
+            in_.seekg( std::streamoff( stride ) * e.count, std::ios_base::cur );
+            continue;
+        }
+
+        int offset[3] = { -1, -1, -1 };
+        std::string type[3];
+        int pos = 0;
+        for ( const auto & p : e.props )
+        {
+            const int coord = p.name == "x" ? 0 : p.name == "y" ? 1 : p.name == "z" ? 2 : -1;
+            if ( coord >= 0 && plyTypeIsFloat( p.type ) )
+            {
+                offset[coord] = pos;
+                type[coord] = p.type;
+            }
+            pos += plyTypeSize( p.type );
+        }
+        if ( offset[0] < 0 || offset[1] < 0 || offset[2] < 0 )
+            return unexpected( std::string( "PLY-file has no floating-point coordinates of vertices" ) );
+
+        plyPoints_.resize( e.count );
+        std::vector<char> block( cReadPortion * stride );
+        for ( size_t first = 0; first < e.count; first += cReadPortion )
+        {
+            const size_t n = std::min( cReadPortion, e.count - first );
+            in_.read( block.data(), n * stride );
+            if ( !in_ )
+                return unexpected( std::string( "Error reading vertices from PLY-file" ) );
+            for ( size_t i = 0; i < n; ++i )
+            {
+                const char * rec = block.data() + i * stride;
+                auto & pt = plyPoints_[VertId( first + i )];
+                for ( int c = 0; c < 3; ++c )
+                    pt[c] = readPlyFloat( rec + offset[c], type[c] );
+            }
+        }
+    }
+    return unexpected( std::string( "PLY-file has no faces" ) );
+}
+
+VoidOrErrStr TriangleReader::rewind()
+{
+    in_.clear();
+    in_.seekg( dataStart_ );
+    readElements_ = 0;
+    if ( !in_ )
+        return unexpected( std::string( "Cannot rewind the file" ) );
+    return {};
+}
+
+VoidOrErrStr TriangleReader::read( std::vector<Triangle3f> & buf )
+{
+    buf.clear();
+    const size_t n = std::min( cReadPortion, numElements_ - readElements_ );
+    if ( n == 0 )
+        return {};
+
+    switch ( format_ )
+    {
+    case Format::Raw:
+        buf.resize( n );
+        in_.read( (char*)buf.data(), n * sizeof( Triangle3f ) );
+        break;
+    case Format::Stl:
+    {
+        #pragma pack(push, 1)
+        struct StlTriangle
+        {
+            Vector3f normal;
+            Vector3f vert[3];
+            std::uint16_t attr;
+        };
+        #pragma pack(pop)
+        static_assert( sizeof( StlTriangle ) == 50, "check your padding" );
+        std::vector<StlTriangle> stlBuf( n );
+        in_.read( (char*)stlBuf.data(), n * sizeof( StlTriangle ) );
+        buf.resize( n );
+        for ( size_t i = 0; i < n; ++i )
+            for ( int j = 0; j < 3; ++j )
+                buf[i][j] = stlBuf[i].vert[j];
+        break;
+    }
+    case Format::Ply:
+        if ( auto res = readPlyFaces_( buf ); !res )
+            return res;
+        break;
+    }
+    if ( !in_ )
+        return unexpected( std::string( "Error reading triangles from file" ) );
+    readElements_ += n;
+    return {};
+}
+
+VoidOrErrStr TriangleReader::readPlyFaces_( std::vector<Triangle3f> & buf )
+{
+    const size_t n = std::min( cReadPortion, numElements_ - readElements_ );
+    const int countSize = plyTypeSize( plyCountType_ );
+    const int indexSize = plyTypeSize( plyIndexType_ );
+    char countBuf[8];
+    std::vector<char> indexBuf;
+    std::vector<VertId> poly;
+    for ( size_t i = 0; i < n; ++i )
+    {
+        if ( plyFaceBytesBefore_ > 0 )
+            in_.ignore( plyFaceBytesBefore_ );
+        in_.read( countBuf, countSize );
+        const auto count = readPlyInt( countBuf, plyCountType_ );
+        if ( !in_ || count < 0 )
+            return unexpected( std::string( "Error reading faces from PLY-file" ) );
+        indexBuf.resize( count * indexSize );
+        in_.read( indexBuf.data(), indexBuf.size() );
+        if ( plyFaceBytesAfter_ > 0 )
+            in_.ignore( plyFaceBytesAfter_ );
+        if ( !in_ )
+            return unexpected( std::string( "Error reading faces from PLY-file" ) );
+
+        poly.resize( count );
+        for ( int j = 0; j < count; ++j )
+        {
+            const auto v = readPlyInt( indexBuf.data() + j * indexSize, plyIndexType_ );
+            if ( v < 0 || v >= (std::int64_t)plyPoints_.size() )
+                return unexpected( std::string( "PLY-file face references missing vertex" ) );
+            poly[j] = VertId( size_t( v ) );
+        }
+        // triangulate the polygon as a fan from its first vertex
+        for ( int j = 2; j < count; ++j )
+            buf.push_back( { plyPoints_[poly[0]], plyPoints_[poly[j - 1]], plyPoints_[poly[j]] } );
+    }
+    return {};
+}
+
+Expected<Box3f, std::string> TriangleReader::computeBox( const ProgressCallback & cb )
+{
+    MR_TIMER
+    Box3f box;
+    if ( format_ == Format::Ply )
+    {
+        for ( const auto & p : plyPoints_ )
+            box.include( p );
+        return box;
+    }
+
+    std::vector<Triangle3f> buf;
+    for ( ;; )
+    {
+        if ( auto res = read( buf ); !res )
+            return unexpected( std::move( res.error() ) );
+        if ( buf.empty() )
+            break;
+        for ( const auto & t : buf )
+            for ( const auto & p : t )
+                box.include( p );
+        if ( !reportProgress( cb, float( readElements_ ) / numElements_ ) )
+            return unexpectedOperationCanceled();
+    }
+    if ( auto res = rewind(); !res )
+        return unexpected( std::move( res.error() ) );
+    return box;
+}
+
+VoidOrErrStr appendTriangles( const std::filesystem::path & file, const std::vector<Triangle3f> & tris )
+{
+    std::ofstream out( file, std::ofstream::binary | std::ofstream::app );
+    out.write( (const char*)tris.data(), tris.size() * sizeof( Triangle3f ) );
+    if ( !out )
+        return unexpected( std::string( "Cannot write temporary file " ) + utf8string( file ) );
+    return {};
+}
+
+Vector3f centroid( const Triangle3f & t )
+{
+    return ( t[0] + t[1] + t[2] ) / 3.0f;
+}
+
+/// a group of spatially close triangles stored in temporary file
+struct Chunk
+{
+    std::filesystem::path file;
+    size_t numTris = 0;
+    /// bounding box of triangle centroids
+    Box3f centroidBox;
+    /// the triangles not written in the file yet
+    std::vector<Triangle3f> buffer;
+
+    void add( const Triangle3f & t )
+    {
+        centroidBox.include( centroid( t ) );
+        buffer.push_back( t );
+        ++numTris;
+    }
+    VoidOrErrStr flush()
+    {
+        auto res = appendTriangles( file, buffer );
+        buffer.clear();
+        return res;
+    }
+};
+
+class StreamingDecimator
+{
+public:
+    StreamingDecimator( const DecimateStreamingSettings & settings, std::filesystem::path tempFolder, std::ostream & out )
+        : settings_( settings ), tempFolder_( std::move( tempFolder ) ), out_( out )
+    {}
+
+    Expected<DecimateStreamingResult, std::string> run( TriangleReader & input );
+
+private:
+    /// splits all triangles from the reader on the chunks of spatial grid shifted on half of cell if requested
+    Expected<std::vector<Chunk>, std::string> distribute_( TriangleReader & reader, bool shift, const ProgressCallback & cb );
+    /// splits the chunk with too many triangles on two halves, returns false if it is impossible
+    Expected<bool, std::string> split_( Chunk & chunk, std::vector<Chunk> & stack );
+    /// decimates given triangles with locked boundary, and writes the triangles far from the boundary in the output;
+    /// if !writeAll, then the triangles near the boundary are appended to seam file
+    VoidOrErrStr decimate_( std::vector<Triangle3f> tris, bool writeAll, const ProgressCallback & cb );
+    /// writes all triangles from the reader in the output without decimation
+    VoidOrErrStr writeAsIs_( TriangleReader & reader );
+    /// appends the triangles of given mesh to the output, if their total number still fits in the header of binary STL-file
+    VoidOrErrStr write_( const Mesh & mesh );
+
+    std::filesystem::path newTempFile_() { return tempFolder_ / ( "chunk" + std::to_string( numTempFiles_++ ) + ".tri" ); }
+
+    const DecimateStreamingSettings & settings_;
+    std::filesystem::path tempFolder_;
+    std::ostream & out_;
+    size_t maxChunkTris_ = 0;
+    int numTempFiles_ = 0;
+    std::filesystem::path seamFile_;
+    size_t seamTris_ = 0;
+    DecimateStreamingResult res_;
+};
+
+Expected<DecimateStreamingResult, std::string> StreamingDecimator::run( TriangleReader & input )
+{
+    MR_TIMER
+    res_ = {};
+    res_.inputTriangles = input.numElements();
+    const size_t resident = input.residentBytes();
+    const size_t budget = settings_.memoryBudget > resident ? settings_.memoryBudget - resident : 0;
+    maxChunkTris_ = std::max( budget / cBytesPerTriangle, size_t( 1024 ) );
+
+    TriangleReader seamReader;
+    std::filesystem::path prevSeamFile;
+    TriangleReader * reader = &input;
+    for ( int level = 0; ; ++level )
+    {
+        // the first level takes most of time, and each next level takes half of the time of previous one
+        const float from = level == 0 ? 0.0f : 1.0f - 0.4f / float( 1 << level );
+        const float to = 1.0f - 0.2f / float( 1 << level );
+        const auto levelCb = subprogress( settings_.progress, from, to );
+
+        seamFile_ = newTempFile_();
+        seamTris_ = 0;
+        if ( level >= settings_.maxSeamLevels && reader->numElements() > maxChunkTris_ )
+        {
+            if ( auto res = writeAsIs_( *reader ); !res )
+                return unexpected( std::move( res.error() ) );
+            break;
+        }
+        if ( reader->numElements() <= maxChunkTris_ )
+        {
+            std::vector<Triangle3f> tris, buf;
+            for ( ;; )
+            {
+                if ( auto res = reader->read( buf ); !res )
+                    return unexpected( std::move( res.error() ) );
+                if ( buf.empty() )
+                    break;
+                tris.insert( tris.end(), buf.begin(), buf.end() );
+            }
+            if ( auto res = decimate_( std::move( tris ), true, levelCb ); !res )
+                return unexpected( std::move( res.error() ) );
+            break;
+        }
+
+        auto chunks = distribute_( *reader, level % 2 == 1, subprogress( levelCb, 0.0f, 0.25f ) );
+        if ( !chunks )
+            return unexpected( std::move( chunks.error() ) );
+        if ( reader == &seamReader )
+        {
+            seamReader.close();
+            std::error_code ec;
+            std::filesystem::remove( prevSeamFile, ec );
+        }
+
+        const auto chunksCb = subprogress( levelCb, 0.25f, 1.0f );
+        const size_t levelTris = reader->numElements();
+        size_t processedTris = 0;
+        auto & stack = *chunks;
+        while ( !stack.empty() )
+        {
+            Chunk chunk = std::move( stack.back() );
+            stack.pop_back();
+            if ( chunk.numTris > maxChunkTris_ )
+            {
+                auto splitted = split_( chunk, stack );
+                if ( !splitted )
+                    return unexpected( std::move( splitted.error() ) );
+                if ( *splitted )
+                    continue;
+            }
+
+            std::vector<Triangle3f> tris( chunk.numTris );
+            {
+                std::ifstream in( chunk.file, std::ifstream::binary );
+                in.read( (char*)tris.data(), chunk.numTris * sizeof( Triangle3f ) );
+                if ( !in )
+                    return unexpected( std::string( "Cannot read temporary file " ) + utf8string( chunk.file ) );
+            }
+            std::error_code ec;
+            std::filesystem::remove( chunk.file, ec );
+
+            const auto chunkCb = subprogress( chunksCb, float( processedTris ) / levelTris,
+                float( std::min( processedTris + chunk.numTris, levelTris ) ) / levelTris );
+            processedTris += chunk.numTris;
+            if ( auto res = decimate_( std::move( tris ), false, chunkCb ); !res )
+                return unexpected( std::move( res.error() ) );
+        }
+
+        if ( seamTris_ == 0 )
+            break;
+        if ( auto res = seamReader.open( seamFile_, TriangleReader::Format::Raw ); !res )
+            return unexpected( std::move( res.error() ) );
+        prevSeamFile = seamFile_;
+        reader = &seamReader;
+    }
+
+    if ( !reportProgress( settings_.progress, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return res_;
+}
+
+Expected<std::vector<Chunk>, std::string> StreamingDecimator::distribute_( TriangleReader & reader, bool shift, const ProgressCallback & cb )
+{
+    MR_TIMER
+    const auto box = reader.computeBox( subprogress( cb, 0.0f, 0.5f ) );
+    if ( !box )
+        return unexpected( std::move( box.error() ) );
+
+    // subdivide the longest cell dimension till the number of cells is enough to put each chunk in the budget
+    const size_t needChunks = std::min( ( reader.numElements() + maxChunkTris_ - 1 ) / maxChunkTris_, size_t( cMaxChunks ) );
+    const auto size = box->size();
+    Vector3i dims( 1, 1, 1 );
+    while ( size_t( dims.x ) * dims.y * dims.z < needChunks )
+    {
+        int axis = 0;
+        for ( int a = 1; a < 3; ++a )
+            if ( size[a] * dims[axis] > size[axis] * dims[a] )
+                axis = a;
+        dims[axis] *= 2;
+    }
+    Vector3f cell;
+    for ( int a = 0; a < 3; ++a )
+        cell[a] = size[a] > 0 ? size[a] / dims[a] : 1.0f;
+
+    // shifted grid has one more cell along each subdivided axis, so the former cell boundaries pass through the centers of new cells
+    const float offset = shift ? 0.5f : 0.0f;
+    Vector3i gridDims = dims;
+    if ( shift )
+        for ( int a = 0; a < 3; ++a )
+            if ( dims[a] > 1 )
+                ++gridDims[a];
+
+    std::vector<Chunk> chunks( size_t( gridDims.x ) * gridDims.y * gridDims.z );
+    for ( auto & c : chunks )
+        c.file = newTempFile_();
+    // keep the buffers of all chunks within half of the budget
+    const size_t flushTris = std::clamp( settings_.memoryBudget / ( 2 * sizeof( Triangle3f ) * chunks.size() ), size_t( 256 ), cReadPortion );
+
+    std::vector<Triangle3f> buf;
+    size_t readTris = 0;
+    const size_t numTris = reader.numElements();
+    for ( ;; )
+    {
+        if ( auto res = reader.read( buf ); !res )
+            return unexpected( std::move( res.error() ) );
+        if ( buf.empty() )
+            break;
+        for ( const auto & t : buf )
+        {
+            const auto c = centroid( t );
+            int idx = 0;
+            for ( int a = 2; a >= 0; --a )
+            {
+                const int i = dims[a] > 1 ? std::clamp( int( std::floor( ( c[a] - box->min[a] ) / cell[a] + offset ) ), 0, gridDims[a] - 1 ) : 0;
+                idx = idx * gridDims[a] + i;
+            }
+            auto & chunk = chunks[idx];
+            chunk.add( t );
+            if ( chunk.buffer.size() >= flushTris )
+                if ( auto res = chunk.flush(); !res )
+                    return unexpected( std::move( res.error() ) );
+        }
+        readTris += buf.size();
+        if ( !reportProgress( cb, 0.5f + 0.5f * std::min( float( readTris ) / numTris, 1.0f ) ) )
+            return unexpectedOperationCanceled();
+    }
+
+    std::vector<Chunk> res;
+    for ( auto & c : chunks )
+    {
+        if ( c.numTris == 0 )
+            continue;
+        if ( auto flushed = c.flush(); !flushed )
+            return unexpected( std::move( flushed.error() ) );
+        res.push_back( std::move( c ) );
+    }
+    return res;
+}
+
+Expected<bool, std::string> StreamingDecimator::split_( Chunk & chunk, std::vector<Chunk> & stack )
+{
+    MR_TIMER
+    const auto size = chunk.centroidBox.size();
+    int axis = 0;
+    for ( int a = 1; a < 3; ++a )
+        if ( size[a] > size[axis] )
+            axis = a;
+    const float mid = chunk.centroidBox.center()[axis];
+    if ( !( mid > chunk.centroidBox.min[axis] ) )
+        return false; // all triangles are at the same place
+
+    TriangleReader reader;
+    if ( auto res = reader.open( chunk.file, TriangleReader::Format::Raw ); !res )
+        return unexpected( std::move( res.error() ) );
+    Chunk halves[2];
+    for ( auto & h : halves )
+        h.file = newTempFile_();
+    std::vector<Triangle3f> buf;
+    for ( ;; )
+    {
+        if ( auto res = reader.read( buf ); !res )
+            return unexpected( std::move( res.error() ) );
+        if ( buf.empty() )
+            break;
+        for ( const auto & t : buf )
+            halves[ centroid( t )[axis] < mid ? 0 : 1 ].add( t );
+        for ( auto & h : halves )
+            if ( auto res = h.flush(); !res )
+                return unexpected( std::move( res.error() ) );
+    }
+    reader.close();
+    std::error_code ec;
+    std::filesystem::remove( chunk.file, ec );
+
+    for ( auto & h : halves )
+    {
+        if ( h.numTris > 0 )
+            stack.push_back( std::move( h ) );
+        else
+            std::filesystem::remove( h.file, ec );
+    }
+    return true;
+}
+
+VoidOrErrStr StreamingDecimator::decimate_( std::vector<Triangle3f> tris, bool writeAll, const ProgressCallback & cb )
+{
+    MR_TIMER
+    Mesh mesh = Mesh::fromPointTriples( tris, true );
+    tris = {};
+
+    DecimateSettings ds = settings_.decimate;
+    ds.maxDeletedVertices = INT_MAX;
+    ds.maxDeletedFaces = INT_MAX;
+    ds.region = nullptr;
+    ds.notFlippable = nullptr;
+    ds.edgesToCollapse = nullptr;
+    ds.touchBdVertices = false;
+    ds.bdVerts = nullptr;
+    ds.preCollapse = {};
+    ds.adjustCollapse = {};
+    ds.onEdgeDel = {};
+    ds.vertForms = nullptr;
+    ds.packMesh = false;
+    ds.progressCallback = subprogress( cb, 0.0f, 0.9f );
+    if ( ds.subdivideParts > 1 && !ds.independentSets )
+        mesh.packOptimally( false );
+
+    const auto dr = decimateMesh( mesh, ds );
+    if ( dr.cancelled )
+        return unexpectedOperationCanceled();
+    res_.errorIntroduced = std::max( res_.errorIntroduced, dr.errorIntroduced );
+    ++res_.numChunks;
+
+    if ( !writeAll )
+    {
+        auto seamVerts = mesh.topology.findBoundaryVerts();
+        if ( settings_.seamRings > 1 )
+            expand( mesh.topology, seamVerts, settings_.seamRings - 1 );
+        const auto seamFaces = getIncidentFaces( mesh.topology, seamVerts );
+        if ( seamFaces.any() )
+        {
+            std::vector<Triangle3f> seam;
+            seam.reserve( seamFaces.count() );
+            for ( auto f : seamFaces )
+                seam.push_back( mesh.getTriPoints( f ) );
+            if ( auto res = appendTriangles( seamFile_, seam ); !res )
+                return res;
+            seamTris_ += seam.size();
+            mesh.deleteFaces( seamFaces );
+        }
+    }
+
+    if ( auto res = write_( mesh ); !res )
+        return res;
+
+    if ( !reportProgress( cb, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return {};
+}
+
+VoidOrErrStr StreamingDecimator::writeAsIs_( TriangleReader & reader )
+{
+    MR_TIMER
+    std::vector<Triangle3f> buf;
+    for ( ;; )
+    {
+        if ( auto res = reader.read( buf ); !res )
+            return res;
+        if ( buf.empty() )
+            break;
+        if ( auto res = write_( Mesh::fromPointTriples( buf, true ) ); !res )
+            return res;
+    }
+    return {};
+}
+
+VoidOrErrStr StreamingDecimator::write_( const Mesh & mesh )
+{
+    if ( res_.outputTriangles + mesh.topology.numValidFaces() > std::numeric_limits<std::uint32_t>::max() )
+        return unexpected( std::string( "Too many triangles for binary STL-file" ) );
+    auto written = MeshSave::appendBinaryStlTriangles( mesh, out_ );
+    if ( !written )
+        return unexpected( std::move( written.error() ) );
+    res_.outputTriangles += *written;
+    return {};
+}
+
+} // anonymous namespace
+
+Expected<DecimateStreamingResult, std::string> decimateMeshFile( const std::filesystem::path & input,
+    const std::filesystem::path & output, const DecimateStreamingSettings & settings )
+{
+    MR_TIMER
+    auto ext = utf8string( input.extension() );
+    for ( auto & c : ext )
+        c = (char)tolower( c );
+    TriangleReader::Format format;
+    if ( ext == ".stl" )
+        format = TriangleReader::Format::Stl;
+    else if ( ext == ".ply" )
+        format = TriangleReader::Format::Ply;
+    else
+        return unexpected( std::string( "Streaming decimation supports only binary .stl and .ply input files" ) );
+
+    TriangleReader reader;
+    if ( auto res = reader.open( input, format ); !res )
+        return unexpected( std::move( res.error() ) );
+
+    std::optional<UniqueTemporaryFolder> uniqueFolder;
+    std::filesystem::path tempFolder = settings.tempFolder;
+    if ( tempFolder.empty() )
+    {
+        uniqueFolder.emplace( FolderCallback{} );
+        if ( !*uniqueFolder )
+            return unexpected( std::string( "Cannot create temporary folder" ) );
+        tempFolder = *uniqueFolder;
+    }
+
+    std::ofstream out( output, std::ofstream::binary );
+    if ( !out )
+        return unexpected( std::string( "Cannot open file for writing " ) + utf8string( output ) );
+
+    StreamingDecimator decimator( settings, tempFolder, out );
+    auto res = MeshSave::writeBinaryStlHeader( out, 0 )
+        .and_then( [&] { return decimator.run( reader ); } )
+        .and_then( [&]( DecimateStreamingResult && r ) -> Expected<DecimateStreamingResult, std::string>
+        {
+            out.seekp( 0 );
+            if ( auto header = MeshSave::writeBinaryStlHeader( out, std::uint32_t( r.outputTriangles ) ); !header )
+                return unexpected( std::move( header.error() ) );
+            return std::move( r );
+        } );
+    if ( !res )
+    {
+        // do not leave partially written file with wrong header
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove( output, ec );
+    }
+    return res;
+}
+
+TEST( MRMesh, DecimateMeshFile )
+{
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+    const auto input = folder / "input.stl";
+    const auto output = folder / "output.stl";
+
+    const Mesh torus = makeTorus( 2, 1, 64, 64 );
+    ASSERT_TRUE( MeshSave::toBinaryStl( torus, input ).has_value() );
+
+    DecimateStreamingSettings settings;
+    settings.decimate.maxError = 0.01f;
+    // force subdivision on several chunks
+    settings.memoryBudget = torus.topology.numValidFaces() * cBytesPerTriangle / 6;
+    settings.tempFolder = folder;
+    const auto res = decimateMeshFile( input, output, settings );
+    ASSERT_TRUE( res.has_value() );
+    EXPECT_EQ( res->inputTriangles, torus.topology.numValidFaces() );
+    EXPECT_GT( res->numChunks, 6 );
+    EXPECT_LT( res->outputTriangles, res->inputTriangles / 2 );
+
+    const auto decimated = MeshLoad::fromBinaryStl( output );
+    ASSERT_TRUE( decimated.has_value() );
+    EXPECT_EQ( decimated->topology.numValidFaces(), res->outputTriangles );
+    // the seams are welded without holes
+    EXPECT_TRUE( decimated->topology.findHoleRepresentiveEdges().empty() );
+    EXPECT_LT( findMaxDistanceSq( torus, *decimated ), sqr( 0.02f ) );
+
+    // canceled decimation does not leave partially written output
+    settings.progress = []( float p ) { return p < 0.5f; };
+    EXPECT_FALSE( decimateMeshFile( input, output, settings ).has_value() );
+    EXPECT_FALSE( std::filesystem::exists( output ) );
+}
+
+} //namespace MR
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "MRMeshDecimate.h"
+#include "MRExpected.h"
+#include <filesystem>
+#include <string>
+
+namespace MR
+{
+
+/**
+ * \struct MR::DecimateStreamingSettings
+ * \brief Parameters structure for MR::decimateMeshFile
+ * \ingroup DecimateGroup
+ *
+ * \sa \ref decimateMeshFile
+ */
+struct DecimateStreamingSettings
+{
+    /// parameters of decimation applied to each chunk and to the seams between chunks;
+    /// the fields referring to the elements of one mesh (region, notFlippable, edgesToCollapse, bdVerts, vertForms,
+    /// preCollapse, adjustCollapse, onEdgeDel), the limits on the number of deleted elements, touchBdVertices, packMesh
+    /// and progressCallback are ignored
+    DecimateSettings decimate;
+    /// approximate limit on the memory (in bytes) used during decimation;
+    /// the input is split on spatial chunks each fitting in this budget
+    size_t memoryBudget = size_t( 4 ) << 30;
+    /// the number of vertex rings near chunk boundaries, which are not written immediately after chunk decimation,
+    /// but decimated again together with the rings of neighbor chunks
+    int seamRings = 2;
+    /// the maximal number of times the seams are decimated again, after that the remaining seams are written as is
+    int maxSeamLevels = 8;
+    /// the folder for temporary files with the triangles of chunks, which need about the size of the input in total;
+    /// if empty then a unique folder in system temporary directory is used
+    std::filesystem::path tempFolder;
+    /// callback to report algorithm progress and cancel it by user request
+    ProgressCallback progress;
+};
+
+/**
+ * \struct MR::DecimateStreamingResult
+ * \brief Results of MR::decimateMeshFile
+ * \ingroup DecimateGroup
+ */
+struct DecimateStreamingResult
+{
+    /// the number of triangles read from input file
+    size_t inputTriangles = 0;
+    /// the number of triangles written in output file
+    size_t outputTriangles = 0;
+    /// the number of decimated chunks including the seams
+    int numChunks = 0;
+    /// the maximal error introduced in any of the chunks, see DecimateResult::errorIntroduced
+    float errorIntroduced = 0;
+};
+
+/**
+ * \brief Decimates the mesh from a file, which can be larger than available memory, and saves the result in another file
+ * \ingroup DecimateGroup
+ * \details The input (binary .stl or binary little-endian .ply) is read in spatial chunks, each chunk is decimated with
+ * locked boundary by \ref decimateMesh, the triangles far from chunk boundary are written in output binary .stl file immediately,
+ * and the triangles near the boundary are merged with their neighbors from other chunks and decimated again;
+ * the vertex coordinates of .ply file are kept in memory during the whole processing;
+ * in case of error or cancellation the output file is removed
+ *
+ * \sa \ref decimateMesh
+ */
+MRMESH_API Expected<DecimateStreamingResult, std::string> decimateMeshFile( const std::filesystem::path & input,
+    const std::filesystem::path & output, const DecimateStreamingSettings & settings = {} );
+
+} //namespace MR
@@ -81,6 +81,8 @@ using Triangulation = Vector<ThreeVertIds, FaceId>;
 struct UnorientedTriangle;
 struct SomeLocalTriangulations;
 struct AllLocalTriangulations;
+struct NeighborGraphSettings;
+struct NeighborGraph;
 
 using EdgePath = std::vector<EdgeId>;
 using EdgeLoop = std::vector<EdgeId>;
@@ -305,6 +307,8 @@ struct PointOnFace;
 struct PointOnObject;
 struct MeshTriPoint;
 struct MeshProjectionResult;
+struct CoordinateConverters;
+struct MeshIntCoords;
 struct MeshIntersectionResult;
 template <typename T> struct IntersectionPrecomputes;
 
@@ -392,7 +396,9 @@ struct MRMESH_CLASS MeshPart;
 class MRMESH_CLASS MeshOrPoints;
 struct MRMESH_CLASS PointCloud;
 class MRMESH_CLASS AABBTree;
+class MRMESH_CLASS WideAABBTree;
 class MRMESH_CLASS AABBTreePoints;
+class PointChunkStore;
 struct MRMESH_CLASS CloudPartMapping;
 struct MRMESH_CLASS PartMapping;
 struct MeshTexture;
@@ -1,5 +1,6 @@
 #include "MRMeshIntersect.h"
 #include "MRAABBTree.h"
+#include "MRWideAABBTree.h"
 #include "MRMesh.h"
 #include "MRMeshPart.h"
 #include "MRRayBoxIntersection.h"
@@ -13,6 +14,7 @@
 #include "MRMeshBuilder.h"
 #include "MRMeshSave.h"
 #include "MRBitSetParallelFor.h"
+#include "MRParallelFor.h"
 #include "MRTimer.h"
 #include "MRPch/MRSpdlog.h"
 
@@ -154,6 +156,287 @@ std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPart& meshPart
     }
 }
 
+template<typename T>
+std::optional<MeshIntersectionResult> meshRayIntersectWide_( const MeshPart& meshPart, const WideAABBTree& tree, const Line3<T>& line,
+    T rayStart, T rayEnd, const IntersectionPrecomputes<T>& prec, bool closestIntersect, const FacePredicate & validFaces )
+{
+    const auto& m = meshPart.mesh;
+    constexpr int maxStackSize = 32 * ( WideAABBTree::Width - 1 ) + 1;
+    if( tree.empty() )
+        return std::nullopt;
+
+    RayOrigin<T> rayOrigin{ line.p };
+    T s = rayStart, e = rayEnd;
+    if( !rayBoxIntersect( Box3<T>{ tree.getBoundingBox() }, rayOrigin, s, e, prec ) )
+    {
+        return std::nullopt;
+    }
+
+    // child references are encoded as in WideAABBTreeNode::child, 0 means the root
+    std::pair<int,T> nodesStack[maxStackSize];
+    int currentNode = 0;
+    nodesStack[0] = { tree.rootNodeId(), rayStart };
+
+    FaceId faceId;
+    TriPointf triP;
+    while( currentNode >= 0 && ( closestIntersect || !faceId ) )
+    {
+        const auto [child, childStart] = nodesStack[currentNode--];
+        if( childStart >= rayEnd )
+            continue;
+
+        if( child < 0 )
+        {
+            auto face = FaceId( ~child );
+            if( ( !meshPart.region || meshPart.region->test( face ) ) && ( !validFaces || validFaces( face ) ) )
+            {
+                VertId a, b, c;
+                m.topology.getTriVerts( face, a, b, c );
+
+                const Vector3<T> vA = Vector3<T>( m.points[a] ) - line.p;
+                const Vector3<T> vB = Vector3<T>( m.points[b] ) - line.p;
+                const Vector3<T> vC = Vector3<T>( m.points[c] ) - line.p;
+                if ( auto triIsect = rayTriangleIntersect( vA, vB, vC, prec ) )
+                {
+                    if ( triIsect->t < rayEnd && triIsect->t > rayStart )
+                    {
+                        faceId = face;
+                        triP = triIsect->bary;
+                        rayEnd = triIsect->t;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // push intersected children so that the nearest one is processed first
+        const auto& node = tree[child];
+        std::pair<int,T> children[WideAABBTree::Width];
+        int numChildren = 0;
+        for( int i = 0; i < WideAABBTree::Width; ++i )
+        {
+            if( !node.hasChild( i ) )
+                continue;
+            T cStart = rayStart, cEnd = rayEnd;
+            if( !rayBoxIntersect( Box3<T>{ node.childBox( i ) }, rayOrigin, cStart, cEnd, prec ) )
+                continue;
+            int j = numChildren++;
+            for( ; j > 0 && children[j - 1].second < cStart; --j )
+                children[j] = children[j - 1];
+            children[j] = { node.child[i], cStart };
+        }
+        assert( currentNode + 1 + numChildren <= maxStackSize );
+        for( int i = 0; i < numChildren; ++i )
+            nodesStack[++currentNode] = children[i];
+    }
+
+    if( faceId.valid() )
+    {
+        MeshIntersectionResult res;
+        res.proj.face = faceId;
+        res.proj.point = Vector3f( line.p + rayEnd * line.d );
+        res.mtp = MeshTriPoint( m.topology.edgeWithLeft( faceId ), triP );
+        res.distanceAlongLine = float( rayEnd );
+        return res;
+    }
+    else
+    {
+        return std::nullopt;
+    }
+}
+
+std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPart& meshPart, const WideAABBTree& tree, const Line3f& line,
+    float rayStart, float rayEnd, const IntersectionPrecomputes<float>* prec, bool closestIntersect, const FacePredicate & validFaces )
+{
+    if( prec )
+    {
+        return meshRayIntersectWide_<float>( meshPart, tree, line, rayStart, rayEnd, *prec, closestIntersect, validFaces );
+    }
+    else
+    {
+        const IntersectionPrecomputes<float> precNew( line.d );
+        return meshRayIntersectWide_<float>( meshPart, tree, line, rayStart, rayEnd, precNew, closestIntersect, validFaces );
+    }
+}
+
+std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPart& meshPart, const WideAABBTree& tree, const Line3d& line,
+    double rayStart, double rayEnd, const IntersectionPrecomputes<double>* prec, bool closestIntersect, const FacePredicate & validFaces )
+{
+    if( prec )
+    {
+        return meshRayIntersectWide_<double>( meshPart, tree, line, rayStart, rayEnd, *prec, closestIntersect, validFaces );
+    }
+    else
+    {
+        const IntersectionPrecomputes<double> precNew( line.d );
+        return meshRayIntersectWide_<double>( meshPart, tree, line, rayStart, rayEnd, precNew, closestIntersect, validFaces );
+    }
+}
+
+void rayMeshIntersectPacket( const MeshPart& meshPart, const RayPacket& packet, MeshIntersectionResult* res,
+    float rayStart, float rayEnd, bool closestIntersect, const RayFacePredicate & validFaces )
+{
+    constexpr int N = RayPacket::MaxSize;
+    constexpr int maxTreeDepth = 32;
+    const int n = packet.size;
+    assert( n >= 0 && n <= N );
+    for ( int i = 0; i < n; ++i )
+        res[i] = {};
+
+    const auto& m = meshPart.mesh;
+    const auto& tree = m.getAABBTree();
+    if ( tree.nodes().size() == 0 || n == 0 )
+        return;
+
+    // per-ray data, inactive rays beyond packet.size have empty interval
+    float invx[N], invy[N], invz[N], tEnd[N];
+    IntersectionPrecomputes<float> precs[N];
+    for ( int i = 0; i < N; ++i )
+    {
+        invx[i] = packet.dx[i] == 0 ? FLT_MAX : 1 / packet.dx[i];
+        invy[i] = packet.dy[i] == 0 ? FLT_MAX : 1 / packet.dy[i];
+        invz[i] = packet.dz[i] == 0 ? FLT_MAX : 1 / packet.dz[i];
+        tEnd[i] = i < n ? rayEnd : -FLT_MAX;
+    }
+    for ( int i = 0; i < n; ++i )
+        precs[i] = IntersectionPrecomputes<float>( packet.dir( i ) );
+
+    // tests given box against all rays at once, returns the mask of intersected rays, and entry distances
+    auto boxMask = [&]( const Box3f & box, float ( &tStart )[N] )
+    {
+        std::uint32_t mask = 0;
+        for ( int i = 0; i < N; ++i )
+        {
+            const float ax = ( box.min.x - packet.ox[i] ) * invx[i], bx = ( box.max.x - packet.ox[i] ) * invx[i];
+            const float ay = ( box.min.y - packet.oy[i] ) * invy[i], by = ( box.max.y - packet.oy[i] ) * invy[i];
+            const float az = ( box.min.z - packet.oz[i] ) * invz[i], bz = ( box.max.z - packet.oz[i] ) * invz[i];
+            const float t0 = std::max( { rayStart, std::min( ax, bx ), std::min( ay, by ), std::min( az, bz ) } );
+            const float t1 = std::min( { tEnd[i], std::max( ax, bx ), std::max( ay, by ), std::max( az, bz ) } );
+            tStart[i] = t0;
+            mask |= std::uint32_t( t0 <= t1 ) << i;
+        }
+        return mask;
+    };
+    // returns the smallest entry distance among given rays to order children traversal
+    auto minStart = []( std::uint32_t mask, const float ( &tStart )[N] )
+    {
+        float res = FLT_MAX;
+        for ( int i = 0; i < N; ++i )
+            if ( mask & ( 1u << i ) )
+                res = std::min( res, tStart[i] );
+        return res;
+    };
+
+    struct SubTask
+    {
+        AABBTree::NodeId n;
+        std::uint32_t mask = 0;
+    };
+    SubTask stack[maxTreeDepth];
+    int stackSize = 0;
+    // rays with found intersection in any-intersection mode
+    std::uint32_t finished = 0;
+
+    float tStart[N];
+    const std::uint32_t activeMask = ( 1u << n ) - 1;
+    if ( auto mask = activeMask & boxMask( tree[tree.rootNodeId()].box, tStart ) )
+        stack[stackSize++] = { tree.rootNodeId(), mask };
+
+    while ( stackSize > 0 )
+    {
+        auto [nodeId, mask] = stack[--stackSize];
+        mask &= ~finished;
+        if ( !mask )
+            continue;
+
+        const auto& node = tree[nodeId];
+        if ( node.leaf() )
+        {
+            const auto face = node.leafId();
+            if ( meshPart.region && !meshPart.region->test( face ) )
+                continue;
+            VertId a, b, c;
+            m.topology.getTriVerts( face, a, b, c );
+            for ( int i = 0; i < n; ++i )
+            {
+                if ( !( mask & ( 1u << i ) ) )
+                    continue;
+                if ( validFaces && !validFaces( i, face ) )
+                    continue;
+                const auto o = packet.origin( i );
+                if ( auto triIsect = rayTriangleIntersect( m.points[a] - o, m.points[b] - o, m.points[c] - o, precs[i] ) )
+                {
+                    if ( triIsect->t < tEnd[i] && triIsect->t > rayStart )
+                    {
+                        tEnd[i] = triIsect->t;
+                        res[i].proj.face = face;
+                        res[i].mtp = MeshTriPoint( m.topology.edgeWithLeft( face ), triIsect->bary );
+                        if ( !closestIntersect )
+                            finished |= 1u << i;
+                    }
+                }
+            }
+            continue;
+        }
+
+        float lStart[N], rStart[N];
+        const auto lMask = mask & boxMask( tree[node.l].box, lStart );
+        const auto rMask = mask & boxMask( tree[node.r].box, rStart );
+        SubTask l{ node.l, lMask }, r{ node.r, rMask };
+        // push farther child first to process the nearer one before
+        if ( lMask && rMask && minStart( lMask, lStart ) < minStart( rMask, rStart ) )
+            std::swap( l, r );
+        if ( l.mask )
+        {
+            assert( stackSize < maxTreeDepth );
+            stack[stackSize++] = l;
+        }
+        if ( r.mask )
+        {
+            assert( stackSize < maxTreeDepth );
+            stack[stackSize++] = r;
+        }
+    }
+
+    for ( int i = 0; i < n; ++i )
+    {
+        if ( !res[i].proj.face )
+            continue;
+        res[i].proj.point = packet.origin( i ) + tEnd[i] * packet.dir( i );
+        res[i].distanceAlongLine = tEnd[i];
+    }
+}
+
+void rayMeshIntersectBatch( const MeshPart& meshPart, const std::vector<Vector3f>& origins, const std::vector<Vector3f>& dirs,
+    std::vector<MeshIntersectionResult>& res, float rayStart, float rayEnd, bool closestIntersect, const RayFacePredicate & validFaces )
+{
+    MR_TIMER
+    assert( origins.size() == dirs.size() );
+    const auto numRays = origins.size();
+    if ( res.size() < numRays )
+        res.resize( numRays );
+    if ( numRays == 0 )
+        return;
+
+    // construct the tree before parallel region
+    meshPart.mesh.getAABBTree();
+
+    constexpr size_t N = RayPacket::MaxSize;
+    const auto numPackets = ( numRays + N - 1 ) / N;
+    ParallelFor( size_t( 0 ), numPackets, [&]( size_t p )
+    {
+        const auto first = p * N;
+        const auto last = std::min( first + N, numRays );
+        RayPacket packet;
+        for ( auto i = first; i < last; ++i )
+            packet.add( origins[i], dirs[i] );
+        RayFacePredicate packetValidFaces;
+        if ( validFaces )
+            packetValidFaces = [&validFaces, first]( size_t ray, FaceId f ) { return validFaces( first + ray, f ); };
+        rayMeshIntersectPacket( meshPart, packet, res.data() + first, rayStart, rayEnd, closestIntersect, packetValidFaces );
+    } );
+}
+
 template<typename T>
 std::optional<MultiMeshIntersectionResult> rayMultiMeshAnyIntersect_( const std::vector<Line3Mesh<T>> & lineMeshes,
     T rayStart /*= 0.0f*/, T rayEnd /*= FLT_MAX */ )
@@ -415,11 +698,39 @@ VertScalars computeThicknessAtVertices( const Mesh& mesh )
 {
     MR_TIMER
     VertScalars res( mesh.points.size(), FLT_MAX );
-    BitSetParallelFor( mesh.topology.getValidVerts(), [&]( VertId v )
+    const auto & validVerts = mesh.topology.getValidVerts();
+    mesh.getAABBTree(); // construct the tree before parallel region
+
+    // the rays from consecutive vertices are usually coherent, so trace them together
+    constexpr size_t N = RayPacket::MaxSize;
+    ParallelFor( size_t( 0 ), ( validVerts.size() + N - 1 ) / N, [&]( size_t p )
     {
-        auto isec = rayInsideIntersect( mesh, v );
-        if ( isec )
-            res[v] = isec->distanceAlongLine;
+        RayPacket packet;
+        VertId verts[N];
+        const VertId vEnd( std::min( ( p + 1 ) * N, validVerts.size() ) );
+        for ( VertId v( p * N ); v < vEnd; ++v )
+        {
+            if ( !validVerts.test( v ) )
+                continue;
+            verts[packet.size] = v;
+            packet.add( mesh.points[v], -mesh.pseudonormal( v ) );
+        }
+        if ( packet.size == 0 )
+            return;
+
+        MeshIntersectionResult isecs[N];
+        rayMeshIntersectPacket( mesh, packet, isecs, 0.0f, FLT_MAX, true,
+            [&verts, &top = mesh.topology]( size_t ray, FaceId f )
+            {
+                // ignore intersections with incident faces of the ray's vertex
+                const auto v = verts[ray];
+                VertId a, b, c;
+                top.getTriVerts( f, a, b, c );
+                return v != a && v != b && v != c;
+            } );
+        for ( int i = 0; i < packet.size; ++i )
+            if ( isecs[i].proj.face )
+                res[verts[i]] = isecs[i].distanceAlongLine;
     } );
     return res;
 }
@@ -444,4 +755,38 @@ TEST(MRMesh, MeshIntersect)
     }
 }
 
+TEST(MRMesh, RayMeshIntersectPacket)
+{
+    Mesh sphere = makeUVSphere( 1, 16, 16 );
+
+    // thickness computed with ray packets equals to the one computed ray by ray
+    const auto thickness = computeThicknessAtVertices( sphere );
+    for ( auto v : sphere.topology.getValidVerts() )
+    {
+        const auto isec = rayInsideIntersect( sphere, v );
+        ASSERT_TRUE( isec.has_value() );
+        EXPECT_NEAR( thickness[v], isec->distanceAlongLine, 1e-5f );
+    }
+
+    std::vector<Vector3f> origins, dirs;
+    for ( int i = 0; i < 21; ++i )
+    {
+        origins.emplace_back( 0.1f * i - 1, 0.05f * i, 3 );
+        dirs.emplace_back( 0.01f * i, 0, -1 );
+    }
+    std::vector<MeshIntersectionResult> res;
+    rayMeshIntersectBatch( sphere, origins, dirs, res );
+    ASSERT_EQ( res.size(), origins.size() );
+    for ( int i = 0; i < origins.size(); ++i )
+    {
+        const auto single = rayMeshIntersect( sphere, Line3f( origins[i], dirs[i] ) );
+        EXPECT_EQ( single.has_value(), res[i].proj.face.valid() );
+        if ( single )
+        {
+            EXPECT_EQ( single->proj.face, res[i].proj.face );
+            EXPECT_NEAR( single->distanceAlongLine, res[i].distanceAlongLine, 1e-5f );
+        }
+    }
+}
+
 } //namespace MR
@@ -42,6 +42,18 @@ struct MeshIntersectionResult
     double rayStart = 0.0, double rayEnd = DBL_MAX, const IntersectionPrecomputes<double>* prec = nullptr, bool closestIntersect = true,
     const FacePredicate & validFaces = {} );
 
+/// Finds ray and mesh intersection in float-precision using compact wide BVH-tree built for the mesh or its part;
+/// all other parameters have the same meaning as in \ref rayMeshIntersect with cached binary tree
+[[nodiscard]] MRMESH_API std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPart& meshPart, const WideAABBTree& tree, const Line3f& line,
+    float rayStart = 0.0f, float rayEnd = FLT_MAX, const IntersectionPrecomputes<float>* prec = nullptr, bool closestIntersect = true,
+    const FacePredicate & validFaces = {} );
+
+/// Finds ray and mesh intersection in double-precision using compact wide BVH-tree built for the mesh or its part;
+/// all other parameters have the same meaning as in \ref rayMeshIntersect with cached binary tree
+[[nodiscard]] MRMESH_API std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPart& meshPart, const WideAABBTree& tree, const Line3d& line,
+    double rayStart = 0.0, double rayEnd = DBL_MAX, const IntersectionPrecomputes<double>* prec = nullptr, bool closestIntersect = true,
+    const FacePredicate & validFaces = {} );
+
 struct MultiMeshIntersectionResult : MeshIntersectionResult
 {
     /// the intersection found in this mesh
@@ -79,6 +91,51 @@ MRMESH_API void rayMeshIntersectAll( const MeshPart& meshPart, const Line3f& lin
 MRMESH_API void rayMeshIntersectAll( const MeshPart& meshPart, const Line3d& line, MeshIntersectionCallback callback,
     double rayStart = 0.0, double rayEnd = DBL_MAX, const IntersectionPrecomputes<double>* prec = nullptr );
 
+/// up to MaxSize rays in structure-of-arrays layout, which are traced through the mesh together
+struct RayPacket
+{
+    static constexpr int MaxSize = 8;
+    /// the number of rays in the packet
+    int size = 0;
+    /// ray origins
+    float ox[MaxSize] = {}, oy[MaxSize] = {}, oz[MaxSize] = {};
+    /// ray directions
+    float dx[MaxSize] = {}, dy[MaxSize] = {}, dz[MaxSize] = {};
+
+    [[nodiscard]] bool full() const { return size == MaxSize; }
+    /// appends one more ray in the packet
+    void add( const Vector3f & origin, const Vector3f & dir )
+    {
+        assert( size < MaxSize );
+        ox[size] = origin.x; oy[size] = origin.y; oz[size] = origin.z;
+        dx[size] = dir.x; dy[size] = dir.y; dz[size] = dir.z;
+        ++size;
+    }
+    [[nodiscard]] Vector3f origin( int i ) const { return { ox[i], oy[i], oz[i] }; }
+    [[nodiscard]] Vector3f dir( int i ) const { return { dx[i], dy[i], dz[i] }; }
+};
+
+/// this predicate is called to check whether given face can be intersected by given ray (#i in a packet or a batch)
+using RayFacePredicate = std::function<bool( size_t ray, FaceId f )>;
+
+/// Finds intersections of all rays in the packet with the mesh in float-precision traversing the tree once for all rays,
+/// which is faster than tracing them one by one for coherent rays (close origins and similar directions).
+/// \param res must point to the array of at least packet.size elements,
+///            res[i] receives the intersection of i-th ray or default value with invalid face if the ray misses the mesh
+/// \param validFaces if given then all faces for which false is returned will be skipped for that ray
+/// Finds the closest to ray origin intersections (or any intersection for better performance if \p !closestIntersect).
+MRMESH_API void rayMeshIntersectPacket( const MeshPart& meshPart, const RayPacket& packet, MeshIntersectionResult* res,
+    float rayStart = 0.0f, float rayEnd = FLT_MAX, bool closestIntersect = true, const RayFacePredicate & validFaces = {} );
+
+/// Finds intersections of many rays (origins[i], dirs[i]) with the mesh in float-precision:
+/// consecutive rays are combined in packets and processed in parallel, so put coherent rays next to each other for the best performance.
+/// \param res is resized to the number of rays if it is smaller,
+///            res[i] receives the intersection of i-th ray or default value with invalid face if the ray misses the mesh
+/// \param validFaces if given then all faces for which false is returned will be skipped for that ray
+MRMESH_API void rayMeshIntersectBatch( const MeshPart& meshPart, const std::vector<Vector3f>& origins, const std::vector<Vector3f>& dirs,
+    std::vector<MeshIntersectionResult>& res, float rayStart = 0.0f, float rayEnd = FLT_MAX, bool closestIntersect = true,
+    const RayFacePredicate & validFaces = {} );
+
 /// given mesh part and plane z=zLevel, outputs
 /// \param fs  triangles crossed or touched by the plane
 /// \param ues edges of these triangles
@@ -1,5 +1,7 @@
 #include "MRMeshLoad.h"
 #include "MRMeshBuilder.h"
+#include "MRMappedMrmesh.h"
+#include "MRStlStream.h"
 #include "MRIdentifyVertices.h"
 #include "MRMesh.h"
 #include "MRphmap.h"
@@ -20,7 +22,10 @@
 #include "MRPch/MRTBB.h"
 
 #include <array>
+#include <climits>
 #include <future>
+#include <numeric>
+#include <optional>
 
 #ifndef MRMESH_NO_OPENCTM
 #include "OpenCTM/openctm.h"
@@ -42,13 +47,76 @@ Expected<Mesh, std::string> fromMrmesh( const std::filesystem::path& file, const
     if ( !in )
         return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
 
+    char magic[sizeof( MrmeshAlignedHeader::Magic )] = {};
+    in.read( magic, sizeof( magic ) );
+    if ( in && MrmeshAlignedHeader::hasMagic( magic, sizeof( magic ) ) )
+    {
+        // aligned layout is copied from memory-mapped file in parallel threads
+        in.close();
+        auto mapped = MappedMrmesh::open( file );
+        if ( !mapped )
+            return addFileNameInError( Expected<Mesh, std::string>( unexpected( std::move( mapped.error() ) ) ), file );
+        return addFileNameInError( mapped->toMesh( settings.callback ), file );
+    }
+    in.clear();
+    in.seekg( 0 );
+
     return addFileNameInError( fromMrmesh( in, settings ), file );
 }
 
+static Expected<Mesh, std::string> fromMrmeshAligned( std::istream& in, const MeshLoadSettings& settings )
+{
+    MR_TIMER
+    const auto start = in.tellg();
+    MrmeshAlignedHeader header;
+    in.read( (char*)&header, sizeof( header ) );
+    in.seekg( 0, std::ios_base::end );
+    const auto end = in.tellg();
+    if ( !in )
+        return unexpected( std::string( "Error reading the header of mrmesh-file" ) );
+    if ( auto v = header.validate( std::uint64_t( end - start ) ); !v )
+        return unexpected( std::move( v.error() ) );
+
+    // blocks of the stream are read in one buffer, and then distributed in the mesh
+    std::vector<char> buf( header.pointsOffset - header.edgesOffset );
+    in.seekg( start + std::streamoff( header.edgesOffset ) );
+    if ( !readByBlocks( in, buf.data(), buf.size(), subprogress( settings.callback, 0.0f, 0.5f ) ) )
+        return unexpected( std::string( "Loading canceled" ) );
+    if ( !in )
+        return unexpected( std::string( "Error reading topology from mrmesh-file" ) );
+
+    Mesh mesh;
+    auto block = [&]( std::uint64_t offset, std::uint64_t size ) { return std::span<const char>( buf.data() + ( offset - header.edgesOffset ), size_t( size ) ); };
+    auto readRes = mesh.topology.read(
+        block( header.edgesOffset, header.numEdges * MrmeshAlignedHeader::EdgeRecordSize ),
+        block( header.edgePerVertexOffset, header.numVerts * sizeof( EdgeId ) ),
+        block( header.edgePerFaceOffset, header.numFaces * sizeof( EdgeId ) ),
+        subprogress( settings.callback, 0.5f, 0.8f ) );
+    if ( !readRes )
+        return unexpected( std::move( readRes.error() ) );
+    buf = {};
+
+    mesh.points.resizeNoInit( header.numPoints );
+    if ( !readByBlocks( in, (char*)mesh.points.data(), mesh.points.size() * sizeof( Vector3f ), subprogress( settings.callback, 0.8f, 1.0f ) ) )
+        return unexpected( std::string( "Loading canceled" ) );
+    if ( !in )
+        return unexpected( std::string( "Error reading  points from mrmesh-file" ) );
+    return mesh;
+}
+
 Expected<Mesh, std::string> fromMrmesh( std::istream& in, const MeshLoadSettings& settings /*= {}*/ )
 {
     MR_TIMER
 
+    const auto start = in.tellg();
+    char magic[sizeof( MrmeshAlignedHeader::Magic )] = {};
+    in.read( magic, sizeof( magic ) );
+    const bool aligned = in && MrmeshAlignedHeader::hasMagic( magic, sizeof( magic ) );
+    in.clear();
+    in.seekg( start );
+    if ( aligned )
+        return fromMrmeshAligned( in, settings );
+
     Mesh mesh;
     auto readRes = mesh.topology.read( in, subprogress( settings.callback, 0.f, 0.5f) );
     if ( !readRes.has_value() )
@@ -147,7 +215,7 @@ Expected<Mesh, std::string> fromOff( std::istream& in, const MeshLoadSettings& s
         {
             forseStop = true;
         }
-    }, settings.callback );
+    }, subprogress( settings.callback, 0.0f, 0.4f ) );
 
     if ( forseStop )
     {
@@ -160,18 +228,22 @@ Expected<Mesh, std::string> fromOff( std::istream& in, const MeshLoadSettings& s
 
     size_t delta = numPoints + strHeader + strBorder;
 
+    // parse the sizes of polygons in parallel, and then compute their spans in the flat list of indices
     Vector<MeshBuilder::VertSpan, FaceId> faces( numPolygons );
-    int numPolygonPoint = 0;
-    int start = 0;
-    for ( size_t i = 0; i < numPolygons; i++ )
+    ParallelFor( faces, [&] ( FaceId f )
     {
-        size_t numLine = delta + i;
-        
+        size_t numLine = delta + f;
         const std::string_view line( &buf[splitLines[numLine]], splitLines[numLine + 1] - splitLines[numLine] );
+        int numPolygonPoint = 0;
         parseFirstNum( line, numPolygonPoint );
-
-        faces.vec_[i] = MeshBuilder::VertSpan{ start, start + numPolygonPoint };
-        start += numPolygonPoint;
+        faces[f].lastVertex = numPolygonPoint;
+    } );
+    int start = 0;
+    for ( auto & span : faces )
+    {
+        span.firstVertex = start;
+        start += span.lastVertex;
+        span.lastVertex = start;
     }
 
     std::vector<VertId> flatPolygonIndices( faces.back().lastVertex );
@@ -191,7 +263,7 @@ Expected<Mesh, std::string> fromOff( std::istream& in, const MeshLoadSettings& s
         {
             forseStop = true;
         }
-    }, settings.callback );
+    }, subprogress( settings.callback, 0.4f, 0.8f ) );
 
     if ( forseStop )
     {
@@ -209,9 +281,11 @@ Expected<Mesh, std::string> fromOff( std::istream& in, const MeshLoadSettings& s
         skippedFaces.resize( faces.size(), true );
         buildSettings.region = &skippedFaces;
     }
-    auto res = Mesh::fromFaceSoup( std::move( pointsBlocks ), flatPolygonIndices, faces, buildSettings );
+    auto res = Mesh::fromFaceSoup( std::move( pointsBlocks ), flatPolygonIndices, faces, buildSettings, subprogress( settings.callback, 0.8f, 1.0f ) );
     if ( settings.skippedFaceCount )
         *settings.skippedFaceCount = int( skippedFaces.count() );
+    if ( !reportProgress( settings.callback, 1.0f ) )
+        return unexpectedOperationCanceled();
     return res;
 }
 
@@ -272,92 +346,109 @@ Expected<Mesh, std::string> fromBinaryStl( const std::filesystem::path & file, c
 Expected<Mesh, std::string> fromBinaryStl( std::istream& in, const MeshLoadSettings& settings /*= {}*/ )
 {
     MR_TIMER
+    auto reader = StlTriangleReader::open( in, 32768 );
+    if ( !reader )
+        return unexpected( std::move( reader.error() ) );
+    return readMesh( *reader, true, settings );
+}
 
-    char header[80];
-    in.read( header, 80 );
-
-    std::uint32_t numTris;
-    in.read( (char*)&numTris, 4 );
+Expected<Mesh, std::string> fromASCIIStl( const std::filesystem::path& file, const MeshLoadSettings& settings /*= {}*/ )
+{
+    std::ifstream in( file, std::ifstream::binary );
     if ( !in )
-        return unexpected( std::string( "Error reading the number of triangles from STL-file" ) );
+        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
 
-    auto posCur = in.tellg();
-    in.seekg( 0, std::ios_base::end );
-    auto posEnd = in.tellg();
-    in.seekg( posCur );
-    if ( posEnd - posCur < 50 * std::istream::pos_type( numTris ) )
-        return unexpected( std::string( "Binary STL-file is too short" ) );
+    return addFileNameInError( fromASCIIStl( in, settings ), file );
+}
 
-    MeshBuilder::VertexIdentifier vi;
-    vi.reserve( numTris );
+Expected<Mesh, std::string> fromASCIIStl( std::istream& in, const MeshLoadSettings& settings /*= {}*/ )
+{
+    MR_TIMER;
+
+    auto bufOrExpect = readCharBuffer( in );
+    if ( !bufOrExpect )
+        return unexpected( std::move( bufOrExpect.error() ) );
+    const auto& buf = bufOrExpect.value();
+    if ( !reportProgress( settings.callback, 0.1f ) )
+        return unexpected( std::string( "Loading canceled" ) );
 
-    #pragma pack(push, 1)
-    struct StlTriangle
+    const auto newlines = splitByLines( buf.data(), buf.size() );
+    const size_t numLines = newlines.size() - 1;
+    // returns i-th line without leading spaces
+    const auto getLine = [&] ( size_t i )
     {
-        Vector3f normal;
-        Vector3f vert[3];
-        std::uint16_t attr;
+        std::string_view line( buf.data() + newlines[i], newlines[i + 1] - newlines[i] );
+        const auto first = line.find_first_not_of( " \t\r\n" );
+        return first == std::string_view::npos ? std::string_view{} : line.substr( first );
+    };
+    const auto isVertexLine = [] ( std::string_view line )
+    {
+        return line.starts_with( "vertex" ) && line.size() > 6 && std::isspace( (unsigned char)line[6] );
     };
-    #pragma pack(pop)
-    static_assert( sizeof( StlTriangle ) == 50, "check your padding" );
-
-    const auto itemsInBuffer = std::min( numTris, 32768u );
-    std::vector<StlTriangle> buffer( itemsInBuffer ), nextBuffer( itemsInBuffer );
-    std::vector<Triangle3f> chunk( itemsInBuffer );
 
-    // first chunk
-    in.read( (char*)buffer.data(), sizeof(StlTriangle) * itemsInBuffer );
-    if ( !in  )
-        return unexpected( std::string( "Binary STL read error" ) );
+    size_t firstLine = 0;
+    while ( firstLine < numLines && getLine( firstLine ).empty() )
+        ++firstLine;
+    if ( firstLine == numLines || !getLine( firstLine ).starts_with( "solid" ) )
+        return unexpected( std::string( "Failed to find 'solid' prefix in ascii STL" ) );
 
-    size_t decodedBytes = 0;
-    // 0.5 because fromTrianglesDuplicatingNonManifoldVertices takes at least half of time
-    const float rStreamSize = 0.5f * sizeof( StlTriangle ) / float( posEnd - posCur );
+    // count vertex lines in each block of lines to know where to put the vertices of each block
+    constexpr size_t linesPerBlock = 4096;
+    const size_t numBlocks = ( numLines + linesPerBlock - 1 ) / linesPerBlock;
+    std::vector<size_t> blockFirstVert( numBlocks + 1, 0 );
+    ParallelFor( size_t( 0 ), numBlocks, [&] ( size_t b )
+    {
+        size_t numVerts = 0;
+        for ( size_t l = b * linesPerBlock; l < std::min( ( b + 1 ) * linesPerBlock, numLines ); ++l )
+            if ( isVertexLine( getLine( l ) ) )
+                ++numVerts;
+        blockFirstVert[b + 1] = numVerts;
+    } );
+    std::partial_sum( blockFirstVert.begin(), blockFirstVert.end(), blockFirstVert.begin() );
+    if ( blockFirstVert.back() % 3 != 0 )
+        return unexpected( std::string( "The number of vertices in ascii STL is not a multiple of three" ) );
 
-    while ( !buffer.empty() )
+    std::vector<Triangle3f> tris( blockFirstVert.back() / 3 );
+    std::atomic<bool> parseError{ false };
+    const bool keepGoing = ParallelFor( size_t( 0 ), numBlocks, [&] ( size_t b )
     {
-        // decode previously read buffer in a worked thread
-        tbb::task_group taskGroup;
-        taskGroup.run( [&chunk, &vi, &buffer] ()
+        size_t v = blockFirstVert[b];
+        for ( size_t l = b * linesPerBlock; l < std::min( ( b + 1 ) * linesPerBlock, numLines ); ++l )
         {
-            chunk.resize( buffer.size() );
-            for ( int i = 0; i < buffer.size(); ++i )
-                for ( int j = 0; j < 3; ++j )
-                    chunk[i][j] = buffer[i].vert[j];
-            vi.addTriangles( chunk );
-        } );
-
-        if ( vi.numTris() + buffer.size() < numTris )
-        {
-            const auto itemsInNextChuck = std::min( numTris - (std::uint32_t)( vi.numTris() + buffer.size() ), itemsInBuffer );
-            nextBuffer.resize( itemsInNextChuck );
-            const size_t size = sizeof( StlTriangle ) * nextBuffer.size();
-            // read from stream in the current thread to be compatible with PythonIstreamBuf
-            in.read( ( char* )nextBuffer.data(), size );
+            const auto line = getLine( l );
+            if ( !isVertexLine( line ) )
+                continue;
+            Vector3d point; // double is used to correctly open coordinates like 1e-55 which are under of float-precision
+            if ( !parseTextCoordinate( line.substr( 6 ), point ) )
+            {
+                parseError.store( true, std::memory_order_relaxed );
+                return;
+            }
+            tris[v / 3][v % 3] = Vector3f( point );
+            ++v;
         }
-        else
-            nextBuffer.clear();
-
-        taskGroup.wait();
-        decodedBytes += buffer.size();
+    }, subprogress( settings.callback, 0.1f, 0.4f ), 1 );
+    if ( parseError )
+        return unexpected( std::string( "Error when reading vertex coordinates in ascii STL" ) );
+    if ( !keepGoing )
+        return unexpected( std::string( "Loading canceled" ) );
 
-        if ( !reportProgress( settings.callback , decodedBytes * rStreamSize ) )
+    // identify coinciding vertices in parallel hash map by portions of triangles to report progress
+    MeshBuilder::VertexIdentifier vi;
+    vi.reserve( tris.size() );
+    constexpr size_t trisInPortion = 1 << 16;
+    std::vector<Triangle3f> portion;
+    for ( size_t first = 0; first < tris.size(); first += trisInPortion )
+    {
+        portion.assign( tris.begin() + first, tris.begin() + std::min( first + trisInPortion, tris.size() ) );
+        vi.addTriangles( portion );
+        if ( !reportProgress( settings.callback, 0.4f + 0.3f * float( vi.numTris() ) / tris.size() ) )
             return unexpected( std::string( "Loading canceled" ) );
-        if ( !in )
-            return unexpected( std::string( "Binary STL read error" ) );
-        buffer.swap( nextBuffer );
     }
-
-//     #pragma warning(disable: 4244)
-//     std::cout <<
-//         "tris = " << numTris << "\n"
-//         "verts = " << hmap.size() << "\n"
-//         "bucket_count = " << hmap.bucket_count() << "\n"
-//         "subcnt = " << hmap.subcnt() << "\n"
-//         "load_factor = " << hmap.load_factor() << "\n"
-//         "max_load_factor = " << hmap.max_load_factor() << "\n";
-
+    tris = {};
     auto t = vi.takeTriangulation();
+    auto points = vi.takePoints();
+
     FaceBitSet skippedFaces;
     std::vector<MeshBuilder::VertDuplication> dups;
     std::vector<MeshBuilder::VertDuplication>* dupsPtr = nullptr;
@@ -370,122 +461,260 @@ Expected<Mesh, std::string> fromBinaryStl( std::istream& in, const MeshLoadSetti
         skippedFaces.set();
         buildSettings.region = &skippedFaces;
     }
-    const auto res = Mesh::fromTrianglesDuplicatingNonManifoldVertices( vi.takePoints(), t, dupsPtr, buildSettings );
+    const auto res = Mesh::fromTrianglesDuplicatingNonManifoldVertices( std::move( points ), t, dupsPtr, buildSettings );
     if ( settings.duplicatedVertexCount )
         *settings.duplicatedVertexCount = int( dups.size() );
     if ( settings.skippedFaceCount )
         *settings.skippedFaceCount = int( skippedFaces.count() );
-    if ( !reportProgress( settings.callback , 1.0f ) )
+    if ( !reportProgress( settings.callback, 1.0f ) )
         return unexpected( std::string( "Loading canceled" ) );
     return res;
 }
 
-Expected<Mesh, std::string> fromASCIIStl( const std::filesystem::path& file, const MeshLoadSettings& settings /*= {}*/ )
+namespace
 {
-    std::ifstream in( file, std::ifstream::binary );
-    if ( !in )
-        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
 
-    return addFileNameInError( fromASCIIStl( in, settings ), file );
-}
-
-Expected<Mesh, std::string> fromASCIIStl( std::istream& in, const MeshLoadSettings& settings /*= {}*/ )
+/// the layout of textual PLY-file, which can be parsed in parallel
+struct AsciiPlyHeader
 {
-    MR_TIMER;
+    struct Element
+    {
+        std::string name;
+        size_t count = 0;
+        std::vector<std::string> props;
+        int listProp = -1; ///< the index of list property (only for faces)
+    };
+    std::vector<Element> elements;
+};
 
-    using HMap = ParallelHashMap<Vector3f, VertId>;
-    HMap hmap;
-    VertCoords points;
-    Triangulation t;
+/// maximal number of properties in one element supported by parallel parser
+constexpr int maxAsciiPlyProps = 64;
 
+/// reads the header of PLY-file; returns nullopt if the file is not textual or has the layout unsupported by parallel parser
+std::optional<AsciiPlyHeader> readAsciiPlyHeader( std::istream& in )
+{
+    AsciiPlyHeader res;
+    bool ascii = false;
     std::string line;
-    std::string prefix;
-    Vector3f point;
-    ThreeVertIds currTri;
-    int triPos = 0;
-    bool solidFound = false;
-
-    const auto posStart = in.tellg();
-    in.seekg( 0, std::ios_base::end );
-    const auto posEnd = in.tellg();
-    in.seekg( posStart );
-    const float streamSize = float( posEnd - posStart );
-
-    for ( int i = 0; std::getline( in, line ); ++i )
+    if ( !std::getline( in, line ) || !line.starts_with( "ply" ) )
+        return {};
+    while ( std::getline( in, line ) )
     {
         std::istringstream iss( line );
-        if ( !( iss >> prefix ) )
+        std::string keyword;
+        iss >> keyword;
+        if ( keyword == "end_header" )
             break;
-
-        if ( !solidFound )
+        if ( keyword == "format" )
         {
-            if ( prefix == "solid" )
-                solidFound = true;
-            else
-                break;
+            std::string format;
+            iss >> format;
+            ascii = format == "ascii";
+            if ( !ascii )
+                return {};
         }
-
-        if ( prefix == "outer" )
+        else if ( keyword == "element" )
         {
-            triPos = 0;
-            continue;
+            AsciiPlyHeader::Element e;
+            iss >> e.name >> e.count;
+            res.elements.push_back( std::move( e ) );
         }
-        if ( prefix == "vertex" )
+        else if ( keyword == "property" )
         {
-            double x, y, z; // double is used to correctly open coordinates like 1e-55 which are under of float-precision
-            if ( !( iss >> x >> y >> z ) )
-                break;
-            point = Vector3f{ Vector3d{ x, y, z } };
-
-            VertId& id = hmap[point];
-            if ( !id.valid() )
+            if ( res.elements.empty() )
+                return {};
+            auto& e = res.elements.back();
+            std::string type, name;
+            iss >> type;
+            if ( type == "list" )
             {
-                id = VertId( points.size() );
-                points.push_back( point );
+                std::string countType, itemType;
+                iss >> countType >> itemType;
+                // lists are supported only for the indices of faces
+                if ( e.name != "face" || e.listProp >= 0 )
+                    return {};
+                e.listProp = (int)e.props.size();
             }
-            currTri[triPos] = id;
-            ++triPos;
-            continue;
+            iss >> name;
+            e.props.push_back( std::move( name ) );
+            if ( e.props.size() > maxAsciiPlyProps )
+                return {};
         }
-        if ( prefix == "endloop" )
+    }
+    if ( !ascii || !in )
+        return {};
+    return res;
+}
+
+/// parses textual PLY-file in parallel threads, each element row is expected on its own line;
+/// returns nullopt if the number of lines differs from the number of rows, then the file shall be read by miniply,
+/// which also reads one row per line but ignores the rest of each line and the lines after the last element
+std::optional<Expected<Mesh, std::string>> fromAsciiPly( std::istream& in, const AsciiPlyHeader& header, const MeshLoadSettings& settings )
+{
+    MR_TIMER
+    auto bufOrExpect = readCharBuffer( in );
+    if ( !bufOrExpect )
+        return unexpected( std::move( bufOrExpect.error() ) );
+    const auto& buf = bufOrExpect.value();
+    const auto newlines = splitByLines( buf.data(), buf.size() );
+    const auto getLine = [&] ( size_t i )
+    {
+        return std::string_view( buf.data() + newlines[i], newlines[i + 1] - newlines[i] );
+    };
+    size_t numLines = newlines.size() - 1;
+    while ( numLines > 0 && getLine( numLines - 1 ).find_first_not_of( " \t\r\n" ) == std::string_view::npos )
+        --numLines; // skip empty lines in the end
+    size_t numRows = 0;
+    for ( const auto& e : header.elements )
+        numRows += e.count;
+    if ( numRows != numLines )
+        return {};
+    if ( !reportProgress( settings.callback, 0.1f ) )
+        return unexpectedOperationCanceled();
+
+    VertCoords points;
+    std::vector<VertId> flatIndices;
+    Vector<MeshBuilder::VertSpan, FaceId> faces;
+    bool gotVerts = false;
+    size_t firstLine = 0;
+    for ( const auto& e : header.elements )
+    {
+        const auto propIndex = [&e] ( const char* name )
         {
-            t.push_back( currTri );
-            continue;
+            auto it = std::find( e.props.begin(), e.props.end(), name );
+            return it == e.props.end() ? -1 : int( it - e.props.begin() );
+        };
+
+        std::atomic<bool> parseError{ false };
+        if ( e.name == "vertex" )
+        {
+            const int pos[3] = { propIndex( "x" ), propIndex( "y" ), propIndex( "z" ) };
+            if ( pos[0] < 0 || pos[1] < 0 || pos[2] < 0 )
+                return unexpected( std::string( "PLY file does not contain vertex positions" ) );
+            const int normal[3] = { propIndex( "nx" ), propIndex( "ny" ), propIndex( "nz" ) };
+            const bool loadNormals = settings.normals && normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0;
+            const int color[3] = { propIndex( "red" ), propIndex( "green" ), propIndex( "blue" ) };
+            const bool loadColors = settings.colors && color[0] >= 0 && color[1] >= 0 && color[2] >= 0;
+
+            points.resizeNoInit( e.count );
+            if ( loadNormals )
+                settings.normals->resizeNoInit( e.count );
+            if ( loadColors )
+                settings.colors->resizeNoInit( e.count );
+            const int numProps = (int)e.props.size();
+            const bool keepGoing = ParallelFor( points, [&] ( VertId v )
+            {
+                double vals[maxAsciiPlyProps];
+                int count = 0;
+                if ( !parseNumbers( getLine( firstLine + v ), vals, numProps, count ) || count < numProps )
+                {
+                    parseError.store( true, std::memory_order_relaxed );
+                    return;
+                }
+                points[v] = Vector3f( Vector3d( vals[pos[0]], vals[pos[1]], vals[pos[2]] ) );
+                if ( loadNormals )
+                    ( *settings.normals )[v] = Vector3f( Vector3d( vals[normal[0]], vals[normal[1]], vals[normal[2]] ) );
+                if ( loadColors )
+                    ( *settings.colors )[v] = Color( int( vals[color[0]] ), int( vals[color[1]] ), int( vals[color[2]] ) );
+            }, subprogress( settings.callback, 0.1f, 0.4f ) );
+            if ( parseError )
+                return unexpected( std::string( "Error when reading vertices from PLY-file" ) );
+            if ( !keepGoing )
+                return unexpectedOperationCanceled();
+            gotVerts = true;
         }
-        if ( settings.callback && !( i & 0x3FF ) )
+        else if ( e.name == "face" && e.listProp >= 0 )
         {
-            const float progress = float( in.tellg() - posStart ) / streamSize;
-            if ( !settings.callback( progress ) )
-                return unexpected( std::string( "Loading canceled" ) );
+            // parse the sizes of polygons, and then compute their spans in the flat list of indices
+            const int k = e.listProp;
+            faces.resize( e.count );
+            ParallelFor( faces, [&] ( FaceId f )
+            {
+                const auto line = getLine( firstLine + f );
+                double vals[maxAsciiPlyProps];
+                int count = 0;
+                // each number in the line takes at least two characters with the separator
+                if ( !parseNumbers( line, vals, k + 1, count, true ) || count < k + 1
+                    || !( vals[k] >= 0 && vals[k] <= double( line.size() / 2 ) ) )
+                {
+                    parseError.store( true, std::memory_order_relaxed );
+                    return;
+                }
+                faces[f].lastVertex = int( vals[k] );
+            } );
+            if ( parseError )
+                return unexpected( std::string( "Error when reading faces from PLY-file" ) );
+            std::int64_t start = 0;
+            for ( auto& span : faces )
+            {
+                span.firstVertex = int( start );
+                start += span.lastVertex;
+                if ( start > INT_MAX )
+                    return unexpected( std::string( "Too many vertices in faces of PLY-file" ) );
+                span.lastVertex = int( start );
+            }
+
+            flatIndices.resize( start );
+            const bool keepGoing = ParallelFor( faces, [&] ( FaceId f )
+            {
+                const auto span = faces[f];
+                const int n = k + 1 + span.lastVertex - span.firstVertex;
+                double vals[maxAsciiPlyProps];
+                std::vector<double> bigVals;
+                double* pVals = vals;
+                if ( n > maxAsciiPlyProps )
+                {
+                    bigVals.resize( n );
+                    pVals = bigVals.data();
+                }
+                int count = 0;
+                if ( !parseNumbers( getLine( firstLine + f ), pVals, n, count ) || count < n )
+                {
+                    parseError.store( true, std::memory_order_relaxed );
+                    return;
+                }
+                for ( int i = span.firstVertex; i < span.lastVertex; ++i )
+                {
+                    const auto index = pVals[k + 1 + i - span.firstVertex];
+                    if ( !( index >= 0 && index < double( INT_MAX ) ) )
+                    {
+                        parseError.store( true, std::memory_order_relaxed );
+                        return;
+                    }
+                    flatIndices[i] = VertId( int( index ) );
+                }
+            }, subprogress( settings.callback, 0.4f, 0.7f ) );
+            if ( parseError )
+                return unexpected( std::string( "Error when reading faces from PLY-file" ) );
+            if ( !keepGoing )
+                return unexpectedOperationCanceled();
         }
+        firstLine += e.count;
     }
 
-    if ( !solidFound )
-        return unexpected( std::string( "Failed to find 'solid' prefix in ascii STL" ) );
-
-
-
+    if ( !gotVerts )
+        return unexpected( std::string( "PLY file does not contain vertices" ) );
+    for ( auto v : flatIndices )
+        if ( v < 0 || v >= points.size() )
+            return unexpected( std::string( "PLY file face references missing vertex" ) );
 
     FaceBitSet skippedFaces;
-    std::vector<MeshBuilder::VertDuplication> dups;
-    std::vector<MeshBuilder::VertDuplication>* dupsPtr = nullptr;
-    if ( settings.duplicatedVertexCount )
-        dupsPtr = &dups;
     MeshBuilder::BuildSettings buildSettings;
     if ( settings.skippedFaceCount )
     {
-        skippedFaces = FaceBitSet( t.size() );
-        skippedFaces.set();
+        skippedFaces.resize( faces.size(), true );
         buildSettings.region = &skippedFaces;
     }
-    const auto res = Mesh::fromTrianglesDuplicatingNonManifoldVertices( std::move( points ), t, dupsPtr, buildSettings );
-    if ( settings.duplicatedVertexCount )
-        *settings.duplicatedVertexCount = int( dups.size() );
+    auto res = Mesh::fromFaceSoup( std::move( points ), flatIndices, faces, buildSettings, subprogress( settings.callback, 0.7f, 1.0f ) );
     if ( settings.skippedFaceCount )
         *settings.skippedFaceCount = int( skippedFaces.count() );
+    if ( !reportProgress( settings.callback, 1.0f ) )
+        return unexpectedOperationCanceled();
     return res;
 }
 
+} // anonymous namespace
+
 Expected<Mesh, std::string> fromPly( const std::filesystem::path& file, const MeshLoadSettings& settings /*= {}*/ )
 {
     std::ifstream in( file, std::ifstream::binary );
@@ -499,6 +728,14 @@ Expected<Mesh, std::string> fromPly( std::istream& in, const MeshLoadSettings& s
 {
     MR_TIMER
 
+    // textual files are parsed in parallel by own parser, other files are read by miniply
+    const auto posHeader = in.tellg();
+    if ( auto asciiHeader = readAsciiPlyHeader( in ) )
+        if ( auto res = fromAsciiPly( in, *asciiHeader, settings ) )
+            return std::move( *res );
+    in.clear();
+    in.seekg( posHeader );
+
     miniply::PLYReader reader( in );
     if ( !reader.valid() )
         return unexpected( std::string( "PLY file open error" ) );
@@ -45,7 +45,9 @@ MRMESH_API Expected<Mesh, std::string> fromBinaryStl( std::istream& in, const Me
 MRMESH_API Expected<Mesh, std::string> fromASCIIStl( const std::filesystem::path& file, const MeshLoadSettings& settings = {} );
 MRMESH_API Expected<Mesh, std::string> fromASCIIStl( std::istream& in, const MeshLoadSettings& settings = {} );
 
-/// loads from .ply file
+/// loads from .ply file;
+/// textual files are parsed in parallel if each element row is on its own line, otherwise they are read by miniply,
+/// and the rows spanning several lines are not supported
 MRMESH_API Expected<Mesh, std::string> fromPly( const std::filesystem::path& file, const MeshLoadSettings& settings = {} );
 MRMESH_API Expected<Mesh, std::string> fromPly( std::istream& in, const MeshLoadSettings& settings = {} );
 
@@ -2,6 +2,8 @@
 #include "MRMeshSave.h"
 #include "MRMesh.h"
 #include "MRBox.h"
+#include "MRColor.h"
+#include "MRTorus.h"
 #include "MRGTest.h"
 
 namespace MR
@@ -76,4 +78,79 @@ TEST(MRMesh, LoadSave)
     EXPECT_EQ( loadRes->topology.numValidFaces(), 6 );
 }
 
+TEST(MRMesh, LoadSaveText)
+{
+    // ascii STL with the vertices identified in parallel
+    const auto torus = makeTorus( 2, 1, 32, 32 );
+    std::stringstream ss;
+    EXPECT_TRUE( MeshSave::toAsciiStl( torus, ss ).has_value() );
+    auto loadRes = MeshLoad::fromASCIIStl( ss );
+    ASSERT_TRUE( loadRes.has_value() );
+    EXPECT_EQ( loadRes->topology.numValidVerts(), torus.topology.numValidVerts() );
+    EXPECT_EQ( loadRes->topology.numValidFaces(), torus.topology.numValidFaces() );
+    EXPECT_TRUE( loadRes->topology.findHoleRepresentiveEdges().empty() );
+
+    // ascii PLY with a quadrangle and vertex colors
+    std::string file =
+        "ply\n"
+        "format ascii 1.0\n"
+        "element vertex 5\n"
+        "property float x\n"
+        "property float y\n"
+        "property float z\n"
+        "property uchar red\n"
+        "property uchar green\n"
+        "property uchar blue\n"
+        "element face 5\n"
+        "property list uchar int vertex_indices\n"
+        "end_header\n"
+        "0 0 1 255 0 0\n"
+        "1 0 0 0 255 0\n"
+        "0 1 0 0 0 255\n"
+        "-1 0 0 0 0 0\n"
+        "0 -1 0 255 255 255\n"
+        "3 0 1 2\n"
+        "3 0 2 3\n"
+        "3 0 3 4\n"
+        "3 0 4 1\n"
+        "4 1 4 3 2\n";
+    std::istringstream in( file );
+    VertColors colors;
+    MeshLoadSettings settings;
+    settings.colors = &colors;
+    loadRes = MeshLoad::fromPly( in, settings );
+    ASSERT_TRUE( loadRes.has_value() );
+    EXPECT_EQ( loadRes->topology.numValidVerts(), 5 );
+    EXPECT_EQ( loadRes->topology.numValidFaces(), 6 );
+    EXPECT_EQ( loadRes->computeBoundingBox(), Box3f( Vector3f( -1, -1, 0 ), Vector3f( 1, 1, 1 ) ) );
+    ASSERT_EQ( colors.size(), 5 );
+    EXPECT_EQ( colors[1_v], Color( 0, 255, 0 ) );
+
+    // the file with extra lines after the elements is read by miniply
+    std::istringstream extraIn( file + "extra line\n" );
+    loadRes = MeshLoad::fromPly( extraIn );
+    ASSERT_TRUE( loadRes.has_value() );
+    EXPECT_EQ( loadRes->topology.numValidVerts(), 5 );
+    EXPECT_EQ( loadRes->topology.numValidFaces(), 6 );
+
+    // damaged rows are reported instead of being silently truncated
+    auto replaced = [&file]( const std::string & what, const std::string & with )
+    {
+        auto res = file;
+        res.replace( res.find( what ), what.size(), with );
+        return res;
+    };
+    for ( const auto & damaged : {
+        replaced( "1 0 0 0 255 0\n", "1 0 0 0 255 0 7\n" ), // extra vertex property
+        replaced( "1 0 0 0 255 0\n", "1 0 0 0 255 x\n" ), // garbage in vertex row
+        replaced( "3 0 2 3\n", "3 0 2 3 4\n" ), // extra face index
+        replaced( "3 0 2 3\n", "3 0 2 3e20\n" ), // vertex index out of int range
+        replaced( "3 0 2 3\n", "2000000000 0 2 3\n" ), // too many vertices in one face
+    } )
+    {
+        std::istringstream damagedIn( damaged );
+        EXPECT_FALSE( MeshLoad::fromPly( damagedIn ).has_value() );
+    }
+}
+
 } //namespace MR
@@ -1,5 +1,6 @@
 #include "MRMeshProject.h"
 #include "MRAABBTree.h"
+#include "MRWideAABBTree.h"
 #include "MRMesh.h"
 #include "MRClosestPointInTriangle.h"
 #include "MRTimer.h"
@@ -96,6 +97,95 @@ MeshProjectionResult findProjectionSubtree( const Vector3f & pt, const MeshPart
     return res;
 }
 
+MeshProjectionResult findProjectionSubtree( const Vector3f & pt, const MeshPart & mp, const WideAABBTree & tree, float upDistLimitSq, const AffineXf3f * xf, float loDistLimitSq, FaceId skipFace )
+{
+    MeshProjectionResult res;
+    res.distSq = upDistLimitSq;
+    if ( tree.empty() )
+        return res;
+
+    struct SubTask
+    {
+        int child = 0; ///< encoded as in WideAABBTreeNode::child, 0 means the root
+        float distSq = 0;
+    };
+
+    constexpr int MaxStackSize = 32 * ( WideAABBTree::Width - 1 ) + 1; // to avoid allocations
+    SubTask subtasks[MaxStackSize];
+    int stackSize = 0;
+    subtasks[stackSize++] = { 0, 0.0f };
+
+    while( stackSize > 0 )
+    {
+        const auto s = subtasks[--stackSize];
+        if ( s.distSq >= res.distSq )
+            continue;
+
+        if ( s.child < 0 )
+        {
+            const auto face = FaceId( ~s.child );
+            if ( face == skipFace )
+                continue;
+            if ( mp.region && !mp.region->test( face ) )
+                continue;
+            Vector3f a, b, c;
+            mp.mesh.getTriPoints( face, a, b, c );
+            if ( xf )
+            {
+                a = (*xf)( a );
+                b = (*xf)( b );
+                c = (*xf)( c );
+            }
+
+            // compute the closest point in double-precision, because float might be not enough
+            const auto [projD, baryD] = closestPointInTriangle( Vector3d( pt ), Vector3d( a ), Vector3d( b ), Vector3d( c ) );
+            const Vector3f proj( projD );
+            const TriPointf bary( baryD );
+
+            float distSq = ( proj - pt ).lengthSq();
+            if ( distSq < res.distSq )
+            {
+                res.distSq = distSq;
+                res.proj.point = proj;
+                res.proj.face = face;
+                res.mtp = MeshTriPoint{ mp.mesh.topology.edgeWithLeft( face ), bary };
+                if ( distSq <= loDistLimitSq )
+                    break;
+            }
+            continue;
+        }
+
+        const auto & node = tree[s.child];
+        float distSq[WideAABBTree::Width];
+        if ( xf )
+        {
+            for ( int i = 0; i < WideAABBTree::Width; ++i )
+                if ( node.hasChild( i ) )
+                    distSq[i] = ( transformed( node.childBox( i ), xf ).getBoxClosestPointTo( pt ) - pt ).lengthSq();
+        }
+        else
+            node.childDistSq( pt, distSq );
+
+        // push children in the order of decreasing distance to look at the closest child first
+        SubTask children[WideAABBTree::Width];
+        int numChildren = 0;
+        for ( int i = 0; i < WideAABBTree::Width; ++i )
+        {
+            if ( !node.hasChild( i ) || !( distSq[i] < res.distSq ) )
+                continue;
+            int j = numChildren++;
+            for ( ; j > 0 && children[j - 1].distSq < distSq[i]; --j )
+                children[j] = children[j - 1];
+            children[j] = { node.child[i], distSq[i] };
+        }
+        assert( stackSize + numChildren <= MaxStackSize );
+        for ( int i = 0; i < numChildren; ++i )
+            subtasks[stackSize++] = children[i];
+    }
+
+    return res;
+}
+
 MeshProjectionResult findProjection( const Vector3f & pt, const MeshPart & mp, float upDistLimitSq, const AffineXf3f * xf, float loDistLimitSq, FaceId skipFace )
 {
     return findProjectionSubtree( pt, mp, mp.mesh.getAABBTree(), upDistLimitSq, xf, loDistLimitSq, skipFace );
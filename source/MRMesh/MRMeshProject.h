@@ -50,6 +50,18 @@ struct MeshProjectionResult
     float loDistLimitSq = 0,
     FaceId skipFace = {} );
 
+/**
+ * \brief computes the closest point on mesh (or its region) to given point using compact wide BVH-tree
+ * \param tree 4-ary tree with quantized boxes built for whole mesh or part of mesh we are searching projection on,
+ * all other parameters have the same meaning as in \ref findProjectionSubtree with binary tree
+ */
+[[nodiscard]] MRMESH_API MeshProjectionResult findProjectionSubtree( const Vector3f & pt,
+    const MeshPart & mp, const WideAABBTree & tree,
+    float upDistLimitSq = FLT_MAX,
+    const AffineXf3f * xf = nullptr,
+    float loDistLimitSq = 0,
+    FaceId skipFace = {} );
+
 struct SignedDistanceToMeshResult
 {
     /// the closest point on mesh
@@ -1,5 +1,6 @@
 #include "MRMeshSave.h"
 #include "MRMesh.h"
+#include "MRMappedMrmesh.h"
 #include "MRTimer.h"
 #include "MRColor.h"
 #include "MRStringConvert.h"
@@ -59,6 +60,51 @@ VoidOrErrStr toMrmesh( const Mesh & mesh, std::ostream & out, const SaveSettings
     return {};
 }
 
+VoidOrErrStr toMrmeshAligned( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings )
+{
+    std::ofstream out( file, std::ofstream::binary );
+    if ( !out )
+        return unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
+
+    return toMrmeshAligned( mesh, out, settings );
+}
+
+VoidOrErrStr toMrmeshAligned( const Mesh & mesh, std::ostream & out, const SaveSettings & settings )
+{
+    MR_TIMER
+    const auto header = MrmeshAlignedHeader::forMesh( mesh );
+    out.write( (const char*)&header, sizeof( header ) );
+
+    std::uint64_t pos = sizeof( header );
+    const std::vector<char> zeros( MrmeshAlignedHeader::Alignment, 0 );
+    auto writeBlock = [&]( std::uint64_t offset, const char * data, size_t size, ProgressCallback cb )
+    {
+        assert( offset >= pos && offset - pos <= zeros.size() );
+        out.write( zeros.data(), offset - pos );
+        pos = offset + size;
+        return writeByBlocks( out, data, size, cb );
+    };
+
+    const auto edges = mesh.topology.edgesBytes();
+    if ( !writeBlock( header.edgesOffset, edges.data(), edges.size(), subprogress( settings.progress, 0.0f, 0.5f ) ) )
+        return unexpected( std::string( "Saving canceled" ) );
+    if ( !writeBlock( header.edgePerVertexOffset, (const char*)mesh.topology.edgePerVertex().data(), header.numVerts * sizeof( EdgeId ), {} ) )
+        return unexpected( std::string( "Saving canceled" ) );
+    if ( !writeBlock( header.edgePerFaceOffset, (const char*)mesh.topology.edgePerFace().data(), header.numFaces * sizeof( EdgeId ), {} ) )
+        return unexpected( std::string( "Saving canceled" ) );
+
+    VertCoords buf;
+    const auto & xfVerts = transformPoints( mesh.points, mesh.topology.getValidVerts(), settings.xf, buf );
+    if ( !writeBlock( header.pointsOffset, (const char*)xfVerts.data(), header.numPoints * sizeof( Vector3f ), subprogress( settings.progress, 0.5f, 1.0f ) ) )
+        return unexpected( std::string( "Saving canceled" ) );
+
+    if ( !out )
+        return unexpected( std::string( "Error saving in Mrmesh-format" ) );
+
+    reportProgress( settings.progress, 1.f );
+    return {};
+}
+
 VoidOrErrStr toOff( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings )
 {
     // although .off is a textual format, we open the file in binary mode to get exactly the same result on Windows and Linux
@@ -198,28 +244,11 @@ static FaceBitSet getNotDegenTris( const Mesh &mesh )
     return notDegenTris;
 }
 
-VoidOrErrStr toBinaryStl( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings )
+static Expected<std::uint32_t, std::string> appendBinaryStlTriangles_( const Mesh & mesh, const FaceBitSet & notDegenTris,
+    std::ostream & out, const SaveSettings & settings )
 {
-    std::ofstream out( file, std::ofstream::binary );
-    if ( !out )
-        return unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
-
-    return toBinaryStl( mesh, out, settings );
-}
-
-VoidOrErrStr toBinaryStl( const Mesh & mesh, std::ostream & out, const SaveSettings & settings )
-{
-    MR_TIMER
-
-    char header[80] = "MeshInspector.com";
-    out.write( header, 80 );
-
-    auto notDegenTris = getNotDegenTris( mesh );
-    auto numTris = (std::uint32_t)notDegenTris.count();
-    out.write( ( const char* )&numTris, 4 );
-
     const float trisNum = float( notDegenTris.count() );
-    int trisIndex = 0;
+    std::uint32_t trisIndex = 0;
     for ( auto f : notDegenTris )
     {
         VertId a, b, c;
@@ -250,9 +279,49 @@ VoidOrErrStr toBinaryStl( const Mesh & mesh, std::ostream & out, const SaveSetti
         return unexpected( std::string( "Error saving in binary STL-format" ) );
 
     reportProgress( settings.progress, 1.f );
+    return trisIndex;
+}
+
+VoidOrErrStr toBinaryStl( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings )
+{
+    std::ofstream out( file, std::ofstream::binary );
+    if ( !out )
+        return unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
+
+    return toBinaryStl( mesh, out, settings );
+}
+
+VoidOrErrStr toBinaryStl( const Mesh & mesh, std::ostream & out, const SaveSettings & settings )
+{
+    MR_TIMER
+
+    auto notDegenTris = getNotDegenTris( mesh );
+    auto res = writeBinaryStlHeader( out, (std::uint32_t)notDegenTris.count() );
+    if ( !res )
+        return res;
+
+    auto numTris = appendBinaryStlTriangles_( mesh, notDegenTris, out, settings );
+    if ( !numTris )
+        return unexpected( std::move( numTris.error() ) );
     return {};
 }
 
+VoidOrErrStr writeBinaryStlHeader( std::ostream & out, std::uint32_t numTris )
+{
+    char header[80] = "MeshInspector.com";
+    out.write( header, 80 );
+    out.write( ( const char* )&numTris, 4 );
+    if ( !out )
+        return unexpected( std::string( "Error saving in binary STL-format" ) );
+    return {};
+}
+
+Expected<std::uint32_t, std::string> appendBinaryStlTriangles( const Mesh & mesh, std::ostream & out, const SaveSettings & settings )
+{
+    MR_TIMER
+    return appendBinaryStlTriangles_( mesh, getNotDegenTris( mesh ), out, settings );
+}
+
 VoidOrErrStr toAsciiStl( const Mesh& mesh, const std::filesystem::path& file, const SaveSettings & settings )
 {
     std::ofstream out( file, std::ofstream::binary );
@@ -4,6 +4,7 @@
 #include "MRExpected.h"
 #include "MRIOFilters.h"
 #include "MRSaveSettings.h"
+#include <cstdint>
 #include <filesystem>
 #include <ostream>
 
@@ -26,6 +27,12 @@ MRMESH_API VoidOrErrStr toMrmesh( const Mesh & mesh, const std::filesystem::path
 MRMESH_API VoidOrErrStr toMrmesh( const Mesh & mesh, std::ostream & out,
                                                      const SaveSettings & settings = {} );
 
+/// saves in internal file format with aligned layout (see \ref MrmeshAlignedHeader),
+/// which can be opened by memory mapping without reading the whole file;
+/// SaveSettings::saveValidOnly = true is ignored
+MRMESH_API VoidOrErrStr toMrmeshAligned( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings = {} );
+MRMESH_API VoidOrErrStr toMrmeshAligned( const Mesh & mesh, std::ostream & out, const SaveSettings & settings = {} );
+
 /// saves in .off file
 MRMESH_API VoidOrErrStr toOff( const Mesh & mesh, const std::filesystem::path & file,
                                                   const SaveSettings & settings = {} );
@@ -44,6 +51,14 @@ MRMESH_API VoidOrErrStr toObj( const Mesh & mesh, std::ostream & out,
 MRMESH_API VoidOrErrStr toBinaryStl( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings = {} );
 MRMESH_API VoidOrErrStr toBinaryStl( const Mesh & mesh, std::ostream & out, const SaveSettings & settings = {} );
 
+/// writes the header of binary .stl file with given number of triangles;
+/// together with appendBinaryStlTriangles it allows one to write binary STL incrementally from several meshes,
+/// rewriting the header with actual number of triangles in the end
+MRMESH_API VoidOrErrStr writeBinaryStlHeader( std::ostream & out, std::uint32_t numTris );
+/// writes all valid not-degenerate triangles of the mesh in binary .stl format without the header;
+/// returns the number of written triangles
+MRMESH_API Expected<std::uint32_t, std::string> appendBinaryStlTriangles( const Mesh & mesh, std::ostream & out, const SaveSettings & settings = {} );
+
 /// saves in textual .stl file;
 /// SaveSettings::saveValidOnly = false is ignored
 MRMESH_API VoidOrErrStr toAsciiStl( const Mesh& mesh, const std::filesystem::path& file, const SaveSettings & settings = {} );
@@ -8,6 +8,12 @@
 #include "MRLine3.h"
 #include "MRMeshIntersect.h"
 #include "MRParallelFor.h"
+#include "MRAABBTree.h"
+#include "MRClosestPointInTriangle.h"
+#include "MRMeshProject.h"
+#include "MRTorus.h"
+#include "MRGTest.h"
+#include <algorithm>
 #include <tuple>
 
 namespace
@@ -42,6 +48,143 @@ float signedDistanceToMesh( const MeshPart& mesh, const Vector3f& p, SignDetecti
     return dist;
 }
 
+/// the size of voxel brick along each dimension, the bricks are processed by one tree descent
+constexpr int cBrickSize = 4;
+constexpr int cMaxBrickVoxels = cBrickSize * cBrickSize * cBrickSize;
+
+/// the points of one brick of voxels stored by coordinates for vectorization
+struct BrickPoints
+{
+    int size = 0;
+    float x[cMaxBrickVoxels];
+    float y[cMaxBrickVoxels];
+    float z[cMaxBrickVoxels];
+
+    Vector3f operator[]( int i ) const { return { x[i], y[i], z[i] }; }
+};
+
+inline float distSqBetweenBoxes( const Box3f& a, const Box3f& b )
+{
+    float res = 0;
+    for ( int i = 0; i < 3; ++i )
+        res += sqr( std::max( { a.min[i] - b.max[i], b.min[i] - a.max[i], 0.0f } ) );
+    return res;
+}
+
+/// finds the projections of all points of the brick on the mesh by one descent in the tree;
+/// the nodes are skipped only if they are farther from the box of all points than the current distances of all points,
+/// and each triangle is tested only for the points that can be closer to it than to previously found triangles,
+/// so the result is the same as given by findProjection for each point separately (up to the choice among equally close triangles)
+void findBrickProjections( const MeshPart& mp, const BrickPoints& pts, float upDistLimitSq, float loDistLimitSq, MeshProjectionResult* res )
+{
+    Box3f ptsBox;
+    for ( int i = 0; i < pts.size; ++i )
+    {
+        ptsBox.include( pts[i] );
+        res[i] = {};
+        res[i].distSq = upDistLimitSq;
+    }
+    // the points having a projection closer than loDistLimitSq are not considered further, as findProjection stops on them
+    bool finished[cMaxBrickVoxels] = {};
+    int numFinished = 0;
+    float maxDistSq = upDistLimitSq; // maximal distance among not finished points
+
+    const auto& tree = mp.mesh.getAABBTree();
+    if ( tree.nodes().empty() )
+        return;
+
+    struct SubTask
+    {
+        AABBTree::NodeId n;
+        float distSq = 0;
+    };
+    constexpr int MaxStackSize = 32; // to avoid allocations
+    SubTask subtasks[MaxStackSize];
+    int stackSize = 0;
+    auto addSubTask = [&]( AABBTree::NodeId n )
+    {
+        const float distSq = distSqBetweenBoxes( tree[n].box, ptsBox );
+        if ( distSq < maxDistSq )
+        {
+            assert( stackSize < MaxStackSize );
+            subtasks[stackSize++] = { n, distSq };
+        }
+    };
+    addSubTask( tree.rootNodeId() );
+
+    float lowerDistSq[cMaxBrickVoxels];
+    while ( stackSize > 0 && numFinished < pts.size )
+    {
+        const auto s = subtasks[--stackSize];
+        if ( s.distSq >= maxDistSq )
+            continue;
+        const auto& node = tree[s.n];
+        if ( !node.leaf() )
+        {
+            const bool leftFirst = distSqBetweenBoxes( tree[node.l].box, ptsBox ) <= distSqBetweenBoxes( tree[node.r].box, ptsBox );
+            addSubTask( leftFirst ? node.r : node.l ); // larger distance to look later
+            addSubTask( leftFirst ? node.l : node.r ); // smaller distance to look first
+            continue;
+        }
+
+        const auto face = node.leafId();
+        if ( mp.region && !mp.region->test( face ) )
+            continue;
+        // the lower bounds of the distances from all points to the triangle by its box, in a loop without branches for vectorization
+        const auto& box = node.box;
+        for ( int i = 0; i < pts.size; ++i )
+        {
+            const float dx = std::max( std::max( box.min.x - pts.x[i], pts.x[i] - box.max.x ), 0.0f );
+            const float dy = std::max( std::max( box.min.y - pts.y[i], pts.y[i] - box.max.y ), 0.0f );
+            const float dz = std::max( std::max( box.min.z - pts.z[i], pts.z[i] - box.max.z ), 0.0f );
+            lowerDistSq[i] = dx * dx + dy * dy + dz * dz;
+        }
+
+        Vector3d a, b, c;
+        bool triLoaded = false;
+        bool updated = false;
+        for ( int i = 0; i < pts.size; ++i )
+        {
+            if ( finished[i] || lowerDistSq[i] >= res[i].distSq )
+                continue;
+            if ( !triLoaded )
+            {
+                Vector3f af, bf, cf;
+                mp.mesh.getTriPoints( face, af, bf, cf );
+                a = Vector3d( af );
+                b = Vector3d( bf );
+                c = Vector3d( cf );
+                triLoaded = true;
+            }
+            const auto pt = pts[i];
+            // compute the closest point in double-precision as findProjection does
+            const auto [projD, baryD] = closestPointInTriangle( Vector3d( pt ), a, b, c );
+            const Vector3f proj( projD );
+            const float distSq = ( proj - pt ).lengthSq();
+            if ( distSq < res[i].distSq )
+            {
+                res[i].distSq = distSq;
+                res[i].proj.point = proj;
+                res[i].proj.face = face;
+                res[i].mtp = MeshTriPoint{ mp.mesh.topology.edgeWithLeft( face ), TriPointf( baryD ) };
+                if ( distSq <= loDistLimitSq )
+                {
+                    finished[i] = true;
+                    ++numFinished;
+                }
+                updated = true;
+            }
+        }
+        if ( updated )
+        {
+            maxDistSq = 0;
+            for ( int i = 0; i < pts.size; ++i )
+                if ( !finished[i] )
+                    maxDistSq = std::max( maxDistSq, res[i].distSq );
+        }
+    }
+}
+
 template <typename T>
 struct MinMax
 {
@@ -85,7 +228,7 @@ Expected<SimpleVolume, std::string> meshToDistanceVolume( const MeshPart& mp, co
         assert( !mp.region ); // only whole mesh is supported for now
         auto fwn = params.fwn;
         if ( !fwn )
-            fwn = std::make_shared<FastWindingNumber>( mp.mesh );
+            fwn = std::make_shared<PacketFastWindingNumber>( mp.mesh );
 
         auto basis = AffineXf3f::linear( Matrix3f::scale( params.voxelSize ) );
         basis.b = params.origin;
@@ -98,23 +241,46 @@ Expected<SimpleVolume, std::string> meshToDistanceVolume( const MeshPart& mp, co
     }
     else
     {
-        if ( !ParallelFor( size_t( 0 ), indexer.size(), [&]( size_t i )
+        // the voxels are processed by bricks, and the tree is descended once for all voxels of a brick
+        const Vector3i brickDims = ( res.dims + Vector3i::diagonal( cBrickSize - 1 ) ) / cBrickSize;
+        const VolumeIndexer brickIndexer( brickDims );
+        if ( !ParallelFor( size_t( 0 ), brickIndexer.size(), [&]( size_t brick )
         {
-            auto coord = Vector3f( indexer.toPos( VoxelId( i ) ) ) + Vector3f::diagonal( 0.5f );
-            auto voxelCenter = params.origin + mult( params.voxelSize, coord );
-            float dist{ 0.0f };
-            if ( params.signMode != SignDetectionMode::ProjectionNormal )
-                dist = std::sqrt( findProjection( voxelCenter, mp, params.maxDistSq, nullptr, params.minDistSq ).distSq );
-            else
-            {
-                auto s = findSignedDistance( voxelCenter, mp, params.maxDistSq, params.minDistSq );
-                dist = s ? s->dist : cQuietNan;
-            }
+            const auto brickPos = brickIndexer.toPos( VoxelId( brick ) );
+            const auto first = brickPos * cBrickSize;
+            const auto last = Vector3i( std::min( first.x + cBrickSize, res.dims.x ), std::min( first.y + cBrickSize, res.dims.y ), std::min( first.z + cBrickSize, res.dims.z ) );
+            BrickPoints pts;
+            VoxelId voxels[cMaxBrickVoxels];
+            Vector3i pos;
+            for ( pos.z = first.z; pos.z < last.z; ++pos.z )
+                for ( pos.y = first.y; pos.y < last.y; ++pos.y )
+                    for ( pos.x = first.x; pos.x < last.x; ++pos.x )
+                    {
+                        const auto coord = Vector3f( pos ) + Vector3f::diagonal( 0.5f );
+                        const auto voxelCenter = params.origin + mult( params.voxelSize, coord );
+                        voxels[pts.size] = indexer.toVoxelId( pos );
+                        pts.x[pts.size] = voxelCenter.x;
+                        pts.y[pts.size] = voxelCenter.y;
+                        pts.z[pts.size] = voxelCenter.z;
+                        ++pts.size;
+                    }
+
+            MeshProjectionResult projs[cMaxBrickVoxels];
+            findBrickProjections( mp, pts, params.maxDistSq, params.minDistSq, projs );
 
-            if ( !isNanFast( dist ) )
+            for ( int i = 0; i < pts.size; ++i )
             {
-                bool changeSign = false;
-                if ( params.signMode == SignDetectionMode::WindingRule )
+                const auto voxelCenter = pts[i];
+                const auto& proj = projs[i];
+                float dist{ 0.0f };
+                if ( params.signMode != SignDetectionMode::ProjectionNormal )
+                    dist = std::sqrt( proj.distSq );
+                else if ( !( proj.distSq < params.maxDistSq ) || proj.distSq < params.minDistSq )
+                    dist = cQuietNan; // as in findSignedDistance
+                else
+                    dist = mp.mesh.signedDistance( voxelCenter, proj.mtp, mp.region );
+
+                if ( !isNanFast( dist ) && params.signMode == SignDetectionMode::WindingRule )
                 {
                     int numInters = 0;
                     rayMeshIntersectAll( mp, Line3d( Vector3d( voxelCenter ), Vector3d::plusX() ),
@@ -123,12 +289,11 @@ Expected<SimpleVolume, std::string> meshToDistanceVolume( const MeshPart& mp, co
                         ++numInters;
                         return true;
                     } );
-                    changeSign = numInters % 2 == 1; // inside
+                    if ( numInters % 2 == 1 ) // inside
+                        dist = -dist;
                 }
-                if ( changeSign )
-                    dist = -dist;
+                res.data[voxels[i]] = dist;
             }
-            res.data[i] = dist;
         }, params.cb ) )
             return unexpectedOperationCanceled();
     }
@@ -254,4 +419,43 @@ Expected<SimpleVolume, std::string> meshRegionToIndicatorVolume( const Mesh& mes
     return res;
 }
 
+TEST( MRMesh, MeshToDistanceVolumeBricks )
+{
+    const Mesh torus = makeTorus( 2, 1, 32, 32 );
+    MeshToDistanceVolumeParams params;
+    params.origin = Vector3f( -3.6f, -3.5f, -1.7f );
+    params.voxelSize = Vector3f( 0.2f, 0.25f, 0.3f );
+    params.dimensions = Vector3i( 37, 29, 11 ); // not divisible by brick size
+    params.maxDistSq = sqr( 0.9f );
+    params.minDistSq = sqr( 0.1f );
+
+    for ( auto signMode : { SignDetectionMode::ProjectionNormal, SignDetectionMode::Unsigned, SignDetectionMode::WindingRule } )
+    {
+        params.signMode = signMode;
+        auto volume = meshToDistanceVolume( torus, params );
+        ASSERT_TRUE( volume.has_value() );
+        const VolumeIndexer indexer( volume->dims );
+        int numValid = 0;
+        for ( size_t i = 0; i < indexer.size(); ++i )
+        {
+            const auto coord = Vector3f( indexer.toPos( VoxelId( i ) ) ) + Vector3f::diagonal( 0.5f );
+            const auto voxelCenter = params.origin + mult( params.voxelSize, coord );
+            // the distance computed for each voxel separately
+            const auto ref = signedDistanceToMesh( torus, voxelCenter, signMode, params.maxDistSq, params.minDistSq );
+            const auto dist = volume->data[i];
+            EXPECT_EQ( isNanFast( ref ), isNanFast( dist ) );
+            if ( isNanFast( ref ) || isNanFast( dist ) )
+                continue;
+            ++numValid;
+            // the values below minimal distance can be found by other triangles,
+            // and the triangles with common closest point can be found in another order
+            if ( std::abs( ref ) > 0.1f )
+            {
+                EXPECT_NEAR( ref, dist, 1e-6f );
+            }
+        }
+        EXPECT_GT( numValid, 0 );
+    }
+}
+
 } //namespace MR
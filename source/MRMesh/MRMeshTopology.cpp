@@ -2159,6 +2159,32 @@ VoidOrErrStr MeshTopology::read( std::istream & s, ProgressCallback callback )
 }
 
 
+VoidOrErrStr MeshTopology::read( std::span<const char> edges, std::span<const char> edgePerVertex, std::span<const char> edgePerFace,
+    ProgressCallback callback )
+{
+    MR_TIMER
+    if ( edges.size() % sizeof( HalfEdgeRecord ) != 0 || edgePerVertex.size() % sizeof( EdgeId ) != 0 || edgePerFace.size() % sizeof( EdgeId ) != 0 )
+        return unexpected( std::string( "Wrong sizes of topology blocks" ) );
+    updateValids_ = false;
+
+    edges_.resizeNoInit( edges.size() / sizeof( HalfEdgeRecord ) );
+    if ( !copyByBlocks( ( char* )edges_.data(), edges.data(), edges.size(), subprogress( callback, 0.0f, 0.6f ) ) )
+        return unexpected( std::string( "Loading canceled" ) );
+
+    edgePerVertex_.resizeNoInit( edgePerVertex.size() / sizeof( EdgeId ) );
+    if ( !copyByBlocks( ( char* )edgePerVertex_.data(), edgePerVertex.data(), edgePerVertex.size(), subprogress( callback, 0.6f, 0.7f ) ) )
+        return unexpected( std::string( "Loading canceled" ) );
+
+    edgePerFace_.resizeNoInit( edgePerFace.size() / sizeof( EdgeId ) );
+    if ( !copyByBlocks( ( char* )edgePerFace_.data(), edgePerFace.data(), edgePerFace.size(), subprogress( callback, 0.7f, 0.8f ) ) )
+        return unexpected( std::string( "Loading canceled" ) );
+
+    computeValidsFromEdges();
+    if ( !checkValidity( subprogress( callback, 0.8f, 1.0f ) ) )
+        return unexpected( std::string( "Data is invalid" ) );
+    return {};
+}
+
 bool MeshTopology::checkValidity( ProgressCallback cb ) const
 {
     MR_TIMER
@@ -8,6 +8,7 @@
 #include "MRProgressCallback.h"
 #include "MRExpected.h"
 #include <fstream>
+#include <span>
 
 namespace MR
 {
@@ -468,6 +469,15 @@ public:
     /// \return text of error if any
     MRMESH_API VoidOrErrStr read( std::istream& s, ProgressCallback callback = {} );
 
+    /// gives direct access to the bytes of all half-edge records in the same format as they are saved by \ref write
+    [[nodiscard]] std::span<const char> edgesBytes() const { return { (const char*)edges_.data(), edges_.size() * sizeof( HalfEdgeRecord ) }; }
+
+    /// loads from memory blocks with the same content as the arrays saved by \ref write (e.g. from memory-mapped file),
+    /// the blocks are copied in parallel threads
+    /// \return text of error if any
+    MRMESH_API VoidOrErrStr read( std::span<const char> edges, std::span<const char> edgePerVertex, std::span<const char> edgePerFace,
+        ProgressCallback callback = {} );
+
     /// compare that two topologies are exactly the same
     [[nodiscard]] MRMESH_API bool operator ==( const MeshTopology & b ) const;
 
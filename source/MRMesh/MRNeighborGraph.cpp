@@ -0,0 +1,241 @@
+#include "MRNeighborGraph.h"
+#include "MRPointCloud.h"
+#include "MRPointsInBall.h"
+#include "MRPointsProject.h"
+#include "MRFewSmallest.h"
+#include "MRPointCloudMakeNormals.h"
+#include "MRPointCloudRelax.h"
+#include "MRUniformSampling.h"
+#include "MRMakeSphereMesh.h"
+#include "MRMesh.h"
+#include "MRParallelFor.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include <algorithm>
+#include <cstring>
+
+namespace MR
+{
+
+NeighborGraph::NeighborGraph( const NeighborGraph & b )
+{
+    *this = b;
+}
+
+NeighborGraph & NeighborGraph::operator =( const NeighborGraph & b )
+{
+    if ( this == &b )
+        return *this;
+    settings = b.settings;
+    offsets.resize( b.offsets.size() );
+    if ( !b.offsets.empty() )
+        std::memcpy( offsets.data(), b.offsets.data(), b.offsets.size() * sizeof( size_t ) );
+    neighbors.resize( b.neighbors.size() );
+    if ( !b.neighbors.empty() )
+        std::memcpy( neighbors.data(), b.neighbors.data(), b.neighbors.size() * sizeof( VertId ) );
+    return *this;
+}
+
+std::optional<NeighborGraph> buildNeighborGraph( const PointCloud & cloud, const NeighborGraphSettings & settings, const ProgressCallback & progress )
+{
+    MR_TIMER
+    assert( settings.radius > 0 || settings.maxNeighbors > 0 );
+
+    NeighborGraph res;
+    res.settings = settings;
+    const auto numPoints = cloud.points.size();
+    res.offsets.resize( numPoints + 1 );
+    res.offsets[0_v] = 0;
+
+    cloud.getAABBTree(); // to avoid tree construction from parallel region
+
+    // the neighbors of each block of points are found in parallel and stored temporary,
+    // then the blocks are copied in the final place
+    constexpr size_t cBlockSize = 4096;
+    const size_t numBlocks = ( numPoints + cBlockSize - 1 ) / cBlockSize;
+    std::vector<std::vector<VertId>> blockNeighbors( numBlocks );
+    const auto upDistLimitSq = settings.radius > 0 ? sqr( settings.radius ) : FLT_MAX;
+    if ( !ParallelFor( size_t( 0 ), numBlocks, [&]( size_t b )
+    {
+        auto & neis = blockNeighbors[b];
+        FewSmallest<PointsProjectionResult> closest;
+        if ( settings.maxNeighbors > 0 )
+            closest.reset( settings.maxNeighbors + 1 ); // the point itself is found as well
+        const VertId vEnd( std::min( ( b + 1 ) * cBlockSize, numPoints ) );
+        for ( VertId v( b * cBlockSize ); v < vEnd; ++v )
+        {
+            const auto before = neis.size();
+            if ( cloud.validPoints.test( v ) )
+            {
+                if ( settings.maxNeighbors > 0 )
+                {
+                    closest.clear();
+                    findFewClosestPoints( cloud.points[v], cloud, closest, upDistLimitSq );
+                    auto found = closest.get();
+                    std::sort( found.begin(), found.end() );
+                    for ( const auto & n : found )
+                        if ( n.vId != v && neis.size() - before < settings.maxNeighbors )
+                            neis.push_back( n.vId );
+                }
+                else
+                {
+                    findPointsInBall( cloud, cloud.points[v], settings.radius, [&]( VertId u, const Vector3f & )
+                    {
+                        if ( u != v )
+                            neis.push_back( u );
+                    } );
+                }
+            }
+            res.offsets[v + 1] = neis.size() - before;
+        }
+    }, subprogress( progress, 0.0f, 0.9f ) ) )
+        return {};
+
+    for ( VertId v( 0 ); v < numPoints; ++v )
+        res.offsets[v + 1] += res.offsets[v];
+    res.neighbors.resize( res.offsets[VertId( numPoints )] );
+
+    if ( !ParallelFor( size_t( 0 ), numBlocks, [&]( size_t b )
+    {
+        auto & neis = blockNeighbors[b];
+        std::copy( neis.begin(), neis.end(), res.neighbors.data() + res.offsets[VertId( b * cBlockSize )] );
+        neis = {};
+    }, subprogress( progress, 0.9f, 1.0f ) ) )
+        return {};
+
+    return res;
+}
+
+const NeighborGraph * findCachedNeighborGraph( const PointCloud & cloud, float radius )
+{
+    auto graph = cloud.getNeighborGraphNotCreate();
+    if ( graph && graph->settings == NeighborGraphSettings{ .radius = radius } )
+        return graph;
+    return nullptr;
+}
+
+TEST( MRMesh, NeighborGraph )
+{
+    PointCloud cloud;
+    for ( int x = 0; x < 20; ++x )
+        for ( int y = 0; y < 30; ++y )
+            for ( int z = 0; z < 10; ++z )
+                cloud.addPoint( Vector3f( float( x ), float( y ), 0.9f * z ) );
+    cloud.validPoints.reset( 5_v );
+
+    const auto & graph = cloud.getNeighborGraph( { .radius = 1.5f } );
+    EXPECT_EQ( findCachedNeighborGraph( cloud, 1.5f ), &graph );
+    EXPECT_EQ( findCachedNeighborGraph( cloud, 1.0f ), nullptr );
+    ASSERT_EQ( graph.offsets.size(), cloud.points.size() + 1 );
+    EXPECT_TRUE( graph.get( 5_v ).empty() );
+    for ( auto v : cloud.validPoints )
+    {
+        std::vector<VertId> ref;
+        findPointsInBall( cloud, cloud.points[v], 1.5f, [&]( VertId u, const Vector3f & )
+        {
+            if ( u != v )
+                ref.push_back( u );
+        } );
+        const auto neis = graph.get( v );
+        EXPECT_TRUE( std::equal( neis.begin(), neis.end(), ref.begin(), ref.end() ) );
+    }
+
+    const auto knn = buildNeighborGraph( cloud, { .maxNeighbors = 6 } );
+    ASSERT_TRUE( knn.has_value() );
+    for ( auto v : cloud.validPoints )
+    {
+        const auto neis = knn->get( v );
+        ASSERT_EQ( neis.size(), 6 );
+        for ( size_t i = 0; i < neis.size(); ++i )
+        {
+            EXPECT_NE( neis[i], v );
+            EXPECT_NE( neis[i], 5_v );
+            if ( i > 0 )
+            {
+                EXPECT_LE( ( cloud.points[neis[i - 1]] - cloud.points[v] ).lengthSq(), ( cloud.points[neis[i]] - cloud.points[v] ).lengthSq() );
+            }
+        }
+        // the closest points are at the distance 0.9 along Z
+        EXPECT_NEAR( ( cloud.points[neis[0]] - cloud.points[v] ).length(), 0.9f, 1e-6f );
+    }
+
+    auto copy = cloud;
+    ASSERT_TRUE( copy.getNeighborGraphNotCreate() );
+    EXPECT_EQ( copy.getNeighborGraphNotCreate()->neighbors.size(), graph.neighbors.size() );
+    copy.invalidateCaches();
+    EXPECT_FALSE( copy.getNeighborGraphNotCreate() );
+}
+
+TEST( MRMesh, NeighborGraphConsumers )
+{
+    PointCloud cloud;
+    cloud.points = makeSphere( { .numMeshVertices = 3000 } ).points;
+    cloud.validPoints.resize( cloud.points.size(), true );
+    const float radius = 0.15f;
+    const auto graph = buildNeighborGraph( cloud, { .radius = radius } );
+    ASSERT_TRUE( graph.has_value() );
+
+    // normals by graph and by radius
+    auto normals = makeUnorientedNormals( cloud, radius );
+    auto graphNormals = makeUnorientedNormals( cloud, *graph );
+    ASSERT_TRUE( normals.has_value() && graphNormals.has_value() );
+    for ( auto v : cloud.validPoints )
+        EXPECT_GT( std::abs( dot( (*normals)[v], (*graphNormals)[v] ) ), 0.9999f );
+
+    EXPECT_TRUE( orientNormals( cloud, *normals, radius ) );
+    EXPECT_TRUE( orientNormals( cloud, *graphNormals, *graph ) );
+    // both orientations are consistent, but can differ globally
+    const float sign = dot( (*normals)[0_v], (*graphNormals)[0_v] ) > 0 ? 1.0f : -1.0f;
+    for ( auto v : cloud.validPoints )
+        EXPECT_GT( sign * dot( (*normals)[v], (*graphNormals)[v] ), 0.9999f );
+
+    // sampling by graph and by radius
+    const auto samples = pointUniformSampling( cloud, { .distance = radius, .lexicographicalOrder = false } );
+    const auto graphSamples = pointUniformSampling( cloud, { .distance = radius, .lexicographicalOrder = false, .neighbors = &*graph } );
+    ASSERT_TRUE( samples.has_value() && graphSamples.has_value() );
+    EXPECT_EQ( *samples, *graphSamples );
+
+    // single relaxation iteration by graph and by radius
+    {
+        auto relaxed = cloud;
+        auto graphRelaxed = cloud;
+        EXPECT_TRUE( relax( relaxed, { { .iterations = 1 }, radius } ) );
+        EXPECT_TRUE( relax( graphRelaxed, { { .iterations = 1 }, radius, &*graph } ) );
+        for ( auto v : cloud.validPoints )
+            EXPECT_NEAR( ( relaxed.points[v] - graphRelaxed.points[v] ).length(), 0, 1e-6f );
+    }
+
+    // several iterations with the graph cached in the relaxed cloud itself give the same result as with independent graph
+    {
+        auto relaxed = cloud;
+        auto ownRelaxed = cloud;
+        ownRelaxed.invalidateCaches();
+        const auto & ownGraph = ownRelaxed.getNeighborGraph( { .radius = radius } );
+        EXPECT_TRUE( relax( relaxed, { { .iterations = 3 }, radius, &*graph } ) );
+        EXPECT_TRUE( relax( ownRelaxed, { { .iterations = 3 }, radius, &ownGraph } ) );
+        EXPECT_EQ( relaxed.points, ownRelaxed.points );
+
+        ownRelaxed = cloud;
+        ownRelaxed.invalidateCaches();
+        const auto & ownGraph2 = ownRelaxed.getNeighborGraph( { .radius = radius } );
+        relaxed = cloud;
+        EXPECT_TRUE( relaxKeepVolume( relaxed, { { .iterations = 3 }, radius, &*graph } ) );
+        EXPECT_TRUE( relaxKeepVolume( ownRelaxed, { { .iterations = 3 }, radius, &ownGraph2 } ) );
+        EXPECT_EQ( relaxed.points, ownRelaxed.points );
+
+        ownRelaxed = cloud;
+        ownRelaxed.invalidateCaches();
+        const auto & ownGraph3 = ownRelaxed.getNeighborGraph( { .radius = radius } );
+        relaxed = cloud;
+        PointCloudApproxRelaxParams approxParams;
+        approxParams.iterations = 3;
+        approxParams.neighborhoodRadius = radius;
+        approxParams.neighbors = &*graph;
+        EXPECT_TRUE( relaxApprox( relaxed, approxParams ) );
+        approxParams.neighbors = &ownGraph3;
+        EXPECT_TRUE( relaxApprox( ownRelaxed, approxParams ) );
+        EXPECT_EQ( relaxed.points, ownRelaxed.points );
+    }
+}
+
+} //namespace MR
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "MRBuffer.h"
+#include "MRProgressCallback.h"
+#include <optional>
+#include <span>
+
+namespace MR
+{
+
+/// \addtogroup PointCloudGroup
+/// \{
+
+/// defines which points of a cloud are considered as neighbors of a point
+struct NeighborGraphSettings
+{
+    /// if positive then only the points within this distance are neighbors
+    float radius = 0;
+    /// if positive then only this number of the closest points are neighbors
+    int maxNeighbors = 0;
+
+    bool operator ==( const NeighborGraphSettings & ) const = default;
+};
+
+/// neighbors of all valid points of a cloud in compressed sparse row format:
+/// the neighbors of point v are stored in neighbors[offsets[v]] ... neighbors[offsets[v+1]-1], not including v itself;
+/// it allows one to find the neighbors once and reuse them in several algorithms
+struct NeighborGraph
+{
+    /// the settings the graph was built with
+    NeighborGraphSettings settings;
+    /// the index of the first neighbor of each point, the size is the number of points plus one
+    Buffer<size_t, VertId> offsets;
+    /// the neighbors of all points one after another;
+    /// if settings.maxNeighbors is positive then the neighbors of each point are sorted by increasing distance,
+    /// otherwise they are in the order of findPointsInBall
+    Buffer<VertId> neighbors;
+
+    NeighborGraph() = default;
+    NeighborGraph( NeighborGraph && ) noexcept = default;
+    NeighborGraph & operator =( NeighborGraph && ) noexcept = default;
+    MRMESH_API NeighborGraph( const NeighborGraph & b );
+    MRMESH_API NeighborGraph & operator =( const NeighborGraph & b );
+
+    /// returns all neighbors of given point
+    [[nodiscard]] std::span<const VertId> get( VertId v ) const
+        { return { (const VertId*)neighbors.data() + offsets[v], size_t( offsets[v + 1] - offsets[v] ) }; }
+
+    /// returns the amount of memory this object occupies on heap
+    [[nodiscard]] size_t heapBytes() const { return offsets.heapBytes() + neighbors.heapBytes(); }
+};
+
+/// finds the neighbors of all valid points of the cloud in parallel threads;
+/// \return nullopt if the operation was canceled
+[[nodiscard]] MRMESH_API std::optional<NeighborGraph> buildNeighborGraph( const PointCloud & cloud,
+    const NeighborGraphSettings & settings, const ProgressCallback & progress = {} );
+
+/// returns the neighbor graph cached in the cloud if it was built for exactly given radius (and without limit on the number of neighbors),
+/// so the functions searching the points in a ball of given radius can reuse it; otherwise returns nullptr
+[[nodiscard]] MRMESH_API const NeighborGraph * findCachedNeighborGraph( const PointCloud & cloud, float radius );
+
+/// \}
+
+} //namespace MR
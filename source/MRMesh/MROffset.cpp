@@ -15,6 +15,17 @@
 #include "MRMeshFixer.h"
 #include "MRBitSetParallelFor.h"
 #include "MRRingIterator.h"
+#include "MRMeshProject.h"
+#include "MRIsNaN.h"
+#include "MRMeshSubdivide.h"
+#include "MRMeshBuilder.h"
+#include "MRMeshToDistanceVolume.h"
+#include "MRMarchingCubes.h"
+#include "MRParallelFor.h"
+#include "MRTorus.h"
+#include "MRCube.h"
+#include "MRMeshComponents.h"
+#include "MRGTest.h"
 #include "MRPch/MRSpdlog.h"
 
 namespace MR
@@ -128,6 +139,7 @@ Expected<Mesh> mcOffsetMesh( const MeshPart& mp, float offset,
         vmParams.lessInside = true;
         vmParams.cb = subprogress( params.callBack, 0.4f, 1.0f );
         vmParams.outVoxelPerFaceMap = outMap;
+        vmParams.skipEmptyBlocks = true;
         return marchingCubes( volume, vmParams );
 #else
         assert( false );
@@ -156,6 +168,7 @@ Expected<Mesh> mcOffsetMesh( const MeshPart& mp, float offset,
         vmParams.cb = subprogress( params.callBack, 0.4f, 1.0f );
         vmParams.lessInside = true;
         vmParams.outVoxelPerFaceMap = outMap;
+        vmParams.skipEmptyBlocks = true; // only the voxels near offset surface have meaningful values
 
         if ( params.memoryEfficient )
         {
@@ -224,6 +237,385 @@ Expected<Mesh> sharpOffsetMesh( const MeshPart& mp, float offset, const SharpOff
     return res;
 }
 
+namespace
+{
+
+/// the range of coarse voxel cells, where the offset surface is recomputed on finer grid
+struct RefinedCells
+{
+    Box3i cells; ///< inclusive range of the cells
+    Mesh mesh;   ///< Marching Cubes mesh of finer grid covering exactly the cells
+};
+
+/// samples exact offset surface near the points of input mesh with step about voxelSize,
+/// and returns the samples located further than voxelSize from given coarse offset mesh,
+/// e.g. on thin walls or small components lost by coarse grid
+std::vector<Vector3f> findLostOffsetPoints( const MeshPart& mp, float offset, bool bothSides, const Mesh& coarse, float voxelSize )
+{
+    MR_TIMER
+    const float absOffset = std::abs( offset );
+    std::vector<Vector3f> samples;
+    for ( auto f : mp.mesh.topology.getFaceIds( mp.region ) )
+    {
+        Vector3f a, b, c;
+        mp.mesh.getTriPoints( f, a, b, c );
+        const auto n = mp.mesh.normal( f );
+        const int steps = std::max( 1, (int)std::ceil( std::sqrt( std::max( { ( b - a ).lengthSq(), ( c - b ).lengthSq(), ( a - c ).lengthSq() } ) ) / voxelSize ) );
+        for ( int i = 0; i <= steps; ++i )
+            for ( int j = 0; i + j <= steps; ++j )
+            {
+                const auto p = a + ( b - a ) * ( float( i ) / steps ) + ( c - a ) * ( float( j ) / steps );
+                samples.push_back( p + offset * n );
+                if ( bothSides )
+                    samples.push_back( p - offset * n );
+            }
+    }
+
+    BitSet lost( samples.size() );
+    BitSetParallelForAll( lost, [&]( size_t i )
+    {
+        // the sample is on exact offset surface only if no other part of input mesh is closer than its source point
+        const auto tol = 0.01f * voxelSize;
+        const float loDistSq = absOffset > tol ? sqr( absOffset - tol ) : 0.0f;
+        if ( findProjection( samples[i], mp, FLT_MAX, nullptr, loDistSq ).distSq < loDistSq )
+            return;
+        if ( findProjection( samples[i], coarse, sqr( voxelSize ) ).distSq >= sqr( voxelSize ) )
+            lost.set( i );
+    } );
+
+    std::vector<Vector3f> res;
+    for ( auto i : lost )
+        res.push_back( samples[i] );
+    return res;
+}
+
+/// groups the cells with lost points of offset surface in not-touching boxes of cells, each with the margin of two cells
+std::vector<RefinedCells> groupLostCells( const std::vector<Vector3i>& lostCells, const Vector3i& numCells )
+{
+    constexpr int cMargin = 2;
+    constexpr int cBrick = 8;
+    const Vector3i brickDims = ( numCells + Vector3i::diagonal( cBrick - 1 ) ) / cBrick;
+    const VolumeIndexer brickIndexer( brickDims );
+    BitSet marked( brickIndexer.size() );
+    std::vector<Box3i> brickCells( brickIndexer.size() );
+    for ( const auto & c : lostCells )
+    {
+        const auto id = brickIndexer.toVoxelId( c / cBrick );
+        marked.set( id );
+        brickCells[id].include( c );
+    }
+
+    // the lost cells in neighbor bricks are united in one box
+    std::vector<RefinedCells> res;
+    std::vector<Vector3i> stack;
+    for ( auto first : marked )
+    {
+        marked.reset( first );
+        Box3i cells;
+        stack.push_back( brickIndexer.toPos( VoxelId( first ) ) );
+        while ( !stack.empty() )
+        {
+            const auto b = stack.back();
+            stack.pop_back();
+            cells.include( brickCells[brickIndexer.toVoxelId( b )] );
+            Vector3i n;
+            for ( n.z = std::max( 0, b.z - 1 ); n.z <= std::min( brickDims.z - 1, b.z + 1 ); ++n.z )
+                for ( n.y = std::max( 0, b.y - 1 ); n.y <= std::min( brickDims.y - 1, b.y + 1 ); ++n.y )
+                    for ( n.x = std::max( 0, b.x - 1 ); n.x <= std::min( brickDims.x - 1, b.x + 1 ); ++n.x )
+                        if ( auto id = brickIndexer.toVoxelId( n ); marked.test( id ) )
+                        {
+                            marked.reset( id );
+                            stack.push_back( n );
+                        }
+        }
+        for ( int i = 0; i < 3; ++i )
+        {
+            cells.min[i] = std::max( 0, cells.min[i] - cMargin );
+            cells.max[i] = std::min( numCells[i] - 1, cells.max[i] + cMargin );
+        }
+        res.push_back( { cells, {} } );
+    }
+
+    // unite the boxes of cells that overlap or touch each other
+    for ( bool united = true; united; )
+    {
+        united = false;
+        for ( size_t i = 0; i < res.size() && !united; ++i )
+            for ( size_t j = i + 1; j < res.size() && !united; ++j )
+            {
+                auto expanded = res[i].cells;
+                expanded.min -= Vector3i::diagonal( 1 );
+                expanded.max += Vector3i::diagonal( 1 );
+                if ( !expanded.intersects( res[j].cells ) )
+                    continue;
+                res[i].cells.include( res[j].cells );
+                res.erase( res.begin() + j );
+                united = true;
+            }
+    }
+    return res;
+}
+
+} // anonymous namespace
+
+Expected<Mesh> adaptiveOffsetMesh( const MeshPart& mp, float offset, const AdaptiveOffsetParameters& params )
+{
+    MR_TIMER
+    if ( params.voxelSize <= 0 )
+    {
+        assert( false );
+        return unexpected( "wrong voxelSize" );
+    }
+    const float voxelSize = params.voxelSize;
+    const float absOffset = std::abs( offset );
+    // the distances are computed here without OpenVDB, and its sign detection is replaced with pseudonormals
+    const auto signMode = params.signDetectionMode == SignDetectionMode::OpenVDB ? SignDetectionMode::ProjectionNormal : params.signDetectionMode;
+
+    // the parameters of coarse and fine grids differ only in the origin, voxel size and dimensions,
+    // and all nodes of coarse grid are the nodes of fine grids as well
+    MeshToDistanceVolumeParams msParams;
+    const auto box = mp.mesh.computeBoundingBox( mp.region );
+    const auto expansion = Vector3f::diagonal( 2 * voxelSize + absOffset );
+    const auto coarseOrigin = box.min - expansion;
+    msParams.origin = coarseOrigin;
+    msParams.voxelSize = Vector3f::diagonal( voxelSize );
+    msParams.dimensions = Vector3i( ( box.max + expansion - coarseOrigin ) / voxelSize ) + Vector3i::diagonal( 1 );
+    msParams.signMode = signMode;
+    msParams.maxDistSq = sqr( absOffset + voxelSize );
+    msParams.minDistSq = sqr( std::max( absOffset - voxelSize, 0.0f ) );
+    msParams.fwn = params.fwn;
+    msParams.cb = subprogress( params.callBack, 0.0f, 0.3f );
+    auto coarseVolume = meshToDistanceVolume( mp, msParams );
+    if ( !coarseVolume )
+        return unexpected( std::move( coarseVolume.error() ) );
+
+    MarchingCubesParams vmParams;
+    vmParams.origin = coarseOrigin;
+    vmParams.iso = offset;
+    vmParams.lessInside = true;
+    vmParams.skipEmptyBlocks = true;
+    vmParams.cb = subprogress( params.callBack, 0.3f, 0.4f );
+    Vector<VoxelId, FaceId> coarseFaceToCell;
+    vmParams.outVoxelPerFaceMap = &coarseFaceToCell;
+    auto res = marchingCubes( *coarseVolume, vmParams );
+    if ( !res.has_value() )
+        return res;
+    auto & mesh = *res;
+
+    // recompute offset surface on finer grids in the places where coarse grid lost the points of exact offset surface
+    const auto lostPoints = findLostOffsetPoints( mp, offset, signMode == SignDetectionMode::Unsigned, mesh, voxelSize );
+    if ( !reportProgress( params.callBack, 0.42f ) )
+        return unexpectedOperationCanceled();
+    const VolumeIndexer coarseIndexer( coarseVolume->dims );
+    const auto numCells = coarseVolume->dims - Vector3i::diagonal( 1 );
+    std::vector<Vector3i> lostCells;
+    lostCells.reserve( lostPoints.size() );
+    for ( const auto & p : lostPoints )
+    {
+        const auto c = Vector3i( ( p - coarseOrigin ) / voxelSize - Vector3f::diagonal( 0.5f ) );
+        lostCells.emplace_back( std::clamp( c.x, 0, numCells.x - 1 ), std::clamp( c.y, 0, numCells.y - 1 ), std::clamp( c.z, 0, numCells.z - 1 ) );
+    }
+    auto refined = params.maxRefinementLevels > 0 ? groupLostCells( lostCells, numCells ) : std::vector<RefinedCells>{};
+
+    for ( auto & r : refined )
+    {
+        for ( int level = 1; ; ++level )
+        {
+            const int m = 1 << level;
+            const float fineVoxelSize = voxelSize / m;
+            const auto fineDims = ( r.cells.size() + Vector3i::diagonal( 1 ) ) * m + Vector3i::diagonal( 1 );
+            msParams.origin = coarseOrigin + ( Vector3f( r.cells.min ) + Vector3f::diagonal( 0.5f ) ) * voxelSize - Vector3f::diagonal( 0.5f * fineVoxelSize );
+            msParams.voxelSize = Vector3f::diagonal( fineVoxelSize );
+            msParams.dimensions = fineDims;
+            msParams.cb = {};
+            auto fineVolume = meshToDistanceVolume( mp, msParams );
+            if ( !fineVolume )
+                return unexpected( std::move( fineVolume.error() ) );
+
+            // the values on the boundary of fine grid are interpolated from coarse grid,
+            // so the boundary vertices of fine and coarse meshes coincide on the lines of coarse grid
+            const VolumeIndexer fineIndexer( fineDims );
+            ParallelFor( 0, fineDims.z, [&]( int z )
+            {
+                Vector3i pos( 0, 0, z );
+                for ( pos.y = 0; pos.y < fineDims.y; ++pos.y )
+                    for ( pos.x = 0; pos.x < fineDims.x; ++pos.x )
+                    {
+                        if ( pos.x > 0 && pos.y > 0 && pos.z > 0 && pos.x + 1 < fineDims.x && pos.y + 1 < fineDims.y && pos.z + 1 < fineDims.z )
+                            continue;
+                        float value = 0;
+                        for ( int corner = 0; corner < 8; ++corner )
+                        {
+                            float w = 1;
+                            Vector3i coarsePos;
+                            for ( int i = 0; i < 3; ++i )
+                            {
+                                coarsePos[i] = r.cells.min[i] + pos[i] / m;
+                                const float t = float( pos[i] % m ) / m;
+                                if ( corner & ( 1 << i ) )
+                                {
+                                    w *= t;
+                                    ++coarsePos[i];
+                                }
+                                else
+                                    w *= 1 - t;
+                            }
+                            if ( w > 0 )
+                                value += w * coarseVolume->data[coarseIndexer.toVoxelId( coarsePos )];
+                        }
+                        fineVolume->data[fineIndexer.toVoxelId( pos )] = value;
+                    }
+            } );
+
+            MarchingCubesParams fineParams;
+            fineParams.origin = msParams.origin;
+            fineParams.iso = offset;
+            fineParams.lessInside = true;
+            fineParams.skipEmptyBlocks = true;
+            auto fineMesh = marchingCubes( *fineVolume, fineParams );
+            if ( !fineMesh.has_value() )
+                return fineMesh;
+
+            bool allFound = true;
+            for ( size_t i = 0; i < lostPoints.size() && allFound; ++i )
+                if ( r.cells.contains( lostCells[i] ) && findProjection( lostPoints[i], *fineMesh, sqr( fineVoxelSize ) ).distSq >= sqr( fineVoxelSize ) )
+                    allFound = false;
+            if ( allFound || level >= params.maxRefinementLevels )
+            {
+                r.mesh = std::move( *fineMesh );
+                break;
+            }
+        }
+        if ( !reportProgress( params.callBack, 0.45f ) )
+            return unexpectedOperationCanceled();
+    }
+
+    if ( !refined.empty() )
+    {
+        FaceBitSet refinedFaces( mesh.topology.faceSize() );
+        for ( FaceId f( 0 ); f < coarseFaceToCell.size(); ++f )
+        {
+            const auto cell = coarseIndexer.toPos( coarseFaceToCell[f] );
+            for ( const auto & r : refined )
+                if ( r.cells.contains( cell ) )
+                    refinedFaces.set( f );
+        }
+        mesh.deleteFaces( refinedFaces );
+        for ( const auto & r : refined )
+            mesh.addPart( r.mesh );
+
+        // unite coinciding boundary vertices of coarse and fine parts, and fill narrow gaps remaining between them
+        const float tol = std::ldexp( 1e-3f * voxelSize, -params.maxRefinementLevels );
+        MeshBuilder::uniteCloseVertices( mesh, tol );
+        auto onRefinedBoundary = [&]( const Vector3f & p )
+        {
+            for ( const auto & r : refined )
+            {
+                const Box3f cellsBox( coarseOrigin + ( Vector3f( r.cells.min ) + Vector3f::diagonal( 0.5f ) ) * voxelSize,
+                    coarseOrigin + ( Vector3f( r.cells.max ) + Vector3f::diagonal( 1.5f ) ) * voxelSize );
+                const auto d = Vector3f::diagonal( 0.01f * voxelSize );
+                if ( Box3f( cellsBox.min - d, cellsBox.max + d ).contains( p ) && !Box3f( cellsBox.min + d, cellsBox.max - d ).contains( p ) )
+                    return true;
+            }
+            return false;
+        };
+        for ( auto e : mesh.topology.findHoleRepresentiveEdges() )
+            if ( onRefinedBoundary( mesh.orgPnt( e ) ) )
+                fillHole( mesh, e );
+    }
+    if ( !reportProgress( params.callBack, 0.5f ) )
+        return unexpectedOperationCanceled();
+
+    std::unique_ptr<FastWindingNumber> fwn;
+    if ( params.signDetectionMode == SignDetectionMode::WindingRule || params.signDetectionMode == SignDetectionMode::HoleWindingRule )
+        fwn = std::make_unique<FastWindingNumber>( mp.mesh );
+
+    // moves given point along the line to its closest point on original mesh till the exact offset surface
+    auto projectOnOffsetSurface = [&]( const Vector3f & p )
+    {
+        const auto prj = findProjection( p, mp );
+        if ( !prj.proj.face )
+            return p;
+        auto dir = p - prj.proj.point;
+        const auto dist = dir.length();
+        if ( dist <= 0 )
+            return prj.proj.point + offset * mp.mesh.pseudonormal( prj.mtp, mp.region );
+        dir /= dist;
+        bool inside = false;
+        if ( fwn )
+        {
+            constexpr float beta = 2;
+            inside = fwn->calc( p, beta ) > 0.5f;
+        }
+        else if ( params.signDetectionMode != SignDetectionMode::Unsigned )
+            inside = mp.mesh.signedDistance( p, prj.mtp, mp.region ) < 0;
+        return prj.proj.point + ( inside ? -offset : offset ) * dir;
+    };
+
+    if ( !BitSetParallelFor( mesh.topology.getValidVerts(), [&]( VertId v )
+    {
+        mesh.points[v] = projectOnOffsetSurface( mesh.points[v] );
+    }, subprogress( params.callBack, 0.5f, 0.6f ) ) )
+        return unexpectedOperationCanceled();
+    mesh.invalidateCaches();
+
+    const float maxDevSq = sqr( params.maxDeviation * params.voxelSize );
+    const float minEdgeLen = std::ldexp( params.voxelSize, -std::max( 0, params.maxRefinementLevels ) );
+
+    // exact positions for the middle points of all initial edges are computed in parallel,
+    // and reused during subdivision while the edge is not changed by flips
+    struct EdgeMiddle
+    {
+        Vector3f mid = Vector3f::diagonal( cQuietNan );
+        Vector3f target;
+    };
+    Vector<EdgeMiddle, UndirectedEdgeId> middles( mesh.topology.undirectedEdgeSize() );
+    if ( !ParallelFor( middles, [&]( UndirectedEdgeId ue )
+    {
+        if ( mesh.topology.isLoneEdge( ue ) || mesh.edgeLengthSq( ue ) < sqr( minEdgeLen ) )
+            return;
+        const auto mid = mesh.edgeCenter( ue );
+        middles[ue] = { mid, projectOnOffsetSurface( mid ) };
+    }, subprogress( params.callBack, 0.6f, 0.8f ) ) )
+        return unexpectedOperationCanceled();
+
+    Vector3f lastTarget;
+    SubdivideSettings subdivideSettings;
+    subdivideSettings.maxEdgeLen = minEdgeLen;
+    subdivideSettings.maxEdgeSplits = INT_MAX;
+    subdivideSettings.maxDeviationAfterFlip = std::sqrt( maxDevSq );
+    subdivideSettings.beforeEdgeSplit = [&]( EdgeId e )
+    {
+        const auto ue = e.undirected();
+        const auto mid = mesh.edgeCenter( ue );
+        if ( ue < middles.size() && middles[ue].mid == mid )
+            lastTarget = middles[ue].target;
+        else
+            lastTarget = projectOnOffsetSurface( mid );
+        const auto devSq = ( lastTarget - mid ).lengthSq();
+        // the middle of the edge crossing thin wall or sharp crease deviates on the most part of edge length,
+        // and splitting of such edges does not converge
+        if ( devSq <= maxDevSq || 16 * devSq >= mesh.edgeLengthSq( ue ) )
+            return false;
+        // the exact point can be already present as a neighbor vertex, if the flips restored previously split edge
+        for ( auto end : { e, e.sym() } )
+            for ( auto ei : orgRing( mesh.topology, end ) )
+                if ( ( mesh.destPnt( ei ) - lastTarget ).lengthSq() <= maxDevSq )
+                    return false;
+        return true;
+    };
+    subdivideSettings.onVertCreated = [&]( VertId v )
+    {
+        mesh.points[v] = lastTarget;
+    };
+    subdivideSettings.progressCallback = subprogress( params.callBack, 0.8f, 1.0f );
+    subdivideMesh( mesh, subdivideSettings );
+    if ( !reportProgress( params.callBack, 1.0f ) )
+        return unexpectedOperationCanceled();
+
+    return res;
+}
+
 Expected<Mesh> generalOffsetMesh( const MeshPart& mp, float offset, const GeneralOffsetParameters& params )
 {
     switch( params.mode )
@@ -324,4 +716,61 @@ Expected<Mesh> offsetPolyline( const Polyline3& polyline, float offset, const Of
 }
 #endif
 
+TEST( MRMesh, AdaptiveOffsetMesh )
+{
+    const auto torus = makeTorus( 1.0f, 0.3f, 64, 32 );
+    const float offset = 0.1f;
+    AdaptiveOffsetParameters params;
+    params.voxelSize = 0.08f;
+    params.maxDeviation = 1.0f / 200;
+    params.signDetectionMode = SignDetectionMode::ProjectionNormal;
+
+    // the maximal deviation of the vertices and edge middles of offset mesh from exact offset surface
+    auto maxDeviation = [&]( const Mesh & mesh )
+    {
+        float res = 0;
+        for ( auto v : mesh.topology.getValidVerts() )
+            res = std::max( res, std::abs( torus.signedDistance( mesh.points[v] ) - offset ) );
+        for ( UndirectedEdgeId ue( 0 ); ue < mesh.topology.undirectedEdgeSize(); ++ue )
+            if ( !mesh.topology.isLoneEdge( ue ) )
+                res = std::max( res, std::abs( torus.signedDistance( mesh.edgeCenter( ue ) ) - offset ) );
+        return res;
+    };
+
+    auto uniform = mcOffsetMesh( torus, offset, params );
+    ASSERT_TRUE( uniform.has_value() );
+    auto adaptive = adaptiveOffsetMesh( torus, offset, params );
+    ASSERT_TRUE( adaptive.has_value() );
+    EXPECT_TRUE( adaptive->topology.isClosed() );
+
+    const auto uniformDev = maxDeviation( *uniform );
+    const auto adaptiveDev = maxDeviation( *adaptive );
+    EXPECT_LT( adaptiveDev, 2 * params.maxDeviation * params.voxelSize );
+    EXPECT_LT( 5 * adaptiveDev, uniformDev );
+}
+
+TEST( MRMesh, AdaptiveOffsetMeshThinWall )
+{
+    // inner offset of the thin plate is much thinner than the voxel
+    auto mesh = makeTorus( 1.0f, 0.3f, 64, 32 );
+    mesh.addPart( makeCube( Vector3f( 1.2f, 0.3f, 0.03f ), Vector3f( -0.6f, -0.15f, -0.015f ) ) );
+    const float offset = -0.01f;
+    AdaptiveOffsetParameters params;
+    params.voxelSize = 0.08f;
+    params.signDetectionMode = SignDetectionMode::ProjectionNormal;
+
+    auto uniform = mcOffsetMesh( mesh, offset, params );
+    ASSERT_TRUE( uniform.has_value() );
+    EXPECT_FALSE( uniform->topology.isClosed() && MeshComponents::getNumComponents( *uniform ) == 2 );
+
+    auto adaptive = adaptiveOffsetMesh( mesh, offset, params );
+    ASSERT_TRUE( adaptive.has_value() );
+    EXPECT_TRUE( adaptive->topology.isClosed() );
+    EXPECT_EQ( MeshComponents::getNumComponents( *adaptive ), 2 );
+    float maxDev = 0;
+    for ( auto v : adaptive->topology.getValidVerts() )
+        maxDev = std::max( maxDev, std::abs( mesh.signedDistance( adaptive->points[v] ) - offset ) );
+    EXPECT_LT( maxDev, 0.1f * params.voxelSize );
+}
+
 }
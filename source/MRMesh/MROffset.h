@@ -28,7 +28,7 @@ struct OffsetParameters : BaseShellParameters
     /// determines the method to compute distance sign
     SignDetectionMode signDetectionMode = SignDetectionMode::OpenVDB;
 
-    /// defines particular implementation of IFastWindingNumber interface that will compute windings. If it is not specified, default FastWindingNumber is used
+    /// defines particular implementation of IFastWindingNumber interface that will compute windings. If it is not specified, default PacketFastWindingNumber is used
     std::shared_ptr<IFastWindingNumber> fwn;
 
     /// use FunctionVolume for voxel grid representation:
@@ -54,6 +54,15 @@ struct SharpOffsetParameters : OffsetParameters
     float maxOldVertPosCorrection = 0.5f;
 };
 
+struct AdaptiveOffsetParameters : OffsetParameters
+{
+    /// maximal allowed distance from the points of result mesh to exact offset surface, measured in voxelSize
+    float maxDeviation = 1.0f / 50;
+    /// how many times the voxels of local grids and the edges of Marching Cubes mesh can be halved during refinement,
+    /// so the smallest voxels and the shortest refined edges are about voxelSize / 2^maxRefinementLevels
+    int maxRefinementLevels = 4;
+};
+
 #ifndef MRMESH_NO_OPENVDB
 /// Offsets mesh by converting it to distance field in voxels using OpenVDB library,
 /// signDetectionMode = Unsigned(from OpenVDB) | OpenVDB | HoleWindingRule,
@@ -82,6 +91,16 @@ struct SharpOffsetParameters : OffsetParameters
 /// post process result using reference mesh to sharpen features
 [[nodiscard]] MRMESH_API Expected<Mesh> sharpOffsetMesh( const MeshPart& mp, float offset, const SharpOffsetParameters& params = {} );
 
+/// Offsets mesh with adaptive resolution: first builds coarse offset mesh by Marching Cubes with params.voxelSize,
+/// then recomputes it on locally refined grids (with voxels halved up to params.maxRefinementLevels times) only in the boxes
+/// where the coarse mesh lost the points of exact offset surface (e.g. thin walls or small components), and stitches the parts;
+/// after that projects all vertices on exact offset surface and splits only the edges, which middle points are further from exact surface
+/// than params.maxDeviation (e.g. on fillets of high curvature), putting new vertices on exact offset surface as well;
+/// so the exact distance is computed only near the surface and only where the refinement is needed,
+/// which gives sub-voxel accuracy with much smaller memory and time than uniform grid of fine voxels;
+/// the distances are computed without OpenVDB, and SignDetectionMode::OpenVDB is replaced with SignDetectionMode::ProjectionNormal
+[[nodiscard]] MRMESH_API Expected<Mesh> adaptiveOffsetMesh( const MeshPart& mp, float offset, const AdaptiveOffsetParameters& params = {} );
+
 /// allows the user to select in the parameters which offset algorithm to call
 struct GeneralOffsetParameters : SharpOffsetParameters
 {
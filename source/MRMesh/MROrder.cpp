@@ -77,6 +77,18 @@ void orderFacePoints( const FacePointSpan & span, int numThreads )
     }
 }
 
+/// inserts two zero bits after each of 21 lower bits of x
+std::uint64_t spreadBits3( std::uint64_t x )
+{
+    x &= 0x1fffff;
+    x = ( x | x << 32 ) & 0x1f00000000ffffull;
+    x = ( x | x << 16 ) & 0x1f0000ff0000ffull;
+    x = ( x | x << 8 ) & 0x100f00f00f00f00full;
+    x = ( x | x << 4 ) & 0x10c30c30c30c30c3ull;
+    x = ( x | x << 2 ) & 0x1249249249249249ull;
+    return x;
+}
+
 } // anonymous namespace
 
 FaceBMap getOptimalFaceOrdering( const Mesh & mesh )
@@ -282,4 +294,61 @@ UndirectedEdgeBMap getEdgeOrdering( const FaceBMap & faceMap, const MeshTopology
     return res;
 }
 
+std::vector<size_t> getMortonOrder( const std::vector<Vector3f> & points )
+{
+    MR_TIMER
+
+    const auto box = tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, points.size() ), Box3f{},
+        [&] ( const tbb::blocked_range<size_t>& range, Box3f curBox )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+            curBox.include( points[i] );
+        return curBox;
+    },
+        [] ( Box3f a, const Box3f & b )
+    {
+        a.include( b );
+        return a;
+    } );
+
+    constexpr float maxCoord = float( ( 1 << 21 ) - 1 );
+    Vector3f scale;
+    if ( box.valid() )
+    {
+        const auto size = box.size();
+        for ( int i = 0; i < 3; ++i )
+            scale[i] = size[i] > 0 ? maxCoord / size[i] : 0.0f;
+    }
+
+    struct OrderedPoint
+    {
+        std::uint64_t code;
+        size_t i;
+        bool operator <( const OrderedPoint & b ) const
+            { return std::tie( code, i ) < std::tie( b.code, b.i ); }
+    };
+    std::vector<OrderedPoint> ord( points.size() );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, points.size() ),
+        [&]( const tbb::blocked_range<size_t>& range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+        {
+            const auto p = mult( points[i] - box.min, scale );
+            ord[i] = OrderedPoint{
+                spreadBits3( std::uint64_t( p.x ) ) | spreadBits3( std::uint64_t( p.y ) ) << 1 | spreadBits3( std::uint64_t( p.z ) ) << 2,
+                i };
+        }
+    } );
+    tbb::parallel_sort( ord.begin(), ord.end() );
+
+    std::vector<size_t> res( points.size() );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, points.size() ),
+        [&]( const tbb::blocked_range<size_t>& range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+            res[i] = ord[i].i;
+    } );
+    return res;
+}
+
 } //namespace MR
@@ -3,6 +3,7 @@
 #include "MRId.h"
 #include "MRBuffer.h"
 #include <tuple>
+#include <vector>
 
 namespace MR
 {
@@ -21,4 +22,8 @@ namespace MR
 /// \param faceMap old face id -> new face id
 [[nodiscard]] MRMESH_API UndirectedEdgeBMap getEdgeOrdering( const FaceBMap & faceMap, const MeshTopology & topology );
 
+/// computes the order of points along Morton (Z-order) curve inside their bounding box:
+/// res[i] is the index of the point to be processed i-th, so that consecutive points in this order are spatially close
+[[nodiscard]] MRMESH_API std::vector<size_t> getMortonOrder( const std::vector<Vector3f> & points );
+
 } //namespace MR
@@ -0,0 +1,666 @@
+#include "MRPointChunkStore.h"
+#include "MRPointCloud.h"
+#include "MRPointsInBall.h"
+#include "MRPointsProject.h"
+#include "MRUniformSampling.h"
+#include "MRMakeSphereMesh.h"
+#include "MRMesh.h"
+#include "MRSerializer.h"
+#include "MRStringConvert.h"
+#include "MRParallelFor.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRPch/MRSpdlog.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+
+namespace MR
+{
+
+namespace
+{
+
+/// the record of one octree node in the file
+struct NodeRecord
+{
+    float box[6] = {};
+    std::int32_t firstChild = -1;
+    std::int32_t numChildren = 0;
+    std::int32_t numPoints = 0;
+    std::int32_t firstPoint = -1;
+    std::uint64_t chunkOffset = 0;
+    std::uint64_t chunkBytes = 0;
+};
+static_assert( sizeof( NodeRecord ) == 56 );
+
+/// the depth of the octree is limited to stop splitting of many coincident points
+constexpr int cMaxDepth = 24;
+
+/// deflates the points after grouping the bytes of the same significance together, which compresses much better than raw floats
+bool compressPoints( std::span<const Vector3f> points, int level, std::string & out )
+{
+    const auto * src = (const char *)points.data();
+    const size_t numFloats = points.size() * 3;
+    std::string shuffled( numFloats * sizeof( float ), '\0' );
+    for ( size_t i = 0; i < numFloats; ++i )
+        for ( size_t b = 0; b < sizeof( float ); ++b )
+            shuffled[b * numFloats + i] = src[i * sizeof( float ) + b];
+
+    uLongf size = compressBound( uLong( shuffled.size() ) );
+    out.resize( size );
+    if ( compress2( (Bytef*)out.data(), &size, (const Bytef*)shuffled.data(), uLong( shuffled.size() ), level ) != Z_OK )
+        return false;
+    out.resize( size );
+    return true;
+}
+
+bool decompressPoints( const char * data, size_t size, std::vector<Vector3f> & points )
+{
+    const size_t numFloats = points.size() * 3;
+    std::string shuffled( numFloats * sizeof( float ), '\0' );
+    uLongf outSize = uLongf( shuffled.size() );
+    if ( uncompress( (Bytef*)shuffled.data(), &outSize, (const Bytef*)data, uLong( size ) ) != Z_OK || outSize != shuffled.size() )
+        return false;
+    auto * dst = (char *)points.data();
+    for ( size_t i = 0; i < numFloats; ++i )
+        for ( size_t b = 0; b < sizeof( float ); ++b )
+            dst[i * sizeof( float ) + b] = shuffled[b * numFloats + i];
+    return true;
+}
+
+/// writes the octree nodes and compressed chunks of the points in the output file
+class OctreeWriter
+{
+public:
+    OctreeWriter( std::ofstream & out, int compressionLevel ) : out_( out ), compressionLevel_( compressionLevel ) {}
+
+    std::vector<NodeRecord> nodes;
+
+    /// allocates given number of consecutive nodes, returns the index of the first one
+    int addNodes( int num )
+    {
+        const int first = (int)nodes.size();
+        nodes.resize( nodes.size() + num );
+        return first;
+    }
+
+    /// fills node #n by the subtree of given points inside the box, splitting it till the leaves have at most maxChunkPoints
+    bool fillPoints( int n, std::span<Vector3f> points, const Box3f & box, int maxChunkPoints, int depth )
+    {
+        if ( (int)points.size() <= maxChunkPoints || depth >= cMaxDepth )
+            return writeLeaf_( n, points );
+
+        // partition the points in 8 octants of the box
+        const auto c = box.center();
+        std::array<Vector3f*, 9> bounds;
+        bounds[0] = points.data();
+        bounds[8] = points.data() + points.size();
+        bounds[4] = std::partition( bounds[0], bounds[8], [&]( const Vector3f & p ) { return p.z < c.z; } );
+        for ( int i = 0; i < 8; i += 4 )
+            bounds[i + 2] = std::partition( bounds[i], bounds[i + 4], [&]( const Vector3f & p ) { return p.y < c.y; } );
+        for ( int i = 0; i < 8; i += 2 )
+            bounds[i + 1] = std::partition( bounds[i], bounds[i + 2], [&]( const Vector3f & p ) { return p.x < c.x; } );
+
+        int numChildren = 0;
+        for ( int i = 0; i < 8; ++i )
+            if ( bounds[i] != bounds[i + 1] )
+                ++numChildren;
+        const int firstChild = addNodes( numChildren );
+        nodes[n].firstChild = firstChild;
+        nodes[n].numChildren = numChildren;
+        int child = firstChild;
+        Box3f nodeBox;
+        for ( int i = 0; i < 8; ++i )
+        {
+            if ( bounds[i] == bounds[i + 1] )
+                continue;
+            Box3f childBox = box;
+            for ( int d = 0; d < 3; ++d )
+                ( ( i >> d ) & 1 ? childBox.min : childBox.max )[d] = c[d];
+            if ( !fillPoints( child, { bounds[i], bounds[i + 1] }, childBox, maxChunkPoints, depth + 1 ) )
+                return false;
+            nodeBox.include( boxOf( child ) );
+            ++child;
+        }
+        setBox( n, nodeBox );
+        return true;
+    }
+
+    Box3f boxOf( int n ) const
+    {
+        const auto & b = nodes[n].box;
+        return { { b[0], b[1], b[2] }, { b[3], b[4], b[5] } };
+    }
+
+    void setBox( int n, const Box3f & box )
+    {
+        for ( int d = 0; d < 3; ++d )
+        {
+            nodes[n].box[d] = box.min[d];
+            nodes[n].box[3 + d] = box.max[d];
+        }
+    }
+
+    std::uint64_t numWrittenPoints() const { return numPoints_; }
+
+private:
+    bool writeLeaf_( int n, std::span<const Vector3f> points )
+    {
+        Box3f box;
+        for ( const auto & p : points )
+            box.include( p );
+        setBox( n, box );
+        auto & node = nodes[n];
+        node.numPoints = (int)points.size();
+        node.firstPoint = (int)numPoints_;
+        numPoints_ += points.size();
+        if ( !compressPoints( points, compressionLevel_, buf_ ) )
+            return false;
+        node.chunkOffset = (std::uint64_t)out_.tellp();
+        node.chunkBytes = buf_.size();
+        out_.write( buf_.data(), buf_.size() );
+        return (bool)out_;
+    }
+
+    std::ofstream & out_;
+    int compressionLevel_ = 1;
+    std::uint64_t numPoints_ = 0;
+    std::string buf_;
+};
+
+} //anonymous namespace
+
+Expected<PointChunkStoreBuilder> PointChunkStoreBuilder::create( const std::filesystem::path & file, const Box3f & box,
+    const PointChunkStoreSettings & settings )
+{
+    if ( settings.bucketDepth < 0 || settings.bucketDepth > 8 || settings.maxChunkPoints <= 0 || settings.bucketBufferPoints <= 0 )
+        return unexpected( std::string( "Invalid settings of point chunk store" ) );
+
+    PointChunkStoreBuilder res;
+    res.file_ = file;
+    res.tmpFile_ = file;
+    res.tmpFile_ += ".tmp";
+    res.box_ = box;
+    res.settings_ = settings;
+    res.tmpOut_.open( res.tmpFile_, std::ios::binary );
+    if ( !res.tmpOut_ )
+        return unexpected( "Cannot open file for writing " + utf8string( res.tmpFile_ ) );
+    const size_t numBuckets = size_t( 1 ) << ( 3 * settings.bucketDepth );
+    res.bucketBuffers_.resize( numBuckets );
+    res.bucketBlocks_.resize( numBuckets );
+    res.bucketSizes_.resize( numBuckets, 0 );
+    return res;
+}
+
+int PointChunkStoreBuilder::bucketOf_( const Vector3f & p ) const
+{
+    const int cellsPerDim = 1 << settings_.bucketDepth;
+    const auto size = box_.size();
+    int res = 0;
+    for ( int d = 0; d < 3; ++d )
+    {
+        int cell = size[d] > 0 ? int( ( p[d] - box_.min[d] ) / size[d] * cellsPerDim ) : 0;
+        cell = std::clamp( cell, 0, cellsPerDim - 1 );
+        res |= cell << ( d * settings_.bucketDepth );
+    }
+    return res;
+}
+
+VoidOrErrStr PointChunkStoreBuilder::flushBucket_( int bucket )
+{
+    auto & buf = bucketBuffers_[bucket];
+    if ( buf.empty() )
+        return {};
+    bucketBlocks_[bucket].push_back( { tmpSize_, std::uint32_t( buf.size() ) } );
+    const auto bytes = buf.size() * sizeof( Vector3f );
+    tmpOut_.write( (const char*)buf.data(), bytes );
+    if ( !tmpOut_ )
+        return unexpected( "Cannot write file " + utf8string( tmpFile_ ) );
+    tmpSize_ += bytes;
+    buf.clear();
+    return {};
+}
+
+VoidOrErrStr PointChunkStoreBuilder::addPoints( std::span<const Vector3f> points )
+{
+    if ( bucketBuffers_.empty() )
+        return unexpected( std::string( "Point chunk store builder is not open" ) );
+    for ( const auto & p : points )
+    {
+        const int bucket = bucketOf_( p );
+        auto & buf = bucketBuffers_[bucket];
+        buf.push_back( p );
+        ++bucketSizes_[bucket];
+        if ( (int)buf.size() >= settings_.bucketBufferPoints )
+            if ( auto v = flushBucket_( bucket ); !v )
+                return v;
+    }
+    numPoints_ += points.size();
+    return {};
+}
+
+VoidOrErrStr PointChunkStoreBuilder::finish( const ProgressCallback & progress )
+{
+    MR_TIMER
+    if ( bucketBuffers_.empty() )
+        return unexpected( std::string( "Point chunk store builder is not open" ) );
+    if ( numPoints_ > size_t( std::numeric_limits<int>::max() ) )
+        return unexpected( std::string( "Too many points for point chunk store" ) );
+    tmpOut_.close();
+    if ( !tmpOut_ )
+        return unexpected( "Cannot write file " + utf8string( tmpFile_ ) );
+
+    std::ifstream tmpIn( tmpFile_, std::ios::binary );
+    std::ofstream out( file_, std::ios::binary );
+    if ( !tmpIn || !out )
+        return unexpected( "Cannot open file " + utf8string( !tmpIn ? tmpFile_ : file_ ) );
+
+    PointChunkStoreHeader header;
+    out.write( (const char*)&header, sizeof( header ) );
+
+    OctreeWriter writer( out, settings_.compressionLevel );
+    const int depth = settings_.bucketDepth;
+    const int cellsPerDim = 1 << depth;
+    const auto cellSize = box_.size() / float( cellsPerDim );
+    auto cellBox = [&]( int level, const Vector3i & cell )
+    {
+        const auto size = cellSize * float( 1 << ( depth - level ) );
+        const Vector3f min( box_.min.x + cell.x * size.x, box_.min.y + cell.y * size.y, box_.min.z + cell.z * size.z );
+        return Box3f( min, min + size );
+    };
+    auto bucketIndex = [&]( const Vector3i & cell )
+    {
+        return cell.x | ( cell.y << depth ) | ( cell.z << ( 2 * depth ) );
+    };
+    // the number of points in the cell of given level
+    auto cellPoints = [&]( int level, const Vector3i & cell )
+    {
+        const int n = 1 << ( depth - level );
+        std::uint64_t res = 0;
+        for ( int z = 0; z < n; ++z )
+            for ( int y = 0; y < n; ++y )
+                for ( int x = 0; x < n; ++x )
+                    res += bucketSizes_[bucketIndex( cell * n + Vector3i( x, y, z ) )];
+        return res;
+    };
+
+    std::vector<Vector3f> points;
+    size_t processedPoints = 0;
+    std::string error;
+    // fills node #n by the points of given cell
+    auto fillCell = [&]( auto && self, int n, int level, const Vector3i & cell ) -> bool
+    {
+        if ( level == depth )
+        {
+            const int bucket = bucketIndex( cell );
+            points.clear();
+            points.reserve( bucketSizes_[bucket] );
+            for ( const auto & block : bucketBlocks_[bucket] )
+            {
+                points.resize( points.size() + block.numPoints );
+                tmpIn.seekg( block.offset );
+                tmpIn.read( (char*)( points.data() + points.size() - block.numPoints ), block.numPoints * sizeof( Vector3f ) );
+            }
+            const auto & buf = bucketBuffers_[bucket];
+            points.insert( points.end(), buf.begin(), buf.end() );
+            bucketBuffers_[bucket] = {};
+            if ( !tmpIn )
+            {
+                error = "Cannot read file " + utf8string( tmpFile_ );
+                return false;
+            }
+            if ( !writer.fillPoints( n, points, cellBox( level, cell ), settings_.maxChunkPoints, level ) )
+            {
+                error = "Cannot write file " + utf8string( file_ );
+                return false;
+            }
+            processedPoints += points.size();
+            if ( !reportProgress( progress, float( processedPoints ) / float( numPoints_ ) ) )
+            {
+                error = stringOperationCanceled();
+                return false;
+            }
+            return true;
+        }
+
+        Vector3i children[8];
+        int numChildren = 0;
+        for ( int i = 0; i < 8; ++i )
+        {
+            const Vector3i child = cell * 2 + Vector3i( i & 1, ( i >> 1 ) & 1, ( i >> 2 ) & 1 );
+            if ( cellPoints( level + 1, child ) > 0 )
+                children[numChildren++] = child;
+        }
+        const int firstChild = writer.addNodes( numChildren );
+        writer.nodes[n].firstChild = firstChild;
+        writer.nodes[n].numChildren = numChildren;
+        Box3f nodeBox;
+        for ( int i = 0; i < numChildren; ++i )
+        {
+            if ( !self( self, firstChild + i, level + 1, children[i] ) )
+                return false;
+            nodeBox.include( writer.boxOf( firstChild + i ) );
+        }
+        writer.setBox( n, nodeBox );
+        return true;
+    };
+
+    if ( numPoints_ > 0 )
+    {
+        writer.addNodes( 1 );
+        if ( !fillCell( fillCell, 0, 0, Vector3i() ) )
+            return unexpected( std::move( error ) );
+    }
+    assert( writer.numWrittenPoints() == numPoints_ );
+
+    std::memcpy( header.magic, PointChunkStoreHeader::Magic, sizeof( header.magic ) );
+    header.version = PointChunkStoreHeader::CurrentVersion;
+    header.headerSize = sizeof( PointChunkStoreHeader );
+    header.numPoints = numPoints_;
+    header.numNodes = writer.nodes.size();
+    header.nodesOffset = (std::uint64_t)out.tellp();
+    out.write( (const char*)writer.nodes.data(), writer.nodes.size() * sizeof( NodeRecord ) );
+    out.seekp( 0 );
+    out.write( (const char*)&header, sizeof( header ) );
+    out.close();
+    if ( !out )
+        return unexpected( "Cannot write file " + utf8string( file_ ) );
+
+    tmpIn.close();
+    std::error_code ec;
+    std::filesystem::remove( tmpFile_, ec );
+    bucketBuffers_ = {};
+    bucketBlocks_ = {};
+    bucketSizes_ = {};
+    return {};
+}
+
+Expected<std::unique_ptr<PointChunkStore>> PointChunkStore::open( const std::filesystem::path & file, size_t cacheBytes )
+{
+    MR_TIMER
+    auto mapped = MappedFile::open( file );
+    if ( !mapped )
+        return unexpected( std::move( mapped.error() ) );
+
+    std::unique_ptr<PointChunkStore> res( new PointChunkStore );
+    res->file_ = std::move( *mapped );
+    res->maxCacheBytes_ = cacheBytes;
+
+    const auto fileSize = res->file_.size();
+    PointChunkStoreHeader header;
+    if ( fileSize < sizeof( header ) )
+        return unexpected( std::string( "Not a point chunk store file" ) );
+    std::memcpy( &header, res->file_.data(), sizeof( header ) );
+    if ( std::memcmp( header.magic, PointChunkStoreHeader::Magic, sizeof( header.magic ) ) != 0 )
+        return unexpected( std::string( "Not a point chunk store file" ) );
+    if ( header.version > PointChunkStoreHeader::CurrentVersion )
+        return unexpected( "Unsupported version of point chunk store file: " + std::to_string( header.version ) );
+    if ( header.headerSize < sizeof( header ) || header.nodesOffset > fileSize
+        || header.numNodes > ( fileSize - header.nodesOffset ) / sizeof( NodeRecord ) )
+        return unexpected( std::string( "Damaged point chunk store file" ) );
+
+    res->numPoints_ = header.numPoints;
+    res->nodes_.resize( header.numNodes );
+    const auto * records = res->file_.data() + header.nodesOffset;
+    for ( NodeId n( 0 ); n < res->nodes_.size(); ++n )
+    {
+        NodeRecord r;
+        std::memcpy( &r, records + (size_t)n * sizeof( NodeRecord ), sizeof( r ) );
+        auto & node = res->nodes_[n];
+        node.box = Box3f( { r.box[0], r.box[1], r.box[2] }, { r.box[3], r.box[4], r.box[5] } );
+        node.firstChild = NodeId( r.firstChild );
+        node.numChildren = r.numChildren;
+        node.numPoints = r.numPoints;
+        node.firstPoint = VertId( r.firstPoint );
+        node.chunkOffset = r.chunkOffset;
+        node.chunkBytes = r.chunkBytes;
+        const bool valid = node.leaf()
+            ? node.chunkOffset <= fileSize && node.chunkBytes <= fileSize - node.chunkOffset
+                && node.numPoints >= 0 && node.firstPoint >= 0 && size_t( node.firstPoint ) + node.numPoints <= header.numPoints
+            : node.numChildren <= 8 && node.firstChild > n && node.firstChild + node.numChildren <= (int)header.numNodes;
+        if ( !valid )
+            return unexpected( std::string( "Damaged point chunk store file" ) );
+        if ( node.leaf() && node.numPoints > 0 )
+            res->leaves_.push_back( n );
+    }
+    std::sort( res->leaves_.begin(), res->leaves_.end(), [&]( NodeId a, NodeId b )
+        { return res->nodes_[a].firstPoint < res->nodes_[b].firstPoint; } );
+
+    // the leaves must cover all point ids without gaps and overlaps for findLeaf
+    size_t nextPoint = 0;
+    for ( auto leaf : res->leaves_ )
+    {
+        const auto & node = res->nodes_[leaf];
+        if ( size_t( node.firstPoint ) != nextPoint )
+            return unexpected( std::string( "Damaged point chunk store file" ) );
+        nextPoint += node.numPoints;
+    }
+    if ( nextPoint != header.numPoints )
+        return unexpected( std::string( "Damaged point chunk store file" ) );
+    return res;
+}
+
+std::shared_ptr<const PointChunkStore::Chunk> PointChunkStore::getChunk( NodeId leaf ) const
+{
+    assert( nodes_[leaf].leaf() );
+    {
+        std::unique_lock lock( mutex_ );
+        if ( auto it = cache_.find( leaf ); it != cache_.end() )
+        {
+            lru_.splice( lru_.begin(), lru_, it->second.lruPos );
+            return it->second.chunk;
+        }
+    }
+
+    // decompress without locking to let other threads use the cache meanwhile
+    const auto & node = nodes_[leaf];
+    auto chunk = std::make_shared<Chunk>();
+    chunk->firstPoint = node.firstPoint;
+    chunk->points.resize( node.numPoints );
+    if ( !decompressPoints( file_.data() + node.chunkOffset, node.chunkBytes, chunk->points ) )
+    {
+        spdlog::error( "Damaged chunk #{} of point chunk store", (int)leaf );
+        std::unique_lock lock( mutex_ );
+        ++numDamagedChunkLoads_;
+        return {};
+    }
+    const size_t bytes = chunk->points.size() * sizeof( Vector3f );
+
+    std::unique_lock lock( mutex_ );
+    ++numChunkLoads_;
+    auto [it, inserted] = cache_.insert( { leaf, CacheEntry{ chunk, {} } } );
+    if ( !inserted ) // other thread has loaded the same chunk
+    {
+        lru_.splice( lru_.begin(), lru_, it->second.lruPos );
+        return it->second.chunk;
+    }
+    lru_.push_front( leaf );
+    it->second.lruPos = lru_.begin();
+    cachedBytes_ += bytes;
+    // evict least recently used chunks, but always keep the last one
+    while ( cachedBytes_ > maxCacheBytes_ && lru_.size() > 1 )
+    {
+        const auto victim = lru_.back();
+        lru_.pop_back();
+        auto vit = cache_.find( victim );
+        cachedBytes_ -= vit->second.chunk->points.size() * sizeof( Vector3f );
+        cache_.erase( vit );
+    }
+    return chunk;
+}
+
+PointChunkStore::NodeId PointChunkStore::findLeaf( VertId v ) const
+{
+    assert( v >= 0 && size_t( v ) < numPoints_ );
+    auto it = std::upper_bound( leaves_.begin(), leaves_.end(), v, [&]( VertId v, NodeId leaf )
+        { return v < nodes_[leaf].firstPoint; } );
+    assert( it != leaves_.begin() );
+    return *( it - 1 );
+}
+
+Expected<Vector3f> PointChunkStore::point( VertId v ) const
+{
+    const auto chunk = getChunk( findLeaf( v ) );
+    if ( !chunk )
+        return unexpected( "Damaged chunk of point #" + std::to_string( (int)v ) );
+    return chunk->points[v - chunk->firstPoint];
+}
+
+VoidOrErrStr PointChunkStore::validate( const ProgressCallback & progress ) const
+{
+    MR_TIMER
+    std::atomic<bool> damaged{ false };
+    if ( !ParallelFor( size_t( 0 ), leaves_.size(), [&]( size_t i )
+    {
+        const auto & node = nodes_[leaves_[i]];
+        std::vector<Vector3f> points( node.numPoints );
+        if ( !decompressPoints( file_.data() + node.chunkOffset, node.chunkBytes, points ) )
+            damaged = true;
+    }, progress, 1 ) )
+        return unexpectedOperationCanceled();
+    if ( damaged )
+        return unexpected( std::string( "Damaged point chunk store file" ) );
+    return {};
+}
+
+size_t PointChunkStore::numChunkLoads() const
+{
+    std::unique_lock lock( mutex_ );
+    return numChunkLoads_;
+}
+
+size_t PointChunkStore::numDamagedChunkLoads() const
+{
+    std::unique_lock lock( mutex_ );
+    return numDamagedChunkLoads_;
+}
+
+size_t PointChunkStore::cachedBytes() const
+{
+    std::unique_lock lock( mutex_ );
+    return cachedBytes_;
+}
+
+TEST( MRMesh, PointChunkStore )
+{
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+    const auto path = folder / "sphere.mrpc";
+
+    PointCloud cloud;
+    cloud.points = makeSphere( { .numMeshVertices = 20000 } ).points;
+    cloud.validPoints.resize( cloud.points.size(), true );
+
+    const PointChunkStoreSettings settings{ .maxChunkPoints = 500, .bucketDepth = 2, .bucketBufferPoints = 64 };
+    auto builder = PointChunkStoreBuilder::create( path, cloud.getBoundingBox(), settings );
+    ASSERT_TRUE( builder.has_value() );
+    for ( size_t i = 0; i < cloud.points.size(); i += 1000 )
+    {
+        const auto n = std::min( size_t( 1000 ), cloud.points.size() - i );
+        EXPECT_TRUE( builder->addPoints( { cloud.points.data() + i, n } ).has_value() );
+    }
+    ASSERT_TRUE( builder->finish().has_value() );
+    EXPECT_FALSE( std::filesystem::exists( folder / "sphere.mrpc.tmp" ) );
+
+    // the cache can hold only few chunks
+    auto store = PointChunkStore::open( path, 4 * settings.maxChunkPoints * sizeof( Vector3f ) );
+    ASSERT_TRUE( store.has_value() );
+    const auto & s = **store;
+    EXPECT_EQ( s.numPoints(), cloud.points.size() );
+    EXPECT_EQ( s.getBoundingBox(), cloud.getBoundingBox() );
+
+    for ( int i = 0; i < 20; ++i )
+    {
+        const auto & center = cloud.points[VertId( i * 997 )];
+        const float radius = 0.1f;
+        size_t cloudCount = 0, storeCount = 0;
+        Vector3d cloudSum, storeSum;
+        findPointsInBall( cloud, center, radius, [&]( VertId, const Vector3f & p ) { ++cloudCount; cloudSum += Vector3d( p ); } );
+        findPointsInBall( s, center, radius, [&]( VertId v, const Vector3f & p )
+        {
+            EXPECT_EQ( *s.point( v ), p );
+            ++storeCount;
+            storeSum += Vector3d( p );
+        } );
+        EXPECT_EQ( cloudCount, storeCount );
+        EXPECT_NEAR( ( cloudSum - storeSum ).length(), 0, 1e-4 );
+
+        const auto pt = 1.1f * center;
+        const auto cloudProj = findProjectionOnPoints( pt, cloud );
+        const auto storeProj = findProjectionOnPoints( pt, s );
+        EXPECT_EQ( cloudProj.distSq, storeProj.distSq );
+        EXPECT_EQ( *s.point( storeProj.vId ), cloud.points[cloudProj.vId] );
+    }
+    EXPECT_LE( s.cachedBytes(), 4 * settings.maxChunkPoints * sizeof( Vector3f ) );
+    EXPECT_GT( s.numChunkLoads(), 4 );
+
+    const float distance = 0.05f;
+    auto sampled = pointUniformSampling( s, { .distance = distance } );
+    ASSERT_TRUE( sampled.has_value() );
+    EXPECT_GT( sampled->count(), 0 );
+    EXPECT_LT( sampled->count(), s.numPoints() );
+    for ( auto v : *sampled )
+    {
+        // other samples are not closer than the distance
+        findPointsInBall( s, *s.point( v ), distance * 0.999f, [&]( VertId u, const Vector3f & )
+        {
+            EXPECT_TRUE( u == v || !sampled->test( u ) );
+        } );
+    }
+
+    EXPECT_TRUE( s.validate().has_value() );
+    EXPECT_EQ( s.numDamagedChunkLoads(), 0 );
+
+    // damage the chunk of the first point
+    const auto damagedLeaf = s[s.findLeaf( 0_v )];
+    {
+        std::fstream f( path, std::ios::binary | std::ios::in | std::ios::out );
+        f.seekp( damagedLeaf.chunkOffset + damagedLeaf.chunkBytes / 2 );
+        const std::string garbage( 16, 'x' );
+        f.write( garbage.data(), garbage.size() );
+    }
+    auto damaged = PointChunkStore::open( path );
+    ASSERT_TRUE( damaged.has_value() );
+    const auto & d = **damaged;
+    EXPECT_FALSE( d.validate().has_value() );
+    EXPECT_EQ( d.getChunk( d.findLeaf( 0_v ) ), nullptr );
+    EXPECT_FALSE( d.point( 0_v ).has_value() );
+    EXPECT_TRUE( d.point( VertId( damagedLeaf.numPoints ) ).has_value() );
+    // the queries skip the damaged chunk
+    size_t numFound = 0;
+    findPointsInBall( d, Vector3f(), 2.0f, [&]( VertId, const Vector3f & ) { ++numFound; } );
+    EXPECT_EQ( numFound, d.numPoints() - damagedLeaf.numPoints );
+    EXPECT_GT( d.numDamagedChunkLoads(), 0 );
+    // but the sampling fails
+    EXPECT_FALSE( pointUniformSampling( d, { .distance = distance } ).has_value() );
+    damaged = {};
+
+    // make a gap in point ids of the leaves
+    {
+        std::fstream f( path, std::ios::binary | std::ios::in | std::ios::out );
+        PointChunkStoreHeader header;
+        f.read( (char*)&header, sizeof( header ) );
+        for ( std::uint64_t i = 0; i < header.numNodes; ++i )
+        {
+            const auto pos = std::streamoff( header.nodesOffset + i * sizeof( NodeRecord ) );
+            NodeRecord r;
+            f.seekg( pos );
+            f.read( (char*)&r, sizeof( r ) );
+            if ( r.numChildren != 0 || r.numPoints < 2 )
+                continue;
+            ++r.firstPoint;
+            --r.numPoints;
+            f.seekp( pos );
+            f.write( (const char*)&r, sizeof( r ) );
+            break;
+        }
+    }
+    EXPECT_FALSE( PointChunkStore::open( path ).has_value() );
+}
+
+} //namespace MR
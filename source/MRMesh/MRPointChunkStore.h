@@ -0,0 +1,187 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRBox.h"
+#include "MRExpected.h"
+#include "MRId.h"
+#include "MRMappedFile.h"
+#include "MRProgressCallback.h"
+#include "MRVector.h"
+#include "MRVector3.h"
+#include "MRphmap.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace MR
+{
+
+/// \addtogroup PointCloudGroup
+/// \{
+
+/// the header of the file of PointChunkStore:
+/// it is followed by compressed chunks of points and then by the records of all octree nodes
+struct PointChunkStoreHeader
+{
+    static constexpr char Magic[8] = { 'M', 'R', 'P', 'C', 'H', 'N', 'K', '\0' };
+    static constexpr std::uint32_t CurrentVersion = 1;
+
+    char magic[8] = {};
+    std::uint32_t version = 0;
+    /// the size of this structure, to be able to add new fields in future versions
+    std::uint32_t headerSize = 0;
+    std::uint64_t numPoints = 0;
+    std::uint64_t numNodes = 0;
+    /// the offset of node records from the start of the file
+    std::uint64_t nodesOffset = 0;
+};
+
+struct PointChunkStoreSettings
+{
+    /// the maximal number of points in one chunk (octree leaf)
+    int maxChunkPoints = 16384;
+    /// the points are distributed in 8^bucketDepth cells of the box while they are added,
+    /// and each cell is split further in the octree only on finishing, so the points of any cell must fit in memory
+    int bucketDepth = 4;
+    /// the number of points of each cell kept in memory before appending them to the temporary file
+    int bucketBufferPoints = 1024;
+    /// zlib compression level of chunks: from 0 (no compression) to 9 (best compression)
+    int compressionLevel = 1;
+};
+
+/// writes PointChunkStore file from the points added portion by portion, keeping bounded amount of them in memory
+class PointChunkStoreBuilder
+{
+public:
+    PointChunkStoreBuilder() = default;
+    PointChunkStoreBuilder( PointChunkStoreBuilder && ) noexcept = default;
+    PointChunkStoreBuilder & operator =( PointChunkStoreBuilder && ) noexcept = default;
+
+    /// starts writing given file; the points are expected to be inside given box, which defines octree cells,
+    /// the points outside are put in the closest cells
+    [[nodiscard]] MRMESH_API static Expected<PointChunkStoreBuilder> create( const std::filesystem::path & file, const Box3f & box,
+        const PointChunkStoreSettings & settings = {} );
+
+    /// adds next portion of points, which get sequential ids in the order of octree leaves only after finish()
+    MRMESH_API VoidOrErrStr addPoints( std::span<const Vector3f> points );
+
+    /// the number of points added so far
+    [[nodiscard]] size_t numPoints() const { return numPoints_; }
+
+    /// builds the octree of compressed chunks, writes it in the file and removes temporary file
+    MRMESH_API VoidOrErrStr finish( const ProgressCallback & progress = {} );
+
+private:
+    struct Block
+    {
+        std::uint64_t offset = 0;
+        std::uint32_t numPoints = 0;
+    };
+    VoidOrErrStr flushBucket_( int bucket );
+    int bucketOf_( const Vector3f & p ) const;
+
+    std::filesystem::path file_;
+    std::filesystem::path tmpFile_;
+    Box3f box_;
+    PointChunkStoreSettings settings_;
+    std::ofstream tmpOut_;
+    std::uint64_t tmpSize_ = 0;
+    std::vector<std::vector<Vector3f>> bucketBuffers_;
+    std::vector<std::vector<Block>> bucketBlocks_;
+    std::vector<std::uint64_t> bucketSizes_;
+    size_t numPoints_ = 0;
+};
+
+/// read-only point cloud stored on disk in the octree of compressed chunks (see PointChunkStoreBuilder),
+/// only recently used chunks are kept decompressed in memory;
+/// point ids go sequentially in the order of octree leaves, and their number is limited by VertId range;
+/// the point queries are in MRPointsInBall.h and MRPointsProject.h, sampling is in MRUniformSampling.h;
+/// the ball and projection queries skip the chunks damaged in the file, which can be checked by numDamagedChunkLoads() after them
+/// or by validate() beforehand, and the sampling fails on them
+class PointChunkStore
+{
+public:
+    class NodeTag;
+    using NodeId = Id<NodeTag>;
+
+    struct Node
+    {
+        Box3f box; ///< bounding box of all points in the subtree
+        NodeId firstChild; ///< children are stored consecutively, invalid for leaves
+        int numChildren = 0;
+        int numPoints = 0; ///< the number of points in the leaf
+        VertId firstPoint; ///< the id of the first point in the leaf
+        std::uint64_t chunkOffset = 0; ///< the position of compressed points of the leaf in the file
+        std::uint64_t chunkBytes = 0; ///< the size of compressed points of the leaf
+        [[nodiscard]] bool leaf() const { return numChildren == 0; }
+    };
+    using NodeVec = Vector<Node, NodeId>;
+
+    /// decompressed points of one leaf
+    struct Chunk
+    {
+        VertId firstPoint;
+        std::vector<Vector3f> points;
+    };
+
+    /// maps given file in memory and reads octree nodes;
+    /// \param cacheBytes the maximal size of decompressed chunks kept in memory
+    [[nodiscard]] MRMESH_API static Expected<std::unique_ptr<PointChunkStore>> open( const std::filesystem::path & file,
+        size_t cacheBytes = size_t( 256 ) << 20 );
+
+    [[nodiscard]] size_t numPoints() const { return numPoints_; }
+    [[nodiscard]] const NodeVec & nodes() const { return nodes_; }
+    [[nodiscard]] const Node & operator[]( NodeId nid ) const { return nodes_[nid]; }
+    [[nodiscard]] static NodeId rootNodeId() { return NodeId{ 0 }; }
+    /// returns the bounding box of all points
+    [[nodiscard]] Box3f getBoundingBox() const { return nodes_.empty() ? Box3f{} : nodes_[rootNodeId()].box; }
+
+    /// returns decompressed points of given leaf, loading them in the cache if necessary, or nullptr if the chunk is damaged in the file;
+    /// can be called from parallel threads, the returned chunk stays valid even after eviction from the cache
+    [[nodiscard]] MRMESH_API std::shared_ptr<const Chunk> getChunk( NodeId leaf ) const;
+    /// returns the leaf containing given point
+    [[nodiscard]] MRMESH_API NodeId findLeaf( VertId v ) const;
+    /// returns the coordinates of given point
+    [[nodiscard]] MRMESH_API Expected<Vector3f> point( VertId v ) const;
+
+    /// decompresses all chunks (without putting them in the cache) to check that none of them is damaged
+    MRMESH_API VoidOrErrStr validate( const ProgressCallback & progress = {} ) const;
+
+    /// the number of chunks decompressed so far (including repeated decompression after eviction)
+    [[nodiscard]] MRMESH_API size_t numChunkLoads() const;
+    /// the number of failed decompressions of damaged chunks so far
+    [[nodiscard]] MRMESH_API size_t numDamagedChunkLoads() const;
+    /// the size of decompressed chunks now in the cache
+    [[nodiscard]] MRMESH_API size_t cachedBytes() const;
+
+private:
+    PointChunkStore() = default;
+
+    MappedFile file_;
+    NodeVec nodes_;
+    std::vector<NodeId> leaves_; // in the order of increasing point ids
+    size_t numPoints_ = 0;
+    size_t maxCacheBytes_ = 0;
+
+    struct CacheEntry
+    {
+        std::shared_ptr<const Chunk> chunk;
+        std::list<NodeId>::iterator lruPos;
+    };
+    mutable std::mutex mutex_;
+    mutable std::list<NodeId> lru_; // most recently used leaves first
+    mutable HashMap<NodeId, CacheEntry> cache_;
+    mutable size_t cachedBytes_ = 0;
+    mutable size_t numChunkLoads_ = 0;
+    mutable size_t numDamagedChunkLoads_ = 0;
+};
+
+/// \}
+
+} //namespace MR
@@ -1,5 +1,6 @@
 #include "MRPointCloud.h"
 #include "MRAABBTreePoints.h"
+#include "MRNeighborGraph.h"
 #include "MRComputeBoundingBox.h"
 #include "MRPlane3.h"
 #include "MRBitSetParallelFor.h"
@@ -117,12 +118,21 @@ const AABBTreePoints& PointCloud::getAABBTree() const
     return AABBTreeOwner_.getOrCreate( [this]{ return AABBTreePoints( *this ); } );
 }
 
+const NeighborGraph& PointCloud::getNeighborGraph( const NeighborGraphSettings & settings ) const
+{
+    if ( auto graph = neighborGraphOwner_.get(); graph && graph->settings != settings )
+        neighborGraphOwner_.reset();
+    getAABBTree(); // build the tree here and not inside the construction of the graph, which is waited by other threads
+    return neighborGraphOwner_.getOrCreate( [this, &settings]{ return *buildNeighborGraph( *this, settings ); } );
+}
+
 size_t PointCloud::heapBytes() const
 {
     return points.heapBytes()
         + normals.heapBytes()
         + validPoints.heapBytes()
-        + AABBTreeOwner_.heapBytes();
+        + AABBTreeOwner_.heapBytes()
+        + neighborGraphOwner_.heapBytes();
 }
 
 void PointCloud::mirror( const Plane3f& plane )
@@ -259,6 +269,7 @@ VertBMap PointCloud::pack( Reorder reoder )
     {
         getAABBTree(); // ensure that tree is constructed
         AABBTreeOwner_.get()->getLeafOrderAndReset( map );
+        neighborGraphOwner_.reset();
         if ( !wasPacked )
         {
             ParallelFor( 0_v, map.b.endId(), [&]( VertId v )
@@ -42,6 +42,13 @@ struct PointCloud
     /// returns cached aabb-tree for this point cloud, but does not create it if it did not exist
     [[nodiscard]] const AABBTreePoints * getAABBTreeNotCreate() const { return AABBTreeOwner_.get(); }
 
+    /// returns cached neighbor graph of this point cloud, creating it if it did not exist or was built with other settings;
+    /// the creation is thread-safe only if all simultaneous calls have the same settings
+    MRMESH_API const NeighborGraph& getNeighborGraph( const NeighborGraphSettings & settings ) const;
+
+    /// returns cached neighbor graph of this point cloud, but does not create it if it did not exist
+    [[nodiscard]] const NeighborGraph * getNeighborGraphNotCreate() const { return neighborGraphOwner_.get(); }
+
     /// returns the minimal bounding box containing all valid vertices (implemented via getAABBTree())
     [[nodiscard]] MRMESH_API Box3f getBoundingBox() const;
 
@@ -85,14 +92,15 @@ struct PointCloud
     /// \return points mapping: old -> new
     MRMESH_API VertBMap pack( Reorder reoder );
 
-    /// Invalidates caches (e.g. aabb-tree) after a change in point cloud
-    void invalidateCaches() { AABBTreeOwner_.reset(); }
+    /// Invalidates caches (e.g. aabb-tree and neighbor graph) after a change in point cloud
+    void invalidateCaches() { AABBTreeOwner_.reset(); neighborGraphOwner_.reset(); }
 
     /// returns the amount of memory this object occupies on heap
     [[nodiscard]] MRMESH_API size_t heapBytes() const;
 
 private:
     mutable UniqueThreadSafeOwner<AABBTreePoints> AABBTreeOwner_;
+    mutable UniqueThreadSafeOwner<NeighborGraph> neighborGraphOwner_;
 };
 
 } // namespace MR
@@ -13,7 +13,16 @@
 #include "MRHeap.h"
 #include "MRBuffer.h"
 #include "MRLocalTriangulations.h"
+#include "MRNeighborGraph.h"
+#include "MRAABBTreePoints.h"
+#include "MRParallelFor.h"
+#include "MRUnionFind.h"
+#include "MRBitSet.h"
+#include "MRMakeSphereMesh.h"
+#include "MRGTest.h"
+#include <tbb/parallel_sort.h>
 #include <cfloat>
+#include <deque>
 
 namespace MR
 {
@@ -21,6 +30,8 @@ namespace MR
 std::optional<VertNormals> makeUnorientedNormals( const PointCloud& pointCloud, float radius, const ProgressCallback & progress )
 {
     MR_TIMER
+    if ( auto graph = findCachedNeighborGraph( pointCloud, radius ) )
+        return makeUnorientedNormals( pointCloud, *graph, progress );
 
     VertNormals normals;
     normals.resizeNoInit( pointCloud.points.size() );
@@ -75,6 +86,25 @@ std::optional<VertNormals> makeUnorientedNormals( const PointCloud& pointCloud,
     return normals;
 }
 
+std::optional<VertNormals> makeUnorientedNormals( const PointCloud& pointCloud, const NeighborGraph& graph, const ProgressCallback & progress )
+{
+    MR_TIMER
+
+    VertNormals normals;
+    normals.resizeNoInit( pointCloud.points.size() );
+    if ( !BitSetParallelFor( pointCloud.validPoints, [&]( VertId vid )
+    {
+        PointAccumulator accum;
+        accum.addPoint( Vector3d( pointCloud.points[vid] ) );
+        for ( auto u : graph.get( vid ) )
+            accum.addPoint( Vector3d( pointCloud.points[u] ) );
+        normals[vid] = Vector3f( accum.getBestPlane().n );
+    }, progress ) )
+        return {};
+
+    return normals;
+}
+
 template<class T>
 bool orientNormalsCore( const PointCloud& pointCloud, VertNormals& normals, const T & enumNeis, ProgressCallback progress )
 {
@@ -162,8 +192,256 @@ bool orientNormalsCore( const PointCloud& pointCloud, VertNormals& normals, cons
     return true;
 }
 
+namespace
+{
+
+/// connection between two patches with summed agreement of normals of neighbor points:
+/// positive vote means that the patches are oriented consistently, negative - that one of them shall be flipped
+struct PatchEdge
+{
+    GraphVertId a, b; // a < b
+    double vote = 0;
+};
+
+// sorts the edges by patches and merges the edges between the same patches
+void mergePatchEdges( std::vector<PatchEdge> & edges )
+{
+    std::sort( edges.begin(), edges.end(), []( const PatchEdge & x, const PatchEdge & y )
+        { return std::tie( x.a, x.b ) < std::tie( y.a, y.b ); } );
+    size_t n = 0;
+    for ( size_t i = 0; i < edges.size(); ++i )
+    {
+        if ( n > 0 && edges[n-1].a == edges[i].a && edges[n-1].b == edges[i].b )
+            edges[n-1].vote += edges[i].vote;
+        else
+            edges[n++] = edges[i];
+    }
+    edges.resize( n );
+}
+
+} //anonymous namespace
+
+template<class T>
+bool orientNormalsByPatchesCore( const PointCloud& pointCloud, VertNormals& normals, const T & enumNeis, ProgressCallback progress )
+{
+    MR_TIMER
+
+    // consecutive points in the tree order are spatially close, so the blocks of them are compact
+    const auto & orderedPoints = pointCloud.getAABBTree().orderedPoints();
+    if ( !reportProgress( progress, 0.05f ) )
+        return false;
+
+    const auto bbox = pointCloud.computeBoundingBox();
+    const auto center = bbox.center();
+    const auto maxDistSqToCenter = bbox.size().lengthSq() / 4;
+
+    constexpr int BlockSize = 4096;
+    const int numPoints = (int)orderedPoints.size();
+    const int numBlocks = ( numPoints + BlockSize - 1 ) / BlockSize;
+
+    // position of each point in orderedPoints: the block of the point is orderPos / BlockSize
+    Buffer<int, VertId> orderPos( normals.size() );
+    ParallelFor( 0, numPoints, [&]( int i )
+    {
+        orderPos[orderedPoints[i].id] = i;
+    } );
+
+    auto enweight = [&]( VertId base, VertId candidate )
+    {
+        // give positive weight to neighbours, with larger value to close points with close normal directions
+        const Vector3f cb = pointCloud.points[base] - pointCloud.points[candidate];
+        const auto d = 0.01f * cb.lengthSq() + sqr( dot( cb, normals[base] ) ) + sqr( dot( cb, normals[candidate] ) );
+        return d > 0 ? 1 / d : FLT_MAX;
+    };
+
+    struct Block
+    {
+        /// squared distance to the center of the first point (the furthest one) of each patch in the block
+        std::vector<float> patchSeedDistSq;
+        /// pairs of neighbor points: (point from this block, point from another block)
+        std::vector<std::pair<VertId, VertId>> crossPairs;
+        GraphVertId firstPatch;
+        std::vector<PatchEdge> edges;
+    };
+    std::vector<Block> blocks( numBlocks );
+    // local patch index inside its block, later converted in global patch id
+    Vector<GraphVertId, VertId> patchOf;
+    patchOf.resizeNoInit( normals.size() );
+
+    // orient each block independently with the same propagation as in orientNormalsCore;
+    // a block can consist of several patches if it is not connected via own points
+    constexpr auto InvalidWeight = -FLT_MAX;
+    using HeapT = Heap<float, VertId>;
+    if ( !ParallelFor( 0, numBlocks, [&]( int b )
+    {
+        auto & block = blocks[b];
+        const int begin = b * BlockSize;
+        const int size = std::min( numPoints, begin + BlockSize ) - begin;
+        auto globalId = [&]( VertId lv ) { return orderedPoints[begin + (int)lv].id; };
+
+        std::vector<HeapT::Element> elements;
+        elements.reserve( size );
+        for ( VertId lv( 0 ); lv < size; ++lv )
+        {
+            const auto v = globalId( lv );
+            const auto dcenter = pointCloud.points[v] - center;
+            // larger weight (smaller by magnitude) for points further from the center
+            elements.push_back( { lv, std::min( 0.0f, dcenter.lengthSq() - maxDistSqToCenter ) } );
+            // initially orient points' normals' outside of the center
+            if ( dot( normals[v], dcenter ) < 0 )
+                normals[v] = -normals[v];
+        }
+        HeapT heap( std::move( elements ) );
+        VertBitSet visited( size );
+
+        for (;;)
+        {
+            auto [lbase, weight] = heap.top();
+            if ( weight == InvalidWeight )
+                break;
+            heap.setSmallerValue( lbase, InvalidWeight );
+            visited.set( lbase );
+            const auto base = globalId( lbase );
+            // the weights of points reached from visited neighbours are positive, so nonpositive weight starts new patch
+            if ( weight <= 0 )
+                block.patchSeedDistSq.push_back( weight + maxDistSqToCenter );
+            patchOf[base] = GraphVertId( block.patchSeedDistSq.size() - 1 );
+
+            enumNeis( base, [&]( VertId v )
+            {
+                assert ( v != base );
+                const int li = orderPos[v] - begin;
+                if ( li < 0 || li >= size )
+                {
+                    block.crossPairs.emplace_back( base, v );
+                    return;
+                }
+                const VertId lv( li );
+                if ( visited.test( lv ) )
+                    return;
+                float weight = enweight( base, v );
+                if ( weight > heap.value( lv ) )
+                {
+                    heap.setLargerValue( lv, weight );
+                    if ( dot( normals[base], normals[v] ) < 0 )
+                        normals[v] = -normals[v];
+                }
+            } );
+        }
+    }, subprogress( progress, 0.05f, 0.7f ), 1 ) )
+        return false;
+
+    // give global ids to all patches
+    int numPatches = 0;
+    for ( auto & block : blocks )
+    {
+        block.firstPatch = GraphVertId( numPatches );
+        numPatches += (int)block.patchSeedDistSq.size();
+    }
+    Vector<float, GraphVertId> patchSeedDistSq;
+    patchSeedDistSq.reserve( numPatches );
+    for ( const auto & block : blocks )
+        patchSeedDistSq.vec_.insert( patchSeedDistSq.vec_.end(), block.patchSeedDistSq.begin(), block.patchSeedDistSq.end() );
+
+    ParallelFor( 0, numBlocks, [&]( int b )
+    {
+        const auto & block = blocks[b];
+        const int begin = b * BlockSize;
+        const int end = std::min( numPoints, begin + BlockSize );
+        for ( int i = begin; i < end; ++i )
+        {
+            auto & p = patchOf[orderedPoints[i].id];
+            p = block.firstPatch + (int)p;
+        }
+    } );
+    if ( !reportProgress( progress, 0.75f ) )
+        return false;
+
+    // accumulate the agreement of the normals of neighbor points from different patches
+    ParallelFor( 0, numBlocks, [&]( int b )
+    {
+        auto & block = blocks[b];
+        block.edges.reserve( block.crossPairs.size() );
+        for ( auto [u, v] : block.crossPairs )
+        {
+            auto pu = patchOf[u];
+            auto pv = patchOf[v];
+            if ( pu > pv )
+                std::swap( pu, pv );
+            const double w = enweight( u, v );
+            block.edges.push_back( { pu, pv, dot( normals[u], normals[v] ) >= 0 ? w : -w } );
+        }
+        block.crossPairs = {};
+        mergePatchEdges( block.edges );
+    } );
+
+    std::vector<PatchEdge> edges;
+    for ( auto & block : blocks )
+    {
+        edges.insert( edges.end(), block.edges.begin(), block.edges.end() );
+        block.edges = {};
+    }
+    mergePatchEdges( edges );
+    if ( !reportProgress( progress, 0.8f ) )
+        return false;
+
+    // find maximum spanning forest of the patch graph, most confident connections first
+    tbb::parallel_sort( edges.begin(), edges.end(), []( const PatchEdge & x, const PatchEdge & y )
+        { return std::abs( x.vote ) > std::abs( y.vote ); } );
+    UnionFind<GraphVertId> unionFind( numPatches );
+    Vector<std::vector<std::pair<GraphVertId, bool>>, GraphVertId> treeNeis( numPatches );
+    for ( const auto & e : edges )
+    {
+        if ( !unionFind.unite( e.a, e.b ).second )
+            continue;
+        const bool flip = e.vote < 0;
+        treeNeis[e.a].emplace_back( e.b, flip );
+        treeNeis[e.b].emplace_back( e.a, flip );
+    }
+
+    // propagate flips along the forest starting in each tree from the patch with the furthest from the center point,
+    // which keeps its initial outside orientation
+    std::vector<GraphVertId> patchOrder;
+    patchOrder.reserve( numPatches );
+    for ( GraphVertId p( 0 ); p < numPatches; ++p )
+        patchOrder.push_back( p );
+    std::sort( patchOrder.begin(), patchOrder.end(), [&]( GraphVertId x, GraphVertId y )
+        { return patchSeedDistSq[x] > patchSeedDistSq[y]; } );
+
+    GraphVertBitSet visited( numPatches ), flipped( numPatches );
+    std::deque<GraphVertId> queue;
+    for ( auto root : patchOrder )
+    {
+        if ( visited.test_set( root ) )
+            continue;
+        queue.push_back( root );
+        while ( !queue.empty() )
+        {
+            const auto p = queue.front();
+            queue.pop_front();
+            for ( auto [q, flip] : treeNeis[p] )
+            {
+                if ( visited.test_set( q ) )
+                    continue;
+                flipped.set( q, flipped.test( p ) != flip );
+                queue.push_back( q );
+            }
+        }
+    }
+    if ( !reportProgress( progress, 0.9f ) )
+        return false;
+
+    return BitSetParallelFor( pointCloud.validPoints, [&]( VertId v )
+    {
+        if ( flipped.test( patchOf[v] ) )
+            normals[v] = -normals[v];
+    }, subprogress( progress, 0.9f, 1.0f ) );
+}
+
 bool orientNormals( const PointCloud& pointCloud, VertNormals& normals, float radius, const ProgressCallback & progress )
 {
+    if ( auto graph = findCachedNeighborGraph( pointCloud, radius ) )
+        return orientNormals( pointCloud, normals, *graph, progress );
     return orientNormalsCore( pointCloud, normals,
         [&]( VertId base, auto callback )
         {
@@ -190,6 +468,43 @@ bool orientNormals( const PointCloud& pointCloud, VertNormals& normals, const Bu
         }, progress );
 }
 
+bool orientNormals( const PointCloud& pointCloud, VertNormals& normals, const NeighborGraph& graph, const ProgressCallback & progress )
+{
+    return orientNormalsCore( pointCloud, normals,
+        [&graph]( VertId base, auto callback )
+        {
+            for ( auto v : graph.get( base ) )
+                callback( v );
+        }, progress );
+}
+
+bool orientNormalsByPatches( const PointCloud& pointCloud, VertNormals& normals, float radius, const ProgressCallback & progress )
+{
+    if ( auto graph = findCachedNeighborGraph( pointCloud, radius ) )
+        return orientNormalsByPatches( pointCloud, normals, *graph, progress );
+    return orientNormalsByPatchesCore( pointCloud, normals,
+        [&]( VertId base, auto callback )
+        {
+            findPointsInBall( pointCloud, pointCloud.points[base], radius,
+                [&]( VertId v, const Vector3f& )
+                {
+                    if ( v == base )
+                        return;
+                    callback( v );
+                } );
+        }, progress );
+}
+
+bool orientNormalsByPatches( const PointCloud& pointCloud, VertNormals& normals, const NeighborGraph& graph, const ProgressCallback & progress )
+{
+    return orientNormalsByPatchesCore( pointCloud, normals,
+        [&graph]( VertId base, auto callback )
+        {
+            for ( auto v : graph.get( base ) )
+                callback( v );
+        }, progress );
+}
+
 bool orientNormals( const PointCloud& pointCloud, VertNormals& normals, const AllLocalTriangulations& triangs,
      const ProgressCallback & progress )
 {
@@ -236,4 +551,31 @@ VertNormals makeNormals( const PointCloud& pointCloud, int avgNeighborhoodSize )
     return *makeOrientedNormals( pointCloud, findAvgPointsRadius( pointCloud, avgNeighborhoodSize ) );
 }
 
+TEST( MRMesh, OrientNormalsByPatches )
+{
+    PointCloud cloud;
+    cloud.points = makeSphere( { .numMeshVertices = 30000 } ).points;
+    cloud.validPoints.resize( cloud.points.size(), true );
+    const auto radius = findAvgPointsRadius( cloud, 24 );
+
+    auto normals = makeUnorientedNormals( cloud, radius );
+    ASSERT_TRUE( normals.has_value() );
+    // spoil the orientation of some normals
+    for ( auto v : cloud.validPoints )
+        if ( v % 3 == 0 )
+            (*normals)[v] = -(*normals)[v];
+
+    EXPECT_TRUE( orientNormalsByPatches( cloud, *normals, radius ) );
+    for ( auto v : cloud.validPoints )
+        EXPECT_GT( dot( (*normals)[v], cloud.points[v] ), 0 );
+
+    // the same result with the cached neighbor graph
+    cloud.getNeighborGraph( { .radius = radius } );
+    for ( auto v : cloud.validPoints )
+        (*normals)[v] = ( v % 2 == 0 ) ? -(*normals)[v] : (*normals)[v];
+    EXPECT_TRUE( orientNormalsByPatches( cloud, *normals, radius ) );
+    for ( auto v : cloud.validPoints )
+        EXPECT_GT( dot( (*normals)[v], cloud.points[v] ), 0 );
+}
+
 } //namespace MR
@@ -7,7 +7,7 @@ namespace MR
 {
 
 /// \brief Makes normals for valid points of given point cloud by directing them along the normal (in one of two sides arbitrary) of best plane through the neighbours
-/// \param radius of neighborhood to consider
+/// \param radius of neighborhood to consider, the neighbor graph cached in the cloud for this radius is used if any
 /// \return nullopt if progress returned false
 /// \ingroup PointCloudGroup
 [[nodiscard]] MRMESH_API std::optional<VertNormals> makeUnorientedNormals( const PointCloud& pointCloud,
@@ -27,8 +27,15 @@ namespace MR
 [[nodiscard]] MRMESH_API std::optional<VertNormals> makeUnorientedNormals( const PointCloud& pointCloud,
     const Buffer<VertId> & closeVerts, int numNei, const ProgressCallback & progress = {} );
 
+/// \brief Makes normals for valid points of given point cloud by directing them along the normal (in one of two sides arbitrary) of best plane through the neighbours
+/// \param graph precomputed neighbours of each point, e.g. from PointCloud::getNeighborGraph
+/// \return nullopt if progress returned false
+/// \ingroup PointCloudGroup
+[[nodiscard]] MRMESH_API std::optional<VertNormals> makeUnorientedNormals( const PointCloud& pointCloud,
+    const NeighborGraph& graph, const ProgressCallback & progress = {} );
+
 /// \brief Select orientation of given normals to make directions of close points consistent;
-/// \param radius of neighborhood to consider
+/// \param radius of neighborhood to consider, the neighbor graph cached in the cloud for this radius is used if any
 /// \return false if progress returned false
 /// \ingroup PointCloudGroup
 MRMESH_API bool orientNormals( const PointCloud& pointCloud, VertNormals& normals, float radius,
@@ -51,6 +58,30 @@ MRMESH_API bool orientNormals( const PointCloud& pointCloud, VertNormals& normal
 MRMESH_API bool orientNormals( const PointCloud& pointCloud, VertNormals& normals, const Buffer<VertId> & closeVerts, int numNei,
     const ProgressCallback & progress = {} );
 
+/// \brief Select orientation of given normals to make directions of close points consistent;
+/// \param graph precomputed neighbours of each point, e.g. from PointCloud::getNeighborGraph
+/// \return false if progress returned false
+/// \ingroup PointCloudGroup
+MRMESH_API bool orientNormals( const PointCloud& pointCloud, VertNormals& normals, const NeighborGraph& graph,
+    const ProgressCallback & progress = {} );
+
+/// \brief Select orientation of given normals to make directions of close points consistent, processing the cloud in parallel threads:
+/// spatially compact blocks of points are oriented independently by the same propagation as in orientNormals,
+/// and then the flips of the obtained patches are resolved along maximum spanning forest of the small graph of patch connections;
+/// recommended for large clouds, where single-threaded orientNormals takes most of the time
+/// \param radius of neighborhood to consider, the neighbor graph cached in the cloud for this radius is used if any
+/// \return false if progress returned false
+/// \ingroup PointCloudGroup
+MRMESH_API bool orientNormalsByPatches( const PointCloud& pointCloud, VertNormals& normals, float radius,
+    const ProgressCallback & progress = {} );
+
+/// \brief Select orientation of given normals to make directions of close points consistent, processing the cloud in parallel threads;
+/// \param graph precomputed neighbours of each point, e.g. from PointCloud::getNeighborGraph
+/// \return false if progress returned false
+/// \ingroup PointCloudGroup
+MRMESH_API bool orientNormalsByPatches( const PointCloud& pointCloud, VertNormals& normals, const NeighborGraph& graph,
+    const ProgressCallback & progress = {} );
+
 /// \brief Makes normals for valid points of given point cloud; directions of close points are selected to be consistent;
 /// \param radius of neighborhood to consider
 /// \return nullopt if progress returned false
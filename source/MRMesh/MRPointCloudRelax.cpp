@@ -3,14 +3,41 @@
 #include "MRTimer.h"
 #include "MRBitSetParallelFor.h"
 #include "MRPointsInBall.h"
+#include "MRNeighborGraph.h"
 #include "MRBox.h"
 #include "MRBestFit.h"
 #include "MRBestFitQuadric.h"
 #include "MRVector4.h"
+#include <optional>
 
 namespace MR
 {
 
+/// calls given callback for each point in the ball around point v (including v itself),
+/// taking the points from neighbor graph if it is given
+template<typename F>
+static void forEachNeighbor( const PointCloud& pointCloud, const NeighborGraph* graph, VertId v, float radius, F&& callback )
+{
+    if ( !graph )
+    {
+        findPointsInBall( pointCloud, pointCloud.points[v], radius, callback );
+        return;
+    }
+    callback( v, pointCloud.points[v] );
+    for ( auto u : graph->get( v ) )
+        callback( u, pointCloud.points[u] );
+}
+
+/// returns the graph given in parameters; if it is owned by the cloud then copies it in \param copy,
+/// since the caches of the cloud are invalidated after each iteration
+static const NeighborGraph* getOwnNeighbors( const PointCloud& pointCloud, const NeighborGraph* graph, std::optional<NeighborGraph>& copy )
+{
+    if ( !graph || graph != pointCloud.getNeighborGraphNotCreate() )
+        return graph;
+    copy = *graph;
+    return &*copy;
+}
+
 bool relax( PointCloud& pointCloud, const PointCloudRelaxParams& params /*= {} */, ProgressCallback cb )
 {
     if ( params.iterations <= 0 )
@@ -28,6 +55,8 @@ bool relax( PointCloud& pointCloud, const PointCloudRelaxParams& params /*= {} *
         return true;
     float radius = params.neighborhoodRadius > 0.0f ? params.neighborhoodRadius :
         pointCloud.getBoundingBox().diagonal() * 0.1f;
+    std::optional<NeighborGraph> neighborsCopy;
+    const auto neighbors = getOwnNeighbors( pointCloud, params.neighbors, neighborsCopy );
 
     bool keepGoing = true;
     for ( int i = 0; i < params.iterations; ++i )
@@ -41,11 +70,12 @@ bool relax( PointCloud& pointCloud, const PointCloudRelaxParams& params /*= {} *
             };
         }
         newPoints = pointCloud.points;
+        const auto graph = neighbors ? neighbors : findCachedNeighborGraph( pointCloud, radius );
         keepGoing = BitSetParallelFor( zone, [&] ( VertId v )
         {
             Vector3d sumPos;
             int count = 0;
-            findPointsInBall( pointCloud, pointCloud.points[v], radius,
+            forEachNeighbor( pointCloud, graph, v, radius,
                 [&] ( VertId newV, const Vector3f& position )
             {
                 if ( newV != v )
@@ -88,6 +118,8 @@ bool relaxKeepVolume( PointCloud& pointCloud, const PointCloudRelaxParams& param
         return true;
     float radius = params.neighborhoodRadius > 0.0f ? params.neighborhoodRadius :
         pointCloud.getBoundingBox().diagonal() * 0.1f;
+    std::optional<NeighborGraph> neighborsCopy;
+    const auto neighbors = getOwnNeighbors( pointCloud, params.neighbors, neighborsCopy );
 
     std::vector<Vector3f> vertPushForces( zone.size() );
 
@@ -107,11 +139,12 @@ bool relaxKeepVolume( PointCloud& pointCloud, const PointCloudRelaxParams& param
             };
         }
         newPoints = pointCloud.points;
+        const auto graph = neighbors ? neighbors : findCachedNeighborGraph( pointCloud, radius );
         keepGoing = BitSetParallelFor( zone, [&] ( VertId v )
         {
             Vector3d sumPos;
             int count = 0;
-            findPointsInBall( pointCloud, pointCloud.points[v], radius,
+            forEachNeighbor( pointCloud, graph, v, radius,
                 [&] ( VertId nv, const Vector3f& position )
             {
                 if ( nv != v && zone.test( nv ) )
@@ -130,7 +163,7 @@ bool relaxKeepVolume( PointCloud& pointCloud, const PointCloudRelaxParams& param
         {
             Vector3d sumForces;
             int count = 0;
-            findPointsInBall( pointCloud, pointCloud.points[v], radius,
+            forEachNeighbor( pointCloud, graph, v, radius,
                 [&] ( VertId nv, const Vector3f& )
             {
                 if ( nv != v && zone.test( nv ) )
@@ -172,6 +205,8 @@ bool relaxApprox( PointCloud& pointCloud, const PointCloudApproxRelaxParams& par
         return true;
     float radius = params.neighborhoodRadius > 0.0f ? params.neighborhoodRadius :
         pointCloud.getBoundingBox().diagonal() * 0.1f;
+    std::optional<NeighborGraph> neighborsCopy;
+    const auto neighbors = getOwnNeighbors( pointCloud, params.neighbors, neighborsCopy );
 
     bool hasNormals = pointCloud.normals.size() > size_t( pointCloud.validPoints.find_last() );
     bool keepGoing = true;
@@ -186,12 +221,13 @@ bool relaxApprox( PointCloud& pointCloud, const PointCloudApproxRelaxParams& par
             };
         }
         newPoints = pointCloud.points;
+        const auto graph = neighbors ? neighbors : findCachedNeighborGraph( pointCloud, radius );
         keepGoing = BitSetParallelFor( zone, [&] ( VertId v )
         {
             PointAccumulator accum;
             std::vector<std::pair<VertId, double>> weightedNeighbors;
 
-            findPointsInBall( pointCloud, pointCloud.points[v], radius,
+            forEachNeighbor( pointCloud, graph, v, radius,
                 [&] ( VertId newV, const Vector3f& position )
             {
                 double w = 1.0;
@@ -14,6 +14,12 @@ struct PointCloudRelaxParams : RelaxParams
     /// radius to find neighbors in,
     /// 0.0 - default, 0.1*boundibg box diagonal
     float neighborhoodRadius{ 0.0f };
+    /// if not nullptr then the neighbors of each point are taken from this graph (found once for initial positions)
+    /// instead of searching them in the ball of neighborhoodRadius around current positions on each iteration;
+    /// if nullptr then the graph cached in the cloud is used on first iteration if it was built for the same radius;
+    /// the graph cached in the relaxed cloud (e.g. from PointCloud::getNeighborGraph) is copied before first iteration,
+    /// because the caches of the cloud are invalidated after each iteration
+    const NeighborGraph* neighbors = nullptr;
 };
 
 /// applies given number of relaxation iterations to the whole pointCloud ( or some region if it is specified )
@@ -2,6 +2,7 @@
 #include "MRPointCloud.h"
 #include "MRMesh.h"
 #include "MRAABBTreePoints.h"
+#include "MRPointChunkStore.h"
 
 namespace MR
 {
@@ -68,4 +69,58 @@ void findPointsInBall( const AABBTreePoints& tree, const Vector3f& center, float
     }
 }
 
+void findPointsInBall( const PointChunkStore& store, const Vector3f& center, float radius,
+    const FoundPointCallback& foundCallback, const AffineXf3f* xf )
+{
+    if ( !foundCallback )
+    {
+        assert( false );
+        return;
+    }
+
+    if ( store.nodes().empty() )
+        return;
+
+    const float radiusSq = sqr( radius );
+
+    constexpr int MaxStackSize = 256; // octree nodes have up to 8 children
+    PointChunkStore::NodeId subtasks[MaxStackSize];
+    int stackSize = 0;
+
+    auto addSubTask = [&]( PointChunkStore::NodeId n )
+    {
+        float distSq = ( transformed( store[n].box, xf ).getBoxClosestPointTo( center ) - center ).lengthSq();
+        if ( distSq <= radiusSq )
+        {
+            assert( stackSize < MaxStackSize );
+            subtasks[stackSize++] = n;
+        }
+    };
+
+    addSubTask( store.rootNodeId() );
+
+    while ( stackSize > 0 )
+    {
+        const auto n = subtasks[--stackSize];
+        const auto& node = store[n];
+
+        if ( node.leaf() )
+        {
+            const auto chunk = store.getChunk( n );
+            if ( !chunk ) // damaged chunk
+                continue;
+            for ( int i = 0; i < (int)chunk->points.size(); ++i )
+            {
+                auto coord = xf ? ( *xf )( chunk->points[i] ) : chunk->points[i];
+                if ( ( coord - center ).lengthSq() <= radiusSq )
+                    foundCallback( chunk->firstPoint + i, coord );
+            }
+            continue;
+        }
+
+        for ( int i = node.numChildren - 1; i >= 0; --i )
+            addSubTask( node.firstChild + i );
+    }
+}
+
 } //namespace MR
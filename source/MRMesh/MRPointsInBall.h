@@ -26,4 +26,11 @@ MRMESH_API void findPointsInBall( const Mesh& mesh, const Vector3f& center, floa
 MRMESH_API void findPointsInBall( const AABBTreePoints& tree, const Vector3f& center, float radius, 
     const FoundPointCallback& foundCallback, const AffineXf3f* xf = nullptr );
 
+/// Finds all points of out-of-core store that are inside or on the surface of given ball (center, radius),
+/// loading only the chunks intersecting the ball
+/// \ingroup AABBTreeGroup
+/// \param xf points-to-center transformation, if not specified then identity transformation is assumed
+MRMESH_API void findPointsInBall( const PointChunkStore& store, const Vector3f& center, float radius,
+    const FoundPointCallback& foundCallback, const AffineXf3f* xf = nullptr );
+
 }
\ No newline at end of file
@@ -5,13 +5,20 @@
 #include "MRPointCloud.h"
 #include "MRStringConvert.h"
 #include "MRQuaternion.h"
+#include "MRParallelFor.h"
 #include "MRTimer.h"
+#include "MRSerializer.h"
+#include "MRGTest.h"
 #include <MRPch/MRFmt.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #pragma warning(push)
 #pragma warning(disable: 4251) // class needs to have dll-interface to be used by clients of another class
 #pragma warning(disable: 4275) // vcpkg `2022.11.14`: non dll-interface class 'std::exception' used as base for dll-interface class 'e57::E57Exception'
 #include <E57Format/E57SimpleReader.h>
+#include <E57Format/E57SimpleWriter.h>
 #if !__has_include(<E57Format/E57Version.h>)
 #define  MR_OLD_E57
 #endif
@@ -24,6 +31,130 @@ namespace MR
 namespace PointsLoad
 {
 
+namespace
+{
+
+/// the information about one scan from its header, and where its points shall be put
+struct ScanInfo
+{
+    std::string name;
+    AffineXf3d e57Xf; // the pose of the scan
+    Box3d box; // the bounds of the points in scan's coordinates
+    int64_t numPoints = 0;
+    bool hasColorFields = false;
+    std::optional<AffineXf3d> aXf; // will be applied to all points
+    size_t firstPoint = 0; // the index of the first point of this scan in the output cloud
+    bool hasInputColors = false;
+};
+
+/// the constructor and destructor of e57::Reader initialize and terminate Xerces, which is not thread-safe
+std::mutex sReaderMutex;
+
+struct LockedReaderDeleter
+{
+    void operator()( e57::Reader * reader ) const
+    {
+        std::lock_guard lock( sReaderMutex );
+        delete reader;
+    }
+};
+using ReaderPtr = std::unique_ptr<e57::Reader, LockedReaderDeleter>;
+
+ReaderPtr openReader( const std::filesystem::path& file )
+{
+    std::lock_guard lock( sReaderMutex );
+#ifdef MR_OLD_E57
+    return ReaderPtr( new e57::Reader( utf8string( file ) ) );
+#else
+    return ReaderPtr( new e57::Reader( utf8string( file ), e57::ReaderOptions{} ) );
+#endif
+}
+
+Vector3d readFirstPoint( e57::Reader & eReader, int scanIndex )
+{
+#ifdef MR_OLD_E57
+    e57::Data3DPointsData_d buffers;
+#else
+    e57::Data3DPointsDouble buffers;
+#endif
+    double x = 0, y = 0, z = 0;
+    buffers.cartesianX = &x;
+    buffers.cartesianY = &y;
+    buffers.cartesianZ = &z;
+    e57::CompressedVectorReader dataReader = eReader.SetUpData3DPointsData( scanIndex, 1, buffers );
+    dataReader.read();
+    dataReader.close();
+    return { x, y, z };
+}
+
+/// decodes all points of the scan, transforms them by scan.aXf and writes in given arrays starting from scan.firstPoint;
+/// returns error if progress returned false or the scan has less points than declared in its header
+VoidOrErrStr decodeScan( e57::Reader & eReader, int scanIndex, ScanInfo & scan, VertCoords & points, VertColors * colors,
+    const ProgressCallback & progress )
+{
+    // how many points to read in a time
+    const int64_t nSize = std::min( scan.numPoints, int64_t( 1024 ) * 128 );
+
+#ifdef MR_OLD_E57
+    e57::Data3DPointsData_d buffers;
+#else
+    e57::Data3DPointsDouble buffers;
+#endif
+    std::vector<double> xs( nSize ), ys( nSize ), zs( nSize );
+    buffers.cartesianX = xs.data();
+    buffers.cartesianY = ys.data();
+    buffers.cartesianZ = zs.data();
+#ifdef MR_OLD_E57
+    std::vector<uint8_t> rs, gs, bs;
+#else
+    std::vector<uint16_t> rs, gs, bs;
+#endif
+    std::vector<int8_t> invalidColors;
+    if ( colors )
+    {
+        rs.resize( nSize );
+        gs.resize( nSize );
+        bs.resize( nSize );
+        buffers.colorRed = rs.data();
+        buffers.colorGreen = gs.data();
+        buffers.colorBlue = bs.data();
+        invalidColors.resize( nSize );
+        buffers.isColorInvalid = invalidColors.data();
+    }
+
+    e57::CompressedVectorReader dataReader = eReader.SetUpData3DPointsData( scanIndex, nSize, buffers );
+
+    const auto xf = scan.aXf.value_or( AffineXf3d() );
+    size_t n = scan.firstPoint;
+    const size_t nEnd = scan.firstPoint + scan.numPoints;
+    unsigned long size = 0;
+    while ( ( size = dataReader.read() ) > 0 )
+    {
+        if ( n == scan.firstPoint )
+            scan.hasInputColors = colors && invalidColors.front() == 0;
+        size = (unsigned long)std::min( size_t( size ), nEnd - n );
+        for ( unsigned long i = 0; i < size; ++i, ++n )
+        {
+            const VertId v( n );
+            points[v] = Vector3f( xf( Vector3d( xs[i], ys[i], zs[i] ) ) );
+            if ( scan.hasInputColors )
+                (*colors)[v] = Color( rs[i], gs[i], bs[i] );
+        }
+        if ( !reportProgress( progress, float( n - scan.firstPoint ) / float( scan.numPoints ) ) )
+        {
+            dataReader.close();
+            return unexpectedOperationCanceled();
+        }
+    }
+    dataReader.close();
+    // otherwise the remaining points would stay uninitialized
+    if ( n != nEnd )
+        return unexpected( fmt::format( "Scan {} has {} points instead of {} declared", scanIndex, n - scan.firstPoint, scan.numPoints ) );
+    return {};
+}
+
+} //anonymous namespace
+
 Expected<std::vector<NamedCloud>> fromSceneE57File( const std::filesystem::path& file, const E57LoadSettings & settings )
 {
     MR_TIMER
@@ -34,128 +165,137 @@ Expected<std::vector<NamedCloud>> fromSceneE57File( const std::filesystem::path&
 
     try
     {
-#ifdef MR_OLD_E57
-        e57::Reader eReader( utf8string( file ) );
-#else
-        e57::Reader eReader( utf8string( file ), {} );
-#endif
-        const auto numScans = eReader.GetData3DCount();
-        res.resize( numScans );
+        auto eReader = openReader( file );
+        const int numScans = (int)eReader->GetData3DCount();
+
+        // read the headers of all scans and select the transformations of their points
+        std::vector<ScanInfo> scans( numScans );
+        size_t totalPoints = 0;
         for ( int scanIndex = 0; scanIndex < numScans; ++scanIndex )
         {
-            auto sp = subprogress( settings.progress, float( scanIndex ) / numScans, float( scanIndex + 1 ) / numScans );
-            auto & nc = res[scanIndex];
+            auto & scan = scans[scanIndex];
             e57::Data3D scanHeader;
-            eReader.ReadData3D( scanIndex, scanHeader );
-            nc.name = scanHeader.name;
-            const AffineXf3d e57Xf(
+            eReader->ReadData3D( scanIndex, scanHeader );
+            scan.name = scanHeader.name;
+            scan.e57Xf = AffineXf3d(
                 Quaterniond( scanHeader.pose.rotation.w, scanHeader.pose.rotation.x, scanHeader.pose.rotation.y, scanHeader.pose.rotation.z ),
                 Vector3d( scanHeader.pose.translation.x, scanHeader.pose.translation.y, scanHeader.pose.translation.z )
             );
-
-            std::optional<AffineXf3d> aXf; // will be applied to all points
-            if ( settings.identityXf )
-                aXf = e57Xf;
-            else if ( settings.combineAllObjects && xf0 )
-                aXf = xf0->inverse() * e57Xf;
-
-            if ( !aXf )
-            {
-                const auto& bounds = scanHeader.cartesianBounds;
-                const Box3d box {
-                    { bounds.xMinimum, bounds.yMinimum, bounds.zMinimum },
-                    { bounds.xMaximum, bounds.yMaximum, bounds.zMaximum },
-                };
-                if ( box.valid() )
-                    aXf = AffineXf3d::translation( -box.center() );
-            }
+            const auto& bounds = scanHeader.cartesianBounds;
+            scan.box = Box3d {
+                { bounds.xMinimum, bounds.yMinimum, bounds.zMinimum },
+                { bounds.xMaximum, bounds.yMaximum, bounds.zMaximum },
+            };
+            scan.hasColorFields = scanHeader.pointFields.colorRedField;
 
             int64_t nColumn = 0;
             int64_t nRow = 0;
-            int64_t nPointsSize = 0;
             int64_t nGroupsSize = 0;
             int64_t nCountSize = 0;
             bool bColumnIndex = false;
-
-            if ( !eReader.GetData3DSizes( scanIndex, nRow, nColumn, nPointsSize, nGroupsSize, nCountSize, bColumnIndex) )
+            if ( !eReader->GetData3DSizes( scanIndex, nRow, nColumn, scan.numPoints, nGroupsSize, nCountSize, bColumnIndex) )
                 return MR::unexpected( std::string( "GetData3DSizes failed during reading of " + utf8string( file ) ) );
-    
-            // how many points to read in a time
-            const int64_t nSize = std::min( nPointsSize, int64_t( 1024 ) * 128 );
-
-    #ifdef MR_OLD_E57
-            e57::Data3DPointsData_d buffers;
-    #else
-            e57::Data3DPointsDouble buffers;
-    #endif
-            std::vector<double> xs( nSize ), ys( nSize ), zs( nSize );
-            buffers.cartesianX = xs.data();
-            buffers.cartesianY = ys.data();
-            buffers.cartesianZ = zs.data();
-    #ifdef MR_OLD_E57
-            std::vector<uint8_t> rs, gs, bs;
-    #else
-            std::vector<uint16_t> rs, gs, bs;
-    #endif
-            std::vector<int8_t> invalidColors;
-            rs.resize( nSize );
-            gs.resize( nSize );
-            bs.resize( nSize );
-            buffers.colorRed = rs.data();
-            buffers.colorGreen = gs.data();
-            buffers.colorBlue = bs.data();
-            invalidColors.resize( nSize );
-            buffers.isColorInvalid = invalidColors.data();
-
-            e57::CompressedVectorReader dataReader = eReader.SetUpData3DPointsData( scanIndex, nSize, buffers );
-
-            auto & cloud = nc.cloud;
-            auto & colors = nc.colors;
-            cloud.points.reserve( nPointsSize );
-            unsigned long size = 0;
-            bool hasInputColors = false;
-            while ( ( size = dataReader.read() ) > 0 )
+
+            if ( settings.identityXf )
+                scan.aXf = scan.e57Xf;
+            else if ( settings.combineAllObjects && xf0 )
+                scan.aXf = xf0->inverse() * scan.e57Xf;
+            if ( !scan.aXf && scan.box.valid() )
+                scan.aXf = AffineXf3d::translation( -scan.box.center() );
+            if ( !scan.aXf && scan.numPoints > 0 )
+                scan.aXf = AffineXf3d::translation( -readFirstPoint( *eReader, scanIndex ) );
+            if ( !xf0 && scan.aXf )
+                xf0 = scan.e57Xf * scan.aXf->inverse();
+
+            scan.firstPoint = settings.combineAllObjects ? totalPoints : 0;
+            totalPoints += scan.numPoints;
+        }
+        if ( !reportProgress( settings.progress, 0.05f ) )
+            return unexpectedOperationCanceled();
+
+        // allocate the output clouds to let all scans write there in parallel
+        res.resize( settings.combineAllObjects ? std::min( numScans, 1 ) : numScans );
+        bool anyColors = false;
+        for ( const auto & scan : scans )
+            anyColors = anyColors || scan.hasColorFields;
+        for ( int i = 0; i < res.size(); ++i )
+        {
+            auto & nc = res[i];
+            nc.name = scans[i].name;
+            const size_t numPoints = settings.combineAllObjects ? totalPoints : scans[i].numPoints;
+            nc.cloud.points.resizeNoInit( numPoints );
+            if ( settings.combineAllObjects ? anyColors : scans[i].hasColorFields )
+                nc.colors.resizeNoInit( numPoints );
+        }
+
+        // each scan is decoded in its own thread by its own reader, since the readers are not thread-safe;
+        // the progress is summed over all scans and reported only from the calling thread
+        const auto decodeProgress = subprogress( settings.progress, 0.05f, 1.0f );
+        const auto callingThreadId = std::this_thread::get_id();
+        std::atomic<bool> keepGoing{ true };
+        std::atomic<size_t> decodedPoints{ 0 };
+        std::vector<std::string> scanErrors( numScans );
+        ParallelFor( 0, numScans, [&]( int scanIndex )
+        {
+            auto & scan = scans[scanIndex];
+            if ( scan.numPoints <= 0 || !keepGoing.load( std::memory_order_relaxed ) )
+                return;
+            auto & nc = res[settings.combineAllObjects ? 0 : scanIndex];
+            size_t scanDecoded = 0;
+            ProgressCallback scanProgress;
+            if ( decodeProgress )
             {
-                reportProgress( sp, float( cloud.points.size() ) / nPointsSize );
-                if ( cloud.points.empty() )
-                {
-                    hasInputColors = invalidColors.front() == 0;
-                    if ( hasInputColors )
-                        colors.reserve( nPointsSize );
-                }
-                if ( !aXf )
-                {
-                    aXf = AffineXf3d::translation( 
-                    {
-                        -buffers.cartesianX[0],
-                        -buffers.cartesianY[0],
-                        -buffers.cartesianZ[0],
-                    } );
-                }
-                for ( unsigned long i = 0; i < size; ++i )
+                scanProgress = [&]( float p )
                 {
-                    const auto p = Vector3d( buffers.cartesianX[i], buffers.cartesianY[i], buffers.cartesianZ[i] );
-                    cloud.points.emplace_back( Vector3f( (*aXf)( p ) ) );
-                    if ( hasInputColors )
-                    {
-                        colors.emplace_back(
-                            buffers.colorRed[i],
-                            buffers.colorGreen[i],
-                            buffers.colorBlue[i]
-                        );
-                    }
-                }
+                    const auto n = size_t( p * scan.numPoints );
+                    const auto total = decodedPoints.fetch_add( n - scanDecoded, std::memory_order_relaxed ) + n - scanDecoded;
+                    scanDecoded = n;
+                    if ( std::this_thread::get_id() == callingThreadId && !decodeProgress( float( total ) / float( totalPoints ) ) )
+                        keepGoing.store( false, std::memory_order_relaxed );
+                    return keepGoing.load( std::memory_order_relaxed );
+                };
             }
+            auto scanReader = openReader( file );
+            auto decoded = decodeScan( *scanReader, scanIndex, scan, nc.cloud.points,
+                scan.hasColorFields && !nc.colors.empty() ? &nc.colors : nullptr, scanProgress );
+            if ( !decoded )
+            {
+                scanErrors[scanIndex] = std::move( decoded.error() );
+                keepGoing.store( false, std::memory_order_relaxed );
+            }
+        } );
+        for ( const auto & error : scanErrors )
+            if ( !error.empty() && error != stringOperationCanceled() )
+                return unexpected( error + " during reading of " + utf8string( file ) );
+        if ( !keepGoing )
+            return unexpectedOperationCanceled();
 
-            assert( cloud.points.size() == (size_t)nPointsSize );
-            cloud.validPoints.resize( cloud.points.size(), true );
-
-            dataReader.close();
-            nc.xf = ( settings.identityXf || !aXf ) ? AffineXf3f() :
-                AffineXf3f( e57Xf * aXf->inverse() );
-            if ( !xf0 && aXf )
-                xf0 = e57Xf * aXf->inverse();
+        if ( settings.combineAllObjects )
+        {
+            if ( !res.empty() )
+            {
+                bool keepColors = true;
+                for ( const auto & scan : scans )
+                    keepColors = keepColors && ( scan.numPoints <= 0 || scan.hasInputColors );
+                if ( !keepColors )
+                    res[0].colors = {};
+                if ( xf0 )
+                    res[0].xf = AffineXf3f( *xf0 );
+            }
+        }
+        else
+        {
+            for ( int i = 0; i < res.size(); ++i )
+            {
+                const auto & scan = scans[i];
+                if ( !scan.hasInputColors )
+                    res[i].colors = {};
+                res[i].xf = ( settings.identityXf || !scan.aXf ) ? AffineXf3f() :
+                    AffineXf3f( scan.e57Xf * scan.aXf->inverse() );
+            }
         }
+        for ( auto & nc : res )
+            nc.cloud.validPoints.resize( nc.cloud.points.size(), true );
     }
     catch( const e57::E57Exception & e )
     {
@@ -163,40 +303,127 @@ Expected<std::vector<NamedCloud>> fromSceneE57File( const std::filesystem::path&
             e57::Utilities::errorCodeToString( e.errorCode() ), utf8string( file ) ) );
     }
 
-    if ( !settings.combineAllObjects || res.size() <= 1 )
-        return res;
+    return res;
+}
 
-    size_t totalPoints = 0;
-    bool keepColors = true;
+#ifndef MR_OLD_E57
+TEST( MRMesh, PointsLoadE57 )
+{
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+    const auto path = folder / "scans.e57";
 
-    for ( int i = 0; i < res.size(); ++i )
+    // two scans with different poses, only the first one has colors
+    const Quaterniond rotations[2] = { Quaterniond(), Quaterniond( Vector3d::plusZ(), 0.5 ) };
+    const Vector3d translations[2] = { Vector3d( 10, 0, 0 ), Vector3d( 0, 20, 0 ) };
+    const int numPoints[2] = { 1000, 1500 };
+    auto localPoint = []( int s, int i ) { return Vector3d( i * 0.01, 5.0 + s, ( i % 7 ) * 0.1 ); };
+    auto worldPoint = [&]( int s, int i ) { return Vector3f( AffineXf3d( rotations[s], translations[s] )( localPoint( s, i ) ) ); };
+    auto pointColor = []( int i ) { return Color( i % 256, ( 2 * i ) % 256, 7 ); };
     {
-        totalPoints += res[i].cloud.points.size();
-        keepColors = keepColors && res[i].cloud.points.size() == res[i].colors.size();
+        e57::WriterOptions options;
+        options.guid = "{8c8e1f4d-3a4b-4d2e-9f1a-000000000000}";
+        e57::Writer writer( utf8string( path ), options );
+        for ( int s = 0; s < 2; ++s )
+        {
+            e57::Data3D header;
+            header.guid = fmt::format( "{{8c8e1f4d-3a4b-4d2e-9f1a-00000000000{}}}", s + 1 );
+            header.name = fmt::format( "scan{}", s );
+            header.pose.rotation.w = rotations[s].a;
+            header.pose.rotation.x = rotations[s].b;
+            header.pose.rotation.y = rotations[s].c;
+            header.pose.rotation.z = rotations[s].d;
+            header.pose.translation.x = translations[s].x;
+            header.pose.translation.y = translations[s].y;
+            header.pose.translation.z = translations[s].z;
+            header.pointCount = numPoints[s];
+            header.pointFields.cartesianXField = true;
+            header.pointFields.cartesianYField = true;
+            header.pointFields.cartesianZField = true;
+            Box3d box;
+            for ( int i = 0; i < numPoints[s]; ++i )
+                box.include( localPoint( s, i ) );
+            header.cartesianBounds.xMinimum = box.min.x;
+            header.cartesianBounds.xMaximum = box.max.x;
+            header.cartesianBounds.yMinimum = box.min.y;
+            header.cartesianBounds.yMaximum = box.max.y;
+            header.cartesianBounds.zMinimum = box.min.z;
+            header.cartesianBounds.zMaximum = box.max.z;
+            if ( s == 0 )
+            {
+                header.pointFields.colorRedField = true;
+                header.pointFields.colorGreenField = true;
+                header.pointFields.colorBlueField = true;
+                header.colorLimits.colorRedMaximum = 255;
+                header.colorLimits.colorGreenMaximum = 255;
+                header.colorLimits.colorBlueMaximum = 255;
+            }
+            e57::Data3DPointsDouble buffers( header );
+            for ( int i = 0; i < numPoints[s]; ++i )
+            {
+                const auto p = localPoint( s, i );
+                buffers.cartesianX[i] = p.x;
+                buffers.cartesianY[i] = p.y;
+                buffers.cartesianZ[i] = p.z;
+                if ( s == 0 )
+                {
+                    const auto c = pointColor( i );
+                    buffers.colorRed[i] = c.r;
+                    buffers.colorGreen[i] = c.g;
+                    buffers.colorBlue[i] = c.b;
+                }
+            }
+            writer.WriteData3DData( header, buffers );
+        }
+        writer.Close();
     }
 
-    res[0].cloud.points.reserve( totalPoints );
-    if ( keepColors )
-        res[0].colors.reserve( totalPoints );
-    else
-        res[0].colors = {};
-
-    for ( int i = 1; i < res.size(); ++i )
+    // separate clouds with their poses
+    auto separate = fromSceneE57File( path );
+    ASSERT_TRUE( separate.has_value() );
+    ASSERT_EQ( separate->size(), 2 );
+    for ( int s = 0; s < 2; ++s )
     {
-        res[0].cloud.points.vec_.insert( end( res[0].cloud.points ), begin( res[i].cloud.points ), end( res[i].cloud.points ) );
-        if ( keepColors )
-            res[0].colors.vec_.insert( end( res[0].colors ), begin( res[i].colors ), end( res[i].colors ) );
+        const auto & nc = ( *separate )[s];
+        EXPECT_EQ( nc.name, fmt::format( "scan{}", s ) );
+        ASSERT_EQ( nc.cloud.points.size(), numPoints[s] );
+        EXPECT_EQ( nc.cloud.validPoints.count(), numPoints[s] );
+        ASSERT_EQ( nc.colors.size(), s == 0 ? numPoints[s] : 0 );
+        for ( int i = 0; i < numPoints[s]; ++i )
+        {
+            EXPECT_NEAR( ( nc.xf( nc.cloud.points[VertId( i )] ) - worldPoint( s, i ) ).length(), 0, 1e-4f );
+            if ( s == 0 )
+            {
+                EXPECT_EQ( nc.colors[VertId( i )], pointColor( i ) );
+            }
+        }
     }
 
-    res.resize( 1 );
-    assert( res[0].cloud.points.size() == totalPoints );
-    assert( !keepColors || res[0].colors.size() == totalPoints );
-    res[0].cloud.validPoints.resize( res[0].cloud.points.size(), true );
-    if ( xf0 )
-        res[0].xf = AffineXf3f( *xf0 );
+    // combined cloud, which loses colors since not all scans have them
+    auto combined = fromSceneE57File( path, { .combineAllObjects = true } );
+    ASSERT_TRUE( combined.has_value() );
+    ASSERT_EQ( combined->size(), 1 );
+    const auto & nc = combined->front();
+    ASSERT_EQ( nc.cloud.points.size(), numPoints[0] + numPoints[1] );
+    EXPECT_TRUE( nc.colors.empty() );
+    for ( int s = 0, v = 0; s < 2; ++s )
+        for ( int i = 0; i < numPoints[s]; ++i, ++v )
+            EXPECT_NEAR( ( nc.xf( nc.cloud.points[VertId( v )] ) - worldPoint( s, i ) ).length(), 0, 1e-4f );
 
-    return res;
+    // identity transformation applied to the points
+    auto world = fromSceneE57File( path, { .combineAllObjects = true, .identityXf = true } );
+    ASSERT_TRUE( world.has_value() );
+    ASSERT_EQ( world->size(), 1 );
+    EXPECT_EQ( world->front().xf, AffineXf3f() );
+    for ( int s = 0, v = 0; s < 2; ++s )
+        for ( int i = 0; i < numPoints[s]; ++i, ++v )
+            EXPECT_NEAR( ( world->front().cloud.points[VertId( v )] - worldPoint( s, i ) ).length(), 0, 1e-4f );
+
+    // cancellation during decoding of the scans
+    auto canceled = fromSceneE57File( path, { .progress = []( float p ) { return p < 0.1f; } } );
+    EXPECT_FALSE( canceled.has_value() );
 }
+#endif // MR_OLD_E57
 
 } //namespace PointsLoad
 
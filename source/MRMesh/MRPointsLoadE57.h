@@ -27,7 +27,7 @@ struct E57LoadSettings
     ProgressCallback progress;
 };
 
-/// loads scene from e57 file
+/// one cloud loaded from e57 file
 struct NamedCloud
 {
     std::string name;
@@ -36,6 +36,9 @@ struct NamedCloud
     VertColors colors;
 };
 
+/// loads scene from e57 file, decoding the scans in parallel threads directly in the output point arrays;
+/// without combineAllObjects every scan is returned as separate cloud with its pose in xf,
+/// so the clouds can be aligned together e.g. by MultiwayICP
 MRMESH_API Expected<std::vector<NamedCloud>> fromSceneE57File( const std::filesystem::path& file,
     const E57LoadSettings & settings = {} );
 
@@ -1,18 +1,30 @@
 #include "MRPointsLoad.h"
 #if !defined( MRMESH_NO_LAS )
+#include "MRPointsLoadLAS.h"
 #include "MRAffineXf3.h"
 #include "MRBox.h"
 #include "MRColor.h"
+#include "MRHash.h"
 #include "MRPointCloud.h"
 #include "MRStringConvert.h"
+#include "MRTimer.h"
 #include "MRPch/MRFmt.h"
 
+#include "MRSerializer.h"
+#include "MRGTest.h"
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <future>
+
 #if _MSC_VER >= 1937 // Visual Studio 2022 version 17.7
 #pragma warning( push )
 #pragma warning( disable: 5267 ) //definition of implicit copy constructor is deprecated because it has a user-provided destructor
 #endif
 #include <lazperf/lazperf.hpp>
 #include <lazperf/readers.hpp>
+#include <lazperf/writers.hpp>
 #if _MSC_VER >= 1937 // Visual Studio 2022 version 17.7
 #pragma warning( pop )
 #endif
@@ -223,6 +235,17 @@ Color getColor( uint8_t classification )
         return Color::black();
 }
 
+// returns the color of the point or the color of its class if the format has no colors
+Color getPointColor( const char* buf, int format )
+{
+    if ( hasColorChannels( format ) )
+    {
+        const auto colorChannels = *getColorChannels( buf, format );
+        return Color( colorChannels.red, colorChannels.green, colorChannels.blue );
+    }
+    return getColor( getClassification( buf, format ) );
+}
+
 Expected<PointCloud, std::string> process( lazperf::reader::basic_file& reader, VertColors* colors, AffineXf3f* outXf, ProgressCallback callback )
 {
     const auto pointCount = reader.pointCount();
@@ -271,26 +294,150 @@ Expected<PointCloud, std::string> process( lazperf::reader::basic_file& reader,
         result.points.emplace_back( pos );
 
         if ( colors )
+            colors->emplace_back( getPointColor( buf.data(), pointFormat ) );
+    }
+
+    result.validPoints.resize( result.points.size(), true );
+
+    return result;
+}
+
+/// reads the points from LAS file in chunks applying the filters of the settings
+class ChunkReader
+{
+public:
+    ChunkReader( lazperf::reader::basic_file& reader, const PointsLoad::LasStreamSettings& settings )
+        : reader_( reader )
+        , settings_( settings )
+        , pointCount_( reader.pointCount() )
+    {
+        const auto& header = reader.header();
+        pointFormat_ = header.pointFormat();
+        if ( buf_.size() < header.point_record_length )
+            error_ = fmt::format( "Unsupported LAS format version: {}.{}", header.version.major, header.version.minor );
+        scale_ = { header.scale.x, header.scale.y, header.scale.z };
+        offset_ = { header.offset.x, header.offset.y, header.offset.z };
+        const Box3d fileBox {
+            { header.minx, header.miny, header.minz },
+            { header.maxx, header.maxy, header.maxz },
+        };
+        gridOrigin_ = fileBox.min;
+        if ( settings_.outXf )
         {
-            if ( hasColorChannels( pointFormat ) )
-            {
-                const auto colorChannels = *getColorChannels( buf.data(), pointFormat );
-                colors->emplace_back(
-                    colorChannels.red,
-                    colorChannels.green,
-                    colorChannels.blue
-                );
-            }
-            else
+            const auto center = fileBox.center();
+            *settings_.outXf = AffineXf3f::translation( Vector3f( center ) );
+            shift_ = center;
+        }
+        for ( auto c : settings_.classes )
+            classAllowed_[c] = true;
+    }
+
+    /// not empty if the file cannot be read
+    const std::string& error() const { return error_; }
+
+    uint64_t pointCount() const { return pointCount_; }
+    /// must not be called during readChunk in another thread
+    uint64_t numRead() const { return numRead_; }
+
+    /// makes readChunk in another thread to return as soon as possible
+    void stop() { stop_.store( true, std::memory_order_relaxed ); }
+
+    /// decodes next points till the chunk is full or the file ends, returns false if the file has ended
+    bool readChunk( PointsLoad::LasPointsChunk& chunk )
+    {
+        chunk.points.clear();
+        chunk.colors.clear();
+        chunk.classifications.clear();
+        const auto chunkSize = std::max( settings_.chunkSize, size_t( 1 ) );
+        while ( chunk.points.size() < chunkSize && numRead_ < pointCount_ )
+        {
+            if ( stop_.load( std::memory_order_relaxed ) )
+                return false;
+            reader_.readPoint( buf_.data() );
+            ++numRead_;
+
+            const auto point = getPoint( buf_.data(), pointFormat_ );
+            const Vector3d pos {
+                point.x * scale_.x + offset_.x,
+                point.y * scale_.y + offset_.y,
+                point.z * scale_.z + offset_.z,
+            };
+            if ( settings_.box.valid() && !settings_.box.contains( pos ) )
+                continue;
+            const auto classification = getClassification( buf_.data(), pointFormat_ );
+            if ( !settings_.classes.empty() && !classAllowed_[classification] )
+                continue;
+            if ( settings_.voxelSize > 0 )
             {
-                colors->emplace_back( getColor( getClassification( buf.data(), pointFormat ) ) );
+                const auto rel = ( pos - gridOrigin_ ) / settings_.voxelSize;
+                const Vector3i voxel { (int)std::floor( rel.x ), (int)std::floor( rel.y ), (int)std::floor( rel.z ) };
+                if ( !occupiedVoxels_.insert( voxel ).second )
+                    continue;
             }
+
+            chunk.points.emplace_back( pos - shift_ );
+            chunk.classifications.push_back( classification );
+            if ( settings_.loadColors )
+                chunk.colors.push_back( getPointColor( buf_.data(), pointFormat_ ) );
         }
+        return numRead_ < pointCount_;
     }
 
-    result.validPoints.resize( result.points.size(), true );
+private:
+    lazperf::reader::basic_file& reader_;
+    const PointsLoad::LasStreamSettings& settings_;
+    uint64_t pointCount_ = 0;
+    int pointFormat_ = 0;
+    std::string error_;
+    uint64_t numRead_ = 0;
+    std::atomic<bool> stop_{ false };
+    Vector3d scale_;
+    Vector3d offset_;
+    Vector3d shift_;
+    Vector3d gridOrigin_;
+    std::array<bool, 256> classAllowed_{};
+    // voxels with already loaded points; unlike the points themselves, it grows with the number of loaded points
+    HashSet<Vector3i> occupiedVoxels_;
+    std::array<char, sizeof( LasPoint10 )> buf_ { '\0' };
+};
 
-    return result;
+VoidOrErrStr processByChunks( lazperf::reader::basic_file& reader, const PointsLoad::LasChunkCallback& onChunk,
+    const PointsLoad::LasStreamSettings& settings )
+{
+    MR_TIMER
+    ChunkReader chunkReader( reader, settings );
+    if ( !chunkReader.error().empty() )
+        return unexpected( chunkReader.error() );
+
+    PointsLoad::LasPointsChunk current, next;
+    bool hasMore = chunkReader.readChunk( current );
+    for (;;)
+    {
+        // take the counter before next decoding starts modifying it
+        const auto numRead = chunkReader.numRead();
+
+        // decode next chunk while the callback processes the current one
+        std::future<bool> nextRead;
+        if ( hasMore )
+            nextRead = std::async( std::launch::async, [&] { return chunkReader.readChunk( next ); } );
+
+        const bool keepGoing = current.points.empty() || onChunk( current );
+        const bool canceled = keepGoing && !reportProgress( settings.progress, (float)numRead / (float)std::max( chunkReader.pointCount(), uint64_t( 1 ) ) );
+        if ( !keepGoing || canceled )
+        {
+            chunkReader.stop();
+            if ( nextRead.valid() )
+                nextRead.wait();
+            if ( canceled )
+                return unexpectedOperationCanceled();
+            break;
+        }
+        if ( !hasMore )
+            break;
+        hasMore = nextRead.get(); // rethrows decoding exception if any
+        std::swap( current, next );
+    }
+    return {};
 }
 
 }
@@ -324,6 +471,131 @@ Expected<PointCloud, std::string> fromLas( std::istream& in, VertColors* colors,
     }
 }
 
+VoidOrErrStr fromLasByChunks( const std::filesystem::path& file, const LasChunkCallback& onChunk, const LasStreamSettings& settings )
+{
+    try
+    {
+        lazperf::reader::named_file reader( utf8string( file ) );
+        return processByChunks( reader, onChunk, settings );
+    }
+    catch ( const std::exception& exc )
+    {
+        return unexpected( fmt::format( "Failed to read file: {}", exc.what() ) );
+    }
+}
+
+VoidOrErrStr fromLasByChunks( std::istream& in, const LasChunkCallback& onChunk, const LasStreamSettings& settings )
+{
+    try
+    {
+        lazperf::reader::generic_file reader( in );
+        return processByChunks( reader, onChunk, settings );
+    }
+    catch ( const std::exception& exc )
+    {
+        return unexpected( fmt::format( "Failed to read file: {}", exc.what() ) );
+    }
+}
+
+TEST( MRMesh, PointsLoadLasByChunks )
+{
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+    const auto path = folder / "grid.laz";
+
+    // the grid of points with step 0.5, having 3 classes
+    struct RefPoint
+    {
+        Vector3d pos;
+        uint8_t classification = 0;
+        Color color;
+    };
+    std::vector<RefPoint> refPoints;
+    for ( int z = 0; z < 4; ++z )
+        for ( int y = 0; y < 10; ++y )
+            for ( int x = 0; x < 10; ++x )
+                refPoints.push_back( { Vector3d( x, y, z ) * 0.5 + Vector3d( 100, 200, 0 ), uint8_t( 1 + ( x + y ) % 3 ),
+                    Color( 20 * x, 20 * y, 50 * z ) } );
+    {
+        lazperf::writer::named_file::config config( { 0.01, 0.01, 0.01 }, { 0, 0, 0 } );
+        config.pdrf = 2;
+        lazperf::writer::named_file writer( utf8string( path ), config );
+        for ( const auto & p : refPoints )
+        {
+            LasPoint2 rec{};
+            rec.x = (int32_t)std::lround( p.pos.x / 0.01 );
+            rec.y = (int32_t)std::lround( p.pos.y / 0.01 );
+            rec.z = (int32_t)std::lround( p.pos.z / 0.01 );
+            rec.classification = p.classification;
+            rec.red = p.color.r;
+            rec.green = p.color.g;
+            rec.blue = p.color.b;
+            writer.writePoint( (const char*)&rec );
+        }
+        writer.close();
+    }
+
+    // reads all chunks of the file, checking their sizes
+    auto readAll = [&]( LasStreamSettings settings )
+    {
+        std::vector<RefPoint> res;
+        size_t numChunks = 0;
+        auto v = fromLasByChunks( path, [&]( LasPointsChunk & chunk )
+        {
+            EXPECT_GT( chunk.points.size(), 0 );
+            EXPECT_LE( chunk.points.size(), settings.chunkSize );
+            EXPECT_EQ( chunk.classifications.size(), chunk.points.size() );
+            EXPECT_EQ( chunk.colors.size(), settings.loadColors ? chunk.points.size() : 0 );
+            for ( size_t i = 0; i < chunk.points.size(); ++i )
+                res.push_back( { Vector3d( chunk.points[i] ), chunk.classifications[i], settings.loadColors ? chunk.colors[i] : Color() } );
+            ++numChunks;
+            return true;
+        }, settings );
+        EXPECT_TRUE( v.has_value() );
+        EXPECT_EQ( numChunks, ( res.size() + settings.chunkSize - 1 ) / settings.chunkSize );
+        return res;
+    };
+
+    AffineXf3f xf;
+    const auto all = readAll( { .chunkSize = 64, .outXf = &xf } );
+    ASSERT_EQ( all.size(), refPoints.size() );
+    EXPECT_NEAR( ( Vector3d( xf.b ) - Vector3d( 102.25, 202.25, 0.75 ) ).length(), 0, 1e-4 );
+    for ( size_t i = 0; i < all.size(); ++i )
+    {
+        EXPECT_NEAR( ( all[i].pos + Vector3d( xf.b ) - refPoints[i].pos ).length(), 0, 1e-4 );
+        EXPECT_EQ( all[i].classification, refPoints[i].classification );
+        EXPECT_EQ( all[i].color, refPoints[i].color );
+    }
+
+    const Box3d box( { 101, 201, 0 }, { 102, 203, 1 } );
+    const auto inBox = readAll( { .chunkSize = 10, .box = box, .loadColors = false } );
+    size_t numInBox = 0;
+    for ( const auto & p : refPoints )
+        numInBox += box.contains( p.pos );
+    EXPECT_EQ( inBox.size(), numInBox );
+    for ( const auto & p : inBox )
+        EXPECT_TRUE( box.contains( p.pos ) );
+
+    const auto ofClass = readAll( { .chunkSize = 50, .classes = { 2 } } );
+    EXPECT_EQ( ofClass.size(), std::count_if( refPoints.begin(), refPoints.end(), []( const RefPoint & p ) { return p.classification == 2; } ) );
+    for ( const auto & p : ofClass )
+        EXPECT_EQ( p.classification, 2 );
+
+    // voxels of the size 1 contain 8 grid points each, only the first of them is loaded
+    const auto subsampled = readAll( { .chunkSize = 1000, .voxelSize = 1.0 } );
+    EXPECT_EQ( subsampled.size(), 5 * 5 * 2 );
+    HashSet<Vector3i> voxels;
+    for ( const auto & p : subsampled )
+        EXPECT_TRUE( voxels.insert( Vector3i( Vector3d( p.pos - Vector3d( 100, 200, 0 ) ) ) ).second );
+
+    // stop after the first chunk
+    size_t numChunks = 0;
+    EXPECT_TRUE( fromLasByChunks( path, [&]( LasPointsChunk & ) { return ++numChunks < 1; }, { .chunkSize = 10 } ).has_value() );
+    EXPECT_EQ( numChunks, 1 );
+
+    EXPECT_FALSE( fromLasByChunks( path, []( LasPointsChunk & ) { return true; }, { .chunkSize = 10, .progress = []( float p ) { return p < 0.5f; } } ).has_value() );
+}
+
 } // namespace MR::PointsLoad
 
 #endif // !defined( MRMESH_NO_LAS )
\ No newline at end of file
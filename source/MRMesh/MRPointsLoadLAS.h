@@ -0,0 +1,82 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include "MRProgressCallback.h"
+#include "MRBox.h"
+#include "MRColor.h"
+#include "MRVector3.h"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+#if !defined( MRMESH_NO_LAS )
+
+namespace MR
+{
+
+namespace PointsLoad
+{
+
+/// \addtogroup PointsLoadGroup
+/// \{
+
+/// next portion of points read from .las/.laz file by fromLasByChunks
+struct LasPointsChunk
+{
+    /// point coordinates relative to the center of the file's bounding box, if LasStreamSettings::outXf is set,
+    /// or relative to the origin otherwise
+    std::vector<Vector3f> points;
+    /// colors of the points (or the colors of their classes if the file has no colors), if LasStreamSettings::loadColors is set
+    std::vector<Color> colors;
+    /// classification codes of the points
+    std::vector<uint8_t> classifications;
+};
+
+struct LasStreamSettings
+{
+    /// the maximal number of points in one chunk, which bounds the memory required for reading
+    size_t chunkSize = 1 << 20;
+
+    /// if valid then only the points inside this box (in the coordinates of the file) are loaded
+    Box3d box;
+
+    /// if not empty then only the points with listed classification codes are loaded
+    std::vector<uint8_t> classes;
+
+    /// if positive then at most one (the first read) point from each cubic voxel of this size is loaded;
+    /// the voxels are counted from the minimal corner of the file's bounding box
+    double voxelSize = 0;
+
+    /// whether to fill LasPointsChunk::colors
+    bool loadColors = true;
+
+    /// if not null then it receives the translation to the center of the file's bounding box,
+    /// and the points are returned relative to this center to preserve the precision of float coordinates
+    AffineXf3f* outXf = nullptr;
+
+    /// progress report and cancellation
+    ProgressCallback progress;
+};
+
+/// receives next portion of points, which can be moved out; returns false to stop reading
+using LasChunkCallback = std::function<bool ( LasPointsChunk & chunk )>;
+
+/// reads the points of .las/.laz file portion by portion passing each one to the callback,
+/// filtering and voxel subsampling the points during decoding;
+/// the decoding of the next chunk runs in a separate thread while the callback processes the current one
+MRMESH_API VoidOrErrStr fromLasByChunks( const std::filesystem::path& file, const LasChunkCallback & onChunk,
+    const LasStreamSettings & settings = {} );
+MRMESH_API VoidOrErrStr fromLasByChunks( std::istream& in, const LasChunkCallback & onChunk,
+    const LasStreamSettings & settings = {} );
+
+/// \}
+
+} // namespace PointsLoad
+
+} // namespace MR
+
+#endif // !defined( MRMESH_NO_LAS )
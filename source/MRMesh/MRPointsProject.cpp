@@ -1,6 +1,7 @@
 #include "MRPointsProject.h"
 #include "MRPointCloud.h"
 #include "MRAABBTreePoints.h"
+#include "MRPointChunkStore.h"
 #include "MRFewSmallest.h"
 #include "MRBuffer.h"
 #include "MRBitSetParallelFor.h"
@@ -178,6 +179,131 @@ void findFewClosestPoints( const Vector3f& pt, const PointCloud& pc, FewSmallest
     }
 }
 
+namespace
+{
+
+struct ChunkSubTask
+{
+    PointChunkStore::NodeId n;
+    float distSq = 0;
+};
+
+/// visits the leaves of the store in the order of increasing distance from pt to their boxes;
+/// \param limitDistSq returns current upper limit of squared distance, the nodes further than it are skipped
+/// \param onLeaf processes the leaf, returns false to stop visiting
+template<typename L, typename F>
+void visitClosestChunks( const Vector3f& pt, const PointChunkStore& store, const AffineXf3f* xf, L && limitDistSq, F && onLeaf )
+{
+    if ( store.nodes().empty() )
+        return;
+
+    constexpr int MaxStackSize = 256; // octree nodes have up to 8 children
+    ChunkSubTask subtasks[MaxStackSize];
+    int stackSize = 0;
+
+    auto getSubTask = [&] ( PointChunkStore::NodeId n )
+    {
+        float distSq = ( transformed( store[n].box, xf ).getBoxClosestPointTo( pt ) - pt ).lengthSq();
+        return ChunkSubTask{ n, distSq };
+    };
+
+    auto addSubTask = [&] ( const ChunkSubTask& s )
+    {
+        if ( s.distSq < limitDistSq() )
+        {
+            assert( stackSize < MaxStackSize );
+            subtasks[stackSize++] = s;
+        }
+    };
+
+    addSubTask( getSubTask( store.rootNodeId() ) );
+
+    while ( stackSize > 0 )
+    {
+        const auto s = subtasks[--stackSize];
+        const auto& node = store[s.n];
+        if ( s.distSq >= limitDistSq() )
+            continue;
+
+        if ( node.leaf() )
+        {
+            const auto chunk = store.getChunk( s.n );
+            if ( chunk && !onLeaf( *chunk ) ) // skip damaged chunks
+                break;
+            continue;
+        }
+
+        ChunkSubTask children[8];
+        for ( int i = 0; i < node.numChildren; ++i )
+            children[i] = getSubTask( node.firstChild + i );
+        // larger distance to look later, smaller distance to look first
+        std::sort( children, children + node.numChildren, []( const ChunkSubTask& a, const ChunkSubTask& b ) { return a.distSq > b.distSq; } );
+        for ( int i = 0; i < node.numChildren; ++i )
+            addSubTask( children[i] );
+    }
+}
+
+} //anonymous namespace
+
+PointsProjectionResult findProjectionOnPoints( const Vector3f& pt, const PointChunkStore& store,
+    float upDistLimitSq /*= FLT_MAX*/,
+    const AffineXf3f* xf /*= nullptr*/,
+    float loDistLimitSq /*= 0*/,
+    VertPredicate skipCb /*= {}*/ )
+{
+    PointsProjectionResult res;
+    res.distSq = upDistLimitSq;
+
+    visitClosestChunks( pt, store, xf, [&] { return res.distSq; }, [&]( const PointChunkStore::Chunk& chunk )
+    {
+        for ( int i = 0; i < (int)chunk.points.size(); ++i )
+        {
+            const VertId v = chunk.firstPoint + i;
+            if ( skipCb && skipCb( v ) )
+                continue;
+            auto proj = xf ? ( *xf )( chunk.points[i] ) : chunk.points[i];
+            float distSq = ( proj - pt ).lengthSq();
+            if ( distSq < res.distSq )
+            {
+                res.distSq = distSq;
+                res.vId = v;
+                if ( distSq <= loDistLimitSq )
+                    return false;
+            }
+        }
+        return true;
+    } );
+
+    return res;
+}
+
+void findFewClosestPoints( const Vector3f& pt, const PointChunkStore& store, FewSmallest<PointsProjectionResult> & res,
+    float upDistLimitSq, const AffineXf3f* xf, float loDistLimitSq )
+{
+    res.clear();
+
+    auto topDistSq = [&]
+    {
+        return !res.full() ? upDistLimitSq : res.top().distSq;
+    };
+
+    visitClosestChunks( pt, store, xf, topDistSq, [&]( const PointChunkStore::Chunk& chunk )
+    {
+        for ( int i = 0; i < (int)chunk.points.size(); ++i )
+        {
+            auto proj = xf ? ( *xf )( chunk.points[i] ) : chunk.points[i];
+            float distSq = ( proj - pt ).lengthSq();
+            if ( distSq < topDistSq() )
+            {
+                res.push( { .distSq = distSq, .vId = chunk.firstPoint + i } );
+                if ( res.full() && res.top().distSq <= loDistLimitSq )
+                    return false;
+            }
+        }
+        return true;
+    } );
+}
+
 Buffer<VertId> findNClosestPointsPerPoint( const PointCloud& pc, int numNei, const ProgressCallback & progress )
 {
     MR_TIMER
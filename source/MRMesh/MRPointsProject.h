@@ -44,6 +44,30 @@ MRMESH_API void findFewClosestPoints( const Vector3f& pt, const PointCloud& pc,
     const AffineXf3f* xf = nullptr,
     float loDistLimitSq = 0 );
 
+/**
+ * \brief computes the closest point in out-of-core point store to given point, loading only the chunks that can contain it
+ * \param upDistLimitSq upper limit on the distance in question, if the real distance is larger than the function exits returning upDistLimitSq and no valid point
+ * \param xf points-to-point transformation, if not specified then identity transformation is assumed
+ * \param loDistLimitSq low limit on the distance in question, if a point is found within this distance then it is immediately returned without searching for a closer one
+ * \param skipCb callback to discard VertId projection candidate
+ */
+[[nodiscard]] MRMESH_API PointsProjectionResult findProjectionOnPoints( const Vector3f& pt, const PointChunkStore& store,
+    float upDistLimitSq = FLT_MAX,
+    const AffineXf3f* xf = nullptr,
+    float loDistLimitSq = 0,
+    VertPredicate skipCb = {} );
+
+/**
+ * \brief finds a number of the closest points in out-of-core point store (as configured in \param res) to given point
+ * \param upDistLimitSq upper limit on the distance in question, points with larger distance than it will not be returned
+ * \param xf points-to-point transformation, if not specified then identity transformation is assumed
+ * \param loDistLimitSq low limit on the distance in question, the algorithm can return given number of points within this distance even skipping closer ones
+ */
+MRMESH_API void findFewClosestPoints( const Vector3f& pt, const PointChunkStore& store, FewSmallest<PointsProjectionResult> & res,
+    float upDistLimitSq = FLT_MAX,
+    const AffineXf3f* xf = nullptr,
+    float loDistLimitSq = 0 );
+
 /**
  * \brief finds given number of closest points (excluding itself) to each valid point in the cloud;
  * \param numNei the number of closest points to find for each point
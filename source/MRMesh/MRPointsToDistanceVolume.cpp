@@ -7,11 +7,20 @@
 #include "MRPointsInBall.h"
 #include "MRColor.h"
 #include "MRTimer.h"
+#include "MRMakeSphereMesh.h"
+#include "MRMeshNormals.h"
+#include "MRMesh.h"
+#include "MRGTest.h"
+#include <algorithm>
+#include <atomic>
 #include <limits>
 
 namespace MR
 {
 
+/// the size of cubic tile of voxels along each dimension, all voxels of a tile are filled by one thread
+constexpr int cTileSize = 16;
+
 Expected<SimpleVolume> pointsToDistanceVolume( const PointCloud & cloud, const PointsToDistanceVolumeParams& params )
 {
     MR_TIMER
@@ -25,25 +34,153 @@ Expected<SimpleVolume> pointsToDistanceVolume( const PointCloud & cloud, const P
     VolumeIndexer indexer( res.dims );
     res.data.resize( indexer.size(), std::numeric_limits<float>::quiet_NaN() );
 
+    const auto radius = 3 * params.sigma;
+    const auto radiusSq = sqr( radius );
+
+    // finds the box of voxels (inclusive) having centers within the ball of influence around given point,
+    // returns false if the box is empty
+    auto influenceBox = [&]( const Vector3f & p, Vector3i & lo, Vector3i & hi )
+    {
+        for ( int k = 0; k < 3; ++k )
+        {
+            const auto lof = std::ceil( ( p[k] - radius - params.origin[k] ) / params.voxelSize[k] - 0.5f );
+            const auto hif = std::floor( ( p[k] + radius - params.origin[k] ) / params.voxelSize[k] - 0.5f );
+            if ( !( lof < res.dims[k] ) || !( hif >= 0 ) || lof > hif )
+                return false;
+            lo[k] = std::max( 0, int( lof ) );
+            hi[k] = std::min( res.dims[k] - 1, int( hif ) );
+        }
+        return true;
+    };
+
+    const Vector3i tileDims(
+        ( res.dims.x + cTileSize - 1 ) / cTileSize,
+        ( res.dims.y + cTileSize - 1 ) / cTileSize,
+        ( res.dims.z + cTileSize - 1 ) / cTileSize );
+    const VolumeIndexer tileIndexer( tileDims );
+
+    // calls given function for every tile influenced by given point
+    auto forEachTile = [&]( VertId v, auto && f )
+    {
+        Vector3i lo, hi;
+        if ( !influenceBox( cloud.points[v], lo, hi ) )
+            return;
+        lo /= cTileSize;
+        hi /= cTileSize;
+        for ( int z = lo.z; z <= hi.z; ++z )
+            for ( int y = lo.y; y <= hi.y; ++y )
+                for ( int x = lo.x; x <= hi.x; ++x )
+                    f( size_t( tileIndexer.toVoxelId( { x, y, z } ) ) );
+    };
+
+    // bin the points once by the tiles they influence instead of searching points around each voxel
+    std::vector<std::atomic<size_t>> tileCursors( tileIndexer.size() + 1 );
+    BitSetParallelFor( cloud.validPoints, [&]( VertId v )
+    {
+        forEachTile( v, [&]( size_t t ) { tileCursors[t + 1].fetch_add( 1, std::memory_order_relaxed ); } );
+    } );
+    std::vector<size_t> tileStarts( tileCursors.size() );
+    for ( size_t t = 1; t < tileCursors.size(); ++t )
+    {
+        tileStarts[t] = tileStarts[t - 1] + tileCursors[t].load( std::memory_order_relaxed );
+        tileCursors[t - 1].store( tileStarts[t - 1], std::memory_order_relaxed );
+    }
+    std::vector<VertId> tilePoints( tileStarts.back() );
+    BitSetParallelFor( cloud.validPoints, [&]( VertId v )
+    {
+        forEachTile( v, [&]( size_t t ) { tilePoints[tileCursors[t].fetch_add( 1, std::memory_order_relaxed )] = v; } );
+    } );
+
+    if ( !reportProgress( params.cb, 0.1f ) )
+        return unexpectedOperationCanceled();
+
+    // scatter the influence of each point in the voxels of the tile, the tiles are processed in parallel without synchronization
     const auto inv2SgSq = -0.5f / sqr( params.sigma );
-    if ( !ParallelFor( size_t( 0 ), indexer.size(), [&]( size_t i )
+    if ( !ParallelFor( size_t( 0 ), tileIndexer.size(), [&]( size_t t )
     {
-        auto coord = Vector3f( indexer.toPos( VoxelId( i ) ) ) + Vector3f::diagonal( 0.5f );
-        auto voxelCenter = params.origin + mult( params.voxelSize, coord );
+        const auto begin = tilePoints.begin() + tileStarts[t];
+        const auto end = tilePoints.begin() + tileStarts[t + 1];
+        if ( begin == end )
+            return;
+        // same order of summation independently on the order of binning
+        std::sort( begin, end );
 
-        float sumDist = 0;
-        float sumWeight = 0;
-        findPointsInBall( cloud, voxelCenter, 3 * params.sigma, [&]( VertId v, const Vector3f& p )
+        const auto tileLo = tileIndexer.toPos( VoxelId( t ) ) * cTileSize;
+        const auto tileHi = Vector3i(
+            std::min( tileLo.x + cTileSize, res.dims.x ),
+            std::min( tileLo.y + cTileSize, res.dims.y ),
+            std::min( tileLo.z + cTileSize, res.dims.z ) ) - Vector3i::diagonal( 1 );
+        constexpr int cTileVoxels = cTileSize * cTileSize * cTileSize;
+        std::vector<float> sumDist( cTileVoxels, 0.0f ), sumWeight( cTileVoxels, 0.0f );
+        // the offsets from the point to voxel centers along one axis, their squares and Gaussian factors
+        struct AxisFactors
         {
-            const auto distSq = ( voxelCenter - p ).lengthSq();
-            const auto w = std::exp( distSq * inv2SgSq );
-            sumWeight += w;
-            sumDist += dot( cloud.normals[v], voxelCenter - p ) * w;
-        } );
+            int first = 0;
+            int size = 0;
+            float d[cTileSize], dSq[cTileSize], w[cTileSize];
+        };
+        auto computeFactors = [&]( AxisFactors & af, int lo, int hi, int k, float p )
+        {
+            af.first = lo;
+            af.size = hi + 1 - lo;
+            for ( int j = 0; j < af.size; ++j )
+            {
+                af.d[j] = params.origin[k] + params.voxelSize[k] * ( float( lo + j ) + 0.5f ) - p;
+                af.dSq[j] = sqr( af.d[j] );
+                af.w[j] = std::exp( af.dSq[j] * inv2SgSq );
+            }
+        };
+
+        AxisFactors fx, fy, fz;
+        for ( auto it = begin; it != end; ++it )
+        {
+            const auto v = *it;
+            const auto p = cloud.points[v];
+            const auto n = cloud.normals[v];
+            Vector3i lo, hi;
+            [[maybe_unused]] const bool influenced = influenceBox( p, lo, hi );
+            assert( influenced );
+            // Gaussian weight is the product of the factors along the axes, so no exponent is computed per voxel
+            computeFactors( fx, std::max( lo.x, tileLo.x ), std::min( hi.x, tileHi.x ), 0, p.x );
+            computeFactors( fy, std::max( lo.y, tileLo.y ), std::min( hi.y, tileHi.y ), 1, p.y );
+            computeFactors( fz, std::max( lo.z, tileLo.z ), std::min( hi.z, tileHi.z ), 2, p.z );
+            for ( int jz = 0; jz < fz.size; ++jz )
+            {
+                for ( int jy = 0; jy < fy.size; ++jy )
+                {
+                    const auto dyzSq = fy.dSq[jy] + fz.dSq[jz];
+                    if ( dyzSq > radiusSq )
+                        continue;
+                    const auto wyz = fy.w[jy] * fz.w[jz];
+                    const auto nyz = n.y * fy.d[jy] + n.z * fz.d[jz];
+                    const int i = ( ( fz.first + jz - tileLo.z ) * cTileSize + ( fy.first + jy - tileLo.y ) ) * cTileSize + fx.first - tileLo.x;
+                    float * tileWeight = sumWeight.data() + i;
+                    float * tileDist = sumDist.data() + i;
+                    for ( int jx = 0; jx < fx.size; ++jx )
+                    {
+                        const auto w = dyzSq + fx.dSq[jx] <= radiusSq ? wyz * fx.w[jx] : 0.0f;
+                        tileWeight[jx] += w;
+                        tileDist[jx] += ( nyz + n.x * fx.d[jx] ) * w;
+                    }
+                }
+            }
+        }
 
-        if ( sumWeight >= params.minWeight )
-            res.data[i] = sumDist / sumWeight;
-    }, params.cb ) )
+        for ( int z = tileLo.z; z <= tileHi.z; ++z )
+        {
+            for ( int y = tileLo.y; y <= tileHi.y; ++y )
+            {
+                const int i = ( ( z - tileLo.z ) * cTileSize + ( y - tileLo.y ) ) * cTileSize;
+                const auto firstVoxel = size_t( indexer.toVoxelId( { tileLo.x, y, z } ) );
+                for ( int x = tileLo.x; x <= tileHi.x; ++x )
+                {
+                    const auto w = sumWeight[i + x - tileLo.x];
+                    if ( w >= params.minWeight )
+                        res.data[firstVoxel + x - tileLo.x] = sumDist[i + x - tileLo.x] / w;
+                }
+            }
+        }
+    }, subprogress( params.cb, 0.1f, 1.0f ) ) )
         return unexpectedOperationCanceled();
 
     res.max =  params.sigma * std::exp( -0.5f );
@@ -83,4 +220,51 @@ Expected<VertColors> calcAvgColors( const PointCloud & cloud, const VertColors &
     return res;
 }
 
+TEST( MRMesh, PointsToDistanceVolume )
+{
+    const auto sphere = makeUVSphere( 1.0f, 64, 64 );
+    PointCloud cloud;
+    cloud.points = sphere.points;
+    cloud.normals = computePerVertNormals( sphere );
+    cloud.validPoints = sphere.topology.getValidVerts();
+
+    PointsToDistanceVolumeParams params;
+    params.sigma = 0.05f;
+    params.minWeight = 0.5f;
+    params.voxelSize = Vector3f( 0.03f, 0.04f, 0.05f );
+    params.origin = Vector3f::diagonal( -1.2f );
+    params.dimensions = Vector3i( 81, 61, 49 );
+    auto volume = pointsToDistanceVolume( cloud, params );
+    ASSERT_TRUE( volume.has_value() );
+
+    // compare with the values computed by searching the points around each voxel
+    const VolumeIndexer indexer( params.dimensions );
+    const auto inv2SgSq = -0.5f / sqr( params.sigma );
+    int numValid = 0;
+    for ( size_t i = 0; i < indexer.size(); ++i )
+    {
+        const auto voxelCenter = params.origin + mult( params.voxelSize, Vector3f( indexer.toPos( VoxelId( i ) ) ) + Vector3f::diagonal( 0.5f ) );
+        float sumDist = 0;
+        float sumWeight = 0;
+        findPointsInBall( cloud, voxelCenter, 3 * params.sigma, [&]( VertId v, const Vector3f& p )
+        {
+            const auto w = std::exp( ( voxelCenter - p ).lengthSq() * inv2SgSq );
+            sumWeight += w;
+            sumDist += dot( cloud.normals[v], voxelCenter - p ) * w;
+        } );
+        const auto value = volume->data[i];
+        if ( sumWeight >= params.minWeight * 1.001f )
+        {
+            ASSERT_FALSE( std::isnan( value ) );
+            EXPECT_NEAR( value, sumDist / sumWeight, 1e-5f );
+            ++numValid;
+        }
+        else if ( sumWeight < params.minWeight * 0.999f )
+        {
+            EXPECT_TRUE( std::isnan( value ) );
+        }
+    }
+    EXPECT_GT( numValid, 1000 );
+}
+
 } //namespace MR
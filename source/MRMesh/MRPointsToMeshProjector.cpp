@@ -2,8 +2,15 @@
 #include "MRMesh.h"
 #include "MRAffineXf3.h"
 #include "MRMatrix3Decompose.h"
+#include "MRMeshProject.h"
+#include "MRWideAABBTree.h"
+#include "MRClosestPointInTriangle.h"
+#include "MROrder.h"
 #include "MRTimer.h"
+#include "MRTorus.h"
+#include "MRGTest.h"
 #include "MRPch/MRTBB.h"
+#include <random>
 
 namespace MR
 {
@@ -11,6 +18,28 @@ namespace MR
 void PointsToMeshProjector::updateMeshData( const Mesh* mesh )
 {
     mesh_ = mesh;
+    tree_ = mesh_ ? std::make_shared<const WideAABBTree>( MeshPart( *mesh_ ) ) : nullptr;
+}
+
+/// computes the closest point to given point on given triangle of the mesh
+static MeshProjectionResult projectOnFace( const Vector3f & pt, const Mesh & mesh, FaceId face, const AffineXf3f * xf )
+{
+    Vector3f a, b, c;
+    mesh.getTriPoints( face, a, b, c );
+    if ( xf )
+    {
+        a = (*xf)( a );
+        b = (*xf)( b );
+        c = (*xf)( c );
+    }
+    // compute the closest point in double-precision as findProjection does
+    const auto [projD, baryD] = closestPointInTriangle( Vector3d( pt ), Vector3d( a ), Vector3d( b ), Vector3d( c ) );
+    MeshProjectionResult res;
+    res.proj.point = Vector3f( projD );
+    res.proj.face = face;
+    res.mtp = MeshTriPoint{ mesh.topology.edgeWithLeft( face ), TriPointf( baryD ) };
+    res.distSq = ( res.proj.point - pt ).lengthSq();
+    return res;
 }
 
 void PointsToMeshProjector::findProjections( std::vector<MeshProjectionResult>& result, const std::vector<Vector3f>& points, const AffineXf3f* objXf, const AffineXf3f* refObjXf, float upDistLimitSq, float loDistLimitSq )
@@ -38,10 +67,46 @@ void PointsToMeshProjector::findProjections( std::vector<MeshProjectionResult>&
         xfPtr = &xf;
     }
 
+    std::vector<Vector3f> queries( points.size() );
     tbb::parallel_for( tbb::blocked_range<size_t>( 0, points.size() ), [&] ( const tbb::blocked_range<size_t>& range )
     {
         for ( size_t i = range.begin(); i < range.end(); ++i )
-            result[i] = findProjection( xfPtr ? ( *xfPtr )( points[VertId( i )] ) : points[VertId( i )], *mesh_, upDistLimitSq, notRigidRefXf, loDistLimitSq );
+            queries[i] = xfPtr ? ( *xfPtr )( points[i] ) : points[i];
+    } );
+    // consecutive points in this order are close to each other and have close projections
+    const auto order = getMortonOrder( queries );
+
+    assert( tree_ );
+    const auto & tree = *tree_;
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, order.size(), 1024 ), [&] ( const tbb::blocked_range<size_t>& range )
+    {
+        FaceId prevFace;
+        for ( size_t j = range.begin(); j < range.end(); ++j )
+        {
+            const auto i = order[j];
+            const auto pt = queries[i];
+
+            // the closest point on the triangle of previous point limits the search
+            MeshProjectionResult warmStart;
+            warmStart.distSq = upDistLimitSq;
+            if ( prevFace )
+            {
+                if ( auto candidate = projectOnFace( pt, *mesh_, prevFace, notRigidRefXf ); candidate.distSq < upDistLimitSq )
+                    warmStart = candidate;
+            }
+
+            auto & res = result[i];
+            if ( warmStart.proj.face && warmStart.distSq <= loDistLimitSq )
+                res = warmStart;
+            else
+            {
+                res = findProjectionSubtree( pt, *mesh_, tree, warmStart.distSq, notRigidRefXf, loDistLimitSq );
+                if ( !res.proj.face )
+                    res = warmStart;
+            }
+            if ( res.proj.face )
+                prevFace = res.proj.face;
+        }
     } );
 }
 
@@ -50,4 +115,34 @@ size_t PointsToMeshProjector::projectionsHeapBytes( size_t ) const
     return 0;
 }
 
-}
\ No newline at end of file
+TEST( MRMesh, PointsToMeshProjector )
+{
+    const auto torus = makeTorus( 1.0f, 0.3f, 64, 32 );
+    std::vector<Vector3f> points;
+    std::mt19937 gen( 42 );
+    std::uniform_real_distribution<float> coord( -1.5f, 1.5f );
+    for ( int i = 0; i < 10000; ++i )
+        points.emplace_back( coord( gen ), coord( gen ), coord( gen ) );
+
+    PointsToMeshProjector projector;
+    projector.updateMeshData( &torus );
+    const auto xf = AffineXf3f::translation( Vector3f( 0.1f, 0.2f, 0.3f ) );
+    for ( const AffineXf3f * objXf : { (const AffineXf3f *)nullptr, &xf } )
+    {
+        for ( float upDistLimitSq : { FLT_MAX, 0.01f } )
+        {
+            std::vector<MeshProjectionResult> res;
+            projector.findProjections( res, points, objXf, nullptr, upDistLimitSq, 0.0f );
+            ASSERT_EQ( res.size(), points.size() );
+            for ( size_t i = 0; i < points.size(); ++i )
+            {
+                const auto pt = objXf ? ( *objXf )( points[i] ) : points[i];
+                const auto ref = findProjection( pt, torus, upDistLimitSq );
+                EXPECT_EQ( bool( res[i].proj.face ), bool( ref.proj.face ) );
+                EXPECT_NEAR( res[i].distSq, ref.distSq, 1e-6f );
+            }
+        }
+    }
+}
+
+} //namespace MR
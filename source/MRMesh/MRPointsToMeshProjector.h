@@ -3,6 +3,7 @@
 #include "MRMeshFwd.h"
 #include "MRAffineXf3.h"
 #include <float.h>
+#include <memory>
 #include <string>
 
 namespace MR
@@ -27,11 +28,15 @@ public:
 class MRMESH_CLASS PointsToMeshProjector : public IPointsToMeshProjector
 {
     const Mesh* mesh_{ nullptr };
+    std::shared_ptr<const WideAABBTree> tree_;
 public:
-    /// update all data related to the referencing mesh
+    /// update all data related to the referencing mesh, including wide AABB tree used for queries;
+    /// it shall be called again after any modification of the mesh
     MRMESH_API virtual void updateMeshData( const Mesh* mesh ) override;
     /// <summary>
-    /// Computes the closest point on mesh to each of given points    
+    /// Computes the closest point on mesh to each of given points.
+    /// The points are processed in the order along Morton curve, and the triangle closest to previous point
+    /// gives the initial distance limit for the search of the next point, which prunes most of tree nodes
     /// </summary>
     /// <param name="result">vector pf projections</param>
     /// <param name="points">vector of points to project</param>
@@ -1,4 +1,6 @@
 #include "MRProgressReadWrite.h"
+#include "MRParallelFor.h"
+#include <cstring>
 
 namespace MR
 {
@@ -51,4 +53,14 @@ bool readByBlocks( std::istream& in, char* data, size_t dataSize, ProgressCallba
     return true;
 }
 
+bool copyByBlocks( char* dst, const char* src, size_t dataSize, ProgressCallback callback /*= {}*/, size_t blockSize /*= ( size_t( 1 ) << 20 )*/ )
+{
+    const size_t numBlocks = ( dataSize + blockSize - 1 ) / blockSize;
+    return ParallelFor( size_t( 0 ), numBlocks, [&] ( size_t i )
+    {
+        const size_t begin = i * blockSize;
+        std::memcpy( dst + begin, src + begin, std::min( blockSize, dataSize - begin ) );
+    }, callback, 1 );
+}
+
 }
@@ -22,4 +22,11 @@ MRMESH_API bool writeByBlocks( std::ostream& out, const char* data, size_t dataS
  */
 MRMESH_API bool readByBlocks( std::istream& in, char* data, size_t dataSize, ProgressCallback callback = {}, size_t blockSize = ( size_t( 1 ) << 16 ) );
 
+/**
+ * \brief copy dataSize bytes from src to dst by blocks of blockSize bytes processed in parallel threads
+ * \details it is useful for reading from memory-mapped files, where page faults of different blocks are served simultaneously
+ * \return false if process was canceled (callback is set and return false )
+ */
+MRMESH_API bool copyByBlocks( char* dst, const char* src, size_t dataSize, ProgressCallback callback = {}, size_t blockSize = ( size_t( 1 ) << 20 ) );
+
 }
@@ -69,4 +69,18 @@ void SeparationPointStorage::getPoints( VertCoords & points ) const
     } );
 }
 
+void SeparationPointStorage::getEdgeIndices( Vector<size_t, VertId> & edges ) const
+{
+    MR_TIMER
+    ParallelFor( size_t( 0 ), blocks_.size(), [&] ( size_t bi )
+    {
+        for ( const auto & [voxelId, set] : blocks_[bi].smap )
+        {
+            for ( int n = 0; n < int( NeighborDir::Count ); ++n )
+                if ( set[n] )
+                    edges[set[n]] = 3 * voxelId + n;
+        }
+    } );
+}
+
 } //namespace MR
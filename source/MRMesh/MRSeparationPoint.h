@@ -59,6 +59,9 @@ public:
     /// obtains coordinates of all stored points
     void getPoints( VertCoords & points ) const;
 
+    /// obtains for each stored point the index of voxel edge it is located on: 3 * voxelId + NeighborDir
+    void getEdgeIndices( Vector<size_t, VertId> & edges ) const;
+
 private:
     size_t blockSize_ = 0;
     std::vector<Block> blocks_;
@@ -24,9 +24,11 @@
 #include "MRMeshTexture.h"
 #include "MRDirectory.h"
 #include "MRZip.h"
+#include "MRZipArchive.h"
 #include "MRPch/MRSpdlog.h"
 #include "MRPch/MRJson.h"
 
+#include <sstream>
 #include <streambuf>
 
 namespace MR
@@ -151,7 +153,7 @@ VoidOrErrStr serializeMesh( const Mesh& mesh, const std::filesystem::path& path,
 }
 
 VoidOrErrStr serializeObjectTree( const Object& object, const std::filesystem::path& path, 
-    ProgressCallback progressCb, FolderCallback preCompress )
+    ProgressCallback progressCb, FolderCallback preCompress, int compressionLevel )
 {
     MR_TIMER;
     if (path.empty())
@@ -172,15 +174,13 @@ VoidOrErrStr serializeObjectTree( const Object& object, const std::filesystem::p
     auto & saveModelFutures = expectedSaveModelFutures.value();
 
     assert( !object.name().empty() );
-    auto paramsFile = scenePath / ( object.name() + ".json" );
-    // although json is a textual format, we open the file in binary mode to get exactly the same result on Windows and Linux
-    std::ofstream ofs( paramsFile, std::ofstream::binary );
+    // the parameters are put in the archive directly from memory
+    const auto paramsFile = object.name() + ".json";
+    std::ostringstream params;
     Json::StreamWriterBuilder builder;
     std::unique_ptr<Json::StreamWriter> writer{ builder.newStreamWriter() };
-    if ( !ofs || writer->write( root, &ofs ) != 0 )
-        return unexpected( "Cannot write parameters " + utf8string( paramsFile ) );
-
-    ofs.close();
+    if ( writer->write( root, &params ) != 0 )
+        return unexpected( "Cannot write parameters " + paramsFile );
 
 #ifndef __EMSCRIPTEN__
     if ( !reportProgress( progressCb, 0.1f ) )
@@ -211,7 +211,14 @@ VoidOrErrStr serializeObjectTree( const Object& object, const std::filesystem::p
     if ( preCompress )
         preCompress( scenePath );
 
-    return compressZip( path, scenePath, {}, nullptr, subprogress( progressCb, 0.9f, 1.0f ) );
+    auto zip = ZipArchiveWriter::create( path, compressionLevel );
+    if ( !zip )
+        return unexpected( std::move( zip.error() ) );
+    if ( auto res = zip->addFile( paramsFile, params.str() ); !res )
+        return res;
+    if ( auto res = zip->addFolder( scenePath, subprogress( progressCb, 0.9f, 0.95f ) ); !res )
+        return res;
+    return zip->finish( subprogress( progressCb, 0.95f, 1.0f ) );
 }
 
 Expected<std::shared_ptr<Object>, std::string> deserializeObjectTree( const std::filesystem::path& path, FolderCallback postDecompress,
@@ -221,11 +228,38 @@ Expected<std::shared_ptr<Object>, std::string> deserializeObjectTree( const std:
     UniqueTemporaryFolder scenePath( postDecompress );
     if ( !scenePath )
         return unexpected( "Cannot create temporary folder" );
-    auto res = decompressZip( path, scenePath );
+
+    // decompress all files in parallel, and use the slower libzip only for the archives with encryption or unusual compression
+    VoidOrErrStr res;
+    if ( auto zip = ZipArchiveReader::open( path ) )
+        res = zip->extractAll( scenePath, subprogress( progressCb, 0.0f, 0.2f ) );
+    else
+        res = decompressZip( path, scenePath );
     if ( !res.has_value() )
         return unexpected( res.error() );
 
-    return deserializeObjectTreeFromFolder( scenePath, progressCb );
+    return deserializeObjectTreeFromFolder( scenePath, subprogress( progressCb, 0.2f, 1.0f ) );
+}
+
+Expected<Json::Value, std::string> deserializeObjectTreeJson( const std::filesystem::path& path )
+{
+    MR_TIMER;
+    auto zip = ZipArchiveReader::open( path );
+    if ( !zip )
+        return unexpected( std::move( zip.error() ) );
+
+    for ( size_t i = 0; i < zip->entries().size(); ++i )
+    {
+        // the parameters are stored in the only json file in the root folder of the archive
+        const auto& name = zip->entries()[i].name;
+        if ( name.find( '/' ) != std::string::npos || !name.ends_with( ".json" ) )
+            continue;
+        auto content = zip->read( i );
+        if ( !content )
+            return unexpected( std::move( content.error() ) );
+        return deserializeJsonValue( *content );
+    }
+    return unexpected( "Cannot find parameters file" );
 }
 
 Expected<std::shared_ptr<Object>, std::string> deserializeObjectTreeFromFolder( const std::filesystem::path& folder,
@@ -763,4 +797,34 @@ TEST( MRMesh, MeshToJson )
     ASSERT_EQ( mesh, mesh1 );
 }
 
+TEST( MRMesh, SerializeObjectTree )
+{
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+
+    Object root;
+    root.setName( "Root" );
+    auto objMesh = std::make_shared<ObjectMesh>();
+    objMesh->setName( "Cube" );
+    objMesh->setMesh( std::make_shared<Mesh>( makeCube() ) );
+    root.addChild( objMesh );
+
+    for ( int level : { 0, -1 } )
+    {
+        const auto path = folder / ( "scene" + std::to_string( level ) + ".mru" );
+        ASSERT_TRUE( serializeObjectTree( root, path, {}, {}, level ).has_value() );
+
+        auto json = deserializeObjectTreeJson( path );
+        ASSERT_TRUE( json.has_value() );
+        EXPECT_EQ( ( *json )["Name"].asString(), "Root" );
+
+        auto loaded = deserializeObjectTree( path );
+        ASSERT_TRUE( loaded.has_value() );
+        ASSERT_EQ( ( *loaded )->children().size(), 1 );
+        auto loadedMesh = std::dynamic_pointer_cast<ObjectMesh>( ( *loaded )->children()[0] );
+        ASSERT_TRUE( loadedMesh && loadedMesh->mesh() );
+        EXPECT_EQ( *loadedMesh->mesh(), *objMesh->mesh() );
+    }
+}
+
 } // namespace MR
@@ -68,9 +68,12 @@ MRMESH_API Expected<Json::Value, std::string> deserializeJsonValue( const std::f
  *  
  * if preCompress is set, it is called before compression
  * saving is controlled with Object::serializeModel_ and Object::serializeFields_
+ * \param compressionLevel 0 - store the files in the archive without compression (the fastest, e.g. for local autosaves),
+ * 1..9 - Deflate levels from the fastest to the best compression, -1 - default Deflate level;
+ * the files are compressed in parallel threads
  */
 MRMESH_API VoidOrErrStr serializeObjectTree( const Object& object, 
-    const std::filesystem::path& path, ProgressCallback progress = {}, FolderCallback preCompress = {} );
+    const std::filesystem::path& path, ProgressCallback progress = {}, FolderCallback preCompress = {}, int compressionLevel = -1 );
 /**
  * \brief loads objects tree from given scene file (zip/mru)
  * \details format specification:
@@ -83,6 +86,9 @@ MRMESH_API VoidOrErrStr serializeObjectTree( const Object& object,
 MRMESH_API Expected<std::shared_ptr<Object>, std::string> deserializeObjectTree( const std::filesystem::path& path,
     FolderCallback postDecompress = {}, ProgressCallback progressCb = {} );
 
+/// reads only the parameters of all objects (the JSON tree) from given scene file (mru) without extracting the models
+MRMESH_API Expected<Json::Value, std::string> deserializeObjectTreeJson( const std::filesystem::path& path );
+
 /**
  * \brief loads objects tree from given scene folder
  * \details format specification:
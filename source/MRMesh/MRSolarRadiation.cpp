@@ -1,12 +1,10 @@
 #include "MRSolarRadiation.h"
 #include "MRMesh.h"
 #include "MRBitSetParallelFor.h"
-#include "MRIntersectionPrecomputes.h"
-#include "MRLine3.h"
+#include "MRParallelFor.h"
 #include "MRMeshIntersect.h"
 #include "MRTimer.h"
 #include <cfloat>
-#include <cstdlib>
 
 namespace MR
 {
@@ -48,6 +46,42 @@ std::vector<Vector3f> sampleHalfSphere()
     return patches;
 }
 
+namespace
+{
+
+/// traces the rays from valid samples in [first, last) toward every sky patch:
+/// the rays having the same direction from neighbor samples are processed in one packet,
+/// and the result of each ray is passed in onRay( sample, patch, intersection )
+template <typename F>
+void traceSkyRays( const Mesh & terrain, const VertCoords & samples, const VertBitSet & validSamples, VertId first, VertId last,
+    const std::vector<SkyPatch> & skyPatches, bool closestIntersect, F && onRay )
+{
+    constexpr int N = RayPacket::MaxSize;
+    VertId verts[N];
+    MeshIntersectionResult isecs[N];
+    for ( VertId v = first; v < last; )
+    {
+        int numVerts = 0;
+        for ( ; v < last && numVerts < N; ++v )
+            if ( validSamples.test( v ) )
+                verts[numVerts++] = v;
+        if ( numVerts == 0 )
+            break;
+
+        for ( int patch = 0; patch < skyPatches.size(); ++patch )
+        {
+            RayPacket packet;
+            for ( int i = 0; i < numVerts; ++i )
+                packet.add( samples[verts[i]], skyPatches[patch].dir );
+            rayMeshIntersectPacket( terrain, packet, isecs, 0, FLT_MAX, closestIntersect );
+            for ( int i = 0; i < numVerts; ++i )
+                onRay( verts[i], patch, isecs[i] );
+        }
+    }
+}
+
+} // anonymous namespace
+
 VertScalars computeSkyViewFactor( const Mesh & terrain, const VertCoords & samples, const VertBitSet & validSamples,
     const std::vector<SkyPatch> & skyPatches, BitSet * outSkyRays, std::vector<MeshIntersectionResult>* outIntersections )
 {
@@ -77,29 +111,27 @@ VertScalars computeSkyViewFactor( const Mesh & terrain, const VertCoords & sampl
         return res;
     }
 
-    std::vector<IntersectionPrecomputes<float>> precs;
-    precs.reserve( skyPatches.size() );
-    for ( const auto & sp : skyPatches )
-        precs.emplace_back( sp.dir );
-
     const size_t numRays = samples.size() * skyPatches.size();
     if ( outIntersections )
         outIntersections->resize( numRays );
 
-    BitSetParallelFor( validSamples, [&]( VertId sampleVertId )
+    terrain.getAABBTree(); // construct the tree before parallel region
+    constexpr size_t N = RayPacket::MaxSize;
+    ParallelFor( size_t( 0 ), ( samples.size() + N - 1 ) / N, [&]( size_t g )
     {
-        const auto samplePt = samples[sampleVertId];
-
-        float totalRadiation = 0;
-        for ( int i = 0; i < skyPatches.size(); ++i )
+        const VertId first( g * N );
+        const VertId last( std::min( ( g + 1 ) * N, samples.size() ) );
+        traceSkyRays( terrain, samples, validSamples, first, last, skyPatches, bool( outIntersections ),
+            [&]( VertId sampleVertId, int patch, const MeshIntersectionResult & isec )
         {
-            const auto intersectionRes = rayMeshIntersect( terrain, Line3f( samplePt, skyPatches[i].dir ), 0, FLT_MAX, &precs[i], bool( outIntersections ));
-            if ( !intersectionRes )
-                totalRadiation += skyPatches[i].radiation;
+            if ( !isec.proj.face )
+                res[sampleVertId] += skyPatches[patch].radiation;
             else if ( outIntersections )
-                (*outIntersections)[ size_t( sampleVertId ) * skyPatches.size() + i ] = *intersectionRes;
-        }
-        res[sampleVertId] = rMaxRadiation * totalRadiation;
+                (*outIntersections)[ size_t( sampleVertId ) * skyPatches.size() + patch ] = isec;
+        } );
+        for ( auto v = first; v < last; ++v )
+            if ( validSamples.test( v ) )
+                res[v] *= rMaxRadiation;
     } );
 
     return res;
@@ -111,28 +143,27 @@ BitSet findSkyRays( const Mesh & terrain,
 {
     MR_TIMER
 
-    std::vector<IntersectionPrecomputes<float>> precs;
-    precs.reserve( skyPatches.size() );
-    for ( const auto & sp : skyPatches )
-        precs.emplace_back( sp.dir );
-
     const size_t numRays = samples.size() * skyPatches.size();
     BitSet res( numRays );
     if ( outIntersections )
         outIntersections->resize( numRays );
 
-    BitSetParallelForAll( res, [&]( size_t ray )
+    // the rays of 64 consecutive samples occupy whole number of bit blocks, so the groups can be processed in parallel
+    terrain.getAABBTree(); // construct the tree before parallel region
+    constexpr size_t GroupSize = BitSet::bits_per_block;
+    ParallelFor( size_t( 0 ), ( samples.size() + GroupSize - 1 ) / GroupSize, [&]( size_t g )
     {
-        const auto div = std::div( std::int64_t( ray ), std::int64_t( skyPatches.size() ) );
-        const VertId sample( int( div.quot ) );
-        if ( !validSamples.test( sample ) )
-            return;
-        const auto patch = div.rem;
-        const auto intersectionRes = rayMeshIntersect( terrain, Line3f( samples[sample], skyPatches[patch].dir ), 0, FLT_MAX, &precs[patch], false );
-        if ( !intersectionRes )            
-            res.set( ray );
-        else if ( outIntersections )
-            (*outIntersections)[ray] =  *intersectionRes;
+        const VertId first( g * GroupSize );
+        const VertId last( std::min( ( g + 1 ) * GroupSize, samples.size() ) );
+        traceSkyRays( terrain, samples, validSamples, first, last, skyPatches, false,
+            [&]( VertId sample, int patch, const MeshIntersectionResult & isec )
+        {
+            const auto ray = size_t( sample ) * skyPatches.size() + patch;
+            if ( !isec.proj.face )
+                res.set( ray );
+            else if ( outIntersections )
+                (*outIntersections)[ray] = isec;
+        } );
     } );
 
     return res;
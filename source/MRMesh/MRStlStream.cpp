@@ -0,0 +1,390 @@
+#include "MRStlStream.h"
+#include "MRIdentifyVertices.h"
+#include "MRMeshBuilder.h"
+#include "MRMeshSave.h"
+#include "MRMesh.h"
+#include "MRSerializer.h"
+#include "MRStringConvert.h"
+#include "MRTorus.h"
+#include "MRTimer.h"
+#include "MRAffineXf3.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string_view>
+
+namespace MR
+{
+
+namespace
+{
+
+#pragma pack(push, 1)
+struct StlTriangle
+{
+    Vector3f normal;
+    Vector3f vert[3];
+    std::uint16_t attr;
+};
+#pragma pack(pop)
+static_assert( sizeof( StlTriangle ) == 50, "check your padding" );
+
+} // anonymous namespace
+
+Expected<StlTriangleReader, std::string> StlTriangleReader::open( const std::filesystem::path & file, size_t portionSize )
+{
+    auto in = std::make_unique<std::ifstream>( file, std::ifstream::binary );
+    if ( !*in )
+        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+
+    auto res = open( *in, portionSize );
+    if ( !res )
+        return unexpected( res.error() + "\nFile: " + utf8string( file ) );
+    res->file_ = std::move( in );
+    return res;
+}
+
+Expected<StlTriangleReader, std::string> StlTriangleReader::open( std::istream & in, size_t portionSize )
+{
+    char header[80];
+    in.read( header, 80 );
+
+    std::uint32_t numTris;
+    in.read( (char*)&numTris, 4 );
+    if ( !in )
+        return unexpected( std::string( "Error reading the number of triangles from STL-file" ) );
+
+    auto posCur = in.tellg();
+    in.seekg( 0, std::ios_base::end );
+    auto posEnd = in.tellg();
+    in.seekg( posCur );
+    if ( posEnd - posCur < 50 * std::istream::pos_type( numTris ) )
+    {
+        if ( std::string_view( header, 5 ) == "solid" )
+            return unexpected( std::string( "ASCII STL-file is not supported, only binary STL can be read by portions" ) );
+        return unexpected( std::string( "Binary STL-file is too short" ) );
+    }
+
+    StlTriangleReader res;
+    res.in_ = &in;
+    res.numTris_ = numTris;
+    res.portionSize_ = std::max( portionSize, size_t( 1 ) );
+    return res;
+}
+
+VoidOrErrStr StlTriangleReader::read( std::vector<Triangle3f> & tris )
+{
+    assert( in_ );
+    const auto n = std::min( portionSize_, numTris_ - numRead_ );
+    tris.resize( n );
+    if ( n == 0 )
+        return {};
+
+    raw_.resize( n * sizeof( StlTriangle ) );
+    in_->read( raw_.data(), raw_.size() );
+    if ( !*in_ )
+        return unexpected( std::string( "Binary STL read error" ) );
+    for ( size_t i = 0; i < n; ++i )
+        std::memcpy( (char*)&tris[i], raw_.data() + i * sizeof( StlTriangle ) + offsetof( StlTriangle, vert ), sizeof( Triangle3f ) );
+    numRead_ += n;
+    return {};
+}
+
+bool StlTriangleReader::next( Triangle3f & t )
+{
+    if ( posInPortion_ >= portion_.size() )
+    {
+        if ( !error_.empty() )
+            return false;
+        if ( auto res = read( portion_ ); !res )
+        {
+            error_ = std::move( res.error() );
+            portion_.clear();
+        }
+        posInPortion_ = 0;
+        if ( portion_.empty() )
+            return false;
+    }
+    t = portion_[posInPortion_++];
+    return true;
+}
+
+Expected<Mesh, std::string> readMesh( StlTriangleReader & reader, bool weld, const MeshLoadSettings & settings )
+{
+    MR_TIMER
+
+    const auto numTris = reader.numTriangles() - reader.numRead();
+    MeshBuilder::VertexIdentifier vi;
+    if ( weld )
+        vi.reserve( numTris );
+
+    Triangulation t;
+    VertCoords points;
+    if ( !weld )
+    {
+        t.reserve( numTris );
+        points.reserve( 3 * numTris );
+    }
+    auto addPortion = [&] ( const std::vector<Triangle3f> & tris )
+    {
+        if ( weld )
+        {
+            vi.addTriangles( tris );
+            return;
+        }
+        for ( const auto & tri : tris )
+        {
+            const int v0 = int( points.size() );
+            t.push_back( { VertId( v0 ), VertId( v0 + 1 ), VertId( v0 + 2 ) } );
+            points.push_back( tri[0] );
+            points.push_back( tri[1] );
+            points.push_back( tri[2] );
+        }
+    };
+
+    std::vector<Triangle3f> portion, nextPortion;
+    if ( auto res = reader.read( portion ); !res )
+        return unexpected( std::move( res.error() ) );
+
+    size_t decodedTris = 0;
+    // 0.5 because fromTrianglesDuplicatingNonManifoldVertices takes at least half of time
+    const float rNumTris = numTris > 0 ? 0.5f / float( numTris ) : 0.0f;
+
+    while ( !portion.empty() )
+    {
+        // decode previously read portion in a worker thread
+        tbb::task_group taskGroup;
+        taskGroup.run( [&addPortion, &portion] { addPortion( portion ); } );
+
+        // read from stream in the current thread to be compatible with PythonIstreamBuf
+        auto readRes = reader.read( nextPortion );
+
+        taskGroup.wait();
+        decodedTris += portion.size();
+
+        if ( !reportProgress( settings.callback, decodedTris * rNumTris ) )
+            return unexpected( std::string( "Loading canceled" ) );
+        if ( !readRes )
+            return unexpected( std::move( readRes.error() ) );
+        portion.swap( nextPortion );
+    }
+
+    if ( weld )
+    {
+        t = vi.takeTriangulation();
+        points = vi.takePoints();
+    }
+    FaceBitSet skippedFaces;
+    std::vector<MeshBuilder::VertDuplication> dups;
+    std::vector<MeshBuilder::VertDuplication>* dupsPtr = nullptr;
+    if ( settings.duplicatedVertexCount )
+        dupsPtr = &dups;
+    MeshBuilder::BuildSettings buildSettings;
+    if ( settings.skippedFaceCount )
+    {
+        skippedFaces = FaceBitSet( t.size() );
+        skippedFaces.set();
+        buildSettings.region = &skippedFaces;
+    }
+    auto res = Mesh::fromTrianglesDuplicatingNonManifoldVertices( std::move( points ), t, dupsPtr, buildSettings );
+    if ( settings.duplicatedVertexCount )
+        *settings.duplicatedVertexCount = int( dups.size() );
+    if ( settings.skippedFaceCount )
+        *settings.skippedFaceCount = int( skippedFaces.count() );
+    if ( !reportProgress( settings.callback, 1.0f ) )
+        return unexpected( std::string( "Loading canceled" ) );
+    return res;
+}
+
+StlTriangleWriter::StlTriangleWriter( StlTriangleWriter && b ) noexcept
+{
+    *this = std::move( b );
+}
+
+StlTriangleWriter & StlTriangleWriter::operator =( StlTriangleWriter && b ) noexcept
+{
+    if ( this != &b )
+    {
+        (void)finish();
+        file_ = std::move( b.file_ );
+        out_ = std::exchange( b.out_, nullptr );
+        headerPos_ = b.headerPos_;
+        declaredTris_ = b.declaredTris_;
+        numWritten_ = b.numWritten_;
+        portionSize_ = b.portionSize_;
+        buffer_ = std::move( b.buffer_ );
+    }
+    return *this;
+}
+
+StlTriangleWriter::~StlTriangleWriter()
+{
+    (void)finish();
+}
+
+Expected<StlTriangleWriter, std::string> StlTriangleWriter::open( const std::filesystem::path & file, size_t portionSize )
+{
+    auto out = std::make_unique<std::ofstream>( file, std::ofstream::binary );
+    if ( !*out )
+        return unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
+
+    auto res = open( *out, portionSize );
+    if ( !res )
+        return unexpected( res.error() + "\nFile: " + utf8string( file ) );
+    res->file_ = std::move( out );
+    return res;
+}
+
+Expected<StlTriangleWriter, std::string> StlTriangleWriter::open( std::ostream & out, size_t portionSize, std::uint32_t numTris )
+{
+    StlTriangleWriter res;
+    res.headerPos_ = out.tellp();
+    if ( auto h = MeshSave::writeBinaryStlHeader( out, numTris ); !h )
+        return unexpected( std::move( h.error() ) );
+    res.out_ = &out;
+    res.declaredTris_ = numTris;
+    res.portionSize_ = std::max( portionSize, size_t( 1 ) );
+    res.buffer_.reserve( res.portionSize_ * sizeof( StlTriangle ) );
+    return res;
+}
+
+VoidOrErrStr StlTriangleWriter::write( const Triangle3f & t )
+{
+    assert( out_ );
+    // perform normal computation in double-precision to get exactly the same single-precision result on all platforms
+    const Vector3d a( t[0] ), b( t[1] ), c( t[2] );
+    const StlTriangle rec{ Vector3f( cross( b - a, c - a ).normalized() ), { t[0], t[1], t[2] }, 0 };
+    const auto pos = buffer_.size();
+    buffer_.resize( pos + sizeof( StlTriangle ) );
+    std::memcpy( buffer_.data() + pos, &rec, sizeof( StlTriangle ) );
+    ++numWritten_;
+    if ( buffer_.size() >= portionSize_ * sizeof( StlTriangle ) )
+        return flush_();
+    return {};
+}
+
+VoidOrErrStr StlTriangleWriter::write( std::span<const Triangle3f> tris )
+{
+    for ( const auto & t : tris )
+        if ( auto res = write( t ); !res )
+            return res;
+    return {};
+}
+
+VoidOrErrStr StlTriangleWriter::write( const Mesh & mesh, ProgressCallback callback )
+{
+    assert( out_ );
+    if ( auto res = flush_(); !res )
+        return res;
+    SaveSettings settings;
+    settings.progress = callback;
+    auto n = MeshSave::appendBinaryStlTriangles( mesh, *out_, settings );
+    if ( !n )
+        return unexpected( std::move( n.error() ) );
+    numWritten_ += *n;
+    return {};
+}
+
+VoidOrErrStr StlTriangleWriter::flush_()
+{
+    if ( buffer_.empty() )
+        return {};
+    out_->write( buffer_.data(), buffer_.size() );
+    buffer_.clear();
+    if ( !*out_ )
+        return unexpected( std::string( "Error saving in binary STL-format" ) );
+    return {};
+}
+
+VoidOrErrStr StlTriangleWriter::finish()
+{
+    if ( !out_ )
+        return {};
+    auto res = flush_();
+    if ( res && numWritten_ != declaredTris_ )
+    {
+        if ( numWritten_ > std::numeric_limits<std::uint32_t>::max() )
+            res = unexpected( std::string( "Too many triangles for binary STL-format" ) );
+        else if ( headerPos_ == std::streampos( -1 ) )
+            res = unexpected( std::string( "Cannot update the number of triangles in the header of binary STL" ) );
+        else
+        {
+            const auto endPos = out_->tellp();
+            out_->seekp( headerPos_ + std::streamoff( 80 ) );
+            const auto numTris = std::uint32_t( numWritten_ );
+            out_->write( (const char*)&numTris, 4 );
+            out_->seekp( endPos );
+            if ( !*out_ )
+                res = unexpected( std::string( "Cannot update the number of triangles in the header of binary STL" ) );
+        }
+    }
+    out_ = nullptr;
+    file_.reset();
+    buffer_ = {};
+    return res;
+}
+
+TEST( MRMesh, StlStream )
+{
+    const Mesh torus = makeTorus( 2, 1, 16, 16 );
+    Mesh shifted = torus;
+    shifted.transform( AffineXf3f::translation( Vector3f( 10, 0, 0 ) ) );
+    const size_t numFaces = torus.topology.numValidFaces();
+
+    std::stringstream ss;
+    {
+        auto writer = StlTriangleWriter::open( ss, 100 );
+        ASSERT_TRUE( writer.has_value() );
+        // the first torus triangle by triangle, and the second one as a whole mesh
+        for ( auto f : torus.topology.getValidFaces() )
+            EXPECT_TRUE( writer->write( torus.getTriPoints( f ) ).has_value() );
+        EXPECT_TRUE( writer->write( shifted ).has_value() );
+        EXPECT_TRUE( writer->finish().has_value() );
+    }
+
+    auto reader = StlTriangleReader::open( ss, 77 );
+    ASSERT_TRUE( reader.has_value() );
+    EXPECT_EQ( reader->numTriangles(), 2 * numFaces );
+    size_t count = 0;
+    for ( const Triangle3f & t : *reader )
+    {
+        if ( count < numFaces )
+        {
+            EXPECT_EQ( t, torus.getTriPoints( FaceId( int( count ) ) ) );
+        }
+        ++count;
+    }
+    EXPECT_TRUE( reader->error().empty() );
+    EXPECT_EQ( count, 2 * numFaces );
+
+    ss.clear();
+    ss.seekg( 0 );
+    reader = StlTriangleReader::open( ss, 77 );
+    ASSERT_TRUE( reader.has_value() );
+    auto welded = readMesh( *reader, true );
+    ASSERT_TRUE( welded.has_value() );
+    EXPECT_EQ( welded->topology.numValidFaces(), 2 * numFaces );
+    EXPECT_EQ( welded->topology.numValidVerts(), 2 * torus.topology.numValidVerts() );
+    EXPECT_EQ( welded->topology.findHoleRepresentiveEdges().size(), 0 );
+
+    ss.clear();
+    ss.seekg( 0 );
+    reader = StlTriangleReader::open( ss );
+    ASSERT_TRUE( reader.has_value() );
+    auto soup = readMesh( *reader, false );
+    ASSERT_TRUE( soup.has_value() );
+    EXPECT_EQ( soup->topology.numValidFaces(), 2 * numFaces );
+    EXPECT_EQ( soup->topology.numValidVerts(), 6 * numFaces );
+
+    // ASCII STL is rejected with clear message
+    std::stringstream ascii;
+    EXPECT_TRUE( MeshSave::toAsciiStl( torus, ascii ).has_value() );
+    reader = StlTriangleReader::open( ascii );
+    ASSERT_FALSE( reader.has_value() );
+    EXPECT_NE( reader.error().find( "ASCII" ), std::string::npos );
+}
+
+} // namespace MR
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include "MRMeshLoadSettings.h"
+#include "MRProgressCallback.h"
+#include "MRVector3.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <array>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace MR
+{
+
+/// \addtogroup IOGroup
+/// \{
+
+/// reads the triangles of binary .stl file portion by portion,
+/// so only one portion of the triangles has to be in memory at any moment; ASCII .stl files are not supported
+class StlTriangleReader
+{
+public:
+    /// the default number of triangles read from the stream at once
+    static constexpr size_t DefaultPortionSize = 65536;
+
+    StlTriangleReader() = default;
+    StlTriangleReader( StlTriangleReader && ) noexcept = default;
+    StlTriangleReader & operator =( StlTriangleReader && ) noexcept = default;
+
+    /// opens given file and reads its header
+    [[nodiscard]] MRMESH_API static Expected<StlTriangleReader, std::string> open( const std::filesystem::path & file, size_t portionSize = DefaultPortionSize );
+    /// reads the header from given stream, which must stay alive while the reader is used;
+    /// important on Windows: the stream must be open in binary mode
+    [[nodiscard]] MRMESH_API static Expected<StlTriangleReader, std::string> open( std::istream & in, size_t portionSize = DefaultPortionSize );
+
+    /// the number of triangles declared in the header
+    [[nodiscard]] size_t numTriangles() const { return numTris_; }
+    /// the number of triangles read so far
+    [[nodiscard]] size_t numRead() const { return numRead_; }
+    /// the maximal number of triangles returned by one call of read()
+    [[nodiscard]] size_t portionSize() const { return portionSize_; }
+    /// returns true if all triangles have been read
+    [[nodiscard]] bool eof() const { return numRead_ >= numTris_; }
+
+    /// reads next portion of triangles (at most portionSize()) replacing the content of \param tris;
+    /// tris becomes empty after the last triangle has been read
+    MRMESH_API VoidOrErrStr read( std::vector<Triangle3f> & tris );
+
+    /// pull-based access to the triangles one by one through the internal buffer of portionSize() triangles;
+    /// returns false after the last triangle or in case of read error, which can be obtained from error()
+    MRMESH_API bool next( Triangle3f & t );
+    /// the error happened in next(), or empty string
+    [[nodiscard]] const std::string & error() const { return error_; }
+
+    /// input iterator over the triangles calling next() on increment, e.g. for( const Triangle3f & t : reader ) ...;
+    /// check error() after the loop
+    class Iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Triangle3f;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Triangle3f*;
+        using reference = const Triangle3f&;
+
+        Iterator() = default;
+        explicit Iterator( StlTriangleReader & reader ) : reader_( &reader ) { ++( *this ); }
+        reference operator *() const { return tri_; }
+        pointer operator ->() const { return &tri_; }
+        Iterator & operator ++() { if ( !reader_->next( tri_ ) ) reader_ = nullptr; return *this; }
+        bool operator ==( const Iterator & b ) const { return reader_ == b.reader_; }
+
+    private:
+        StlTriangleReader * reader_ = nullptr;
+        Triangle3f tri_;
+    };
+    [[nodiscard]] Iterator begin() { return Iterator( *this ); }
+    [[nodiscard]] Iterator end() { return {}; }
+
+private:
+    std::unique_ptr<std::ifstream> file_; // only if the reader has opened the file itself
+    std::istream * in_ = nullptr;
+    size_t numTris_ = 0;
+    size_t numRead_ = 0;
+    size_t portionSize_ = DefaultPortionSize;
+    std::vector<char> raw_; // records of the current portion as they are in the file
+    std::vector<Triangle3f> portion_;
+    size_t posInPortion_ = 0;
+    std::string error_;
+};
+
+/// constructs the mesh from all remaining triangles of the reader, decoding one portion while the next one is read;
+/// \param weld if true then the vertices with bit-wise equal coordinates are merged incrementally in a spatial hash map,
+/// so peak memory is proportional to the output mesh and not to the whole triangle soup;
+/// if false then each triangle gets three own vertices
+[[nodiscard]] MRMESH_API Expected<Mesh, std::string> readMesh( StlTriangleReader & reader, bool weld = true, const MeshLoadSettings & settings = {} );
+
+/// writes triangles in binary .stl file portion by portion;
+/// the number of triangles in the header is written in finish()
+class StlTriangleWriter
+{
+public:
+    /// the default number of triangles buffered before writing in the stream
+    static constexpr size_t DefaultPortionSize = 65536;
+
+    StlTriangleWriter() = default;
+    MRMESH_API StlTriangleWriter( StlTriangleWriter && b ) noexcept;
+    MRMESH_API StlTriangleWriter & operator =( StlTriangleWriter && b ) noexcept;
+    /// finishes writing if it was not done explicitly ignoring any errors
+    MRMESH_API ~StlTriangleWriter();
+
+    /// creates given file and writes the header in it
+    [[nodiscard]] MRMESH_API static Expected<StlTriangleWriter, std::string> open( const std::filesystem::path & file, size_t portionSize = DefaultPortionSize );
+    /// writes the header in given stream, which must stay alive until finish();
+    /// if the stream does not support seeking, then \param numTris must be the exact number of triangles to be written
+    [[nodiscard]] MRMESH_API static Expected<StlTriangleWriter, std::string> open( std::ostream & out, size_t portionSize = DefaultPortionSize, std::uint32_t numTris = 0 );
+
+    /// the number of triangles written so far
+    [[nodiscard]] size_t numWritten() const { return numWritten_; }
+
+    /// appends one triangle, its normal is computed from the vertices
+    MRMESH_API VoidOrErrStr write( const Triangle3f & t );
+    /// appends several triangles
+    MRMESH_API VoidOrErrStr write( std::span<const Triangle3f> tris );
+    /// appends all valid not-degenerate triangles of the mesh
+    MRMESH_API VoidOrErrStr write( const Mesh & mesh, ProgressCallback callback = {} );
+
+    /// writes buffered triangles and updates the number of triangles in the header
+    MRMESH_API VoidOrErrStr finish();
+
+private:
+    VoidOrErrStr flush_();
+
+    std::unique_ptr<std::ofstream> file_; // only if the writer has created the file itself
+    std::ostream * out_ = nullptr;
+    std::streampos headerPos_ = -1;
+    std::uint32_t declaredTris_ = 0;
+    size_t numWritten_ = 0;
+    size_t portionSize_ = DefaultPortionSize;
+    std::vector<char> buffer_;
+};
+
+/// \}
+
+} // namespace MR
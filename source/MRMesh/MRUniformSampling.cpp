@@ -4,6 +4,8 @@
 #include "MRVector.h"
 #include "MRTimer.h"
 #include "MRPointsInBall.h"
+#include "MRNeighborGraph.h"
+#include "MRPointChunkStore.h"
 #include "MRBox.h"
 #include <cfloat>
 
@@ -29,6 +31,7 @@ std::optional<VertBitSet> pointUniformSampling( const PointCloud& pointCloud, co
         float distSq = 0;
     };
     std::vector<NearVert> nearVerts;
+    const auto graph = settings.neighbors ? settings.neighbors : findCachedNeighborGraph( pointCloud, settings.distance );
 
     auto processOne = [&]( VertId v )
     {
@@ -37,7 +40,7 @@ std::optional<VertBitSet> pointUniformSampling( const PointCloud& pointCloud, co
         sampled.set( v );
         const auto c = pointCloud.points[v];
         float localMaxDistSq = sqr( settings.distance );
-        findPointsInBall( pointCloud, c, settings.distance, [&] ( VertId u, const Vector3f& pu )
+        auto processNear = [&] ( VertId u, const Vector3f& pu )
         {
             const auto distSq = ( c - pu ).lengthSq();
             if ( pNormals && std::abs( dot( (*pNormals)[v], (*pNormals)[u] ) ) < settings.minNormalDot )
@@ -46,7 +49,15 @@ std::optional<VertBitSet> pointUniformSampling( const PointCloud& pointCloud, co
                 return;
             }
             nearVerts.push_back( { u, distSq } );
-        } );
+        };
+        if ( graph )
+        {
+            processNear( v, c );
+            for ( auto u : graph->get( v ) )
+                processNear( u, pointCloud.points[u] );
+        }
+        else
+            findPointsInBall( pointCloud, c, settings.distance, processNear );
         for ( const auto & [ u, distSq ] : nearVerts )
         {
             if ( distSq >= localMaxDistSq )
@@ -85,6 +96,43 @@ std::optional<VertBitSet> pointUniformSampling( const PointCloud& pointCloud, co
     return sampled;
 }
 
+std::optional<VertBitSet> pointUniformSampling( const PointChunkStore& store, const UniformSamplingSettings & settings )
+{
+    MR_TIMER
+
+    const auto numPoints = store.numPoints();
+    VertBitSet visited( numPoints );
+    VertBitSet sampled( numPoints );
+    const float maxDistSq = sqr( settings.distance );
+
+    size_t progressCount = 0;
+    for ( VertId v( 0 ); v < numPoints; )
+    {
+        // keep the chunk referenced while its points are processed
+        const auto leaf = store.findLeaf( v );
+        const auto chunk = store.getChunk( leaf );
+        if ( !chunk ) // damaged chunk
+            return {};
+        const VertId chunkEnd = store[leaf].firstPoint + store[leaf].numPoints;
+        for ( ; v < chunkEnd; ++v )
+        {
+            if ( settings.progress && !( ( ++progressCount ) & 0x3ff ) && !settings.progress( float( progressCount ) / float( numPoints ) ) )
+                return {};
+            if ( visited.test( v ) )
+                continue;
+            sampled.set( v );
+            const auto c = chunk->points[v - chunk->firstPoint];
+            findPointsInBall( store, c, settings.distance, [&]( VertId u, const Vector3f& pu )
+            {
+                if ( ( c - pu ).lengthSq() < maxDistSq )
+                    visited.set( u );
+            } );
+        }
+    }
+
+    return sampled;
+}
+
 std::optional<PointCloud> makeUniformSampledCloud( const PointCloud& pointCloud, const UniformSamplingSettings & settings )
 {
     MR_TIMER
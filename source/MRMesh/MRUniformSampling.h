@@ -22,6 +22,10 @@ struct UniformSamplingSettings
     bool lexicographicalOrder = true;
     /// if not nullptr then these normals will be used during sampling instead of normals in the cloud itself
     const VertNormals * pNormals = nullptr;
+    /// if not nullptr then the neighbors of each point are taken from this graph instead of searching them,
+    /// the graph must include all points within the distance (e.g. built with radius not less than the distance);
+    /// if nullptr then the graph cached in the cloud is used if it was built for the radius equal to the distance
+    const NeighborGraph * neighbors = nullptr;
     /// to report progress and cancel processing
     ProgressCallback progress;
 };
@@ -31,6 +35,13 @@ struct UniformSamplingSettings
 /// \ingroup PointCloudGroup
 [[nodiscard]] MRMESH_API std::optional<VertBitSet> pointUniformSampling( const PointCloud& pointCloud, const UniformSamplingSettings & settings );
 
+/// Sample points of out-of-core store, removing ones that are too close;
+/// the points are processed chunk by chunk in the order of their ids, so only nearby chunks are in memory at any time;
+/// only settings.distance and settings.progress are used;
+/// returns std::nullopt if it was terminated by the callback or a damaged chunk was found in the store
+/// \ingroup PointCloudGroup
+[[nodiscard]] MRMESH_API std::optional<VertBitSet> pointUniformSampling( const PointChunkStore& store, const UniformSamplingSettings & settings );
+
 
 /// Composes new point cloud consisting of uniform samples of original point cloud;
 /// returns std::nullopt if it was terminated by the callback
@@ -8,6 +8,11 @@
 #include "MRMeshDecimate.h"
 #include "MRMeshCollidePrecise.h"
 #include "MRBox.h"
+#include "MRMakeSphereMesh.h"
+#include "MRGTest.h"
+#include <algorithm>
+#include <functional>
+#include <numeric>
 #include <random>
 
 namespace MR
@@ -51,13 +56,16 @@ Expected<Mesh, std::string> unitePairOfMeshes( Mesh&& a, Mesh&& b,
     return res.mesh;
 }
 
+// returns the value of given mesh for given leaf index of the reduction
+using LeafMeshGetter = std::function<Mesh( int )>;
+
 class BooleanReduce
 {
 public:
-    BooleanReduce( std::vector<Mesh>& mehses, const std::vector<Vector3f>& shifts, float maxError, bool fixDegenerations, bool collectNewFaces, bool mergeMode ) :
+    BooleanReduce( const LeafMeshGetter& getLeafMesh, const std::vector<Vector3f>& shifts, float maxError, bool fixDegenerations, bool collectNewFaces, bool mergeMode ) :
         maxError_{ maxError },
         fixDegenerations_{ fixDegenerations },
-        mergedMeshes_{ mehses },
+        getLeafMesh_{ getLeafMesh },
         shifts_{ shifts },
         collectNewFaces_{ collectNewFaces },
         mergeMode_{ mergeMode }
@@ -67,7 +75,7 @@ public:
         error{ x.error },
         maxError_{ x.maxError_ },
         fixDegenerations_{ x.fixDegenerations_ },
-        mergedMeshes_{ x.mergedMeshes_ },
+        getLeafMesh_{ x.getLeafMesh_ },
         shifts_{ x.shifts_ },
         collectNewFaces_{ x.collectNewFaces_ },
         mergeMode_{ x.mergeMode_ }
@@ -147,7 +155,7 @@ public:
         assert( resultMesh.points.empty() );
         if ( !shifts_.empty() )
             resShift = shifts_[r.begin()];
-        resultMesh = std::move( mergedMeshes_[r.begin()] );
+        resultMesh = getLeafMesh_( r.begin() );
         newFaces.resize( resultMesh.topology.faceSize() );
     }
 
@@ -158,18 +166,101 @@ public:
 private:
     float maxError_{ 0.0f };
     bool fixDegenerations_{ false };
-    std::vector<Mesh>& mergedMeshes_;
+    const LeafMeshGetter& getLeafMesh_;
     const std::vector<Vector3f>& shifts_;
     bool collectNewFaces_{ false };
     bool mergeMode_{ false };
 };
 
+// orders given boxes so that the halves (as split by tbb::blocked_range) of any range in the order contain spatially close boxes
+static std::vector<int> orderByProximity( const std::vector<Box3d>& boxes )
+{
+    MR_TIMER
+    std::vector<int> order( boxes.size() );
+    std::iota( order.begin(), order.end(), 0 );
+    auto splitRange = [&]( auto&& self, int first, int last ) -> void
+    {
+        if ( last - first <= 2 )
+            return;
+        Box3d centersBox;
+        for ( int i = first; i < last; ++i )
+            centersBox.include( boxes[order[i]].center() );
+        const auto boxDiag = centersBox.size();
+        int axis = 0;
+        for ( int a = 1; a < 3; ++a )
+            if ( boxDiag[a] > boxDiag[axis] )
+                axis = a;
+        // the same middle as in tbb::blocked_range::split
+        const int middle = first + ( last - first ) / 2;
+        std::nth_element( order.begin() + first, order.begin() + middle, order.begin() + last, [&]( int a, int b )
+        {
+            const auto ca = boxes[a].center()[axis], cb = boxes[b].center()[axis];
+            return ca < cb || ( ca == cb && a < b );
+        } );
+        self( self, first, middle );
+        self( self, middle, last );
+    };
+    splitRange( splitRange, 0, int( order.size() ) );
+    return order;
+}
+
+// unites given meshes in a balanced tree of pairwise unions with spatially close meshes in neighbor leaves
+static Expected<Mesh, std::string> uniteManyMeshesTree( const std::vector<const Mesh*>& inputMeshes, const UniteManyMeshesParams& params )
+{
+    MR_TIMER
+    std::vector<const Mesh*> meshes;
+    meshes.reserve( inputMeshes.size() );
+    for ( auto m : inputMeshes )
+        if ( m )
+            meshes.push_back( m );
+    if ( meshes.empty() )
+        return Mesh{};
+
+    std::vector<Box3d> boxes( meshes.size() );
+    tbb::parallel_for( tbb::blocked_range<int>( 0, int( meshes.size() ) ), [&] ( const tbb::blocked_range<int>& range )
+    {
+        for ( int i = range.begin(); i < range.end(); ++i )
+            boxes[i] = Box3d( meshes[i]->getBoundingBox() );
+    } );
+    const auto order = orderByProximity( boxes );
+    if ( !reportProgress( params.progressCb, 0.1f ) )
+        return unexpectedOperationCanceled();
+
+    std::vector<Vector3f> randomShifts;
+    if ( params.useRandomShifts )
+    {
+        randomShifts.resize( meshes.size() );
+        std::mt19937 mt( params.randomShiftsSeed );
+        std::uniform_real_distribution<float> dist( -params.maxAllowedError * 0.5f, params.maxAllowedError * 0.5f );
+        for ( auto& shift : randomShifts )
+            for ( int i = 0; i < 3; ++i )
+                shift[i] = dist( mt );
+    }
+
+    // the copy of input mesh is made only when the reduction reaches its leaf
+    const LeafMeshGetter getLeafMesh = [&]( int i ) { return *meshes[order[i]]; };
+    const bool mergeNestedComponents = params.nestedComponentsMode == NestedComponenetsMode::Merge;
+    BooleanReduce reducer( getLeafMesh, randomShifts, params.maxAllowedError, params.fixDegenerations, params.newFaces != nullptr, mergeNestedComponents );
+    tbb::parallel_deterministic_reduce( tbb::blocked_range<int>( 0, int( meshes.size() ), 1 ), reducer );
+    if ( !reducer.error.empty() )
+        return unexpected( "Error while uniting meshes: " + reducer.error );
+
+    if ( !reportProgress( params.progressCb, 1.0f ) )
+        return unexpectedOperationCanceled();
+
+    if ( params.newFaces != nullptr )
+        *params.newFaces = std::move( reducer.newFaces );
+    return std::move( reducer.resultMesh );
+}
+
 Expected<Mesh, std::string> uniteManyMeshes( 
     const std::vector<const Mesh*>& meshes, const UniteManyMeshesParams& params /*= {} */ )
 {
     MR_TIMER
     if ( meshes.empty() )
         return Mesh{};
+    if ( params.treeReduction )
+        return uniteManyMeshesTree( meshes, params );
 
     bool separateComponentsProcess = params.nestedComponentsMode != NestedComponenetsMode::Union;
     bool mergeNestedComponents = params.nestedComponentsMode == NestedComponenetsMode::Merge;
@@ -319,7 +410,8 @@ Expected<Mesh, std::string> uniteManyMeshes(
     }
 
     // parallel reduce unite merged meshes
-    BooleanReduce reducer( mergedMeshes, randomShifts, params.maxAllowedError, params.fixDegenerations, params.newFaces != nullptr, mergeNestedComponents );
+    const LeafMeshGetter getLeafMesh = [&]( int i ) { return std::move( mergedMeshes[i] ); };
+    BooleanReduce reducer( getLeafMesh, randomShifts, params.maxAllowedError, params.fixDegenerations, params.newFaces != nullptr, mergeNestedComponents );
     tbb::parallel_deterministic_reduce( tbb::blocked_range<int>( 0, int( mergedMeshes.size() ), 1 ), reducer );
     if ( !reducer.error.empty() )
         return unexpected( "Error while uniting meshes: " + reducer.error );
@@ -332,4 +424,27 @@ Expected<Mesh, std::string> uniteManyMeshes(
     return reducer.resultMesh;
 }
 
+TEST( MRMesh, UniteManyMeshesTree )
+{
+    // a chain of overlapping spheres and few separate ones
+    std::vector<Mesh> spheres;
+    for ( int i = 0; i < 10; ++i )
+    {
+        auto sphere = makeUVSphere( 1.0f, 24, 24 );
+        const float x = i < 7 ? 1.5f * i : 5.0f * i;
+        sphere.transform( AffineXf3f::translation( Vector3f( x, 0.1f * ( i % 3 ), 0.05f * i ) ) );
+        spheres.push_back( std::move( sphere ) );
+    }
+    std::vector<const Mesh*> meshes;
+    for ( const auto& s : spheres )
+        meshes.push_back( &s );
+
+    auto ref = uniteManyMeshes( meshes );
+    ASSERT_TRUE( ref.has_value() );
+    auto res = uniteManyMeshes( meshes, { .treeReduction = true } );
+    ASSERT_TRUE( res.has_value() );
+    EXPECT_TRUE( res->topology.isClosed() );
+    EXPECT_NEAR( res->volume(), ref->volume(), 1e-3f * ref->volume() );
+}
+
 }
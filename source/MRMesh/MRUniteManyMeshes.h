@@ -35,6 +35,13 @@ struct UniteManyMeshesParams
     // read comment of NestedComponenetsMode enum for more information
     NestedComponenetsMode nestedComponentsMode{ NestedComponenetsMode::Remove };
 
+    // If true, the search for non-intersecting groups is skipped, and the meshes are united pairwise in a balanced tree,
+    // where the neighbor leaves are spatially close meshes (found by recursive median splits of the centers of their bounding boxes);
+    // independent unions of each tree level are performed in parallel and each mesh is copied from input only when it is needed,
+    // and released as soon as it is consumed by the next union;
+    // this mode is much faster for many meshes intersecting only few others (e.g. many small parts attached to one big body)
+    bool treeReduction{ false };
+
     ProgressCallback progressCb;
 };
 
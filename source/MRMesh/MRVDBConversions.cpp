@@ -426,7 +426,7 @@ VoidOrErrStr makeSignedWithFastWinding( FloatGrid& grid, const Vector3f& voxelSi
 
     std::vector<float> windVals;
     if ( !fwn )
-        fwn = std::make_shared<FastWindingNumber>( refMesh );
+        fwn = std::make_shared<PacketFastWindingNumber>( refMesh );
 
     if ( auto res = fwn->calcFromGrid( windVals, 
         Vector3i{ dims.x(),  dims.y(), dims.z() }, 
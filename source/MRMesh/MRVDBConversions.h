@@ -98,7 +98,7 @@ MRMESH_API Expected<Mesh> gridToMesh( FloatGrid&& grid, const GridToMeshSettings
 
 /// set signs for unsigned distance field grid using refMesh FastWindingNumber;
 /// \param meshToGridXf defines the mapping from mesh reference from to grid reference frame
-/// \param fwn defines particular implementation of IFastWindingNumber interface that will compute windings. If it is not specified, default FastWindingNumber is used
+/// \param fwn defines particular implementation of IFastWindingNumber interface that will compute windings. If it is not specified, default PacketFastWindingNumber is used
 MRMESH_API VoidOrErrStr makeSignedWithFastWinding( FloatGrid& grid, const Vector3f& voxelSize, const Mesh& refMesh,
     const AffineXf3f& meshToGridXf = {}, std::shared_ptr<IFastWindingNumber> fwn = {}, ProgressCallback cb = {} );
 
@@ -106,7 +106,7 @@ MRMESH_API VoidOrErrStr makeSignedWithFastWinding( FloatGrid& grid, const Vector
 // allowed only for closed meshes
 // adaptivity - [0.0;1.0] ratio of combining small triangles into bigger ones 
 //                       (curvature can be lost on high values)
-/// \param fwn defines particular implementation of IFastWindingNumber interface that will compute windings. If it is not specified, default FastWindingNumber is used
+/// \param fwn defines particular implementation of IFastWindingNumber interface that will compute windings. If it is not specified, default PacketFastWindingNumber is used
 MRMESH_API Expected<Mesh> levelSetDoubleConvertion( const MeshPart& mp, const AffineXf3f& xf,
     float voxelSize, float offsetA, float offsetB, float adaptivity = 0.0f, std::shared_ptr<IFastWindingNumber> fwn = {}, ProgressCallback cb = {} );
 
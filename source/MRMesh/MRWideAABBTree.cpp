@@ -0,0 +1,227 @@
+#include "MRWideAABBTree.h"
+#include "MRAABBTree.h"
+#include "MRMesh.h"
+#include "MRMeshPart.h"
+#include "MRTorus.h"
+#include "MRMeshProject.h"
+#include "MRMeshIntersect.h"
+#include "MRMeshCollide.h"
+#include "MRLine3.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <tuple>
+
+namespace MR
+{
+
+namespace
+{
+
+// computes the quantization step along given axis, such that decoded 255 is not less than box.max
+void setQuantization( WideAABBTreeNode & node, const Box3f & box )
+{
+    node.origin = box.min;
+    for ( int a = 0; a < 3; ++a )
+    {
+        node.scale[a] = ( box.max[a] - box.min[a] ) / 255;
+        while ( node.decode( a, 255 ) < box.max[a] )
+            node.scale[a] = std::nextafter( node.scale[a], FLT_MAX );
+    }
+}
+
+// stores conservatively quantized box of i-th child
+void quantizeChildBox( WideAABBTreeNode & node, int i, const Box3f & box )
+{
+    for ( int a = 0; a < 3; ++a )
+    {
+        if ( node.scale[a] <= 0 )
+        {
+            node.qmin[a][i] = node.qmax[a][i] = 0;
+            continue;
+        }
+        int qmin = std::clamp( int( std::floor( ( box.min[a] - node.origin[a] ) / node.scale[a] ) ), 0, 255 );
+        while ( qmin > 0 && node.decode( a, qmin ) > box.min[a] )
+            --qmin;
+        int qmax = std::clamp( int( std::ceil( ( box.max[a] - node.origin[a] ) / node.scale[a] ) ), qmin, 255 );
+        while ( qmax < 255 && node.decode( a, qmax ) < box.max[a] )
+            ++qmax;
+        node.qmin[a][i] = std::uint8_t( qmin );
+        node.qmax[a][i] = std::uint8_t( qmax );
+    }
+}
+
+} // anonymous namespace
+
+WideAABBTree::WideAABBTree( const AABBTree & tree )
+{
+    build_( tree );
+}
+
+WideAABBTree::WideAABBTree( const MeshPart & mp )
+{
+    if ( !mp.region )
+        build_( mp.mesh.getAABBTree() );
+    else
+        build_( AABBTree( mp ) );
+}
+
+void WideAABBTree::build_( const AABBTree & tree )
+{
+    MR_TIMER
+    nodes_.clear();
+    if ( tree.nodes().empty() )
+        return;
+
+    // most wide nodes consume 3 binary nodes
+    nodes_.reserve( tree.nodes().size() / 3 + 1 );
+
+    struct Task
+    {
+        AABBTree::NodeId binNode;
+        int wideNode = 0;
+    };
+    std::vector<Task> tasks;
+
+    // the number of faces in each binary subtree; children are always stored after their parent
+    Vector<int, AABBTree::NodeId> numLeaves( tree.nodes().size() );
+    for ( auto n = AABBTree::NodeId( tree.nodes().size() - 1 ); n.valid(); --n )
+    {
+        const auto & binNode = tree[n];
+        if ( binNode.leaf() )
+            numLeaves[n] = 1;
+        else
+        {
+            assert( binNode.l > n && binNode.r > n );
+            numLeaves[n] = numLeaves[binNode.l] + numLeaves[binNode.r];
+        }
+    }
+    // splitting a child makes sense if it has more faces than a wide node can reference,
+    // or if both its halves are leaves; otherwise the child becomes one (almost) full wide node itself
+    auto worthSplitting = [&]( AABBTree::NodeId n )
+    {
+        const auto & c = tree[n];
+        return !c.leaf() && ( numLeaves[n] > Width || ( tree[c.l].leaf() && tree[c.r].leaf() ) );
+    };
+
+    nodes_.emplace_back();
+    tasks.push_back( { tree.rootNodeId(), 0 } );
+
+    while ( !tasks.empty() )
+    {
+        const auto t = tasks.back();
+        tasks.pop_back();
+        const auto & binNode = tree[t.binNode];
+
+        // collect up to Width descendants by splitting the largest inner one, which is worth splitting
+        AABBTree::NodeId children[Width];
+        int numChildren = 0;
+        if ( binNode.leaf() )
+            children[numChildren++] = t.binNode; // the root of a tree with single face
+        else
+        {
+            children[numChildren++] = binNode.l;
+            children[numChildren++] = binNode.r;
+            while ( numChildren < Width )
+            {
+                int splitPos = -1;
+                float maxDiagSq = -1;
+                for ( int i = 0; i < numChildren; ++i )
+                {
+                    if ( !worthSplitting( children[i] ) )
+                        continue;
+                    const auto diagSq = tree[children[i]].box.size().lengthSq();
+                    if ( diagSq > maxDiagSq )
+                    {
+                        maxDiagSq = diagSq;
+                        splitPos = i;
+                    }
+                }
+                if ( splitPos < 0 )
+                    break;
+                const auto & c = tree[children[splitPos]];
+                children[numChildren++] = c.r;
+                children[splitPos] = c.l;
+            }
+        }
+
+        Node node;
+        setQuantization( node, binNode.box );
+        for ( int i = 0; i < numChildren; ++i )
+        {
+            const auto & c = tree[children[i]];
+            quantizeChildBox( node, i, c.box );
+            if ( c.leaf() )
+                node.child[i] = ~int( c.leafId() );
+            else
+            {
+                node.child[i] = int( nodes_.size() );
+                nodes_.emplace_back();
+                tasks.push_back( { children[i], node.child[i] } );
+            }
+        }
+        nodes_[t.wideNode] = node;
+    }
+    nodes_.shrink_to_fit();
+}
+
+TEST( MRMesh, WideAABBTree )
+{
+    Mesh torus = makeTorus( 2, 1, 32, 32 );
+    const auto & binTree = torus.getAABBTree();
+    WideAABBTree wideTree( binTree );
+    EXPECT_LT( wideTree.heapBytes(), binTree.heapBytes() / 2 );
+
+    // every face is referenced exactly once, and children boxes contain original face boxes
+    FaceBitSet faces( torus.topology.faceSize() );
+    for ( const auto & node : wideTree.nodes() )
+    {
+        for ( int i = 0; i < WideAABBTree::Width; ++i )
+        {
+            if ( !node.hasChild( i ) || !node.isLeaf( i ) )
+                continue;
+            const auto f = node.leafFace( i );
+            EXPECT_FALSE( faces.test( f ) );
+            faces.set( f );
+            Vector3f a, b, c;
+            torus.getTriPoints( f, a, b, c );
+            const auto box = node.childBox( i );
+            EXPECT_TRUE( box.contains( a ) && box.contains( b ) && box.contains( c ) );
+        }
+    }
+    EXPECT_EQ( faces, torus.topology.getValidFaces() );
+
+    // queries give the same results as with binary tree
+    for ( int i = 0; i < 50; ++i )
+    {
+        const Vector3f pt( 4 * std::sin( 0.3f * i ), 3 * std::cos( 0.7f * i ), 2 * std::sin( 1.1f * i ) );
+        const auto binProj = findProjection( pt, torus );
+        const auto wideProj = findProjectionSubtree( pt, torus, wideTree );
+        EXPECT_NEAR( binProj.distSq, wideProj.distSq, 1e-6f );
+
+        const Line3f line( pt, -pt );
+        const auto binHit = rayMeshIntersect( torus, line );
+        const auto wideHit = rayMeshIntersect( torus, wideTree, line );
+        EXPECT_EQ( binHit.has_value(), wideHit.has_value() );
+        if ( binHit && wideHit )
+        {
+            EXPECT_NEAR( binHit->distanceAlongLine, wideHit->distanceAlongLine, 1e-6f );
+        }
+    }
+
+    Mesh torus2 = makeTorus( 2, 1, 32, 32 );
+    const auto xf = AffineXf3f::translation( Vector3f( 0.5f, 0.3f, 0.1f ) );
+    torus2.transform( xf );
+    WideAABBTree wideTree2( torus2 );
+    auto binPairs = findCollidingTriangles( torus, torus2 );
+    auto widePairs = findCollidingTriangles( torus, wideTree, torus2, wideTree2 );
+    auto less = []( const FaceFace & x, const FaceFace & y ) { return std::tie( x.aFace, x.bFace ) < std::tie( y.aFace, y.bFace ); };
+    std::sort( binPairs.begin(), binPairs.end(), less );
+    std::sort( widePairs.begin(), widePairs.end(), less );
+    EXPECT_FALSE( binPairs.empty() );
+    EXPECT_EQ( binPairs, widePairs );
+}
+
+} // namespace MR
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRBox.h"
+#include "MRId.h"
+#include "MRVector3.h"
+#include <cstdint>
+#include <vector>
+
+namespace MR
+{
+
+/// \addtogroup AABBTreeGroup
+/// \{
+
+/// one node of WideAABBTree occupying exactly one cache line (64 bytes):
+/// it stores the bounding boxes of up to 4 children quantized with 8 bits per coordinate
+/// in the local frame of this node's box, and references to the children
+struct alignas( 64 ) WideAABBTreeNode
+{
+    static constexpr int Width = 4;
+
+    /// minimal corner of this node's box
+    Vector3f origin;
+    /// the size of one quantization step along each axis
+    Vector3f scale;
+    /// quantized boxes of the children stored per axis to process all children at once: qmin[axis][child]
+    std::uint8_t qmin[3][Width] = {};
+    std::uint8_t qmax[3][Width] = {};
+    /// child references: 0 - no child in this slot (the root is never a child),
+    /// positive value - index of inner node, negative value - ~FaceId of a leaf
+    std::int32_t child[Width] = {};
+
+    [[nodiscard]] bool hasChild( int i ) const { return child[i] != 0; }
+    [[nodiscard]] bool isLeaf( int i ) const { return child[i] < 0; }
+    [[nodiscard]] FaceId leafFace( int i ) const { assert( isLeaf( i ) ); return FaceId( ~child[i] ); }
+    [[nodiscard]] int childNode( int i ) const { assert( child[i] > 0 ); return child[i]; }
+
+    /// converts quantized coordinate back to the world coordinate along given axis
+    [[nodiscard]] float decode( int axis, int q ) const { return origin[axis] + float( q ) * scale[axis]; }
+    /// returns conservative (a bit larger than original) bounding box of i-th child
+    [[nodiscard]] Box3f childBox( int i ) const
+    {
+        return Box3f(
+            { decode( 0, qmin[0][i] ), decode( 1, qmin[1][i] ), decode( 2, qmin[2][i] ) },
+            { decode( 0, qmax[0][i] ), decode( 1, qmax[1][i] ), decode( 2, qmax[2][i] ) } );
+    }
+    /// returns conservative bounding box of this node
+    [[nodiscard]] Box3f box() const { return Box3f( origin, { decode( 0, 255 ), decode( 1, 255 ), decode( 2, 255 ) } ); }
+
+    /// computes squared distances from given point to the boxes of all children at once
+    void childDistSq( const Vector3f & pt, float ( &distSq )[Width] ) const
+    {
+        for ( int i = 0; i < Width; ++i )
+            distSq[i] = 0;
+        for ( int a = 0; a < 3; ++a )
+        {
+            for ( int i = 0; i < Width; ++i )
+            {
+                const float lo = decode( a, qmin[a][i] ) - pt[a];
+                const float hi = pt[a] - decode( a, qmax[a][i] );
+                const float d = std::max( std::max( lo, hi ), 0.0f );
+                distSq[i] += d * d;
+            }
+        }
+    }
+};
+static_assert( sizeof( WideAABBTreeNode ) == 64 );
+
+/// bounding volume hierarchy with 4 children per node and quantized children boxes;
+/// it is constructed by collapsing the levels of binary AABBTree, and occupies more than 2 times less memory than the original tree,
+/// making it suitable for caching of many large meshes and for memory-bound queries (projection, ray intersection, collision)
+class WideAABBTree
+{
+public:
+    using Node = WideAABBTreeNode;
+    static constexpr int Width = Node::Width;
+
+    WideAABBTree() = default;
+    /// creates wide tree from existing binary tree
+    [[nodiscard]] MRMESH_API explicit WideAABBTree( const AABBTree & tree );
+    /// creates wide tree for given mesh part, using cached binary tree of the mesh if the part is the whole mesh
+    [[nodiscard]] MRMESH_API explicit WideAABBTree( const MeshPart & mp );
+
+    [[nodiscard]] const std::vector<Node> & nodes() const { return nodes_; }
+    [[nodiscard]] const Node & operator[]( int n ) const { return nodes_[n]; }
+    [[nodiscard]] static int rootNodeId() { return 0; }
+    [[nodiscard]] bool empty() const { return nodes_.empty(); }
+    /// returns conservative bounding box of the whole tree
+    [[nodiscard]] Box3f getBoundingBox() const { return nodes_.empty() ? Box3f{} : nodes_.front().box(); }
+
+    /// returns the amount of memory this object occupies on heap
+    [[nodiscard]] size_t heapBytes() const { return nodes_.capacity() * sizeof( Node ); }
+
+private:
+    void build_( const AABBTree & tree );
+
+    std::vector<Node> nodes_;
+};
+
+/// \}
+
+} // namespace MR
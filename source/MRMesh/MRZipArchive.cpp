@@ -0,0 +1,751 @@
+#include "MRZipArchive.h"
+#include "MRDirectory.h"
+#include "MRParallelFor.h"
+#include "MRSerializer.h"
+#include "MRStringConvert.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+
+namespace MR
+{
+
+namespace
+{
+
+/// the size of independently compressed parts of one entry
+constexpr size_t cBlockSize = 1 << 20;
+
+/// the maximal ratio of uncompressed and compressed sizes, which can be achieved by Deflate
+constexpr std::uint64_t cMaxDeflateRatio = 1032;
+
+/// the total size of queued entries after which they are compressed and written
+constexpr size_t cMaxPendingBytes = size_t( 256 ) << 20;
+
+constexpr std::uint32_t cLocalHeaderSig = 0x04034b50;
+constexpr std::uint32_t cCentralHeaderSig = 0x02014b50;
+constexpr std::uint32_t cEndOfCentralDirSig = 0x06054b50;
+constexpr std::uint32_t cZip64EndOfCentralDirSig = 0x06064b50;
+constexpr std::uint32_t cZip64LocatorSig = 0x07064b50;
+constexpr std::uint16_t cZip64ExtraId = 0x0001;
+constexpr std::uint16_t cUtf8Flag = 0x0800;
+constexpr std::uint16_t cEncryptedFlag = 0x0001;
+constexpr std::uint16_t cMethodStore = 0;
+constexpr std::uint16_t cMethodDeflate = 8;
+constexpr std::uint32_t cMax32 = 0xFFFFFFFF;
+constexpr std::uint16_t cMax16 = 0xFFFF;
+
+void put16( std::string & s, std::uint16_t v )
+{
+    s.push_back( char( v & 0xFF ) );
+    s.push_back( char( v >> 8 ) );
+}
+
+void put32( std::string & s, std::uint32_t v )
+{
+    put16( s, std::uint16_t( v & 0xFFFF ) );
+    put16( s, std::uint16_t( v >> 16 ) );
+}
+
+void put64( std::string & s, std::uint64_t v )
+{
+    put32( s, std::uint32_t( v & cMax32 ) );
+    put32( s, std::uint32_t( v >> 32 ) );
+}
+
+std::uint16_t get16( const char * p )
+{
+    const auto * u = (const unsigned char *)p;
+    return std::uint16_t( u[0] | ( u[1] << 8 ) );
+}
+
+std::uint32_t get32( const char * p )
+{
+    return std::uint32_t( get16( p ) ) | ( std::uint32_t( get16( p + 2 ) ) << 16 );
+}
+
+std::uint64_t get64( const char * p )
+{
+    return std::uint64_t( get32( p ) ) | ( std::uint64_t( get32( p + 4 ) ) << 32 );
+}
+
+std::uint32_t computeCrc( const char * data, size_t size, std::uint32_t crc = 0 )
+{
+    // zlib takes the length as 32-bit integer
+    constexpr size_t cMaxPortion = size_t( 1 ) << 30;
+    while ( size > 0 )
+    {
+        const auto n = std::min( size, cMaxPortion );
+        crc = (std::uint32_t)crc32( crc, (const Bytef*)data, uInt( n ) );
+        data += n;
+        size -= n;
+    }
+    return crc;
+}
+
+/// compresses one block of the entry in raw Deflate format;
+/// all blocks except the last one are terminated by sync flush, so their concatenation is a valid Deflate stream
+bool deflateBlock( const char * data, size_t size, int level, bool last, std::string & out )
+{
+    z_stream stream{};
+    if ( deflateInit2( &stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+        return false;
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = uInt( size );
+    out.resize( deflateBound( &stream, uLong( size ) ) + 16 );
+    size_t written = 0;
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    bool ok = true;
+    for ( ;; )
+    {
+        stream.next_out = (Bytef*)out.data() + written;
+        stream.avail_out = uInt( out.size() - written );
+        const int ret = deflate( &stream, flush );
+        written = out.size() - stream.avail_out;
+        if ( ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR )
+        {
+            ok = false;
+            break;
+        }
+        if ( last ? ret == Z_STREAM_END : stream.avail_out > 0 )
+            break;
+        out.resize( out.size() * 2 );
+    }
+    deflateEnd( &stream );
+    out.resize( written );
+    return ok;
+}
+
+void currentDosTime( std::uint16_t & time, std::uint16_t & date )
+{
+    const std::time_t t = std::time( nullptr );
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s( &tm, &t );
+#else
+    localtime_r( &t, &tm );
+#endif
+    time = std::uint16_t( ( tm.tm_hour << 11 ) | ( tm.tm_min << 5 ) | ( tm.tm_sec / 2 ) );
+    date = std::uint16_t( ( std::max( tm.tm_year - 80, 0 ) << 9 ) | ( ( tm.tm_mon + 1 ) << 5 ) | tm.tm_mday );
+}
+
+} // anonymous namespace
+
+Expected<ZipArchiveWriter, std::string> ZipArchiveWriter::create( const std::filesystem::path & zipFile, int compressionLevel )
+{
+    ZipArchiveWriter res;
+    res.out_ = std::make_unique<std::ofstream>( zipFile, std::ofstream::binary );
+    if ( !*res.out_ )
+        return unexpected( std::string( "Cannot open file for writing " ) + utf8string( zipFile ) );
+    res.level_ = std::clamp( compressionLevel, -1, 9 );
+    currentDosTime( res.dosTime_, res.dosDate_ );
+    return res;
+}
+
+VoidOrErrStr ZipArchiveWriter::addDirectory( std::string name )
+{
+    if ( name.empty() || name.back() != '/' )
+        name.push_back( '/' );
+    pending_.push_back( { std::move( name ), {} } );
+    return {};
+}
+
+VoidOrErrStr ZipArchiveWriter::addFile( std::string name, std::string content, ProgressCallback cb )
+{
+    assert( !name.empty() && name.back() != '/' );
+    pendingBytes_ += content.size();
+    pending_.push_back( { std::move( name ), std::move( content ) } );
+    if ( pendingBytes_ >= cMaxPendingBytes )
+        return flush_( cb );
+    return {};
+}
+
+VoidOrErrStr ZipArchiveWriter::addFile( std::string name, const std::filesystem::path & file, ProgressCallback cb )
+{
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return unexpected( "Cannot open file " + utf8string( file ) + " for reading" );
+    in.seekg( 0, std::ios_base::end );
+    const auto size = in.tellg();
+    in.seekg( 0 );
+    std::string content;
+    content.resize( size_t( size ) );
+    if ( !in.read( content.data(), content.size() ) )
+        return unexpected( "Cannot read file " + utf8string( file ) );
+    return addFile( std::move( name ), std::move( content ), cb );
+}
+
+VoidOrErrStr ZipArchiveWriter::addFolder( const std::filesystem::path & folder, ProgressCallback cb )
+{
+    MR_TIMER
+    std::error_code ec;
+    if ( !std::filesystem::is_directory( folder, ec ) )
+        return unexpected( "Directory '" + utf8string( folder ) + "' does not exist" );
+
+    auto archivePath = [&] ( const std::filesystem::path & path )
+    {
+        auto res = utf8string( std::filesystem::relative( path, folder, ec ) );
+        // convert folder separators in Linux style for the latest 7-zip to open archive correctly
+        std::replace( res.begin(), res.end(), '\\', '/' );
+        return res;
+    };
+
+    std::vector<std::filesystem::path> files;
+    for ( auto entry : DirectoryRecursive{ folder, ec } )
+    {
+        const auto path = entry.path();
+        if ( entry.is_directory( ec ) )
+        {
+            if ( path == folder )
+                continue;
+            if ( auto res = addDirectory( archivePath( path ) ); !res )
+                return res;
+        }
+        else if ( entry.is_regular_file( ec ) )
+            files.push_back( path );
+    }
+
+    for ( size_t i = 0; i < files.size(); ++i )
+    {
+        // the progress is approximated by the number of added files
+        if ( auto res = addFile( archivePath( files[i] ), files[i] ); !res )
+            return res;
+        if ( !reportProgress( cb, float( i + 1 ) / files.size() ) )
+            return unexpectedOperationCanceled();
+    }
+    return {};
+}
+
+void ZipArchiveWriter::writeLocalHeader_( const Record & r )
+{
+    const bool zip64 = r.size >= cMax32 || r.compressedSize >= cMax32;
+    std::string h;
+    put32( h, cLocalHeaderSig );
+    put16( h, zip64 ? 45 : 20 );
+    put16( h, cUtf8Flag );
+    put16( h, r.method );
+    put16( h, dosTime_ );
+    put16( h, dosDate_ );
+    put32( h, r.crc );
+    put32( h, zip64 ? cMax32 : std::uint32_t( r.compressedSize ) );
+    put32( h, zip64 ? cMax32 : std::uint32_t( r.size ) );
+    put16( h, std::uint16_t( r.name.size() ) );
+    put16( h, zip64 ? 20 : 0 );
+    h += r.name;
+    if ( zip64 )
+    {
+        put16( h, cZip64ExtraId );
+        put16( h, 16 );
+        put64( h, r.size );
+        put64( h, r.compressedSize );
+    }
+    out_->write( h.data(), h.size() );
+    offset_ += h.size();
+}
+
+VoidOrErrStr ZipArchiveWriter::flush_( ProgressCallback cb )
+{
+    MR_TIMER
+    assert( out_ );
+    if ( pending_.empty() )
+        return {};
+
+    // split all entries on blocks to compress them in parallel
+    struct Block
+    {
+        size_t entry = 0;
+        size_t begin = 0;
+        size_t end = 0;
+        std::uint32_t crc = 0;
+        std::string compressed;
+    };
+    std::vector<Block> blocks;
+    for ( size_t i = 0; i < pending_.size(); ++i )
+    {
+        const auto size = pending_[i].content.size();
+        size_t begin = 0;
+        do
+        {
+            const auto end = std::min( begin + cBlockSize, size );
+            blocks.push_back( { .entry = i, .begin = begin, .end = end } );
+            begin = end;
+        } while ( begin < size );
+    }
+
+    std::atomic<bool> failed{ false };
+    const bool store = level_ == 0;
+    const bool keepGoing = ParallelFor( size_t( 0 ), blocks.size(), [&] ( size_t i )
+    {
+        auto & b = blocks[i];
+        const auto & content = pending_[b.entry].content;
+        b.crc = computeCrc( content.data() + b.begin, b.end - b.begin );
+        if ( !store && !deflateBlock( content.data() + b.begin, b.end - b.begin, level_, b.end == content.size(), b.compressed ) )
+            failed = true;
+    }, subprogress( cb, 0.0f, 0.9f ), 1 );
+    if ( !keepGoing )
+        return unexpectedOperationCanceled();
+    if ( failed )
+        return unexpected( std::string( "Cannot compress zip entry" ) );
+
+    size_t firstBlock = 0;
+    for ( size_t i = 0; i < pending_.size(); ++i )
+    {
+        auto & p = pending_[i];
+        Record r;
+        r.name = std::move( p.name );
+        r.directory = !r.name.empty() && r.name.back() == '/';
+        r.method = store || r.directory ? cMethodStore : cMethodDeflate;
+        r.size = p.content.size();
+        r.localHeaderOffset = offset_;
+
+        size_t lastBlock = firstBlock;
+        while ( lastBlock < blocks.size() && blocks[lastBlock].entry == i )
+        {
+            const auto & b = blocks[lastBlock];
+            r.crc = lastBlock == firstBlock ? b.crc : (std::uint32_t)crc32_combine( r.crc, b.crc, z_off_t( b.end - b.begin ) );
+            r.compressedSize += r.method == cMethodStore ? b.end - b.begin : b.compressed.size();
+            ++lastBlock;
+        }
+        if ( r.directory )
+            r.compressedSize = 0;
+
+        writeLocalHeader_( r );
+        if ( r.method == cMethodStore )
+            out_->write( p.content.data(), p.content.size() );
+        else
+            for ( size_t j = firstBlock; j < lastBlock; ++j )
+                out_->write( blocks[j].compressed.data(), blocks[j].compressed.size() );
+        offset_ += r.compressedSize;
+        if ( !*out_ )
+            return unexpected( std::string( "Cannot write zip entry " ) + r.name );
+
+        // release the memory as soon as possible
+        p.content = {};
+        for ( size_t j = firstBlock; j < lastBlock; ++j )
+            blocks[j].compressed = {};
+        firstBlock = lastBlock;
+        records_.push_back( std::move( r ) );
+        if ( !reportProgress( cb, 0.9f + 0.1f * float( i + 1 ) / pending_.size() ) )
+            return unexpectedOperationCanceled();
+    }
+    pending_.clear();
+    pendingBytes_ = 0;
+    return {};
+}
+
+VoidOrErrStr ZipArchiveWriter::finish( ProgressCallback cb )
+{
+    MR_TIMER
+    if ( !out_ )
+        return unexpected( std::string( "Zip archive is not open" ) );
+    if ( auto res = flush_( cb ); !res )
+        return res;
+
+    std::string cd;
+    for ( const auto & r : records_ )
+    {
+        std::string extra;
+        if ( r.size >= cMax32 || r.compressedSize >= cMax32 || r.localHeaderOffset >= cMax32 )
+        {
+            // in central directory zip64 extra field has only the values that do not fit in 32 bits
+            std::string fields;
+            if ( r.size >= cMax32 )
+                put64( fields, r.size );
+            if ( r.compressedSize >= cMax32 )
+                put64( fields, r.compressedSize );
+            if ( r.localHeaderOffset >= cMax32 )
+                put64( fields, r.localHeaderOffset );
+            put16( extra, cZip64ExtraId );
+            put16( extra, std::uint16_t( fields.size() ) );
+            extra += fields;
+        }
+        put32( cd, cCentralHeaderSig );
+        put16( cd, 45 );
+        put16( cd, extra.empty() ? 20 : 45 );
+        put16( cd, cUtf8Flag );
+        put16( cd, r.method );
+        put16( cd, dosTime_ );
+        put16( cd, dosDate_ );
+        put32( cd, r.crc );
+        put32( cd, std::uint32_t( std::min<std::uint64_t>( r.compressedSize, cMax32 ) ) );
+        put32( cd, std::uint32_t( std::min<std::uint64_t>( r.size, cMax32 ) ) );
+        put16( cd, std::uint16_t( r.name.size() ) );
+        put16( cd, std::uint16_t( extra.size() ) );
+        put16( cd, 0 ); // comment length
+        put16( cd, 0 ); // disk number
+        put16( cd, 0 ); // internal attributes
+        put32( cd, r.directory ? 0x10 : 0 ); // external attributes: MS-DOS directory flag
+        put32( cd, std::uint32_t( std::min<std::uint64_t>( r.localHeaderOffset, cMax32 ) ) );
+        cd += r.name;
+        cd += extra;
+    }
+
+    const std::uint64_t cdOffset = offset_;
+    const std::uint64_t cdSize = cd.size();
+    const std::uint64_t numEntries = records_.size();
+    if ( numEntries >= cMax16 || cdOffset >= cMax32 || cdSize >= cMax32 )
+    {
+        const std::uint64_t zip64EndOffset = cdOffset + cdSize;
+        put32( cd, cZip64EndOfCentralDirSig );
+        put64( cd, 44 ); // the size of remaining record
+        put16( cd, 45 );
+        put16( cd, 45 );
+        put32( cd, 0 );
+        put32( cd, 0 );
+        put64( cd, numEntries );
+        put64( cd, numEntries );
+        put64( cd, cdSize );
+        put64( cd, cdOffset );
+
+        put32( cd, cZip64LocatorSig );
+        put32( cd, 0 );
+        put64( cd, zip64EndOffset );
+        put32( cd, 1 );
+    }
+    put32( cd, cEndOfCentralDirSig );
+    put16( cd, 0 );
+    put16( cd, 0 );
+    put16( cd, std::uint16_t( std::min<std::uint64_t>( numEntries, cMax16 ) ) );
+    put16( cd, std::uint16_t( std::min<std::uint64_t>( numEntries, cMax16 ) ) );
+    put32( cd, std::uint32_t( std::min<std::uint64_t>( cdSize, cMax32 ) ) );
+    put32( cd, std::uint32_t( std::min<std::uint64_t>( cdOffset, cMax32 ) ) );
+    put16( cd, 0 ); // comment length
+
+    out_->write( cd.data(), cd.size() );
+    out_->close();
+    const bool ok = !out_->fail();
+    out_.reset();
+    if ( !ok )
+        return unexpected( std::string( "Cannot write zip central directory" ) );
+    return {};
+}
+
+Expected<ZipArchiveReader, std::string> ZipArchiveReader::open( const std::filesystem::path & zipFile )
+{
+    MR_TIMER
+    auto mapped = MappedFile::open( zipFile );
+    if ( !mapped )
+        return unexpected( std::move( mapped.error() ) );
+
+    ZipArchiveReader res;
+    res.file_ = std::move( *mapped );
+    const char * data = res.file_.data();
+    const size_t size = res.file_.size();
+
+    // end of central directory record is in the end of the file before optional comment of at most 64K
+    constexpr size_t cEndSize = 22;
+    if ( size < cEndSize )
+        return unexpected( std::string( "Not a zip-archive: " ) + utf8string( zipFile ) );
+    size_t endPos = size - cEndSize;
+    const size_t minEndPos = size > cEndSize + cMax16 ? size - cEndSize - cMax16 : 0;
+    while ( get32( data + endPos ) != cEndOfCentralDirSig )
+    {
+        if ( endPos == minEndPos )
+            return unexpected( std::string( "Not a zip-archive: " ) + utf8string( zipFile ) );
+        --endPos;
+    }
+    std::uint64_t numEntries = get16( data + endPos + 10 );
+    std::uint64_t cdSize = get32( data + endPos + 12 );
+    std::uint64_t cdOffset = get32( data + endPos + 16 );
+
+    constexpr size_t cLocatorSize = 20;
+    if ( endPos >= cLocatorSize && get32( data + endPos - cLocatorSize ) == cZip64LocatorSig )
+    {
+        const auto zip64EndPos = get64( data + endPos - cLocatorSize + 8 );
+        if ( zip64EndPos + 56 > size || get32( data + zip64EndPos ) != cZip64EndOfCentralDirSig )
+            return unexpected( std::string( "Damaged zip64 end of central directory" ) );
+        numEntries = get64( data + zip64EndPos + 32 );
+        cdSize = get64( data + zip64EndPos + 40 );
+        cdOffset = get64( data + zip64EndPos + 48 );
+    }
+    if ( cdOffset > size || cdSize > size - cdOffset )
+        return unexpected( std::string( "Damaged zip central directory" ) );
+
+    constexpr size_t cCentralHeaderSize = 46;
+    const char * p = data + cdOffset;
+    const char * cdEnd = p + cdSize;
+    res.entries_.reserve( size_t( std::min( numEntries, cdSize / cCentralHeaderSize ) ) );
+    for ( std::uint64_t i = 0; i < numEntries; ++i )
+    {
+        if ( cdEnd - p < (std::ptrdiff_t)cCentralHeaderSize || get32( p ) != cCentralHeaderSig )
+            return unexpected( std::string( "Damaged zip central directory" ) );
+        const auto flags = get16( p + 8 );
+        Entry e;
+        e.method = get16( p + 10 );
+        e.crc = get32( p + 16 );
+        e.compressedSize = get32( p + 20 );
+        e.size = get32( p + 24 );
+        const auto nameLen = get16( p + 28 );
+        const auto extraLen = get16( p + 30 );
+        const auto commentLen = get16( p + 32 );
+        e.localHeaderOffset = get32( p + 42 );
+        if ( cdEnd - p < (std::ptrdiff_t)( cCentralHeaderSize + nameLen + extraLen + commentLen ) )
+            return unexpected( std::string( "Damaged zip central directory" ) );
+        e.name.assign( p + cCentralHeaderSize, nameLen );
+        std::replace( e.name.begin(), e.name.end(), '\\', '/' );
+
+        // replace saturated values from zip64 extra field
+        const char * extra = p + cCentralHeaderSize + nameLen;
+        const char * extraEnd = extra + extraLen;
+        while ( extraEnd - extra >= 4 )
+        {
+            const auto id = get16( extra );
+            const auto len = get16( extra + 2 );
+            const char * field = extra + 4;
+            if ( extraEnd - field < len )
+                break;
+            if ( id == cZip64ExtraId )
+            {
+                const char * fieldEnd = field + len;
+                for ( auto * v : { &e.size, &e.compressedSize, &e.localHeaderOffset } )
+                {
+                    if ( *v != cMax32 )
+                        continue;
+                    if ( fieldEnd - field < 8 )
+                        return unexpected( std::string( "Damaged zip64 extra field" ) );
+                    *v = get64( field );
+                    field += 8;
+                }
+            }
+            extra += 4 + len;
+        }
+
+        if ( flags & cEncryptedFlag )
+            return unexpected( "Encrypted zip entry is not supported: " + e.name );
+        if ( e.method != cMethodStore && e.method != cMethodDeflate )
+            return unexpected( "Unsupported compression method of zip entry: " + e.name );
+        p += cCentralHeaderSize + nameLen + extraLen + commentLen;
+        res.entries_.push_back( std::move( e ) );
+    }
+    return res;
+}
+
+int ZipArchiveReader::find( std::string_view name ) const
+{
+    for ( size_t i = 0; i < entries_.size(); ++i )
+        if ( entries_[i].name == name )
+            return int( i );
+    return -1;
+}
+
+Expected<std::string, std::string> ZipArchiveReader::read( size_t index ) const
+{
+    assert( index < entries_.size() );
+    const auto & e = entries_[index];
+    const char * data = file_.data();
+    const size_t size = file_.size();
+
+    constexpr size_t cLocalHeaderSize = 30;
+    if ( e.localHeaderOffset + cLocalHeaderSize > size || get32( data + e.localHeaderOffset ) != cLocalHeaderSig )
+        return unexpected( "Damaged zip entry " + e.name );
+    const auto dataOffset = e.localHeaderOffset + cLocalHeaderSize
+        + get16( data + e.localHeaderOffset + 26 ) + get16( data + e.localHeaderOffset + 28 );
+    if ( dataOffset > size || e.compressedSize > size - dataOffset )
+        return unexpected( "Damaged zip entry " + e.name );
+    const char * compressed = data + dataOffset;
+
+    std::string res;
+    if ( e.method == cMethodStore )
+    {
+        if ( e.compressedSize != e.size )
+            return unexpected( "Damaged zip entry " + e.name );
+        res.assign( compressed, size_t( e.size ) );
+    }
+    else
+    {
+        // do not trust the size from the archive before allocating the memory for it
+        if ( e.size > e.compressedSize * cMaxDeflateRatio + 1024 )
+            return unexpected( "Damaged zip entry " + e.name );
+        res.resize( size_t( e.size ) );
+        z_stream stream{};
+        if ( inflateInit2( &stream, -MAX_WBITS ) != Z_OK )
+            return unexpected( "Cannot decompress zip entry " + e.name );
+        // zlib takes the lengths as 32-bit integers
+        constexpr std::uint64_t cMaxPortion = std::uint64_t( 1 ) << 30;
+        std::uint64_t inLeft = e.compressedSize, outLeft = e.size;
+        stream.next_in = (Bytef*)compressed;
+        stream.next_out = (Bytef*)res.data();
+        int ret = Z_OK;
+        while ( ret == Z_OK )
+        {
+            if ( stream.avail_in == 0 )
+            {
+                stream.avail_in = uInt( std::min( inLeft, cMaxPortion ) );
+                inLeft -= stream.avail_in;
+            }
+            if ( stream.avail_out == 0 )
+            {
+                stream.avail_out = uInt( std::min( outLeft, cMaxPortion ) );
+                outLeft -= stream.avail_out;
+            }
+            ret = inflate( &stream, Z_NO_FLUSH );
+            // no progress was possible: continue only if the exhausted buffer will be refilled, otherwise the entry is truncated or damaged
+            if ( ret == Z_BUF_ERROR && ( ( stream.avail_in == 0 && inLeft > 0 ) || ( stream.avail_out == 0 && outLeft > 0 ) ) )
+                ret = Z_OK;
+        }
+        const bool ok = ret == Z_STREAM_END && outLeft == 0 && stream.avail_out == 0;
+        inflateEnd( &stream );
+        if ( !ok )
+            return unexpected( "Cannot decompress zip entry " + e.name );
+    }
+    if ( computeCrc( res.data(), res.size() ) != e.crc )
+        return unexpected( "Wrong checksum of zip entry " + e.name );
+    return res;
+}
+
+VoidOrErrStr ZipArchiveReader::extractAll( const std::filesystem::path & targetFolder, ProgressCallback cb ) const
+{
+    MR_TIMER
+    std::error_code ec;
+    if ( !std::filesystem::is_directory( targetFolder, ec ) )
+        return unexpected( "Directory does not exist " + utf8string( targetFolder ) );
+
+    // create all folders in advance, and then write the files in parallel
+    std::vector<std::filesystem::path> paths( entries_.size() );
+    std::vector<size_t> files;
+    for ( size_t i = 0; i < entries_.size(); ++i )
+    {
+        auto relativeName = pathFromUtf8( entries_[i].name ).lexically_normal();
+        if ( relativeName.is_absolute() || ( !relativeName.empty() && *relativeName.begin() == ".." ) )
+            return unexpected( "Zip entry is outside of target folder: " + entries_[i].name );
+        relativeName.make_preferred();
+        paths[i] = targetFolder / relativeName;
+        const auto folder = entries_[i].isDirectory() ? paths[i] : paths[i].parent_path();
+        if ( !std::filesystem::exists( folder, ec ) && !std::filesystem::create_directories( folder, ec ) )
+            return unexpected( "Cannot create folder " + utf8string( folder ) );
+        if ( !entries_[i].isDirectory() )
+            files.push_back( i );
+    }
+
+    std::mutex errorMutex;
+    std::string error;
+    const bool keepGoing = ParallelFor( size_t( 0 ), files.size(), [&] ( size_t j )
+    {
+        const auto i = files[j];
+        auto content = read( i );
+        std::string myError;
+        if ( !content )
+            myError = std::move( content.error() );
+        else
+        {
+            std::ofstream ofs( paths[i], std::ios::binary );
+            if ( !ofs || !ofs.write( content->data(), content->size() ) )
+                myError = "Cannot write file from zip " + utf8string( paths[i] );
+        }
+        if ( !myError.empty() )
+        {
+            std::lock_guard lock( errorMutex );
+            if ( error.empty() )
+                error = std::move( myError );
+        }
+    }, cb, 1 );
+
+    if ( !keepGoing )
+        return unexpectedOperationCanceled();
+    if ( !error.empty() )
+        return unexpected( std::move( error ) );
+    return {};
+}
+
+VoidOrErrStr compressZipParallel( const std::filesystem::path & zipFile, const std::filesystem::path & sourceFolder,
+    int compressionLevel, ProgressCallback cb )
+{
+    MR_TIMER
+    if ( !reportProgress( cb, 0.0f ) )
+        return unexpectedOperationCanceled();
+
+    auto zip = ZipArchiveWriter::create( zipFile, compressionLevel );
+    if ( !zip )
+        return unexpected( std::move( zip.error() ) );
+    if ( auto res = zip->addFolder( sourceFolder, subprogress( cb, 0.0f, 0.9f ) ); !res )
+        return res;
+    return zip->finish( subprogress( cb, 0.9f, 1.0f ) );
+}
+
+TEST( MRMesh, ZipArchive )
+{
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+
+    std::string big( 3 * cBlockSize + 12345, '\0' );
+    for ( size_t i = 0; i < big.size(); ++i )
+        big[i] = char( ( i * 7919 ) % 251 );
+    const std::string text = "{ \"Name\" : \"test\" }";
+
+    for ( int level : { 0, 1, -1 } )
+    {
+        const auto zipPath = folder / ( "test" + std::to_string( level ) + ".zip" );
+        {
+            auto zip = ZipArchiveWriter::create( zipPath, level );
+            ASSERT_TRUE( zip.has_value() );
+            EXPECT_TRUE( zip->addFile( "scene.json", text ).has_value() );
+            EXPECT_TRUE( zip->addDirectory( "scene" ).has_value() );
+            EXPECT_TRUE( zip->addFile( "scene/big.bin", big ).has_value() );
+            EXPECT_TRUE( zip->addFile( "scene/empty.bin", std::string() ).has_value() );
+            EXPECT_TRUE( zip->finish().has_value() );
+        }
+
+        auto zip = ZipArchiveReader::open( zipPath );
+        ASSERT_TRUE( zip.has_value() );
+        ASSERT_EQ( zip->entries().size(), 4 );
+        EXPECT_TRUE( zip->entries()[1].isDirectory() );
+        if ( level != 0 )
+        {
+            EXPECT_LT( zip->entries()[2].compressedSize, big.size() / 2 );
+        }
+
+        // single entry without extracting the others
+        const auto jsonIndex = zip->find( "scene.json" );
+        ASSERT_EQ( jsonIndex, 0 );
+        auto json = zip->read( jsonIndex );
+        ASSERT_TRUE( json.has_value() );
+        EXPECT_EQ( *json, text );
+
+        const auto target = folder / ( "extracted" + std::to_string( level ) );
+        std::error_code ec;
+        std::filesystem::create_directory( target, ec );
+        EXPECT_TRUE( zip->extractAll( target ).has_value() );
+        std::ifstream in( target / "scene" / "big.bin", std::ifstream::binary );
+        std::string extracted( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+        EXPECT_EQ( extracted, big );
+        EXPECT_EQ( std::filesystem::file_size( target / "scene" / "empty.bin", ec ), 0 );
+    }
+
+    // the uncompressed size of deflated entry in central directory is much larger than possible
+    {
+        const auto zipPath = folder / "damaged.zip";
+        {
+            auto zip = ZipArchiveWriter::create( zipPath, 1 );
+            ASSERT_TRUE( zip.has_value() );
+            EXPECT_TRUE( zip->addFile( "big.bin", big ).has_value() );
+            EXPECT_TRUE( zip->finish().has_value() );
+        }
+        std::string bytes;
+        {
+            std::ifstream in( zipPath, std::ifstream::binary );
+            bytes.assign( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+        }
+        const auto central = bytes.find( "PK\x01\x02" );
+        ASSERT_NE( central, std::string::npos );
+        std::memset( bytes.data() + central + 24, 0x7F, 4 );
+        {
+            std::ofstream out( zipPath, std::ofstream::binary );
+            out.write( bytes.data(), bytes.size() );
+        }
+        auto zip = ZipArchiveReader::open( zipPath );
+        ASSERT_TRUE( zip.has_value() );
+        ASSERT_EQ( zip->entries().size(), 1 );
+        EXPECT_EQ( zip->entries()[0].size, 0x7F7F7F7F );
+        EXPECT_FALSE( zip->read( 0 ).has_value() );
+    }
+}
+
+} // namespace MR
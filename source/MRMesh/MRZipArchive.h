@@ -0,0 +1,119 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include "MRMappedFile.h"
+#include "MRProgressCallback.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace MR
+{
+
+/// \addtogroup SerializerGroup
+/// \{
+
+/// writes zip-archive directly from memory: the entries are compressed by blocks in parallel threads
+/// and appended to the archive in the order of their addition without any intermediate files
+class ZipArchiveWriter
+{
+public:
+    /// creates new archive in given file;
+    /// \param compressionLevel 0 - store the entries without compression (the fastest, e.g. for local autosaves),
+    /// 1..9 - Deflate from the fastest to the best compression, -1 - default Deflate level
+    [[nodiscard]] MRMESH_API static Expected<ZipArchiveWriter, std::string> create( const std::filesystem::path & zipFile, int compressionLevel = -1 );
+
+    /// adds directory entry, e.g. "Folder/"
+    MRMESH_API VoidOrErrStr addDirectory( std::string name );
+    /// queues file entry with given name and content;
+    /// the queued entries are compressed and written when their total size becomes large enough or in finish()
+    MRMESH_API VoidOrErrStr addFile( std::string name, std::string content, ProgressCallback cb = {} );
+    /// reads given file from disk and queues it as an entry with given name
+    MRMESH_API VoidOrErrStr addFile( std::string name, const std::filesystem::path & file, ProgressCallback cb = {} );
+    /// adds all subfolders and files of given folder with the names relative to it
+    MRMESH_API VoidOrErrStr addFolder( const std::filesystem::path & folder, ProgressCallback cb = {} );
+
+    /// compresses and writes all queued entries, and then the central directory of the archive
+    MRMESH_API VoidOrErrStr finish( ProgressCallback cb = {} );
+
+private:
+    struct Record
+    {
+        std::string name;
+        std::uint64_t size = 0;
+        std::uint64_t compressedSize = 0;
+        std::uint64_t localHeaderOffset = 0;
+        std::uint32_t crc = 0;
+        std::uint16_t method = 0;
+        bool directory = false;
+    };
+    struct Pending
+    {
+        std::string name;
+        std::string content;
+    };
+
+    VoidOrErrStr flush_( ProgressCallback cb );
+    void writeLocalHeader_( const Record & r );
+
+    std::unique_ptr<std::ofstream> out_;
+    int level_ = -1;
+    std::uint16_t dosTime_ = 0;
+    std::uint16_t dosDate_ = 0;
+    std::uint64_t offset_ = 0;
+    std::vector<Record> records_;
+    std::vector<Pending> pending_;
+    size_t pendingBytes_ = 0;
+};
+
+/// reads zip-archive mapped in memory, which allows one to decompress any entry without touching the others,
+/// and to decompress many entries in parallel;
+/// only not-encrypted entries stored without compression or with Deflate are supported
+class ZipArchiveReader
+{
+public:
+    struct Entry
+    {
+        /// the name of the entry inside the archive with '/' as separator
+        std::string name;
+        std::uint64_t size = 0;
+        std::uint64_t compressedSize = 0;
+        std::uint64_t localHeaderOffset = 0;
+        std::uint32_t crc = 0;
+        std::uint16_t method = 0;
+        [[nodiscard]] bool isDirectory() const { return !name.empty() && name.back() == '/'; }
+    };
+
+    /// opens the archive and reads its central directory;
+    /// returns error if the archive has encrypted entries or the entries with unsupported compression
+    [[nodiscard]] MRMESH_API static Expected<ZipArchiveReader, std::string> open( const std::filesystem::path & zipFile );
+
+    [[nodiscard]] const std::vector<Entry> & entries() const { return entries_; }
+    /// returns the index of the entry with given name or -1 if it is absent
+    [[nodiscard]] MRMESH_API int find( std::string_view name ) const;
+
+    /// decompresses one entry in memory; can be called from parallel threads
+    [[nodiscard]] MRMESH_API Expected<std::string, std::string> read( size_t index ) const;
+
+    /// extracts all entries in given folder decompressing them in parallel threads
+    MRMESH_API VoidOrErrStr extractAll( const std::filesystem::path & targetFolder, ProgressCallback cb = {} ) const;
+
+private:
+    MappedFile file_;
+    std::vector<Entry> entries_;
+};
+
+/// compresses given folder in given zip-file as compressZip does (without password),
+/// but the files are compressed in parallel threads and written directly in the archive;
+/// \param compressionLevel 0 - store the files without compression, 1..9 - Deflate levels, -1 - default Deflate level
+MRMESH_API VoidOrErrStr compressZipParallel( const std::filesystem::path & zipFile, const std::filesystem::path & sourceFolder,
+    int compressionLevel = -1, ProgressCallback cb = {} );
+
+/// \}
+
+} // namespace MR
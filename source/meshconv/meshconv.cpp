@@ -1,6 +1,8 @@
 #include "MRMesh/MRMesh.h"
 #include "MRMesh/MRMeshLoad.h"
 #include "MRMesh/MRMeshSave.h"
+#include "MRMesh/MRStlStream.h"
+#include "MRMesh/MRStringConvert.h"
 #include "MRMesh/MRMeshDecimate.h"
 #include "MRMesh/MRMeshBoolean.h"
 #include "MRMesh/MRConvexHull.h"
@@ -14,8 +16,72 @@
 #include <boost/program_options.hpp>
 #pragma warning(pop)
 #include <boost/exception/diagnostic_information.hpp>
+#include <cctype>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
+static bool isStl( const std::filesystem::path& path )
+{
+    auto ext = MR::utf8string( path.extension() );
+    for ( auto& c : ext )
+        c = (char)std::tolower( (unsigned char)c );
+    return ext == ".stl";
+}
+
+// returns true if the file starts with "solid" and is too short to hold the triangles declared in binary STL header
+static bool isAsciiStl( const std::filesystem::path& path )
+{
+    std::ifstream in( path, std::ifstream::binary );
+    char header[84] = {};
+    if ( !in.read( header, 84 ) )
+        return std::strncmp( header, "solid", 5 ) == 0;
+    if ( std::strncmp( header, "solid", 5 ) != 0 )
+        return false;
+    std::uint32_t numTris = 0;
+    std::memcpy( &numTris, header + 80, 4 );
+    std::error_code ec;
+    const auto fileSize = std::filesystem::file_size( path, ec );
+    return !ec && fileSize < 84 + 50 * std::uintmax_t( numTris );
+}
+
+// copies all triangles from binary STL to binary STL without constructing the mesh
+static int copyStlTriangles( MR::StlTriangleReader& reader, const std::filesystem::path& outFilePath )
+{
+    auto writer = MR::StlTriangleWriter::open( outFilePath, reader.portionSize() );
+    if ( !writer.has_value() )
+    {
+        std::cerr << "Mesh save error: " << writer.error() << "\n";
+        return 1;
+    }
+    std::vector<MR::Triangle3f> portion;
+    for ( ;; )
+    {
+        auto readRes = reader.read( portion );
+        if ( !readRes.has_value() )
+        {
+            std::cerr << "Mesh load error: " << readRes.error() << "\n";
+            return 1;
+        }
+        if ( portion.empty() )
+            break;
+        auto writeRes = writer->write( portion );
+        if ( !writeRes.has_value() )
+        {
+            std::cerr << "Mesh save error: " << writeRes.error() << "\n";
+            return 1;
+        }
+    }
+    auto finishRes = writer->finish();
+    if ( !finishRes.has_value() )
+    {
+        std::cerr << "Mesh save error: " << finishRes.error() << "\n";
+        return 1;
+    }
+    std::cout << writer->numWritten() << " triangles copied successfully\n";
+    return 0;
+}
+
 bool doCommand( const boost::program_options::option& option, MR::Mesh& mesh )
 {
     namespace po = boost::program_options;
@@ -85,6 +151,11 @@ static int mainInternal( int argc, char **argv )
         ("timings", "print performance timings in the end")
         ("input-file", po::value<std::filesystem::path>( &inFilePath ), "filename of input mesh")
         ("output-file", po::value<std::filesystem::path>( &outFilePath ), "filename of output mesh")
+        ("stream", po::value<size_t>()->implicit_value( MR::StlTriangleReader::DefaultPortionSize ),
+            "read binary STL input by portions of given number of triangles; "
+            "if the output is STL too and there are no commands, the triangles are copied without constructing the mesh; "
+            "ASCII STL input is not supported and is loaded entirely as without this option")
+        ("no-weld", "together with --stream, do not merge the vertices with equal coordinates")
         ;
 
     po::options_description commands( "Commands" );
@@ -145,7 +216,27 @@ static int mainInternal( int argc, char **argv )
 
     std::cout << "Loading " << inFilePath << "..." << std::endl;
     MR::Timer t("LoadMesh");
-    auto loadRes = MR::MeshLoad::fromAnySupportedFormat( inFilePath );
+    MR::Expected<MR::Mesh, std::string> loadRes;
+    bool stream = vm.count( "stream" ) && isStl( inFilePath );
+    if ( stream && isAsciiStl( inFilePath ) )
+    {
+        std::cout << "--stream supports only binary STL, loading ASCII STL entirely" << std::endl;
+        stream = false;
+    }
+    if ( stream )
+    {
+        auto reader = MR::StlTriangleReader::open( inFilePath, vm["stream"].as<size_t>() );
+        if ( !reader.has_value() )
+        {
+            std::cerr << "Mesh load error: " << reader.error() << "\n";
+            return 1;
+        }
+        if ( parsedCommands.options.empty() && isStl( outFilePath ) )
+            return copyStlTriangles( *reader, outFilePath );
+        loadRes = MR::readMesh( *reader, !vm.count( "no-weld" ) );
+    }
+    else
+        loadRes = MR::MeshLoad::fromAnySupportedFormat( inFilePath );
     if ( !loadRes.has_value() )
     {
         std::cerr << "Mesh load error: " << loadRes.error() << "\n";
@@ -81,7 +81,10 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, BooleanExposing, [] ( pybind11::module_& m )
         def_readwrite( "nestedComponentsMode", &MR::UniteManyMeshesParams::nestedComponentsMode,
             "By default function separate nested meshes and remove them, just like union operation should do\n"
             "read comment of NestedComponenetsMode enum for more information" ).
-        def_readwrite( "newFaces", &MR::UniteManyMeshesParams::newFaces, "If set, the bitset will store new faces created by boolean operations" );
+        def_readwrite( "newFaces", &MR::UniteManyMeshesParams::newFaces, "If set, the bitset will store new faces created by boolean operations" ).
+        def_readwrite( "treeReduction", &MR::UniteManyMeshesParams::treeReduction,
+            "If true, the meshes are united pairwise in a balanced tree with spatially close meshes in neighbor leaves,\n"
+            "independent unions are performed in parallel; much faster for many meshes intersecting only few others" );
 
     m.def( "uniteManyMeshes", MR::decorateExpected( &MR::uniteManyMeshes ), pybind11::arg( "meshes" ), pybind11::arg_v( "params", MR::UniteManyMeshesParams(), "UniteManyMeshesParams()" ),
         "Computes the surface of objects' union each of which is defined by its own surface mesh\n"
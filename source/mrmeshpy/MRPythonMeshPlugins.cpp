@@ -418,6 +418,13 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, MeshOffset, [] ( pybind11::module_& m )
             "correct positions of the input vertices using reference mesh by not more than this distance, measured in voxelSize;\n"
             "big correction can be wrong and result from self-intersections in the reference mesh" );
 
+    pybind11::class_<MR::AdaptiveOffsetParameters, MR::OffsetParameters>( m, "AdaptiveOffsetParameters" ).
+        def( pybind11::init<>() ).
+        def_readwrite( "maxDeviation", &MR::AdaptiveOffsetParameters::maxDeviation, "maximal allowed distance from the points of result mesh to exact offset surface, measured in voxelSize" ).
+        def_readwrite( "maxRefinementLevels", &MR::AdaptiveOffsetParameters::maxRefinementLevels,
+            "how many times the voxels of local grids and the edges of Marching Cubes mesh can be halved during refinement,\n"
+            "so the smallest voxels and the shortest refined edges are about voxelSize / 2^maxRefinementLevels" );
+
     pybind11::enum_<MR::GeneralOffsetParameters::Mode>( m, "GeneralOffsetParametersMode" ).
         value( "Smooth", MR::GeneralOffsetParameters::Mode::Smooth, "create mesh using dual marching cubes from OpenVDB library" ).
         value( "Standard", MR::GeneralOffsetParameters::Mode::Standard, "create mesh using standard marching cubes implemented in MeshLib" ).
@@ -439,6 +446,17 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, MeshOffset, [] ( pybind11::module_& m )
         pybind11::arg( "mp" ), pybind11::arg( "offset" ), pybind11::arg_v( "params", MR::GeneralOffsetParameters(), "GeneralOffsetParameters()" ),
         "Offsets mesh by converting it to voxels and back using one of three modes specified in the parameters" );
 
+    m.def( "adaptiveOffsetMesh",
+        MR::decorateExpected( [] ( const MR::MeshPart& mp, float offset, MR::AdaptiveOffsetParameters params )
+    {
+        if ( params.voxelSize <= 0 )
+            params.voxelSize = suggestVoxelSize( mp, 5e6f );
+        return MR::adaptiveOffsetMesh( mp, offset, params );
+    } ),
+        pybind11::arg( "mp" ), pybind11::arg( "offset" ), pybind11::arg_v( "params", MR::AdaptiveOffsetParameters(), "AdaptiveOffsetParameters()" ),
+        "Offsets mesh by converting it to coarse voxels and back, recomputes it on finer local grids where coarse voxels lost thin walls or small components,\n"
+        "and then refines the result only where it deviates from exact offset surface" );
+
     m.def( "offsetMesh",
         MR::decorateExpected( []( const MR::MeshPart & mp, float offset, MR::OffsetParameters params )
             {